@@ -22,6 +22,22 @@ SOURCES += \
     Lab3/storagewindow.cpp \
     Lab4/camerawindow.cpp \
     Lab4/cameraworker.cpp \
+    Lab4/cameragroup.cpp \
+    Lab4/framepool.cpp \
+    Lab4/videoframe.cpp \
+    Lab4/pixelconvert.cpp \
+    Lab4/aviwriter.cpp \
+    Lab4/filewriter.cpp \
+    Lab4/videorecorder.cpp \
+    Lab4/prerollbuffer.cpp \
+    Lab4/timelapsefilter.cpp \
+    Lab4/motiondetector.cpp \
+    Lab4/pipelinestats.cpp \
+    Lab4/framesource.cpp \
+    Lab4/pacedframesource.cpp \
+    Lab4/syntheticsource.cpp \
+    Lab4/replaysource.cpp \
+    Lab4/avireader.cpp \
     Lab4/jakecamerawarning.cpp \
     Lab4/lab4_logger.cpp \
     Lab5/usbdevice.cpp \
@@ -34,7 +50,9 @@ SOURCES += \
     Lab6/bluetoothconnection.cpp \
     Lab6/bluetoothreceiver.cpp \
     Lab6/obexfilesender.cpp \
+    Lab6/obexframeparser.cpp \
     Lab6/bluetoothserver.cpp \
+    Lab6/bytetransport.cpp \
     Animation/jakewidget.cpp
 
 HEADERS += \
@@ -45,6 +63,22 @@ HEADERS += \
     Lab3/storagewindow.h \
     Lab4/camerawindow.h \
     Lab4/cameraworker.h \
+    Lab4/cameragroup.h \
+    Lab4/framepool.h \
+    Lab4/videoframe.h \
+    Lab4/pixelconvert.h \
+    Lab4/aviwriter.h \
+    Lab4/filewriter.h \
+    Lab4/videorecorder.h \
+    Lab4/prerollbuffer.h \
+    Lab4/timelapsefilter.h \
+    Lab4/motiondetector.h \
+    Lab4/pipelinestats.h \
+    Lab4/framesource.h \
+    Lab4/pacedframesource.h \
+    Lab4/syntheticsource.h \
+    Lab4/replaysource.h \
+    Lab4/avireader.h \
     Lab4/jakecamerawarning.h \
     Lab4/lab4_logger.h \
     Lab5/usbdevice.h \
@@ -57,7 +91,9 @@ HEADERS += \
     Lab6/bluetoothconnection.h \
     Lab6/bluetoothreceiver.h \
     Lab6/obexfilesender.h \
+    Lab6/obexframeparser.h \
     Lab6/bluetoothserver.h \
+    Lab6/bytetransport.h \
     Animation/jakewidget.h
 
 FORMS += \
@@ -71,6 +107,16 @@ RESOURCES += \
 # Lab4 использует DirectShow API (Windows нативный API)
 # Низкоуровневый доступ к камере без высокоуровневых библиотек
 # Qt Multimedia НЕ используется!
+# На Linux камера подключается через V4L2; для работы без камеры есть
+# синтетический источник и воспроизведение AVI (LAB4_CAMERA_SOURCE)
+win32 {
+    SOURCES += Lab4/dshowsource.cpp
+    HEADERS += Lab4/dshowsource.h
+}
+linux {
+    SOURCES += Lab4/v4l2source.cpp
+    HEADERS += Lab4/v4l2source.h
+}
 
 # Lab5 использует Windows API для мониторинга USB-устройств
 # Библиотеки: setupapi.lib, Cfgmgr32.lib
@@ -78,4 +124,12 @@ RESOURCES += \
 # Lab6 использует Windows Bluetooth API (Native Windows API)
 # Библиотеки: Bthprops.lib, ws2_32.lib
 
-win32: LIBS += -luser32 -lpowrprof -ladvapi32 -lsetupapi -lole32 -loleaut32 -lwbemuuid -lstrmiids -lvfw32 -lCfgmgr32 -lBthprops -lws2_32
+win32: LIBS += -luser32 -lpowrprof -ladvapi32 -lsetupapi -lole32 -loleaut32 -lwbemuuid -lstrmiids -lCfgmgr32 -lBthprops -lws2_32
+
+# make bench: сборка и запуск бенчмарка конвейера камеры (Lab4/camera_bench.pro).
+# Результат (JSON) - camera_bench.json в каталоге сборки, для сравнения между коммитами
+bench.commands = \
+    $(QMAKE) $$shell_path($$PWD/Lab4/camera_bench.pro) -o Makefile.camera_bench && \
+    $(MAKE) -f Makefile.camera_bench && \
+    $$shell_path($$OUT_PWD/camera_bench) --cameras 4 --json camera_bench.json
+QMAKE_EXTRA_TARGETS += bench
@@ -0,0 +1,247 @@
+#include "avireader.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// Глубина вложенности списков (RIFF > LIST movi > LIST rec)
+static const int AVI_MAX_LIST_DEPTH = 4;
+
+static unsigned int readU32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<unsigned int>(p[3]) << 24);
+}
+
+static unsigned short readU16(const unsigned char *p)
+{
+    return static_cast<unsigned short>(p[0] | (p[1] << 8));
+}
+
+static bool isFourcc(const unsigned char *p, const char *code)
+{
+    return std::memcmp(p, code, 4) == 0;
+}
+
+AviReader::AviReader()
+    : m_file(nullptr),
+      m_fileSize(0),
+      m_width(0),
+      m_height(0),
+      m_bottomUp(true),
+      m_fps(30),
+      m_codec(CodecUnknown),
+      m_videoStream(false)
+{
+}
+
+AviReader::~AviReader()
+{
+    close();
+}
+
+bool AviReader::open(const std::string &path)
+{
+    close();
+    m_error.clear();
+    m_width = 0;
+    m_height = 0;
+    m_bottomUp = true;
+    m_fps = 30;
+    m_codec = CodecUnknown;
+    m_videoStream = false;
+
+#ifdef _WIN32
+    int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+    std::vector<wchar_t> wpath(len > 0 ? len : 1, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wpath.data(), len);
+    m_file = _wfopen(wpath.data(), L"rb");
+#else
+    m_file = std::fopen(path.c_str(), "rb");
+#endif
+    if (!m_file) {
+        return fail("cannot open file " + path);
+    }
+
+#ifdef _WIN32
+    _fseeki64(m_file, 0, SEEK_END);
+    m_fileSize = static_cast<unsigned long long>(_ftelli64(m_file));
+#else
+    fseeko(m_file, 0, SEEK_END);
+    m_fileSize = static_cast<unsigned long long>(ftello(m_file));
+#endif
+
+    // Файл - последовательность RIFF: 'AVI ' и (для больших файлов) 'AVIX'
+    unsigned long long position = 0;
+    while (position + 12 <= m_fileSize) {
+        unsigned char header[12];
+        if (!seek(position) || std::fread(header, 1, 12, m_file) != 12) {
+            break;
+        }
+        if (!isFourcc(header, "RIFF") ||
+            (!isFourcc(header + 8, "AVI ") && !isFourcc(header + 8, "AVIX"))) {
+            if (position == 0) {
+                close();
+                return fail("not an AVI file");
+            }
+            break;
+        }
+        unsigned long long end = position + 8 + readU32(header + 4);
+        if (end > m_fileSize) {
+            // Запись прервана: размер RIFF не дописан
+            end = m_fileSize;
+        }
+        if (!parseList(position + 12, end, 1)) {
+            break;
+        }
+        position = end + (end & 1);
+    }
+
+    if (m_codec == CodecUnknown || m_width <= 0 || m_height <= 0) {
+        close();
+        return fail("unsupported video stream (expected BI_RGB 24 bit or MJPG)");
+    }
+    if (m_frames.empty()) {
+        close();
+        return fail("no video frames");
+    }
+    return true;
+}
+
+void AviReader::close()
+{
+    if (m_file) {
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+    m_frames.clear();
+}
+
+bool AviReader::parseList(unsigned long long start, unsigned long long end, int depth)
+{
+    unsigned long long position = start;
+    while (position + 8 <= end) {
+        unsigned char header[12];
+        if (!seek(position) || std::fread(header, 1, 8, m_file) != 8) {
+            return false;
+        }
+        const unsigned int size = readU32(header + 4);
+        const unsigned long long dataStart = position + 8;
+        unsigned long long dataEnd = dataStart + size;
+        if (dataEnd > end) {
+            // Последний кадр обрезан - его не используем
+            if (!isFourcc(header, "LIST")) {
+                return true;
+            }
+            dataEnd = end;
+        }
+
+        if (isFourcc(header, "LIST")) {
+            if (std::fread(header + 8, 1, 4, m_file) != 4) {
+                return false;
+            }
+            if (isFourcc(header + 8, "strl")) {
+                m_videoStream = false;
+            }
+            if (depth < AVI_MAX_LIST_DEPTH && !parseList(dataStart + 4, dataEnd, depth + 1)) {
+                return false;
+            }
+        } else if (isFourcc(header, "strh") || isFourcc(header, "strf")) {
+            std::vector<unsigned char> data(size);
+            if (size > 0 && std::fread(data.data(), 1, size, m_file) != size) {
+                return false;
+            }
+            if (isFourcc(header, "strh")) {
+                parseStreamHeader(data.data(), size);
+            } else if (m_videoStream) {
+                parseStreamFormat(data.data(), size);
+            }
+        } else if (header[0] == '0' && header[1] == '0' &&
+                   (header[2] == 'd') && (header[3] == 'b' || header[3] == 'c')) {
+            // Кадр первого потока; пустые чанки - пропущенные кадры
+            if (size > 0) {
+                FrameEntry entry;
+                entry.offset = dataStart;
+                entry.size = size;
+                m_frames.push_back(entry);
+            }
+        }
+
+        position = dataEnd + (dataEnd & 1);
+    }
+    return true;
+}
+
+void AviReader::parseStreamHeader(const unsigned char *data, unsigned int size)
+{
+    if (size < 28) {
+        return;
+    }
+    m_videoStream = isFourcc(data, "vids");
+    if (m_videoStream) {
+        const unsigned int scale = readU32(data + 20);
+        const unsigned int rate = readU32(data + 24);
+        if (scale > 0 && rate > 0) {
+            m_fps = static_cast<int>((rate + scale / 2) / scale);
+            if (m_fps <= 0) {
+                m_fps = 1;
+            }
+        }
+    }
+}
+
+void AviReader::parseStreamFormat(const unsigned char *data, unsigned int size)
+{
+    // BITMAPINFOHEADER
+    if (size < 40) {
+        return;
+    }
+    const int width = static_cast<int>(readU32(data + 4));
+    const int height = static_cast<int>(readU32(data + 8));
+    const unsigned short bitCount = readU16(data + 14);
+
+    m_width = width;
+    m_height = height < 0 ? -height : height;
+    m_bottomUp = height > 0;
+
+    if (isFourcc(data + 16, "MJPG")) {
+        m_codec = CodecMJPEG;
+    } else if (readU32(data + 16) == 0 && bitCount == 24) {
+        m_codec = CodecRGB24;
+    } else {
+        m_codec = CodecUnknown;
+    }
+}
+
+bool AviReader::readFrame(unsigned int index, std::vector<char> &data)
+{
+    if (!m_file) {
+        return fail("file is not open");
+    }
+    if (index >= m_frames.size()) {
+        return fail("frame index out of range");
+    }
+
+    const FrameEntry &entry = m_frames[index];
+    data.resize(entry.size);
+    if (!seek(entry.offset) || std::fread(data.data(), 1, entry.size, m_file) != entry.size) {
+        return fail("read failed");
+    }
+    return true;
+}
+
+bool AviReader::seek(unsigned long long position)
+{
+#ifdef _WIN32
+    return _fseeki64(m_file, static_cast<long long>(position), SEEK_SET) == 0;
+#else
+    return fseeko(m_file, static_cast<off_t>(position), SEEK_SET) == 0;
+#endif
+}
+
+bool AviReader::fail(const std::string &error)
+{
+    m_error = error;
+    return false;
+}
@@ -0,0 +1,67 @@
+#ifndef AVIREADER_H
+#define AVIREADER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Чтение видеопотока AVI, записанного AviWriter (BI_RGB или MJPEG).
+// Кадры находятся обходом списков movi (индекс idx1 не нужен), поэтому
+// читаются и файлы, запись которых была прервана.
+// Переносимый C++ без Qt/WinAPI (на Windows - _wfopen для путей в Unicode).
+class AviReader
+{
+public:
+    enum Codec {
+        CodecRGB24,     // BGR24 bottom-up, строки выровнены на 4 байта
+        CodecMJPEG,
+        CodecUnknown
+    };
+
+    AviReader();
+    ~AviReader();
+
+    // path - UTF-8
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return m_file != nullptr; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    bool bottomUp() const { return m_bottomUp; }
+    int fps() const { return m_fps; }
+    Codec codec() const { return m_codec; }
+    unsigned int frameCount() const { return static_cast<unsigned int>(m_frames.size()); }
+    const std::string &lastError() const { return m_error; }
+
+    // Чтение кадра index в data (буфер переиспользуется)
+    bool readFrame(unsigned int index, std::vector<char> &data);
+
+private:
+    struct FrameEntry
+    {
+        unsigned long long offset;  // начало данных кадра в файле
+        unsigned int size;
+    };
+
+    bool parseList(unsigned long long start, unsigned long long end, int depth);
+    void parseStreamHeader(const unsigned char *data, unsigned int size);
+    void parseStreamFormat(const unsigned char *data, unsigned int size);
+    bool seek(unsigned long long position);
+    bool fail(const std::string &error);
+
+    std::FILE *m_file;
+    std::string m_error;
+    unsigned long long m_fileSize;
+
+    int m_width;
+    int m_height;
+    bool m_bottomUp;
+    int m_fps;
+    Codec m_codec;
+    bool m_videoStream;     // разбирается strl видеопотока
+
+    std::vector<FrameEntry> m_frames;
+};
+
+#endif // AVIREADER_H
@@ -0,0 +1,481 @@
+#include "aviwriter.h"
+
+#include <cstring>
+
+// Флаги AVI
+static const unsigned int AVIF_HASINDEX  = 0x00000010;
+static const unsigned int AVIIF_KEYFRAME = 0x00000010;
+
+// Типы индексов OpenDML
+static const unsigned char AVI_INDEX_OF_INDEXES = 0x00;
+static const unsigned char AVI_INDEX_OF_CHUNKS  = 0x01;
+
+// Размеры чанков заголовка (без 8 байт fourcc и размера)
+static const unsigned int AVIH_SIZE = 56;
+static const unsigned int STRH_SIZE = 56;
+static const unsigned int STRF_SIZE = 40;
+static const unsigned int DMLH_SIZE = 248;
+static const unsigned int INDX_SIZE = 24 + 16 * AviWriter::SUPER_INDEX_ENTRIES;
+
+namespace {
+
+// Буфер для сборки заголовков в little-endian
+class ByteWriter
+{
+public:
+    void fourcc(const char *code) { m_data.insert(m_data.end(), code, code + 4); }
+    void u8(unsigned char v) { m_data.push_back(static_cast<char>(v)); }
+    void u16(unsigned short v)
+    {
+        m_data.push_back(static_cast<char>(v & 0xFF));
+        m_data.push_back(static_cast<char>((v >> 8) & 0xFF));
+    }
+    void u32(unsigned int v)
+    {
+        for (int i = 0; i < 4; ++i) {
+            m_data.push_back(static_cast<char>((v >> (8 * i)) & 0xFF));
+        }
+    }
+    void u64(unsigned long long v)
+    {
+        u32(static_cast<unsigned int>(v & 0xFFFFFFFFULL));
+        u32(static_cast<unsigned int>(v >> 32));
+    }
+    void zeros(size_t count) { m_data.insert(m_data.end(), count, '\0'); }
+    size_t size() const { return m_data.size(); }
+    const char *data() const { return m_data.data(); }
+
+private:
+    std::vector<char> m_data;
+};
+
+// Размер чанка ix00 на count кадров (с заголовком)
+unsigned long long indexChunkSize(size_t count)
+{
+    return 8 + 24 + 8ULL * count;
+}
+
+} // namespace
+
+AviWriter::AviWriter()
+    : m_width(0),
+      m_height(0),
+      m_fps(30),
+      m_codec(CodecRGB24),
+      m_chunkId("00db"),
+      m_indexInterval(0),
+      m_frameCount(0),
+      m_maxFrameSize(0),
+      m_fileSize(0),
+      m_totalFramesPos(0),
+      m_suggestedBufferPos(0),
+      m_streamLengthPos(0),
+      m_streamBufferPos(0),
+      m_superIndexPos(0),
+      m_odmlFramesPos(0),
+      m_superIndexUsed(0),
+      m_riffStart(0),
+      m_moviListStart(0),
+      m_moviStart(0),
+      m_extended(false),
+      m_firstRiffFrames(0)
+{
+}
+
+AviWriter::~AviWriter()
+{
+    if (m_file.isOpen()) {
+        close();
+    }
+}
+
+bool AviWriter::open(const std::string &path, int width, int height, int fps, Codec codec)
+{
+    if (m_file.isOpen()) {
+        close();
+    }
+
+    m_error.clear();
+    m_width = width;
+    m_height = height;
+    m_fps = fps > 0 ? fps : 30;
+    m_codec = codec;
+    // 00db - несжатые кадры, 00dc - сжатые
+    m_chunkId = codec == CodecMJPEG ? "00dc" : "00db";
+    m_frameCount = 0;
+    m_maxFrameSize = 0;
+    m_fileSize = 0;
+    m_superIndexUsed = 0;
+    m_riffStart = 0;
+    m_extended = false;
+    m_firstRiffFrames = 0;
+    m_index.clear();
+    m_pending.clear();
+
+    if (width <= 0 || height <= 0) {
+        return fail("invalid frame size");
+    }
+
+    // Несжатое видео сразу получает резерв на секунду записи, MJPEG -
+    // шагами FileWriter по мере роста
+    const unsigned long long reserve = codec == CodecRGB24
+        ? static_cast<unsigned long long>(rgb24Stride(width)) * height * m_fps : 0;
+    if (!m_file.open(path, reserve)) {
+        return fail(m_file.lastError());
+    }
+
+    if (!writeHeaders()) {
+        m_file.close();
+        return false;
+    }
+
+    return true;
+}
+
+bool AviWriter::writeHeaders()
+{
+    // Для MJPEG это верхняя оценка; точное значение дописывается по ходу записи
+    const unsigned int frameSize = static_cast<unsigned int>(rgb24Stride(m_width)) * m_height;
+    const unsigned int strlSize = 4 + 8 + STRH_SIZE + 8 + STRF_SIZE + 8 + INDX_SIZE;
+    const unsigned int odmlSize = 4 + 8 + DMLH_SIZE;
+
+    ByteWriter h;
+    h.fourcc("RIFF");
+    h.u32(0);                               // размер RIFF (updateHeaders)
+    h.fourcc("AVI ");
+
+    h.fourcc("LIST");
+    h.u32(4 + 8 + AVIH_SIZE + 8 + strlSize + 8 + odmlSize);
+    h.fourcc("hdrl");
+
+    // MainAVIHeader
+    h.fourcc("avih");
+    h.u32(AVIH_SIZE);
+    h.u32(1000000 / m_fps);                 // dwMicroSecPerFrame
+    h.u32(frameSize * m_fps);               // dwMaxBytesPerSec
+    h.u32(0);                               // dwPaddingGranularity
+    h.u32(AVIF_HASINDEX);                   // dwFlags
+    m_totalFramesPos = h.size();
+    h.u32(0);                               // dwTotalFrames: кадры первого RIFF
+    h.u32(0);                               // dwInitialFrames
+    h.u32(1);                               // dwStreams
+    m_suggestedBufferPos = h.size();
+    h.u32(frameSize);                       // dwSuggestedBufferSize
+    h.u32(m_width);
+    h.u32(m_height);
+    for (int i = 0; i < 4; ++i) {
+        h.u32(0);                           // dwReserved
+    }
+
+    h.fourcc("LIST");
+    h.u32(strlSize);
+    h.fourcc("strl");
+
+    // AVIStreamHeader
+    h.fourcc("strh");
+    h.u32(STRH_SIZE);
+    h.fourcc("vids");
+    if (m_codec == CodecMJPEG) {
+        h.fourcc("MJPG");                   // fccHandler
+    } else {
+        h.u32(0);                           // fccHandler: BI_RGB
+    }
+    h.u32(0);                               // dwFlags
+    h.u16(0);                               // wPriority
+    h.u16(0);                               // wLanguage
+    h.u32(0);                               // dwInitialFrames
+    h.u32(1);                               // dwScale
+    h.u32(m_fps);                           // dwRate
+    h.u32(0);                               // dwStart
+    m_streamLengthPos = h.size();
+    h.u32(0);                               // dwLength: все кадры
+    m_streamBufferPos = h.size();
+    h.u32(frameSize);                       // dwSuggestedBufferSize
+    h.u32(0xFFFFFFFF);                      // dwQuality
+    h.u32(0);                               // dwSampleSize
+    h.u16(0);
+    h.u16(0);
+    h.u16(static_cast<unsigned short>(m_width));
+    h.u16(static_cast<unsigned short>(m_height));
+
+    // BITMAPINFOHEADER
+    h.fourcc("strf");
+    h.u32(STRF_SIZE);
+    h.u32(40);
+    h.u32(m_width);
+    h.u32(m_height);                        // положительная высота: bottom-up
+    h.u16(1);                               // biPlanes
+    h.u16(24);                              // biBitCount
+    if (m_codec == CodecMJPEG) {
+        h.fourcc("MJPG");                   // biCompression
+    } else {
+        h.u32(0);                           // biCompression: BI_RGB
+    }
+    h.u32(frameSize);
+    h.u32(0);
+    h.u32(0);
+    h.u32(0);
+    h.u32(0);
+
+    // Индекс индексов (AVISUPERINDEX): место под все порции сразу
+    m_superIndexPos = h.size();
+    h.fourcc("indx");
+    h.u32(INDX_SIZE);
+    h.u16(4);                               // wLongsPerEntry
+    h.u8(0);                                // bIndexSubType
+    h.u8(AVI_INDEX_OF_INDEXES);             // bIndexType
+    h.u32(0);                               // nEntriesInUse
+    h.fourcc(m_chunkId);                    // dwChunkId
+    h.zeros(12 + 16 * SUPER_INDEX_ENTRIES); // dwReserved[3], aIndex[]
+
+    // Расширенный заголовок OpenDML
+    h.fourcc("LIST");
+    h.u32(odmlSize);
+    h.fourcc("odml");
+    h.fourcc("dmlh");
+    h.u32(DMLH_SIZE);
+    m_odmlFramesPos = h.size();
+    h.u32(0);                               // dwTotalFrames: все кадры
+    h.zeros(DMLH_SIZE - 4);
+
+    m_moviListStart = h.size();
+    h.fourcc("LIST");
+    h.u32(0);                               // размер movi (updateHeaders)
+    m_moviStart = h.size();
+    h.fourcc("movi");
+
+    return writeBytes(h.data(), h.size()) && updateHeaders();
+}
+
+bool AviWriter::writeFrame(const void *data, unsigned int size)
+{
+    if (!m_file.isOpen()) {
+        return fail("file is not open");
+    }
+
+    // Кадр, его порция индекса и (в первом RIFF) idx1 должны поместиться в RIFF
+    const unsigned long long padded = size + (size & 1);
+    unsigned long long riffSize = m_fileSize - m_riffStart + 8 + padded +
+                                  indexChunkSize(m_pending.size() + 1);
+    if (!m_extended) {
+        riffSize += 8 + 16ULL * (m_index.size() + 1);
+    }
+    if (riffSize > RIFF_MAX_SIZE && m_fileSize > m_moviStart + 4 && !startRiff()) {
+        return false;
+    }
+
+    const unsigned long long chunkStart = m_fileSize;
+    ByteWriter chunk;
+    chunk.fourcc(m_chunkId);
+    chunk.u32(size);
+    if (!writeBytes(chunk.data(), chunk.size()) || !writeBytes(data, size)) {
+        return false;
+    }
+    if (size & 1) {
+        const char pad = 0;
+        if (!writeBytes(&pad, 1)) {
+            return false;
+        }
+    }
+
+    if (!m_extended) {
+        IndexEntry entry;
+        entry.offset = static_cast<unsigned int>(chunkStart - m_moviStart);
+        entry.size = size;
+        m_index.push_back(entry);
+    }
+    PendingEntry pending;
+    pending.offset = chunkStart + 8;
+    pending.size = size;
+    m_pending.push_back(pending);
+
+    m_frameCount++;
+    if (size > m_maxFrameSize) {
+        m_maxFrameSize = size;
+    }
+
+    const size_t interval = static_cast<size_t>(m_indexInterval > 0 ? m_indexInterval : m_fps);
+    return m_pending.size() < interval || flushIndex();
+}
+
+bool AviWriter::flushIndex()
+{
+    if (m_pending.empty()) {
+        return true;
+    }
+    if (m_superIndexUsed >= SUPER_INDEX_ENTRIES) {
+        return fail("OpenDML index is full");
+    }
+
+    // Стандартный индекс (AVISTDINDEX): смещения данных кадров от начала
+    // RIFF (RIFF меньше 4 ГБ - смещения 32-битные)
+    ByteWriter index;
+    index.fourcc("ix00");
+    index.u32(static_cast<unsigned int>(indexChunkSize(m_pending.size()) - 8));
+    index.u16(2);                           // wLongsPerEntry
+    index.u8(0);                            // bIndexSubType
+    index.u8(AVI_INDEX_OF_CHUNKS);          // bIndexType
+    index.u32(static_cast<unsigned int>(m_pending.size()));
+    index.fourcc(m_chunkId);
+    index.u64(m_riffStart);                 // qwBaseOffset
+    index.u32(0);                           // dwReserved
+    for (size_t i = 0; i < m_pending.size(); ++i) {
+        // В MJPEG каждый кадр независим - все кадры ключевые (бит 31 = 0)
+        index.u32(static_cast<unsigned int>(m_pending[i].offset - m_riffStart));
+        index.u32(m_pending[i].size);
+    }
+
+    const unsigned long long indexStart = m_fileSize;
+    const unsigned int frames = static_cast<unsigned int>(m_pending.size());
+    if (!writeBytes(index.data(), index.size())) {
+        return false;
+    }
+    m_pending.clear();
+
+    // Сначала на диск кадры и порция индекса, затем ссылка на неё в
+    // заголовке: после сбоя заголовок не указывает на недописанные данные
+    if (!m_file.sync()) {
+        return fail(m_file.lastError());
+    }
+
+    ByteWriter entry;
+    entry.u64(indexStart);                  // qwOffset
+    entry.u32(static_cast<unsigned int>(index.size()));
+    entry.u32(frames);                      // dwDuration
+    if (!m_file.writeAt(m_superIndexPos + 32 + 16ULL * m_superIndexUsed, entry.data(), entry.size())) {
+        return fail("header update failed");
+    }
+    m_superIndexUsed++;
+
+    if (!patchU32(m_superIndexPos + 12, m_superIndexUsed) || !updateHeaders()) {
+        return false;
+    }
+    if (!m_file.sync()) {
+        return fail(m_file.lastError());
+    }
+    return true;
+}
+
+bool AviWriter::updateHeaders()
+{
+    // Размеры текущего RIFF и его movi (порции индекса - внутри movi)
+    bool ok = patchU32(m_riffStart + 4, static_cast<unsigned int>(m_fileSize - m_riffStart - 8)) &&
+              patchU32(m_moviListStart + 4, static_cast<unsigned int>(m_fileSize - m_moviListStart - 8));
+
+    ok = ok && patchU32(m_totalFramesPos, m_extended ? m_firstRiffFrames
+                                                     : static_cast<unsigned int>(m_index.size()));
+    ok = ok && patchU32(m_streamLengthPos, m_frameCount);
+    ok = ok && patchU32(m_odmlFramesPos, m_frameCount);
+    if (m_maxFrameSize > 0) {
+        ok = ok && patchU32(m_suggestedBufferPos, m_maxFrameSize);
+        ok = ok && patchU32(m_streamBufferPos, m_maxFrameSize);
+    }
+    return ok;
+}
+
+bool AviWriter::finishFirstRiff()
+{
+    // Индекс idx1 первого RIFF: смещения относительно fourcc 'movi'
+    const unsigned long long moviEnd = m_fileSize;
+    ByteWriter index;
+    index.fourcc("idx1");
+    index.u32(static_cast<unsigned int>(16 * m_index.size()));
+    for (size_t i = 0; i < m_index.size(); ++i) {
+        index.fourcc(m_chunkId);
+        index.u32(AVIIF_KEYFRAME);
+        index.u32(m_index[i].offset);
+        index.u32(m_index[i].size);
+    }
+    if (!writeBytes(index.data(), index.size())) {
+        return false;
+    }
+
+    m_firstRiffFrames = static_cast<unsigned int>(m_index.size());
+    m_index.clear();
+    m_extended = true;
+    return patchU32(m_moviListStart + 4, static_cast<unsigned int>(moviEnd - m_moviListStart - 8)) &&
+           patchU32(4, static_cast<unsigned int>(m_fileSize - 8)) &&
+           patchU32(m_totalFramesPos, m_firstRiffFrames);
+}
+
+bool AviWriter::startRiff()
+{
+    // Текущий RIFF закрывается со своей порцией индекса
+    if (!flushIndex() || !updateHeaders()) {
+        return false;
+    }
+    if (!m_extended && !finishFirstRiff()) {
+        return false;
+    }
+
+    // Продолжение: RIFF 'AVIX' с одним списком movi
+    m_riffStart = m_fileSize;
+    m_moviListStart = m_riffStart + 12;
+    m_moviStart = m_moviListStart + 8;
+    ByteWriter h;
+    h.fourcc("RIFF");
+    h.u32(4 + 12);
+    h.fourcc("AVIX");
+    h.fourcc("LIST");
+    h.u32(4);
+    h.fourcc("movi");
+    if (!writeBytes(h.data(), h.size())) {
+        return false;
+    }
+    if (!m_file.sync()) {
+        return fail(m_file.lastError());
+    }
+    return true;
+}
+
+bool AviWriter::close()
+{
+    if (!m_file.isOpen()) {
+        return false;
+    }
+
+    // Последняя порция индекса и idx1, если файл уместился в один RIFF
+    bool ok = flushIndex();
+    if (!m_extended) {
+        ok = finishFirstRiff() && ok;
+    } else {
+        ok = updateHeaders() && ok;
+    }
+
+    if (!m_file.close()) {
+        ok = fail(m_file.lastError());
+    }
+    m_index.clear();
+    m_pending.clear();
+    return ok;
+}
+
+bool AviWriter::writeBytes(const void *data, size_t size)
+{
+    if (size == 0) {
+        return true;
+    }
+    if (!m_file.write(data, size)) {
+        return fail(m_file.lastError());
+    }
+    m_fileSize += size;
+    return true;
+}
+
+bool AviWriter::patchU32(unsigned long long position, unsigned int value)
+{
+    unsigned char bytes[4];
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<unsigned char>((value >> (8 * i)) & 0xFF);
+    }
+    if (!m_file.writeAt(position, bytes, 4)) {
+        return fail("header update failed");
+    }
+    return true;
+}
+
+bool AviWriter::fail(const std::string &error)
+{
+    m_error = error;
+    return false;
+}
@@ -0,0 +1,115 @@
+#ifndef AVIWRITER_H
+#define AVIWRITER_H
+
+#include <string>
+#include <vector>
+#include "filewriter.h"
+
+// Потоковая запись AVI без Video for Windows в формате OpenDML (AVI 2.0).
+// Кадры дописываются в файл по мере поступления. Раз в indexInterval кадров
+// (по умолчанию - секунда видео) в список movi пишется порция индекса
+// (стандартный индекс ix00), ссылка на неё - в индекс индексов indx в
+// заголовке, размеры в заголовках обновляются и файл сбрасывается на
+// диск. Поэтому файл, запись которого прервана (сбой, завершение
+// процесса), читается до последней такой точки.
+// Файл делится на RIFF не больше RIFF_MAX_SIZE ('AVI ', затем 'AVIX'),
+// поэтому его размер не ограничен 2 ГБ; первый RIFF дополнительно несёт
+// индекс idx1 для проигрывателей AVI 1.0. Запись идёт через FileWriter
+// (резерв места, запись блоками). Переносимый C++ без Qt.
+class AviWriter
+{
+public:
+    enum Codec {
+        CodecRGB24,   // BI_RGB: BGR24 bottom-up, строки выровнены на 4 байта
+        CodecMJPEG    // MJPG: каждый кадр - отдельный JPEG
+    };
+
+    enum {
+        RIFF_MAX_SIZE = 1024 * 1024 * 1024,   // размер одного RIFF, байт
+        SUPER_INDEX_ENTRIES = 16384           // порций индекса (4.5 ч по секунде)
+    };
+
+    AviWriter();
+    ~AviWriter();
+
+    // path - UTF-8
+    bool open(const std::string &path, int width, int height, int fps, Codec codec = CodecRGB24);
+    bool writeFrame(const void *data, unsigned int size);
+    bool close();
+
+    // Кадров в порции индекса, т.е. сколько кадров может потеряться при
+    // сбое; 0 - секунда видео. Задаётся до open()
+    void setIndexInterval(int frames) { m_indexInterval = frames > 0 ? frames : 0; }
+
+    // Как часто данные сбрасываются на диск между порциями индекса
+    // (см. FileWriter), байт
+    void setSyncInterval(unsigned long long bytes) { m_file.setSyncInterval(bytes); }
+    int syncCount() const { return m_file.syncCount(); }
+
+    bool isOpen() const { return m_file.isOpen(); }
+    unsigned int frameCount() const { return m_frameCount; }
+    unsigned long long bytesWritten() const { return m_fileSize; }
+    const std::string &lastError() const { return m_error; }
+
+    // Размер строки кадра в байтах для BI_RGB 24 бит
+    static int rgb24Stride(int width) { return (width * 3 + 3) & ~3; }
+
+private:
+    // Кадр в idx1: смещение заголовка чанка от fourcc 'movi' первого RIFF
+    struct IndexEntry
+    {
+        unsigned int offset;
+        unsigned int size;
+    };
+
+    // Кадр ещё не записанной порции индекса: начало данных в файле
+    struct PendingEntry
+    {
+        unsigned long long offset;
+        unsigned int size;
+    };
+
+    bool writeBytes(const void *data, size_t size);
+    bool writeHeaders();
+    bool flushIndex();
+    bool updateHeaders();
+    bool finishFirstRiff();
+    bool startRiff();
+    bool patchU32(unsigned long long position, unsigned int value);
+    bool fail(const std::string &error);
+
+    FileWriter m_file;
+    std::string m_error;
+
+    int m_width;
+    int m_height;
+    int m_fps;
+    Codec m_codec;
+    const char *m_chunkId;
+    int m_indexInterval;
+    unsigned int m_frameCount;
+    unsigned int m_maxFrameSize;
+    unsigned long long m_fileSize;
+
+    // Позиции полей заголовка, которые обновляются по ходу записи
+    unsigned long long m_totalFramesPos;
+    unsigned long long m_suggestedBufferPos;
+    unsigned long long m_streamLengthPos;
+    unsigned long long m_streamBufferPos;
+    unsigned long long m_superIndexPos;
+    unsigned long long m_odmlFramesPos;
+    unsigned int m_superIndexUsed;
+
+    // Текущий RIFF: начало, начало LIST movi и fourcc 'movi'
+    unsigned long long m_riffStart;
+    unsigned long long m_moviListStart;
+    unsigned long long m_moviStart;
+    // Первый RIFF закрыт (idx1 записан), кадров в нём
+    bool m_extended;
+    unsigned int m_firstRiffFrames;
+
+    std::vector<IndexEntry> m_index;
+    std::vector<PendingEntry> m_pending;
+};
+
+#endif // AVIWRITER_H
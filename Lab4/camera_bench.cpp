@@ -0,0 +1,546 @@
+// Бенчмарк конвейера камеры без окна и без камеры.
+// Синтетический источник (SyntheticSource, без ограничения частоты) отдаёт
+// кадры 480p, 720p, 1080p и 4K; получатель проходит те же этапы, что и
+// CameraWorker с VideoRecorder: преобразование BGR24 -> RGB888 (или
+// копирование YUY2/NV12 как есть) в слот пула, уменьшение до превью 640x480,
+// детектор движения, сжатие JPEG и запись кадра в AVI (MJPEG).
+// Этапы выполняются последовательно в потоке источника, поэтому время
+// каждого этапа измеряется без влияния остальных потоков.
+//
+// Результат - JSON: кадры в секунду (всего и для каждого этапа), время
+// этапов (PipelineStats), выделения памяти на кадр и пиковый RSS процесса.
+// Сравнение JSON разных коммитов показывает регрессии.
+//
+// С --cameras N дополнительно проверяется масштабирование: N камер 720p
+// (CameraGroup, синтетические источники 30 кадр/с, общий пул сжатия)
+// одновременно пишут MJPEG; для каждой камеры выводятся записанные и
+// потерянные кадры.
+//
+// Запуск: camera_bench [--seconds N] [--sizes 480p,720p,1080p,4k] [--cameras N]
+//                      [--format BGR24|YUY2|NV12] [--json файл]
+
+#include "syntheticsource.h"
+#include "framepool.h"
+#include "videoframe.h"
+#include "pixelconvert.h"
+#include "pipelinestats.h"
+#include "aviwriter.h"
+#include "cameragroup.h"
+#include "cameraworker.h"
+#include "motiondetector.h"
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QTimer>
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QElapsedTimer>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QThread>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Счётчик выделений памяти.
+// С glibc перехватываются malloc/calloc/realloc (через них выделяют и Qt,
+// и operator new); на других платформах - только operator new.
+static std::atomic<long long> g_allocations(0);
+
+#if defined(__GLIBC__)
+#define CAMERA_BENCH_ALLOC_COUNTER "malloc"
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+// Спецификация исключений должна совпадать с объявлением в <stdlib.h>
+void *malloc(size_t size) __THROW
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) __THROW
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) __THROW
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+#define CAMERA_BENCH_ALLOC_COUNTER "operator new"
+void *operator new(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+#endif
+
+// Пиковый объём памяти процесса, КБ
+static qint64 peakRssKb()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return qint64(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef Q_OS_MAC
+    return usage.ru_maxrss / 1024;  // байты
+#else
+    return usage.ru_maxrss;         // КБ
+#endif
+#endif
+}
+
+// Строки RGB24 копируются без преобразования
+static void copyRgb24Row(const unsigned char *src, unsigned char *dst, int width)
+{
+    std::memcpy(dst, src, width * 3);
+}
+
+struct Resolution
+{
+    const char *name;
+    int width;
+    int height;
+};
+
+// Получатель кадров с этапами конвейера CameraWorker/VideoRecorder
+class BenchSink : public FrameSink
+{
+public:
+    BenchSink(PipelineStats *stats, const QString &aviPath)
+        : m_stats(stats), m_aviPath(aviPath), m_framePool(4), m_previewPool(2),
+          m_framePixelFormat(FrameFormat::FormatRGB24), m_yuv(false),
+          m_convertRow(nullptr), m_frames(0), m_failed(false)
+    {
+        m_jpegBuffer.setBuffer(&m_jpeg);
+        // Пороги как в CameraWorker
+        m_motion.configure(12, 2, 1000);
+    }
+
+    ~BenchSink()
+    {
+        m_writer.close();
+    }
+
+    void formatChanged(const FrameFormat &format) override
+    {
+        m_format = format;
+        // Как в CameraWorker: YUV копируется в слот как есть
+        m_yuv = format.pixelFormat == FrameFormat::FormatYUY2 ||
+                format.pixelFormat == FrameFormat::FormatNV12;
+        m_framePixelFormat = m_yuv ? format.pixelFormat : FrameFormat::FormatRGB24;
+        m_convertRow = format.pixelFormat == FrameFormat::FormatBGR24
+                     ? PixelConvert::swapRedBlue24Row() : copyRgb24Row;
+        const QSize bufferSize = VideoFrame::bufferSize(m_framePixelFormat, format.width, format.height);
+        m_framePool.configure(bufferSize.width(), bufferSize.height(),
+                              VideoFrame::bufferFormat(m_framePixelFormat));
+
+        m_previewSize = QSize(format.width, format.height).scaled(640, 480, Qt::KeepAspectRatio);
+        m_previewPool.configure(m_previewSize.width(), m_previewSize.height(), QImage::Format_RGB32);
+        m_scratch.resize(m_yuv ? PixelConvert::scaleYuvScratchSize(format.width, format.height,
+                                                                   m_previewSize.width(), m_previewSize.height())
+                               : PixelConvert::scaleScratchSize(format.width, format.height,
+                                                                m_previewSize.width(), m_previewSize.height()));
+
+        m_writer.close();
+        if (!m_writer.open(QFile::encodeName(m_aviPath).toStdString(), format.width, format.height,
+                           30, AviWriter::CodecMJPEG)) {
+            std::fprintf(stderr, "camera_bench: %s\n", m_writer.lastError().c_str());
+            m_failed = true;
+        }
+    }
+
+    void frameArrived(const RawFrame &raw) override
+    {
+        if (!m_convertRow || m_failed) {
+            return;
+        }
+        const qint64 arrivalUs = m_stats->nowUs();
+
+        const int slot = m_framePool.acquire();
+        if (slot < 0) {
+            m_failed = true;
+            return;
+        }
+        m_stats->recordSince(PipelineStats::StageAcquire, arrivalUs);
+
+        qint64 startUs = m_stats->nowUs();
+        uchar *dst = m_framePool.slotData(slot);
+        const int dstStride = m_framePool.bytesPerLine();
+        if (m_yuv) {
+            const QSize bufferSize = VideoFrame::bufferSize(m_framePixelFormat, m_format.width, m_format.height);
+            for (int y = 0; y < bufferSize.height(); ++y) {
+                std::memcpy(dst + y * dstStride, raw.data + y * m_format.stride, bufferSize.width());
+            }
+        } else {
+            PixelConvert::convertImage(m_convertRow, raw.data, m_format.stride, dst, dstStride,
+                                       m_format.width, m_format.height, m_format.bottomUp);
+        }
+        const VideoFrame frame(m_framePool.wrap(slot), m_framePixelFormat,
+                               m_format.width, m_format.height);
+        m_stats->recordSince(PipelineStats::StageConvert, startUs);
+
+        startUs = m_stats->nowUs();
+        const int previewSlot = m_previewPool.acquire();
+        if (previewSlot >= 0) {
+            uchar *preview = m_previewPool.slotData(previewSlot);
+            uchar *scratch = reinterpret_cast<uchar*>(m_scratch.data());
+            if (m_yuv) {
+                PixelConvert::scaleYuvToRgb32(m_framePixelFormat == FrameFormat::FormatYUY2
+                                                  ? PixelConvert::YuvYUY2 : PixelConvert::YuvNV12,
+                                              frame.constBits(), frame.bytesPerLine(),
+                                              frame.width(), frame.height(),
+                                              preview, m_previewPool.bytesPerLine(),
+                                              m_previewSize.width(), m_previewSize.height(), scratch);
+            } else {
+                PixelConvert::scaleRgb24ToRgb32(frame.constBits(), frame.bytesPerLine(),
+                                                frame.width(), frame.height(),
+                                                preview, m_previewPool.bytesPerLine(),
+                                                m_previewSize.width(), m_previewSize.height(), scratch);
+            }
+            m_previewPool.release(previewSlot);
+        }
+        m_stats->recordSince(PipelineStats::StageScale, startUs);
+
+        // Как в CameraWorker::detectMotion: плоскость яркости, без RGB
+        startUs = m_stats->nowUs();
+        m_motion.process(frame, arrivalUs);
+        m_stats->recordSince(PipelineStats::StageMotion, startUs);
+
+        // Как в VideoRecorder::EncodeTask (YUV переводится в RGB здесь)
+        startUs = m_stats->nowUs();
+        m_jpeg.clear();
+        m_jpegBuffer.open(QIODevice::WriteOnly);
+        const bool encoded = frame.toImage().save(&m_jpegBuffer, "JPG", 85);
+        m_jpegBuffer.close();
+        m_stats->recordSince(PipelineStats::StageEncode, startUs);
+        if (!encoded) {
+            m_failed = true;
+            return;
+        }
+
+        startUs = m_stats->nowUs();
+        if (!m_writer.writeFrame(m_jpeg.constData(), m_jpeg.size())) {
+            std::fprintf(stderr, "camera_bench: %s\n", m_writer.lastError().c_str());
+            m_failed = true;
+            return;
+        }
+        m_stats->recordSince(PipelineStats::StageWrite, startUs);
+        m_stats->recordSince(PipelineStats::StageEndToEnd, arrivalUs);
+        m_frames++;
+    }
+
+    // Читаются основным потоком во время работы источника
+    qint64 frames() const { return m_frames.load(); }
+    bool failed() const { return m_failed; }
+    qint64 fileBytes() const { return qint64(m_writer.bytesWritten()); }
+
+private:
+    PipelineStats *m_stats;
+    QString m_aviPath;
+    FrameFormat m_format;
+    FramePool m_framePool;
+    FramePool m_previewPool;
+    QSize m_previewSize;
+    QByteArray m_scratch;
+    FrameFormat::PixelFormat m_framePixelFormat;
+    bool m_yuv;
+    PixelConvert::RowFunc m_convertRow;
+    MotionDetector m_motion;
+    QByteArray m_jpeg;
+    QBuffer m_jpegBuffer;
+    AviWriter m_writer;
+    std::atomic<qint64> m_frames;
+    std::atomic<bool> m_failed;
+};
+
+static QJsonObject stageJson(const PipelineStats::StageSummary &stage)
+{
+    QJsonObject object;
+    object["count"] = double(stage.count);
+    object["mean_us"] = stage.meanUs;
+    object["p50_us"] = double(stage.p50Us);
+    object["p95_us"] = double(stage.p95Us);
+    object["p99_us"] = double(stage.p99Us);
+    object["max_us"] = double(stage.maxUs);
+    object["fps"] = stage.meanUs > 0 ? 1000000.0 / stage.meanUs : 0.0;
+    return object;
+}
+
+static QJsonObject runResolution(const Resolution &res, FrameFormat::PixelFormat pixelFormat,
+                                 double seconds)
+{
+    const QString aviPath = QDir::temp().filePath(QString("camera_bench_%1.avi").arg(res.name));
+    PipelineStats stats;
+    QJsonObject result;
+    result["resolution"] = res.name;
+    result["width"] = res.width;
+    result["height"] = res.height;
+    result["pixel_format"] = FrameFormat::pixelFormatName(pixelFormat);
+
+    {
+        BenchSink sink(&stats, aviPath);
+        SyntheticSource source(res.width, res.height, 30);
+        source.setMode(CaptureMode(0, 0, 0, pixelFormat));
+        source.setFreeRunning(true);
+        source.setSink(&sink);
+        if (!source.open() || !source.start()) {
+            result["error"] = source.lastError();
+            return result;
+        }
+
+        // Первые кадры (выделение слотов пула, загрузка JPEG-плагина) не считаются
+        while (sink.frames() < 3 && !sink.failed()) {
+            QThread::msleep(1);
+        }
+        stats.reset();
+        const qint64 framesBefore = sink.frames();
+        const long long allocationsBefore = g_allocations.load();
+        QElapsedTimer timer;
+        timer.start();
+
+        QThread::msleep(static_cast<unsigned long>(seconds * 1000));
+
+        source.stop();
+        const qint64 elapsedMs = qMax<qint64>(1, timer.elapsed());
+        const long long allocations = g_allocations.load() - allocationsBefore;
+        const qint64 frames = sink.frames() - framesBefore;
+        source.close();
+
+        const PipelineStats::Snapshot snapshot = stats.snapshot();
+        QJsonObject stages;
+        for (int i = 0; i < PipelineStats::StageCount; ++i) {
+            if (i == PipelineStats::StageDeliver) {
+                continue;   // окна нет
+            }
+            stages[PipelineStats::stageName(PipelineStats::Stage(i))] = stageJson(snapshot.stages[i]);
+        }
+
+        result["frames"] = double(frames);
+        result["seconds"] = elapsedMs / 1000.0;
+        result["fps"] = frames * 1000.0 / elapsedMs;
+        result["allocs_per_frame"] = frames > 0 ? double(allocations) / frames : 0.0;
+        result["avi_bytes_per_frame"] = sink.frames() > 0 ? double(sink.fileBytes()) / sink.frames() : 0.0;
+        result["peak_rss_kb"] = double(peakRssKb());
+        result["stages"] = stages;
+        if (sink.failed()) {
+            result["error"] = "pipeline failed";
+        }
+    }
+
+    QFile::remove(aviPath);
+    return result;
+}
+
+// Ожидание сигнала с ограничением по времени (события обрабатываются)
+template <typename Signal>
+static bool waitForSignal(CameraGroup *group, Signal signal, int timeoutMs)
+{
+    QEventLoop loop;
+    bool received = false;
+    QObject::connect(group, signal, &loop, [&loop, &received]() {
+        received = true;
+        loop.quit();
+    });
+    QTimer::singleShot(timeoutMs, &loop, &QEventLoop::quit);
+    loop.exec();
+    return received;
+}
+
+static QJsonObject runCameras(int cameras, const Resolution &res, FrameFormat::PixelFormat pixelFormat,
+                              double seconds)
+{
+    QJsonObject result;
+    result["cameras"] = cameras;
+    result["resolution"] = res.name;
+    result["target_fps"] = 30;
+
+    QDir outputDir(QDir::temp().filePath("camera_bench_cameras"));
+    outputDir.mkpath(".");
+
+    QStringList specs;
+    for (int i = 0; i < cameras; ++i) {
+        specs << QString("synthetic:%1x%2@30 %3").arg(res.width).arg(res.height)
+                                                  .arg(FrameFormat::pixelFormatName(pixelFormat));
+    }
+
+    {
+        CameraGroup group(specs);
+        group.setOutputDirectory(outputDir.absolutePath());
+        result["encoder_threads"] = group.encoderPool()->maxThreadCount();
+
+        // Запись идёт с общего времени начала (через SYNC_START_DELAY_MS)
+        const qint64 startUs = PipelineStats::nowUs() + qint64(CameraGroup::SYNC_START_DELAY_MS) * 1000;
+        group.startRecording();
+        if (!waitForSignal(&group, &CameraGroup::recordingStarted, 10000)) {
+            result["error"] = "recording did not start";
+            return result;
+        }
+
+        const qint64 remainingMs = (startUs - PipelineStats::nowUs()) / 1000 + qint64(seconds * 1000);
+        QEventLoop loop;
+        QTimer::singleShot(int(qMax<qint64>(0, remainingMs)), &loop, &QEventLoop::quit);
+        loop.exec();
+
+        const double recordedSeconds = (PipelineStats::nowUs() - startUs) / 1e6;
+        group.stopRecording();
+        if (!waitForSignal(&group, &CameraGroup::recordingStopped, 30000)) {
+            result["error"] = "recording did not stop";
+            return result;
+        }
+
+        QJsonArray perCamera;
+        double minFps = 0.0;
+        qint64 totalDropped = 0;
+        for (int i = 0; i < group.cameraCount(); ++i) {
+            CameraWorker *camera = group.camera(i);
+            const VideoRecorder::Stats stats = camera->videoStats();
+            const FrameSource::Counters counters = camera->captureCounters();
+            const double fps = stats.framesWritten / recordedSeconds;
+            minFps = i == 0 ? fps : qMin(minFps, fps);
+            totalDropped += stats.framesDropped + counters.dropped;
+
+            QJsonObject object;
+            object["frames_written"] = stats.framesWritten;
+            object["frames_dropped"] = stats.framesDropped;
+            object["source_dropped"] = double(counters.dropped);
+            object["fps"] = fps;
+            object["sustained_write_fps"] = stats.sustainedFps;
+            perCamera.append(object);
+        }
+        result["per_camera"] = perCamera;
+        result["min_fps"] = minFps;
+        result["dropped"] = double(totalDropped);
+        result["peak_rss_kb"] = double(peakRssKb());
+    }
+
+    outputDir.removeRecursively();
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    // Приложение нужно для поиска плагина JPEG
+    QCoreApplication app(argc, argv);
+
+    double seconds = 2.0;
+    QStringList sizes;
+    QString jsonPath;
+    int cameras = 0;
+    FrameFormat::PixelFormat pixelFormat = FrameFormat::FormatBGR24;
+    const QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i] == "--seconds" && i + 1 < args.size()) {
+            seconds = qMax(0.1, args[++i].toDouble());
+        } else if (args[i] == "--sizes" && i + 1 < args.size()) {
+            sizes = args[++i].toLower().split(',', QString::SkipEmptyParts);
+        } else if (args[i] == "--cameras" && i + 1 < args.size()) {
+            cameras = qMax(0, args[++i].toInt());
+        } else if (args[i] == "--json" && i + 1 < args.size()) {
+            jsonPath = args[++i];
+        } else if (args[i] == "--format" && i + 1 < args.size()) {
+            const int format = CaptureMode::fromString(args[++i]).pixelFormat;
+            if (format != FrameFormat::FormatBGR24 && format != FrameFormat::FormatYUY2 &&
+                format != FrameFormat::FormatNV12) {
+                std::fprintf(stderr, "camera_bench: --format must be BGR24, YUY2 or NV12\n");
+                return 2;
+            }
+            pixelFormat = FrameFormat::PixelFormat(format);
+        } else {
+            std::fprintf(stderr, "usage: camera_bench [--seconds N] [--sizes 480p,720p,1080p,4k] "
+                                 "[--cameras N] [--format BGR24|YUY2|NV12] [--json file]\n");
+            return 2;
+        }
+    }
+
+    const Resolution resolutions[] = {
+        { "480p",  640,  480  },
+        { "720p",  1280, 720  },
+        { "1080p", 1920, 1080 },
+        { "4k",    3840, 2160 },
+    };
+
+    QJsonArray results;
+    bool ok = true;
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); ++r) {
+        const Resolution &res = resolutions[r];
+        if (!sizes.isEmpty() && !sizes.contains(res.name)) {
+            continue;
+        }
+        std::fprintf(stderr, "camera_bench: %s...\n", res.name);
+        const QJsonObject result = runResolution(res, pixelFormat, seconds);
+        ok = ok && !result.contains("error");
+        results.append(result);
+    }
+
+    QJsonObject root;
+    root["benchmark"] = "camera_bench";
+    root["kernel"] = PixelConvert::kernelName(PixelConvert::bestKernel());
+    root["alloc_counter"] = CAMERA_BENCH_ALLOC_COUNTER;
+    root["seconds_per_size"] = seconds;
+    root["results"] = results;
+    if (cameras > 0) {
+        std::fprintf(stderr, "camera_bench: %d cameras 720p...\n", cameras);
+        const QJsonObject multi = runCameras(cameras, resolutions[1], pixelFormat, seconds);
+        ok = ok && !multi.contains("error");
+        root["multi_camera"] = multi;
+    }
+
+    const QByteArray json = QJsonDocument(root).toJson();
+    if (jsonPath.isEmpty()) {
+        std::fwrite(json.constData(), 1, json.size(), stdout);
+    } else {
+        QFile file(jsonPath);
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            std::fprintf(stderr, "camera_bench: cannot write %s\n", qPrintable(jsonPath));
+            return 1;
+        }
+    }
+    return ok ? 0 : 1;
+}
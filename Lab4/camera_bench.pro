@@ -0,0 +1,67 @@
+QT += core gui
+
+TARGET = camera_bench
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle debug_and_release
+
+# Исполняемый файл рядом с Makefile (цель bench в IIvuim.pro)
+DESTDIR = $$OUT_PWD
+
+SOURCES += \
+    camera_bench.cpp \
+    framesource.cpp \
+    pacedframesource.cpp \
+    syntheticsource.cpp \
+    replaysource.cpp \
+    avireader.cpp \
+    framepool.cpp \
+    videoframe.cpp \
+    pixelconvert.cpp \
+    pipelinestats.cpp \
+    aviwriter.cpp \
+    filewriter.cpp \
+    cameraworker.cpp \
+    cameragroup.cpp \
+    videorecorder.cpp \
+    prerollbuffer.cpp \
+    timelapsefilter.cpp \
+    motiondetector.cpp
+
+HEADERS += \
+    framesource.h \
+    pacedframesource.h \
+    syntheticsource.h \
+    replaysource.h \
+    avireader.h \
+    framepool.h \
+    videoframe.h \
+    pixelconvert.h \
+    pipelinestats.h \
+    aviwriter.h \
+    filewriter.h \
+    cameraworker.h \
+    cameragroup.h \
+    videorecorder.h \
+    prerollbuffer.h \
+    timelapsefilter.h \
+    motiondetector.h
+
+# FrameSource::create() подключает камеру платформы
+win32 {
+    SOURCES += dshowsource.cpp
+    HEADERS += dshowsource.h
+    LIBS += -lole32 -loleaut32 -lstrmiids -lpsapi -lsetupapi
+}
+linux {
+    SOURCES += v4l2source.cpp
+    HEADERS += v4l2source.h
+}
+
+# Бенчмарк имеет смысл только с оптимизацией
+CONFIG += release
+gcc {
+    QMAKE_CXXFLAGS_RELEASE -= -O2
+    QMAKE_CXXFLAGS_RELEASE += -O3
+}
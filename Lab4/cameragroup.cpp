@@ -0,0 +1,173 @@
+#include "cameragroup.h"
+#include "cameraworker.h"
+#include "pipelinestats.h"
+#include <QThread>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include "dshowsource.h"
+#endif
+
+CameraGroup::CameraGroup(const QStringList &specs, QObject *parent)
+    : QObject(parent),
+      m_recording(false),
+      m_pendingReplies(0),
+      m_recordingCameras(0)
+{
+    // Сжатие всех камер делит ядра; захват идёт в потоках источников
+    m_encoderPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+
+    connect(this, &CameraGroup::cameraReplied, this, &CameraGroup::onCameraReplied,
+            Qt::QueuedConnection);
+
+    const QStringList sourceSpecs = specs.isEmpty() ? defaultSpecs() : specs;
+    for (int i = 0; i < sourceSpecs.size(); ++i) {
+        FrameSource *source = FrameSource::create(sourceSpecs[i]);
+        if (!source) {
+            qDebug() << "CameraGroup: no source for" << sourceSpecs[i];
+            continue;
+        }
+
+        const int index = m_cameras.size();
+        CameraWorker *worker = new CameraWorker(source);
+        worker->setName(QString("cam%1").arg(index + 1));
+        worker->setEncoderPool(&m_encoderPool);
+
+        // Команды выполняются в потоке камеры: остановка записи одной
+        // камеры (дописывание очереди) не задерживает остальные
+        QThread *thread = new QThread(this);
+        worker->moveToThread(thread);
+
+        connect(this, &CameraGroup::previewRequested, worker, [worker](bool enabled) {
+            if (enabled) {
+                worker->startPreview();
+            } else {
+                worker->stopPreview();
+            }
+        }, Qt::QueuedConnection);
+        connect(this, &CameraGroup::recordingRequested, worker, [this, worker, index](qint64 startUs) {
+            worker->startVideoRecording(startUs);
+            emit cameraReplied(index, worker->isRecordingVideo());
+        }, Qt::QueuedConnection);
+        connect(this, &CameraGroup::stopRequested, worker, [this, worker, index](qint64 stopUs) {
+            worker->stopVideoRecording(stopUs);
+            emit cameraReplied(index, false);
+        }, Qt::QueuedConnection);
+        connect(worker, &CameraWorker::errorOccurred, this, [this, index](const QString &error) {
+            emit errorOccurred(index, error);
+        }, Qt::QueuedConnection);
+
+        Camera camera;
+        camera.worker = worker;
+        camera.thread = thread;
+        m_cameras.append(camera);
+        thread->start();
+
+        qDebug() << "CameraGroup: camera" << index + 1 << "-" << sourceSpecs[i];
+    }
+}
+
+CameraGroup::~CameraGroup()
+{
+    // Потоки камер останавливаются, затем камеры закрываются здесь
+    // (их потоки уже не обрабатывают события)
+    for (int i = 0; i < m_cameras.size(); ++i) {
+        m_cameras[i].thread->quit();
+    }
+    for (int i = 0; i < m_cameras.size(); ++i) {
+        m_cameras[i].thread->wait();
+        m_cameras[i].worker->stopAll();
+        delete m_cameras[i].worker;
+    }
+    m_cameras.clear();
+}
+
+QStringList CameraGroup::defaultSpecs()
+{
+    const QString sources = QString::fromLocal8Bit(qgetenv("LAB4_CAMERA_SOURCES"));
+    if (!sources.isEmpty()) {
+        return sources.split(';', QString::SkipEmptyParts);
+    }
+
+    QStringList specs;
+#ifdef Q_OS_WIN
+    const int devices = DirectShowSource::deviceCount();
+    for (int i = 0; i < devices; ++i) {
+        specs << QString("dshow:%1").arg(i);
+    }
+#else
+    specs << "camera";
+#endif
+    return specs;
+}
+
+void CameraGroup::setOutputDirectory(const QString &path)
+{
+    if (m_recording) {
+        return;
+    }
+    for (int i = 0; i < m_cameras.size(); ++i) {
+        m_cameras[i].worker->setOutputDirectory(path);
+    }
+}
+
+void CameraGroup::startPreview()
+{
+    emit previewRequested(true);
+}
+
+void CameraGroup::stopPreview()
+{
+    emit previewRequested(false);
+}
+
+void CameraGroup::startRecording()
+{
+    if (m_recording || m_pendingReplies > 0 || m_cameras.isEmpty()) {
+        return;
+    }
+
+    // Общее время начала с запасом на запуск источников
+    const qint64 startUs = PipelineStats::nowUs() + qint64(SYNC_START_DELAY_MS) * 1000;
+    m_recording = true;
+    m_pendingReplies = m_cameras.size();
+    m_recordingCameras = 0;
+    emit recordingRequested(startUs);
+}
+
+void CameraGroup::stopRecording()
+{
+    if (!m_recording || m_pendingReplies > 0) {
+        return;
+    }
+
+    m_recording = false;
+    m_pendingReplies = m_cameras.size();
+    emit stopRequested(PipelineStats::nowUs());
+}
+
+void CameraGroup::onCameraReplied(int camera, bool recording)
+{
+    if (m_pendingReplies == 0) {
+        return;
+    }
+    if (recording) {
+        m_recordingCameras++;
+    } else if (m_recording) {
+        qDebug() << "CameraGroup: camera" << camera + 1 << "did not start recording";
+    }
+    if (--m_pendingReplies > 0) {
+        return;
+    }
+
+    if (!m_recording) {
+        qDebug() << "CameraGroup: recording stopped";
+        emit recordingStopped();
+    } else if (m_recordingCameras == 0) {
+        m_recording = false;
+        emit errorOccurred(-1, "Ни одна камера не начала запись");
+    } else {
+        qDebug() << "CameraGroup: recording started on" << m_recordingCameras << "cameras";
+        emit recordingStarted(m_recordingCameras);
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef CAMERAGROUP_H
+#define CAMERAGROUP_H
+
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QVector>
+
+class CameraWorker;
+class QThread;
+
+// Несколько камер одновременно.
+// Для каждого источника создаётся свой CameraWorker в своём потоке (кадры
+// при этом приходят в потоках источников). Сжатие видео всех камер идёт в
+// одном пуле по числу ядер, а не в пуле на каждую камеру, поэтому
+// N камер не создают N * ядер потоков.
+//
+// Запись синхронизирована: все камеры получают общее время начала и
+// конца (PipelineStats::nowUs()) и пишут кадры, полученные в этом
+// интервале, поэтому файлы начинаются и заканчиваются в пределах одного
+// кадра друг от друга.
+class CameraGroup : public QObject
+{
+    Q_OBJECT
+
+public:
+    // specs - описания источников (FrameSource::create). Пустой список -
+    // переменная окружения LAB4_CAMERA_SOURCES (через ';'), а без неё
+    // все камеры DirectShow
+    explicit CameraGroup(const QStringList &specs = QStringList(), QObject *parent = nullptr);
+    ~CameraGroup();
+
+    int cameraCount() const { return m_cameras.size(); }
+    CameraWorker *camera(int index) const { return m_cameras.at(index).worker; }
+    QThreadPool *encoderPool() { return &m_encoderPool; }
+
+    // Папка для файлов всех камер; задаётся до записи
+    void setOutputDirectory(const QString &path);
+
+    void startPreview();
+    void stopPreview();
+
+    // Асинхронно: по готовности всех камер - recordingStarted/recordingStopped
+    void startRecording();
+    void stopRecording();
+    bool isRecording() const { return m_recording; }
+
+    // Через сколько после вызова startRecording() начинается запись, мс.
+    // Запас покрывает запуск источников всех камер
+    static const int SYNC_START_DELAY_MS = 500;
+
+signals:
+    // cameras - сколько камер действительно пишет
+    void recordingStarted(int cameras);
+    void recordingStopped();
+    void errorOccurred(int camera, const QString &error);
+
+    // Команды камерам (выполняются в их потоках)
+    void previewRequested(bool enabled);
+    void recordingRequested(qint64 startUs);
+    void stopRequested(qint64 stopUs);
+
+    // Ответ камеры на команду записи (из потока камеры)
+    void cameraReplied(int camera, bool recording);
+
+private slots:
+    void onCameraReplied(int camera, bool recording);
+
+private:
+    struct Camera {
+        CameraWorker *worker;
+        QThread *thread;
+    };
+
+    static QStringList defaultSpecs();
+
+    QThreadPool m_encoderPool;
+    QVector<Camera> m_cameras;
+    bool m_recording;
+    int m_pendingReplies;
+    int m_recordingCameras;
+};
+
+#endif // CAMERAGROUP_H
@@ -24,6 +24,10 @@ CameraWindow* CameraWindow::instance = nullptr;
 CameraWindow::CameraWindow(QWidget *parent, QWidget *mainWin)
     : QWidget(parent),
       cameraWorker(nullptr),
+      statsOverlay(nullptr),
+      statsOverlayTimer(nullptr),
+      statsOverlayCaptured(0),
+      statsOverlayShown(0),
       isRecording(false),
       isPreviewEnabled(true),
       recordingIndicatorVisible(false),
@@ -62,7 +66,28 @@ CameraWindow::CameraWindow(QWidget *parent, QWidget *mainWin)
     connect(cameraWorker, &CameraWorker::photoSaved, this, &CameraWindow::onPhotoSaved);
     connect(cameraWorker, &CameraWorker::errorOccurred, this, &CameraWindow::onError);
     connect(cameraWorker, &CameraWorker::cameraInfoReady, this, &CameraWindow::onCameraInfoReady);
-    connect(cameraWorker, &CameraWorker::frameReady, this, &CameraWindow::onFrameReady);
+    connect(cameraWorker, &CameraWorker::previewFrameReady, this, &CameraWindow::onPreviewFrameReady);
+    connect(cameraWorker, &CameraWorker::motionDetected, this, &CameraWindow::onMotionDetected);
+    connect(cameraWorker, &CameraWorker::motionStopped, this, &CameraWindow::onMotionStopped);
+    
+    // Кадры превью масштабируются worker'ом под размер области превью
+    cameraWorker->setPreviewSize(previewLabel->contentsRect().size());
+    previewLabel->installEventFilter(this);
+    
+    // Наложение со статистикой конвейера обновляется дважды в секунду
+    statsOverlayTimer = new QTimer(this);
+    connect(statsOverlayTimer, &QTimer::timeout, this, &CameraWindow::updateStatsOverlay);
+    QShortcut *statsShortcut = new QShortcut(QKeySequence(Qt::Key_F3), this);
+    connect(statsShortcut, &QShortcut::activated, this, [this]() {
+        statsOverlay->setVisible(!statsOverlay->isVisible());
+        if (statsOverlay->isVisible()) {
+            statsOverlayClock.invalidate();
+            updateStatsOverlay();
+            statsOverlayTimer->start(500);
+        } else {
+            statsOverlayTimer->stop();
+        }
+    });
     
     
     // Подключаем сигналы автоматического режима
@@ -74,6 +99,10 @@ CameraWindow::CameraWindow(QWidget *parent, QWidget *mainWin)
     isRecording = false;
     isPreviewEnabled = false;
     isVideoRecording = false;
+    isMotionActive = false;
+    
+    // Список режимов камеры (после открытия источника)
+    updateCaptureModes();
     
     // Инициализируем систему запрещенных слов
     initializeForbiddenWordsSystem();
@@ -204,6 +233,14 @@ void CameraWindow::setupUI()
     previewLabel->setScaledContents(false); // Сохраняем пропорции
     previewGroupLayout->addWidget(previewLabel);
     
+    // Статистика конвейера поверх превью (скрыта, F3)
+    statsOverlay = new QLabel(previewLabel);
+    statsOverlay->setStyleSheet("QLabel { background-color: rgba(0, 0, 0, 160); color: #00FF00; "
+                                "font-family: Consolas, monospace; font-size: 11px; padding: 4px; }");
+    statsOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+    statsOverlay->move(6, 6);
+    statsOverlay->hide();
+    
     // Индикатор записи
     recordingIndicator = new QLabel("");
     recordingIndicator->setAlignment(Qt::AlignCenter);
@@ -276,6 +313,51 @@ void CameraWindow::setupUI()
     connect(togglePreviewBtn, &QPushButton::clicked, this, &CameraWindow::onTogglePreview);
     controlGroupLayout->addWidget(togglePreviewBtn);
     
+    // Режим камеры: меньшее разрешение снижает нагрузку на USB и процессор
+    QHBoxLayout *captureModeLayout = new QHBoxLayout();
+    captureModeLayout->addWidget(new QLabel("Режим камеры:"));
+    captureModeCombo = new QComboBox();
+    captureModeCombo->setToolTip("Разрешение, частота кадров и формат пикселей камеры");
+    connect(captureModeCombo, static_cast<void (QComboBox::*)(int)>(&QComboBox::activated),
+            this, &CameraWindow::onCaptureModeSelected);
+    captureModeLayout->addWidget(captureModeCombo, 1);
+    controlGroupLayout->addLayout(captureModeLayout);
+    
+    // Таймлапс: запись сохраняет редкие кадры, часы съёмки - небольшой файл
+    QHBoxLayout *timelapseLayout = new QHBoxLayout();
+    timelapseLayout->addWidget(new QLabel("Таймлапс:"));
+    timelapseSpin = new QSpinBox();
+    timelapseSpin->setRange(0, 3600);
+    timelapseSpin->setSuffix(" с");
+    timelapseSpin->setSpecialValueText("выкл");
+    timelapseSpin->setToolTip("Кадр раз в столько секунд; 0 - обычная запись");
+    // Начальные значения - из тех же переменных окружения, что и у CameraWorker
+    timelapseSpin->setValue(qRound(qgetenv("LAB4_TIMELAPSE_SECONDS").toDouble()));
+    timelapseLayout->addWidget(timelapseSpin, 1);
+    timelapseSceneCheck = new QCheckBox("по смене сцены");
+    timelapseSceneCheck->setToolTip("Сохранять кадр, когда изображение заметно меняется");
+    timelapseSceneCheck->setChecked(qgetenv("LAB4_TIMELAPSE_SCENE").toInt() > 0);
+    timelapseLayout->addWidget(timelapseSceneCheck);
+    connect(timelapseSpin, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &CameraWindow::onTimelapseChanged);
+    connect(timelapseSceneCheck, &QCheckBox::toggled, this, &CameraWindow::onTimelapseChanged);
+    controlGroupLayout->addLayout(timelapseLayout);
+    
+    // Детектор движения и запись по нему (с предзаписью файл начнётся до движения)
+    QHBoxLayout *motionLayout = new QHBoxLayout();
+    motionCheck = new QCheckBox("Детектор движения");
+    motionCheck->setToolTip("Искать движение в кадре, пока камера работает");
+    motionCheck->setChecked(qgetenv("LAB4_MOTION").toInt() > 0);
+    motionLayout->addWidget(motionCheck);
+    motionRecordCheck = new QCheckBox("запись по движению");
+    motionRecordCheck->setToolTip("Начинать запись при движении и останавливать через 5 с после него");
+    motionRecordCheck->setChecked(qgetenv("LAB4_MOTION_RECORD").toInt() > 0);
+    motionRecordCheck->setEnabled(motionCheck->isChecked());
+    motionLayout->addWidget(motionRecordCheck, 1);
+    connect(motionCheck, &QCheckBox::toggled, this, &CameraWindow::onMotionSettingsChanged);
+    connect(motionRecordCheck, &QCheckBox::toggled, this, &CameraWindow::onMotionSettingsChanged);
+    controlGroupLayout->addLayout(motionLayout);
+    
     controlLayout->addWidget(controlGroup);
     
     // Скрытый режим
@@ -450,8 +532,16 @@ void CameraWindow::onVideoRecordingStarted()
     isRecording = true;
     isVideoRecording = true;
     updateVideoButtonText();
+    captureModeCombo->setEnabled(false);
+    timelapseSpin->setEnabled(false);
+    timelapseSceneCheck->setEnabled(false);
     recordingBlinkTimer->start(500);
-    statusLabel->setText("Статус: ⏺ ЗАПИСЬ ВИДЕО");
+    if (cameraWorker->isRecordingByMotion()) {
+        statusLabel->setText("Статус: ⏺ ЗАПИСЬ ПО ДВИЖЕНИЮ");
+    } else {
+        statusLabel->setText(cameraWorker->isTimelapseEnabled() ? "Статус: ⏺ ЗАПИСЬ ТАЙМЛАПСА"
+                                                                : "Статус: ⏺ ЗАПИСЬ ВИДЕО");
+    }
     
     // Jake танцует при записи!
     jakeWarning->showWarning(JakeCameraWarning::RECORDING_STARTED);
@@ -462,6 +552,9 @@ void CameraWindow::onVideoRecordingStopped()
     isRecording = false;
     isVideoRecording = false;
     updateVideoButtonText();
+    captureModeCombo->setEnabled(true);
+    timelapseSpin->setEnabled(true);
+    timelapseSceneCheck->setEnabled(true);
     recordingBlinkTimer->stop();
     recordingIndicator->clear();
     recordingIndicator->setStyleSheet("QLabel { background-color: transparent; }");
@@ -471,6 +564,87 @@ void CameraWindow::onVideoRecordingStopped()
     jakeWarning->hideWarning();
 }
 
+void CameraWindow::updateCaptureModes()
+{
+    // Режимы известны после открытия камеры
+    const QList<CaptureMode> modes = cameraWorker->supportedModes();
+    const CaptureMode current = cameraWorker->captureMode();
+    captureModeCombo->clear();
+    for (int i = 0; i < modes.size(); ++i) {
+        captureModeCombo->addItem(modes[i].toString());
+        if (modes[i].width == current.width && modes[i].height == current.height &&
+            modes[i].pixelFormat == current.pixelFormat &&
+            (captureModeCombo->currentIndex() < 0 || modes[i].fps == current.fps)) {
+            captureModeCombo->setCurrentIndex(i);
+        }
+    }
+    captureModeCombo->setEnabled(modes.size() > 1 && !isVideoRecording);
+}
+
+void CameraWindow::onCaptureModeSelected(int index)
+{
+    const CaptureMode mode = CaptureMode::fromString(captureModeCombo->itemText(index));
+    if (mode == cameraWorker->captureMode()) {
+        return;
+    }
+    
+    if (cameraWorker->setCaptureMode(mode)) {
+        Lab4Logger::instance()->logCameraEvent("Capture mode: " + mode.toString());
+        statusLabel->setText(QString("Статус: Режим камеры %1").arg(mode.toString()));
+    }
+    // Список обновляется в любом случае: выбор показывает фактический режим
+    updateCaptureModes();
+}
+
+void CameraWindow::onTimelapseChanged()
+{
+    // Порог смены сцены - средняя разница яркости миниатюры (из 255)
+    static const int SCENE_THRESHOLD = 12;
+    const int intervalMs = timelapseSpin->value() * 1000;
+    const int threshold = timelapseSceneCheck->isChecked() ? SCENE_THRESHOLD : 0;
+    cameraWorker->setTimelapse(intervalMs, threshold);
+    
+    if (cameraWorker->isTimelapseEnabled()) {
+        Lab4Logger::instance()->logCameraEvent(QString("Timelapse: interval %1 s, scene threshold %2")
+                                               .arg(timelapseSpin->value()).arg(threshold));
+        statusLabel->setText("Статус: Запись в режиме таймлапса");
+    } else {
+        statusLabel->setText("Статус: Обычная запись видео");
+    }
+}
+
+void CameraWindow::onMotionSettingsChanged()
+{
+    motionRecordCheck->setEnabled(motionCheck->isChecked());
+    cameraWorker->setMotionDetection(motionCheck->isChecked());
+    cameraWorker->setMotionRecording(motionCheck->isChecked() && motionRecordCheck->isChecked());
+    
+    Lab4Logger::instance()->logCameraEvent(QString("Motion detection: %1, recording on motion: %2")
+                                           .arg(cameraWorker->isMotionDetectionEnabled() ? "on" : "off")
+                                           .arg(cameraWorker->isMotionRecordingEnabled() ? "on" : "off"));
+}
+
+void CameraWindow::onMotionDetected(const QList<QRect> &regions)
+{
+    // Сигнал повторяется, пока движение продолжается; в журнал - только начало
+    if (!isMotionActive) {
+        isMotionActive = true;
+        Lab4Logger::instance()->logCameraEvent(QString("Motion detected: %1 region(s)").arg(regions.size()));
+    }
+    if (!isRecording) {
+        statusLabel->setText(QString("Статус: Движение в кадре (областей: %1)").arg(regions.size()));
+    }
+}
+
+void CameraWindow::onMotionStopped()
+{
+    isMotionActive = false;
+    Lab4Logger::instance()->logCameraEvent("Motion stopped");
+    if (!isRecording) {
+        statusLabel->setText("Статус: Движения нет");
+    }
+}
+
 void CameraWindow::onPhotoSaved(const QString &path)
 {
     Lab4Logger::instance()->logCameraEvent(QString("Photo saved: %1").arg(path));
@@ -497,16 +671,78 @@ void CameraWindow::onCameraInfoReady(const QString &info)
     infoTextEdit->setHtml(info);
 }
 
-void CameraWindow::onFrameReady(const QImage &frame)
+void CameraWindow::onPreviewFrameReady()
 {
+    // Берём самый свежий кадр; промежуточные worker уже отбросил
+    const QImage frame = cameraWorker->takePreviewFrame();
     if (frame.isNull()) {
         return;
     }
     
-    // Масштабируем изображение с сохранением пропорций
-    QPixmap pixmap = QPixmap::fromImage(frame);
-    QPixmap scaled = pixmap.scaled(previewLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
-    previewLabel->setPixmap(scaled);
+    // Кадр уже уменьшен до размера области превью (Format_RGB32),
+    // поэтому выводится без преобразований
+    previewLabel->setPixmap(QPixmap::fromImage(frame));
+    cameraWorker->previewFrameShown();
+}
+
+void CameraWindow::updateStatsOverlay()
+{
+    if (!cameraWorker) {
+        return;
+    }
+    
+    const PipelineStats::Snapshot stats = cameraWorker->pipelineStats();
+    const FrameSource::Counters counters = cameraWorker->captureCounters();
+    const qint64 captured = stats.stages[PipelineStats::StageConvert].count;
+    const qint64 shown = stats.stages[PipelineStats::StageEndToEnd].count;
+    
+    // FPS за интервал между обновлениями (после сброса статистики - заново)
+    double captureFps = 0.0;
+    double displayFps = 0.0;
+    if (statsOverlayClock.isValid() && captured >= statsOverlayCaptured && shown >= statsOverlayShown) {
+        const qint64 elapsedMs = qMax<qint64>(1, statsOverlayClock.restart());
+        captureFps = (captured - statsOverlayCaptured) * 1000.0 / elapsedMs;
+        displayFps = (shown - statsOverlayShown) * 1000.0 / elapsedMs;
+    } else {
+        statsOverlayClock.start();
+    }
+    statsOverlayCaptured = captured;
+    statsOverlayShown = shown;
+    
+    const PipelineStats::StageSummary &e2e = stats.stages[PipelineStats::StageEndToEnd];
+    QString text = QString("Задержка кадр -> экран: p50 %1 мс, p95 %2 мс, макс %3 мс\n")
+        .arg(e2e.p50Us / 1000.0, 0, 'f', 1)
+        .arg(e2e.p95Us / 1000.0, 0, 'f', 1)
+        .arg(e2e.maxUs / 1000.0, 0, 'f', 1);
+    text += QString("FPS: камера %1, экран %2\n").arg(captureFps, 0, 'f', 1).arg(displayFps, 0, 'f', 1);
+    text += QString("Потери: источник %1, превью %2, запись %3\n")
+        .arg(counters.dropped)
+        .arg(cameraWorker->previewFramesSkipped())
+        .arg(cameraWorker->videoFramesDropped());
+    
+    // Этапы конвейера, мкс
+    text += QString("%1 %2 %3 %4 %5")
+        .arg("этап", -10).arg("кадров", 8).arg("p50", 7).arg("p95", 7).arg("макс", 8);
+    for (int i = 0; i < PipelineStats::StageEndToEnd; ++i) {
+        const PipelineStats::StageSummary &stage = stats.stages[i];
+        text += QString("\n%1 %2 %3 %4 %5")
+            .arg(PipelineStats::stageName(PipelineStats::Stage(i)), -10)
+            .arg(stage.count, 8)
+            .arg(stage.p50Us, 7)
+            .arg(stage.p95Us, 7)
+            .arg(stage.maxUs, 8);
+    }
+    
+    statsOverlay->setText(text);
+    statsOverlay->adjustSize();
+}
+
+bool CameraWindow::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == previewLabel && event->type() == QEvent::Resize && cameraWorker) {
+        cameraWorker->setPreviewSize(previewLabel->contentsRect().size());
+    }
+    return QWidget::eventFilter(watched, event);
 }
 
 void CameraWindow::updateVideoButtonText()
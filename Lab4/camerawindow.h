@@ -7,10 +7,16 @@
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QTextEdit>
+#include <QComboBox>
+#include <QSpinBox>
+#include <QCheckBox>
 #include <QTimer>
 #include <QShortcut>
 #include <QAbstractNativeEventFilter>
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QList>
+#include <QRect>
 #include <windows.h>
 #include <winuser.h>
 
@@ -36,6 +42,9 @@ protected:
     
     // Обработка закрытия окна
     void closeEvent(QCloseEvent *event) override;
+    
+    // Изменение размера области превью
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private slots:
     void onGetCameraInfo();
@@ -47,7 +56,13 @@ private slots:
     void onPhotoSaved(const QString &path);
     void onError(const QString &error);
     void onCameraInfoReady(const QString &info);
-    void onFrameReady(const QImage &frame);
+    void onPreviewFrameReady();
+    void onCaptureModeSelected(int index);
+    void onTimelapseChanged();
+    void onMotionSettingsChanged();
+    void onMotionDetected(const QList<QRect> &regions);
+    void onMotionStopped();
+    void updateStatsOverlay();
     
     
     // Автоматический режим
@@ -55,6 +70,7 @@ private slots:
 private:
     void setupUI();
     void updateVideoButtonText();
+    void updateCaptureModes();
     void setupHotkeys();
     void registerGlobalHotkeys();
     void unregisterGlobalHotkeys();
@@ -100,9 +116,21 @@ private:
     QPushButton *takePhotoBtn;
     QPushButton *startStopVideoBtn;
     QPushButton *togglePreviewBtn;
+    QComboBox *captureModeCombo;    // Режимы захвата камеры
+    QSpinBox *timelapseSpin;        // Интервал таймлапса, с (0 - обычная запись)
+    QCheckBox *timelapseSceneCheck; // Таймлапс по смене сцены
+    QCheckBox *motionCheck;         // Детектор движения
+    QCheckBox *motionRecordCheck;   // Запись по движению
     QLabel *statusLabel;
     QLabel *recordingIndicator;
     
+    // Наложение со временем этапов конвейера, FPS и потерями (F3)
+    QLabel *statsOverlay;
+    QTimer *statsOverlayTimer;
+    QElapsedTimer statsOverlayClock;
+    qint64 statsOverlayCaptured;   // кадров получено на прошлом обновлении
+    qint64 statsOverlayShown;      // кадров выведено на прошлом обновлении
+    
     // Логика камеры
     CameraWorker *cameraWorker;
     
@@ -116,6 +144,7 @@ private:
     bool isRecording;
     bool isPreviewEnabled;
     bool isVideoRecording;
+    bool isMotionActive;    // было motionDetected без motionStopped
     
     // Таймер для индикатора записи
     QTimer *recordingBlinkTimer;
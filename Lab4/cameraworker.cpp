@@ -1,22 +1,104 @@
 #include "cameraworker.h"
+#include "pixelconvert.h"
+#include "filewriter.h"
 #include <QDateTime>
 #include <QDir>
 #include <QStandardPaths>
 #include <QDebug>
 #include <QBuffer>
+#include <QRunnable>
 #include <QThread>
+#include <QTimer>
+#include <QStringList>
+
+#include <cstring>
+#include <limits>
+
+// Кадры, пропускаемые после запуска камеры ради фото (экспозиция и баланс
+// белого ещё устанавливаются)
+static const int PHOTO_WARMUP_FRAMES = 5;
+
+// Запас времени на получение кадров для фото, мс
+static const int PHOTO_TIMEOUT_MS = 3000;
+
+// Сколько ждать кадр после общего времени остановки записи, мс
+static const int VIDEO_STOP_WAIT_MS = 1000;
+
+// Бюджет памяти кольца предзаписи по умолчанию, МБ (~30 с MJPEG 720p)
+static const int DEFAULT_PREROLL_MB = 64;
+
+// Детектор движения: средняя разница яркости блока (из 255), число
+// изменившихся блоков и удержание движения после последнего такого кадра, мс
+static const int MOTION_BLOCK_THRESHOLD = 12;
+static const int MOTION_MIN_BLOCKS = 2;
+static const int MOTION_HOLD_MS = 1000;
+
+// Как часто повторять motionDetected, пока движение продолжается, мс
+static const int MOTION_EVENT_INTERVAL_MS = 200;
+
+// Запись по движению продолжается после его окончания, мс
+static const int MOTION_POST_ROLL_MS = 5000;
+
+// JPEG сжимается в память и пишется в файл одним блоком с резервом места
+// точно под его размер (QImage::save пишет файл множеством мелких записей)
+static bool saveJpeg(const QImage &image, const QString &path, int quality)
+{
+    QByteArray jpeg;
+    QBuffer buffer(&jpeg);
+    buffer.open(QIODevice::WriteOnly);
+    if (!image.save(&buffer, "JPG", quality)) {
+        return false;
+    }
+    buffer.close();
+    
+    FileWriter file;
+    const bool ok = file.open(path.toUtf8().toStdString(), jpeg.size()) &&
+                    file.write(jpeg.constData(), jpeg.size()) &&
+                    file.close();
+    if (!ok) {
+        qDebug() << "Photo write failed:" << path << QString::fromStdString(file.lastError());
+    }
+    return ok;
+}
+
+// Сжатие и запись одного фото в пуле потоков
+class CameraWorker::PhotoTask : public QRunnable
+{
+public:
+    PhotoTask(CameraWorker *worker, const VideoFrame &frame, const QString &path)
+        : m_worker(worker), m_frame(frame), m_path(path)
+    {
+    }
+    
+    void run() override
+    {
+        const qint64 startUs = m_worker->m_pipelineStats.nowUs();
+        // Кадр YUV преобразуется в RGB здесь, а не в потоке захвата
+        const bool ok = saveJpeg(m_frame.toImage(), m_path, 90);
+        m_worker->m_pipelineStats.recordSince(PipelineStats::StageEncode, startUs);
+        // Слот пула кадров освобождается сразу после сжатия
+        m_frame = VideoFrame();
+        emit m_worker->photoEncoded(m_path, ok);
+    }
+    
+private:
+    CameraWorker *m_worker;
+    VideoFrame m_frame;
+    QString m_path;
+};
+
+// Строки RGB24 копируются без преобразования
+static void copyRgb24Row(const unsigned char *src, unsigned char *dst, int width)
+{
+    memcpy(dst, src, width * 3);
+}
 
 // Windows API includes для информации о камере
+#ifdef Q_OS_WIN
 #include <windows.h>
 #include <setupapi.h>
 #include <devguid.h>
 #include <initguid.h>
-#include <dshow.h>
-#include <qedit.h>
-
-// Для работы с AVI файлами
-#include <vfw.h>
-#include <mmreg.h>
 
 // Линковка библиотек задана в IIvuim.pro
 // MinGW не поддерживает #pragma comment
@@ -25,48 +107,103 @@
 #ifndef GUID_DEVCLASS_CAMERA
 DEFINE_GUID(GUID_DEVCLASS_CAMERA, 0xca3e7ab9, 0xb4c3, 0x4ae6, 0x82, 0x51, 0x57, 0x9e, 0xf9, 0x33, 0x89, 0x0f);
 #endif
-
-// ISampleGrabber interface (qedit.h может не содержать все определения)
-EXTERN_C const CLSID CLSID_SampleGrabber;
-EXTERN_C const CLSID CLSID_NullRenderer;
-EXTERN_C const IID IID_ISampleGrabber;
-
-// Forward declaration вспомогательной функции
-void FreeMediaType(AM_MEDIA_TYPE& mt);
+#endif
 
 CameraWorker::CameraWorker(QObject *parent)
+    : CameraWorker(FrameSource::create(QString::fromLocal8Bit(qgetenv("LAB4_CAMERA_SOURCE"))), parent)
+{
+}
+
+CameraWorker::CameraWorker(FrameSource *source, QObject *parent)
     : QObject(parent),
-      m_pGraph(nullptr),
-      m_pCapture(nullptr),
-      m_pMediaControl(nullptr),
-      m_pVideoCapture(nullptr),
-      m_pGrabber(nullptr),
-      m_pGrabberF(nullptr),
-      m_captureTimer(nullptr),
-      m_videoFrameTimer(nullptr),
+      m_source(source),
       m_initialized(false),
       m_isPreviewActive(false),
       m_isRecordingVideo(false),
+      m_isPreRollActive(false),
+      m_framePool(12),
+      m_convert(nullptr),
+      m_framePixelFormat(FrameFormat::FormatRGB24),
+      m_convertRow(nullptr),
+      m_previewPool(4),
+      m_photosRequested(0),
+      m_photoWarmupFrames(0),
+      m_photoNameRepeat(0),
+      m_photoGeneration(0),
+      m_previewPending(false),
+      m_previewSkipped(0),
+      m_previewArrivalUs(0),
+      m_previewReadyUs(0),
+      m_shownArrivalUs(-1),
+      m_shownReadyUs(-1),
+      m_recorder(nullptr),
+      m_preRollSeconds(0),
+      m_preRollBudget(0),
+      m_timelapseIntervalMs(0),
+      m_timelapseThreshold(0),
+      m_timelapseFps(30),
+      m_isTimelapse(false),
+      m_codecBeforeTimelapse(VideoRecorder::CodecMJPEG),
+      m_motionEnabled(false),
+      m_motionEventUs(0),
+      m_motionDetection(false),
+      m_motionRecording(false),
+      m_recordingByMotion(false),
+      m_motionStopGeneration(0),
+      m_videoFirstTimestampUs(-1),
+      m_videoLastTimestampUs(-1),
+      m_videoStartUs(-1),
+      m_videoStopUs(-1),
+      m_lastArrivalUs(-1),
       m_videoFrameCount(0),
       m_videoFrameWidth(640),
       m_videoFrameHeight(480)
 {
-    // Инициализируем COM
-    CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
-    
-    // Инициализируем VFW для работы с AVI
-    AVIFileInit();
-    
-    // Создаем таймеры
-    m_captureTimer = new QTimer(this);
-    connect(m_captureTimer, &QTimer::timeout, this, &CameraWorker::captureFrame);
+    // Запись видео идёт в отдельном потоке
+    m_recorder = new VideoRecorder(this);
+    connect(m_recorder, &VideoRecorder::recordingError, this, &CameraWorker::errorOccurred);
+    m_recorder->setPipelineStats(&m_pipelineStats);
+    
+    // Предзапись выключена, если длительность не задана
+    const int preRollMb = qEnvironmentVariableIsSet("LAB4_PREROLL_MB")
+                        ? qgetenv("LAB4_PREROLL_MB").toInt() : DEFAULT_PREROLL_MB;
+    setPreRoll(qgetenv("LAB4_PREROLL_SECONDS").toInt(), qint64(preRollMb) * 1024 * 1024);
+    
+    // Таймлапс выключен, если не заданы ни интервал, ни порог смены сцены
+    setTimelapse(qRound(qgetenv("LAB4_TIMELAPSE_SECONDS").toDouble() * 1000),
+                 qgetenv("LAB4_TIMELAPSE_SCENE").toInt());
+    
+    // Детектор движения сообщает о движении из потока источника; запись
+    // по нему запускается и останавливается в потоке worker'а
+    qRegisterMetaType<QList<QRect> >("QList<QRect>");
+    m_motion.configure(MOTION_BLOCK_THRESHOLD, MOTION_MIN_BLOCKS, MOTION_HOLD_MS);
+    connect(this, &CameraWorker::motionDetected, this, &CameraWorker::onMotionDetected,
+            Qt::QueuedConnection);
+    connect(this, &CameraWorker::motionStopped, this, &CameraWorker::onMotionStopped,
+            Qt::QueuedConnection);
+    setMotionDetection(qgetenv("LAB4_MOTION").toInt() > 0);
+    setMotionRecording(qgetenv("LAB4_MOTION_RECORD").toInt() > 0);
+    
+    // Фото сжимаются в пуле; итог обрабатывается в потоке worker'а
+    m_photoPool.setMaxThreadCount(2);
+    connect(this, &CameraWorker::photoEncoded, this, &CameraWorker::onPhotoEncoded,
+            Qt::QueuedConnection);
+    
+    // Кадры приходят от источника по мере захвата (без опроса по таймеру)
+    if (m_source) {
+        m_source->setSink(this);
+    }
     
-    m_videoFrameTimer = new QTimer(this);
-    connect(m_videoFrameTimer, &QTimer::timeout, this, &CameraWorker::captureFrame);
+    // Режим захвата, например LAB4_CAPTURE_MODE="640x480@30 YUY2"
+    const QString captureMode = QString::fromLocal8Bit(qgetenv("LAB4_CAPTURE_MODE"));
+    if (m_source && !captureMode.isEmpty() &&
+        !m_source->setMode(CaptureMode::fromString(captureMode))) {
+        qDebug() << "Capture mode" << captureMode << "ignored:" << m_source->lastError();
+    }
     
-    // Инициализируем DirectShow
-    if (!initializeDirectShow()) {
-        qDebug() << "Failed to initialize DirectShow";
+    // Подключаемся к источнику кадров
+    if (!openSource()) {
+        qDebug() << "Failed to open frame source";
         emit errorOccurred("Не удалось инициализировать камеру");
     }
 }
@@ -74,235 +211,80 @@ CameraWorker::CameraWorker(QObject *parent)
 CameraWorker::~CameraWorker()
 {
     stopAll();
-    releaseDirectShow();
+    m_photoPool.waitForDone();
+    closeSource();
     
-    // Освобождаем VFW
-    AVIFileExit();
-    
-    CoUninitialize();
+    delete m_source;
 }
 
-bool CameraWorker::initializeDirectShow()
+bool CameraWorker::openSource()
 {
     if (m_initialized) {
         return true;
     }
     
-    HRESULT hr;
-    
-    // Создаем Filter Graph Manager
-    hr = CoCreateInstance(CLSID_FilterGraph, NULL, CLSCTX_INPROC_SERVER,
-                         IID_IGraphBuilder, (void**)&m_pGraph);
-    if (FAILED(hr)) {
-        qDebug() << "Failed to create FilterGraph:" << hr;
+    if (!m_source) {
+        qDebug() << "No frame source available";
+        emit errorOccurred("Источник кадров недоступен");
         return false;
     }
     
-    // Создаем Capture Graph Builder
-    hr = CoCreateInstance(CLSID_CaptureGraphBuilder2, NULL, CLSCTX_INPROC_SERVER,
-                         IID_ICaptureGraphBuilder2, (void**)&m_pCapture);
-    if (FAILED(hr)) {
-        qDebug() << "Failed to create CaptureGraphBuilder2:" << hr;
-        m_pGraph->Release();
-        m_pGraph = nullptr;
-            return false;
+    if (!m_source->open()) {
+        qDebug() << m_source->name() << "source failed to open:" << m_source->lastError();
+        if (!m_source->lastError().isEmpty()) {
+            emit errorOccurred(m_source->lastError());
         }
-        
-    // Связываем Capture Graph с Filter Graph
-    hr = m_pCapture->SetFiltergraph(m_pGraph);
-    if (FAILED(hr)) {
-        qDebug() << "Failed to set filter graph:" << hr;
-        releaseDirectShow();
-        return false;
-    }
-    
-    // Получаем интерфейс Media Control
-    hr = m_pGraph->QueryInterface(IID_IMediaControl, (void**)&m_pMediaControl);
-    if (FAILED(hr)) {
-        qDebug() << "Failed to get MediaControl:" << hr;
-        releaseDirectShow();
-        return false;
-    }
-    
-    // Создаем Video Capture Device
-    ICreateDevEnum *pDevEnum = nullptr;
-    IEnumMoniker *pEnum = nullptr;
-    
-    hr = CoCreateInstance(CLSID_SystemDeviceEnum, NULL, CLSCTX_INPROC_SERVER,
-                         IID_ICreateDevEnum, (void**)&pDevEnum);
-    if (FAILED(hr)) {
-        qDebug() << "Failed to create DeviceEnumerator:" << hr;
-        releaseDirectShow();
-        return false;
-    }
-    
-    hr = pDevEnum->CreateClassEnumerator(CLSID_VideoInputDeviceCategory, &pEnum, 0);
-    if (hr == S_OK) {
-        IMoniker *pMoniker = nullptr;
-        if (pEnum->Next(1, &pMoniker, NULL) == S_OK) {
-            hr = pMoniker->BindToObject(NULL, NULL, IID_IBaseFilter, (void**)&m_pVideoCapture);
-            pMoniker->Release();
-        }
-        pEnum->Release();
-    }
-    pDevEnum->Release();
-    
-    if (m_pVideoCapture == nullptr) {
-        qDebug() << "No video capture device found";
-        emit errorOccurred("Камера не найдена");
-        releaseDirectShow();
-        return false;
-    }
-    
-    // Добавляем Video Capture в граф
-    hr = m_pGraph->AddFilter(m_pVideoCapture, L"Video Capture");
-    if (FAILED(hr)) {
-        qDebug() << "Failed to add video capture filter:" << hr;
-        releaseDirectShow();
         return false;
     }
     
-    // Пытаемся явно задать формат RGB24 640x480 @ ~30fps через IAMStreamConfig
-    {
-        IAMStreamConfig *pConfig = nullptr;
-        hr = m_pCapture->FindInterface(&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
-                                       m_pVideoCapture, IID_IAMStreamConfig, (void**)&pConfig);
-        if (SUCCEEDED(hr) && pConfig) {
-            int iCount = 0, iSize = 0;
-            if (SUCCEEDED(pConfig->GetNumberOfCapabilities(&iCount, &iSize)) && iSize == sizeof(VIDEO_STREAM_CONFIG_CAPS)) {
-                for (int i = 0; i < iCount; ++i) {
-                    VIDEO_STREAM_CONFIG_CAPS scc;
-                    AM_MEDIA_TYPE *pmt = nullptr;
-                    if (SUCCEEDED(pConfig->GetStreamCaps(i, &pmt, (BYTE*)&scc))) {
-                        if (pmt && pmt->formattype == FORMAT_VideoInfo && pmt->cbFormat >= sizeof(VIDEOINFOHEADER)) {
-                            VIDEOINFOHEADER *vih = (VIDEOINFOHEADER*)pmt->pbFormat;
-                            // Предпочитаем RGB24
-                            if (pmt->majortype == MEDIATYPE_Video) {
-                                vih->bmiHeader.biCompression = BI_RGB;
-                                vih->bmiHeader.biBitCount = 24;
-                                vih->bmiHeader.biWidth = 640;
-                                vih->bmiHeader.biHeight = 480; // bottom-up
-                                vih->bmiHeader.biSizeImage = vih->bmiHeader.biWidth * abs(vih->bmiHeader.biHeight) * 3;
-                                vih->AvgTimePerFrame = 333333; // ~30 fps
-                                pmt->subtype = MEDIASUBTYPE_RGB24;
-                                if (SUCCEEDED(pConfig->SetFormat(pmt))) {
-                                    qDebug() << "Capture format set to RGB24 640x480@~30fps";
-                                    m_videoFrameWidth = 640;
-                                    m_videoFrameHeight = 480;
-                                    FreeMediaType(*pmt);
-                                    CoTaskMemFree(pmt);
-                                    break;
-                                }
-                            }
-                        }
-                        if (pmt) { FreeMediaType(*pmt); CoTaskMemFree(pmt); }
-                    }
-                }
-            }
-            pConfig->Release();
-        } else {
-            qDebug() << "IAMStreamConfig not available or FindInterface failed:" << hr;
-        }
-    }
-    
-    // Создаем Sample Grabber для захвата кадров
-    hr = CoCreateInstance(CLSID_SampleGrabber, NULL, CLSCTX_INPROC_SERVER,
-                         IID_IBaseFilter, (void**)&m_pGrabberF);
-    if (FAILED(hr)) {
-        qDebug() << "Failed to create SampleGrabber filter:" << hr;
-        // Продолжаем без grabber'а (не критично)
-    } else {
-        hr = m_pGraph->AddFilter(m_pGrabberF, L"Sample Grabber");
-        if (SUCCEEDED(hr)) {
-            hr = m_pGrabberF->QueryInterface(IID_ISampleGrabber, (void**)&m_pGrabber);
-            if (SUCCEEDED(hr)) {
-                // Настраиваем Sample Grabber
-                AM_MEDIA_TYPE mt;
-                ZeroMemory(&mt, sizeof(AM_MEDIA_TYPE));
-                mt.majortype = MEDIATYPE_Video;
-                mt.subtype = MEDIASUBTYPE_RGB24;
-                m_pGrabber->SetMediaType(&mt);
-                m_pGrabber->SetBufferSamples(TRUE);
-                m_pGrabber->SetOneShot(FALSE);
-            }
-        }
-    }
-    
-    // Создаем NULL Renderer (чтобы граф работал без отображения)
-    IBaseFilter *pNullRenderer = nullptr;
-    hr = CoCreateInstance(CLSID_NullRenderer, NULL, CLSCTX_INPROC_SERVER,
-                         IID_IBaseFilter, (void**)&pNullRenderer);
-    if (SUCCEEDED(hr)) {
-        m_pGraph->AddFilter(pNullRenderer, L"Null Renderer");
-        
-        // Соединяем фильтры: сначала пробуем CAPTURE, затем PREVIEW как fallback
-        HRESULT hrConnect = E_FAIL;
-        if (m_pGrabberF) {
-            hrConnect = m_pCapture->RenderStream(&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
-                                                 m_pVideoCapture, m_pGrabberF, pNullRenderer);
-            if (FAILED(hrConnect)) {
-                qDebug() << "RenderStream CAPTURE failed, falling back to PREVIEW. hr:" << hrConnect;
-                hrConnect = m_pCapture->RenderStream(&PIN_CATEGORY_PREVIEW, &MEDIATYPE_Video,
-                                                     m_pVideoCapture, m_pGrabberF, pNullRenderer);
-            }
-        } else {
-            hrConnect = m_pCapture->RenderStream(&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
-                                                 m_pVideoCapture, nullptr, pNullRenderer);
-            if (FAILED(hrConnect)) {
-                qDebug() << "RenderStream CAPTURE (no grabber) failed, trying PREVIEW. hr:" << hrConnect;
-                hrConnect = m_pCapture->RenderStream(&PIN_CATEGORY_PREVIEW, &MEDIATYPE_Video,
-                                                     m_pVideoCapture, nullptr, pNullRenderer);
-            }
-        }
-        if (FAILED(hrConnect)) {
-            qDebug() << "Failed to connect capture graph for video stream:" << hrConnect;
-        }
-        
-        pNullRenderer->Release();
-    }
-    
+    m_videoFrameWidth = m_source->width();
+    m_videoFrameHeight = m_source->height();
     m_initialized = true;
-    qDebug() << "DirectShow initialized successfully";
+    qDebug() << m_source->name() << "source initialized successfully";
     
     return true;
 }
 
-void CameraWorker::releaseDirectShow()
+void CameraWorker::closeSource()
 {
-    if (m_pMediaControl) {
-        m_pMediaControl->Stop();
-        m_pMediaControl->Release();
-        m_pMediaControl = nullptr;
+    if (m_source) {
+        m_source->close();
     }
     
-    if (m_pGrabber) {
-        m_pGrabber->Release();
-        m_pGrabber = nullptr;
-    }
-    
-    if (m_pGrabberF) {
-        m_pGraph->RemoveFilter(m_pGrabberF);
-        m_pGrabberF->Release();
-        m_pGrabberF = nullptr;
+    m_initialized = false;
+}
+
+bool CameraWorker::startSource()
+{
+    if (!m_initialized && !openSource()) {
+        return false;
     }
-    
-    if (m_pVideoCapture) {
-        m_pGraph->RemoveFilter(m_pVideoCapture);
-        m_pVideoCapture->Release();
-        m_pVideoCapture = nullptr;
+    return m_source->start();
+}
+
+void CameraWorker::stopSourceIfIdle()
+{
+    // Вызывается без m_mutex: stop() ждёт завершения frameArrived()
+    bool idle = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        idle = !m_isPreviewActive && !m_isRecordingVideo && m_photosRequested == 0;
     }
-    
-    if (m_pCapture) {
-        m_pCapture->Release();
-        m_pCapture = nullptr;
+    if (idle && m_initialized) {
+        m_source->stop();
+        qDebug() << "Frame source stopped";
+        // Следующий кадр после перезапуска не сравнивается со старым
+        resetMotion();
     }
-    
-    if (m_pGraph) {
-        m_pGraph->Release();
-        m_pGraph = nullptr;
+}
+
+FrameSource::Counters CameraWorker::captureCounters() const
+{
+    if (!m_source) {
+        FrameSource::Counters empty = { 0, 0, 0 };
+        return empty;
     }
-    
-    m_initialized = false;
+    return m_source->counters();
 }
 
 bool CameraWorker::initializeCamera()
@@ -319,10 +301,10 @@ bool CameraWorker::initializeCamera()
     stopAll();
     
     // Освобождаем предыдущие ресурсы
-    releaseDirectShow();
+    closeSource();
     
     // Пытаемся инициализировать заново
-    bool result = initializeDirectShow();
+    bool result = openSource();
     
     if (result) {
         qDebug() << "Camera initialized successfully";
@@ -337,149 +319,477 @@ bool CameraWorker::initializeCamera()
 
 void CameraWorker::startPreview()
 {
-    if (!m_initialized) {
-        if (!initializeDirectShow()) {
-        return;
+    if (startSource()) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_isPreviewActive = true;
         }
+        m_pipelineStats.reset();
+        qDebug() << "Preview started";
+        updatePreRoll();
+    } else if (m_initialized) {
+        qDebug() << "Failed to start preview:" << m_source->lastError();
+        emit errorOccurred("Не удалось запустить превью");
+    }
+}
+
+QList<CaptureMode> CameraWorker::supportedModes() const
+{
+    return m_source ? m_source->supportedModes() : QList<CaptureMode>();
+}
+
+CaptureMode CameraWorker::captureMode() const
+{
+    return m_source ? m_source->currentMode() : CaptureMode();
+}
+
+bool CameraWorker::setCaptureMode(const CaptureMode &mode)
+{
+    if (!m_source) {
+        return false;
+    }
+    if (m_isRecordingVideo) {
+        emit errorOccurred("Режим камеры нельзя менять во время записи");
+        return false;
     }
     
-    if (m_pMediaControl) {
-        HRESULT hr = m_pMediaControl->Run();
-        if (SUCCEEDED(hr)) {
-            m_isPreviewActive = true;
-            m_captureTimer->start(33); // ~30 FPS
-            qDebug() << "Preview started";
-        } else {
-            qDebug() << "Failed to start preview:" << hr;
-            emit errorOccurred("Не удалось запустить превью");
-        }
+    // Кольцо предзаписи хранит кадры прежнего размера
+    {
+        QMutexLocker locker(&m_mutex);
+        m_isPreRollActive = false;
+    }
+    if (m_recorder->isPreRollActive()) {
+        m_recorder->stopPreRoll();
+    }
+    
+    bool running = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        running = m_isPreviewActive || m_photosRequested > 0;
+    }
+    
+    // Режим применяется при открытии источника
+    const CaptureMode previous = captureMode();
+    closeSource();
+    bool applied = m_source->setMode(mode);
+    if (!applied) {
+        qDebug() << "Capture mode" << mode.toString() << "rejected:" << m_source->lastError();
+        emit errorOccurred(m_source->lastError());
+    }
+    bool opened = openSource();
+    if (!opened && applied && previous.width > 0) {
+        // Камера не открылась в новом режиме - возвращаем прежний
+        qDebug() << "Restoring capture mode" << previous.toString();
+        m_source->setMode(previous);
+        opened = openSource();
+        applied = false;
+    }
+    
+    if (opened && running && !startSource()) {
+        qDebug() << "Failed to restart source:" << m_source->lastError();
+        emit errorOccurred("Не удалось запустить превью");
     }
+    updatePreRoll();
+    
+    if (applied) {
+        qDebug() << "Capture mode set:" << captureMode().toString();
+    }
+    return applied;
+}
+
+void CameraWorker::setPreviewSize(const QSize &size)
+{
+    QMutexLocker locker(&m_mutex);
+    m_previewSize = size;
 }
 
 void CameraWorker::stopPreview()
 {
-    m_captureTimer->stop();
-    
-    if (!m_isRecordingVideo && m_pMediaControl) {
-        m_pMediaControl->Stop();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_isPreviewActive = false;
     }
     
-    m_isPreviewActive = false;
-    qDebug() << "Preview stopped";
+    updatePreRoll();
+    stopSourceIfIdle();
+    // Кадр, который окно не успело забрать, больше не нужен
+    takePreviewFrame();
+    qDebug() << "Preview stopped, frames skipped by coalescing:" << previewFramesSkipped();
 }
 
-void CameraWorker::takePhoto()
+void CameraWorker::takePhoto(int count)
 {
     if (!m_initialized) {
         emit errorOccurred("Камера не инициализирована");
         return;
     }
+    if (count <= 0) {
+        return;
+    }
     
-    bool wasPreviewActive = m_isPreviewActive;
+    // Папка создаётся здесь, а не в потоке источника
+    const QString outputDir = getOutputDirectory();
     
-    // Запускаем граф и таймер если не запущены
-    if (!m_isPreviewActive && m_pMediaControl) {
-        m_pMediaControl->Run();
-        m_captureTimer->start(33); // Запускаем таймер для захвата кадров
-        QThread::msleep(500); // Даём камере прогреться
+    int pending = 0;
+    bool running = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        running = m_isPreviewActive || m_isRecordingVideo || m_photosRequested > 0;
+        if (!running) {
+            m_photoWarmupFrames = PHOTO_WARMUP_FRAMES;
+        }
+        m_photoDirectory = outputDir;
+        m_photosRequested += count;
+        pending = m_photosRequested;
     }
     
-    // Захватываем текущий кадр
-    QImage frame = captureCurrentFrame();
-    
-    if (frame.isNull()) {
-        // Останавливаем если запускали
-        if (!wasPreviewActive) {
-            m_captureTimer->stop();
-            if (m_pMediaControl) {
-                m_pMediaControl->Stop();
-            }
+    // Кадры заберёт frameArrived(); камеру запускаем, если она не работает
+    if (!running && !startSource()) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_photosRequested = 0;
         }
+        qDebug() << "Failed to start source for photo:" << m_source->lastError();
         emit errorOccurred("Не удалось захватить кадр");
         return;
     }
     
-    // Генерируем путь для сохранения
-    QString outputDir = getOutputDirectory();
-    QString fileName = generateFileName("photo", "jpg");
-    QString fullPath = outputDir + "/" + fileName;
+    // Если кадры не придут (камера зависла), запрос снимается по таймауту
+    const int generation = ++m_photoGeneration;
+    const int timeoutMs = PHOTO_TIMEOUT_MS +
+                          (pending + PHOTO_WARMUP_FRAMES) * 1000 / qMax(1, m_source->frameRate());
+    QTimer::singleShot(timeoutMs, this, [this, generation]() {
+        photoTimeout(generation);
+    });
+    
+    qDebug() << "Photo requested:" << count << "frame(s), pending" << pending;
+}
+
+void CameraWorker::startPhotoTask(const VideoFrame &frame)
+{
+    // Несколько кадров серии могут попасть в одну миллисекунду
+    QString name = generateFileName("photo", "jpg");
+    if (name == m_lastPhotoName) {
+        m_photoNameRepeat++;
+    } else {
+        m_lastPhotoName = name;
+        m_photoNameRepeat = 0;
+    }
+    if (m_photoNameRepeat > 0) {
+        name.insert(name.lastIndexOf('.'), QString("_%1").arg(m_photoNameRepeat));
+    }
     
-    // Сохраняем кадр
-    if (saveFrame(frame, fullPath)) {
-        emit photoSaved(fullPath);
-        qDebug() << "Photo saved:" << fullPath;
+    m_photoPool.start(new PhotoTask(this, frame, m_photoDirectory + "/" + name));
+}
+
+void CameraWorker::onPhotoEncoded(const QString &path, bool ok)
+{
+    if (ok) {
+        qDebug() << "Photo saved:" << path;
+        emit photoSaved(path);
     } else {
+        qDebug() << "Failed to save photo:" << path;
         emit errorOccurred("Не удалось сохранить фото");
     }
     
-    // Останавливаем граф и таймер если превью не было активно
-    if (!wasPreviewActive) {
-        m_captureTimer->stop();
-        if (m_pMediaControl) {
-            m_pMediaControl->Stop();
+    // Камера запускалась только ради фото
+    stopSourceIfIdle();
+}
+
+void CameraWorker::photoTimeout(int generation)
+{
+    // Более поздний запрос продлил ожидание
+    if (generation != m_photoGeneration) {
+        return;
+    }
+    
+    int missed = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        missed = m_photosRequested;
+        m_photosRequested = 0;
+    }
+    if (missed == 0) {
+        return;
+    }
+    
+    qDebug() << "Photo timeout:" << missed << "frame(s) not received";
+    emit errorOccurred("Не удалось захватить кадр");
+    stopSourceIfIdle();
+}
+
+void CameraWorker::setPreRoll(int seconds, qint64 byteBudget)
+{
+    m_preRollSeconds = qMax(0, seconds);
+    m_preRollBudget = qMax<qint64>(0, byteBudget);
+    if (m_preRollSeconds > 0) {
+        qDebug() << "Pre-roll:" << m_preRollSeconds << "s," << m_preRollBudget / (1024 * 1024) << "MB";
+    }
+    
+    // Новые настройки применяются перезапуском кольца
+    if (m_recorder->isPreRollActive() && !m_isRecordingVideo) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_isPreRollActive = false;
+        }
+        m_recorder->stopPreRoll();
+    }
+    updatePreRoll();
+}
+
+void CameraWorker::updatePreRoll()
+{
+    // Идущая запись из кольца завершается в stopVideoRecording()
+    if (m_isRecordingVideo) {
+        return;
+    }
+    
+    bool wanted = false;
+    {
+        QMutexLocker locker(&m_mutex);
+        wanted = m_isPreviewActive && m_preRollSeconds > 0 && m_preRollBudget > 0;
+    }
+    
+    if (wanted && !m_recorder->isPreRollActive()) {
+        const FrameFormat format = m_source->format();
+        if (!m_recorder->startPreRoll(QSize(format.width, format.height), m_source->frameRate(),
+                                      m_preRollSeconds, m_preRollBudget, 8)) {
+            qDebug() << "Failed to start pre-roll";
+            return;
+        }
+        QMutexLocker locker(&m_mutex);
+        m_isPreRollActive = true;
+    } else if (!wanted && m_recorder->isPreRollActive()) {
+        // Сначала перестаём отдавать кадры, затем останавливаем поток записи
+        {
+            QMutexLocker locker(&m_mutex);
+            m_isPreRollActive = false;
+        }
+        m_recorder->stopPreRoll();
+    }
+}
+
+void CameraWorker::setTimelapse(int intervalMs, int sceneThreshold, int playbackFps)
+{
+    if (m_isRecordingVideo) {
+        qDebug() << "Timelapse change ignored while recording";
+        return;
+    }
+    m_timelapseIntervalMs = qMax(0, intervalMs);
+    m_timelapseThreshold = qBound(0, sceneThreshold, 255);
+    m_timelapseFps = qBound(1, playbackFps, 120);
+    if (isTimelapseEnabled()) {
+        qDebug() << "Timelapse: every" << m_timelapseIntervalMs << "ms, scene threshold"
+                 << m_timelapseThreshold << "playback" << m_timelapseFps << "fps";
+    }
+}
+
+void CameraWorker::setMotionDetection(bool enabled)
+{
+    m_motionDetection = enabled;
+    {
+        QMutexLocker locker(&m_motionMutex);
+        m_motionEnabled = enabled;
+    }
+    if (enabled) {
+        qDebug() << "Motion detection: block threshold" << MOTION_BLOCK_THRESHOLD
+                 << "min blocks" << MOTION_MIN_BLOCKS;
+    } else {
+        resetMotion();
+    }
+}
+
+void CameraWorker::setMotionRecording(bool enabled)
+{
+    m_motionRecording = enabled;
+    // Идущая запись по движению становится обычной: её останавливают вручную
+    if (!enabled && m_recordingByMotion) {
+        m_recordingByMotion = false;
+        m_motionStopGeneration++;
+    }
+    if (enabled && !m_motionDetection) {
+        qDebug() << "Motion recording enabled, but motion detection is off";
+    }
+}
+
+void CameraWorker::resetMotion()
+{
+    bool wasActive = false;
+    {
+        QMutexLocker locker(&m_motionMutex);
+        wasActive = m_motion.isActive();
+        m_motion.reset();
+    }
+    if (wasActive) {
+        emit motionStopped();
+    }
+}
+
+void CameraWorker::detectMotion(const VideoFrame &frame, qint64 arrivalUs)
+{
+    QList<QRect> regions;
+    bool stopped = false;
+    {
+        QMutexLocker locker(&m_motionMutex);
+        if (!m_motionEnabled) {
+            return;
+        }
+        const qint64 startUs = m_pipelineStats.nowUs();
+        const bool wasActive = m_motion.isActive();
+        m_motion.process(frame, arrivalUs);
+        m_pipelineStats.recordSince(PipelineStats::StageMotion, startUs);
+        
+        if (m_motion.hasMotion() &&
+            (!wasActive || arrivalUs - m_motionEventUs >= qint64(MOTION_EVENT_INTERVAL_MS) * 1000)) {
+            regions = m_motion.regions();
+            m_motionEventUs = arrivalUs;
         }
+        stopped = wasActive && !m_motion.isActive();
+    }
+    
+    // Сигналы - вне мьютекса (обработчики в других потоках)
+    if (!regions.isEmpty()) {
+        emit motionDetected(regions);
+    } else if (stopped) {
+        emit motionStopped();
+    }
+}
+
+void CameraWorker::onMotionDetected(const QList<QRect> &regions)
+{
+    // Движение продолжается - ожидающая остановка отменяется
+    m_motionStopGeneration++;
+    if (!m_motionRecording || m_isRecordingVideo) {
+        return;
+    }
+    
+    qDebug() << "Motion detected in" << regions.size() << "region(s), starting recording";
+    // Источник уже работает: запись начинается с текущего кадра без
+    // прогрева, более ранние кадры даёт предзапись
+    m_recordingByMotion = true;
+    startVideoRecording(PipelineStats::nowUs());
+    if (!m_isRecordingVideo) {
+        m_recordingByMotion = false;
     }
 }
 
-void CameraWorker::startVideoRecording()
+void CameraWorker::onMotionStopped()
+{
+    if (!m_recordingByMotion) {
+        return;
+    }
+    
+    // Запись останавливается, если движение не возобновится
+    const int generation = ++m_motionStopGeneration;
+    QTimer::singleShot(MOTION_POST_ROLL_MS, this, [this, generation]() {
+        if (generation == m_motionStopGeneration && m_recordingByMotion) {
+            qDebug() << "No motion for" << MOTION_POST_ROLL_MS << "ms, stopping recording";
+            stopVideoRecording();
+        }
+    });
+}
+
+void CameraWorker::startVideoRecording(qint64 startUs)
 {
     if (!m_initialized) {
         emit errorOccurred("Камера не инициализирована");
         return;
     }
     
-    // Очищаем буфер кадров
-    m_videoFrames.clear();
-    m_videoFrameCount = 0;
+    if (m_isRecordingVideo) {
+        qDebug() << "startVideoRecording called while already recording";
+        return;
+    }
+    
+    // Кадры предзаписи идут с полной частотой и в таймлапс не попадают
+    const bool timelapse = isTimelapseEnabled();
+    if (timelapse && m_recorder->isPreRollActive()) {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_isPreRollActive = false;
+        }
+        m_recorder->stopPreRoll();
+    }
     
     // Генерируем путь для видео
     QString outputDir = getOutputDirectory();
-    QString fileName = generateFileName("video", "avi");
+    QString fileName = generateFileName(timelapse ? "timelapse" : "video", "avi");
     m_currentVideoPath = outputDir + "/" + fileName;
     
     qDebug() << "Will save video to:" << m_currentVideoPath;
     
-    // Запускаем граф если не запущен
-    if (m_pMediaControl) {
-        HRESULT hr = m_pMediaControl->Run();
-        if (FAILED(hr)) {
-            qDebug() << "Failed to start media control, hr:" << hr;
-            // Попытка восстановиться: переинициализируем граф и пробуем снова
-            releaseDirectShow();
-            if (initializeDirectShow()) {
-                qDebug() << "Reinitialized DirectShow after Run() failure, retrying Run...";
-                if (m_pMediaControl) {
-                    hr = m_pMediaControl->Run();
-                    if (FAILED(hr)) {
-                        qDebug() << "Retry Run() failed, hr:" << hr;
-                    } else {
-                        qDebug() << "Media control started successfully after reinit";
-                    }
-                }
+    // С предзаписью источник уже работает, и файл начнётся с кадров из
+    // кольца - прогрев не нужен. С общим временем начала кадры до него
+    // и так не записываются
+    const bool preRoll = m_recorder->isPreRollActive();
+    const bool warmUp = !preRoll && startUs < 0;
+    
+    // Запускаем источник если не запущен
+    if (preRoll) {
+        qDebug() << "Recording from pre-roll:" << m_recorder->preRollFrameCount() << "frames";
+    } else if (!startSource()) {
+        qDebug() << "Failed to start frame source:" << m_source->lastError();
+        // Попытка восстановиться: переподключаем источник и пробуем снова
+        closeSource();
+        if (openSource()) {
+            qDebug() << "Reopened frame source after start failure, retrying...";
+            if (!startSource()) {
+                qDebug() << "Retry start failed:" << m_source->lastError();
             } else {
-                qDebug() << "Reinitialize DirectShow failed; cannot start media control";
+                qDebug() << "Frame source started successfully after reopen";
             }
         } else {
-            qDebug() << "Media control started successfully";
+            qDebug() << "Reopen frame source failed; cannot start capture";
         }
+    } else {
+        qDebug() << "Frame source started successfully";
     }
     
-    // Небольшой прогрев, чтобы SampleGrabber начал отдавать кадры
-    QThread::msleep(250);
+    if (warmUp) {
+        // Небольшой прогрев, чтобы источник начал отдавать кадры
+        QThread::msleep(250);
+        
+        // Увеличенный прогрев перед началом кадров
+        QThread::msleep(700);
+    }
     
-    // Увеличенный прогрев перед началом кадров
-    QThread::msleep(700);
+    // Файл создаётся под текущий формат источника.
+    // Очередь с запасом: в MJPEG несколько кадров сжимаются параллельно
+    // Таймлапс всегда сжимается: кадров мало, а каждый кадр BI_RGB велик
+    const FrameFormat format = m_source->format();
+    const int fps = timelapse ? m_timelapseFps : m_source->frameRate();
+    m_codecBeforeTimelapse = m_recorder->codec();
+    if (timelapse) {
+        m_recorder->setCodec(VideoRecorder::CodecMJPEG);
+    }
+    if (!m_recorder->startRecording(m_currentVideoPath, QSize(format.width, format.height), fps, 8)) {
+        qDebug() << "Failed to start video recorder, format" << format.width << "x" << format.height;
+        m_recorder->setCodec(m_codecBeforeTimelapse);
+        emit errorOccurred("Не удалось начать запись видео");
+        updatePreRoll();
+        stopSourceIfIdle();
+        return;
+    }
     
-    // Запускаем таймер захвата кадров для видео
-    m_isRecordingVideo = true;
-    m_videoFrameTimer->start(33); // ~30 FPS
-    qDebug() << "Video frame timer started";
+    // С этого момента кадры источника идут в запись
+    m_videoStartCounters = m_source->counters();
+    {
+        QMutexLocker locker(&m_mutex);
+        m_videoFrameCount = 0;
+        m_videoFirstTimestampUs = -1;
+        m_videoLastTimestampUs = -1;
+        m_videoStartUs = startUs;
+        m_videoStopUs = -1;
+        m_timelapse.configure(m_timelapseIntervalMs, m_timelapseThreshold);
+        m_isTimelapse = timelapse;
+        m_isRecordingVideo = true;
+    }
     
     emit videoRecordingStarted();
-    qDebug() << "Video recording started";
+    qDebug() << (timelapse ? "Timelapse recording started" : "Video recording started");
 }
 
-void CameraWorker::stopVideoRecording()
+void CameraWorker::stopVideoRecording(qint64 stopUs)
 {
     if (!m_isRecordingVideo) {
         qDebug() << "stopVideoRecording called but not recording";
@@ -487,42 +797,83 @@ void CameraWorker::stopVideoRecording()
     }
     
     qDebug() << "Stopping video recording...";
-    m_videoFrameTimer->stop();
-    m_isRecordingVideo = false;
-    
-    qDebug() << "Captured" << m_videoFrames.count() << "frames";
-    
-    // Сохраняем видео в настоящий AVI файл
-    if (!m_videoFrames.isEmpty()) {
-        qDebug() << "Saving video to AVI...";
-        bool success = saveVideoToAVI(m_currentVideoPath, m_videoFrames, m_videoFrameWidth, m_videoFrameHeight);
-        if (success) {
-            qDebug() << "✅ Video saved as AVI:" << m_currentVideoPath << "-" << m_videoFrames.count() << "frames";
-            emit videoRecordingStopped(); // Отправляем сигнал только если успешно
-        } else {
-            qDebug() << "❌ Failed to save video as AVI, falling back to frames";
-            // Fallback: сохраняем первый кадр
-            QString firstFramePath = m_currentVideoPath;
-            firstFramePath.replace(".avi", "_frame_000.jpg");
-            if (saveFrame(m_videoFrames.first(), firstFramePath)) {
-                qDebug() << "Saved first frame as fallback:" << firstFramePath;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (stopUs >= 0) {
+            // Кадры, полученные до stopUs, ещё могут быть в пути
+            m_videoStopUs = stopUs;
+            while (m_lastArrivalUs < stopUs) {
+                if (!m_videoStopReached.wait(&m_mutex, VIDEO_STOP_WAIT_MS)) {
+                    qDebug() << "No frame after the common stop time";
+                    break;
+                }
             }
-            emit videoRecordingStopped();
         }
-    } else {
+        m_isRecordingVideo = false;
+    }
+    m_recordingByMotion = false;
+    
+    // Дописываем оставшиеся в очереди кадры и закрываем файл
+    bool success = m_recorder->stopRecording();
+    const bool timelapse = m_isTimelapse;
+    if (timelapse) {
+        m_recorder->setCodec(m_codecBeforeTimelapse);
+        QMutexLocker locker(&m_mutex);
+        m_isTimelapse = false;
+    }
+    int written = m_recorder->framesWritten();
+    qDebug() << "Captured" << m_videoFrameCount << "frames, written" << written
+             << "dropped" << m_recorder->framesDropped();
+    
+    // Фактическая частота камеры по меткам времени кадров (у таймлапса
+    // кадры отобраны - частота не считается)
+    double captureFps = 0.0;
+    if (!timelapse && m_videoFrameCount > 1 && m_videoLastTimestampUs > m_videoFirstTimestampUs) {
+        captureFps = (m_videoFrameCount - 1) * 1000000.0 /
+                     (m_videoLastTimestampUs - m_videoFirstTimestampUs);
+    }
+    const FrameSource::Counters counters = m_source->counters();
+    
+    VideoRecorder::Stats stats = m_recorder->stats();
+    // Запись из предзаписи всегда в MJPEG: кольцо хранит сжатые кадры
+    const bool mjpeg = m_recorder->codec() == VideoRecorder::CodecMJPEG || stats.preRollFrames > 0 ||
+                       timelapse;
+    m_lastRecordingSummary = QString("%1, %2 кадров (из них предзапись %9), сжатие %3:1, "
+                                     "%4 кадр/с, %5 МБ; камера %6 кадр/с, потеряно %7, повторов %8")
+        .arg(mjpeg ? "MJPEG" : "RGB24")
+        .arg(stats.framesWritten)
+        .arg(stats.compressionRatio, 0, 'f', 1)
+        .arg(stats.sustainedFps, 0, 'f', 1)
+        .arg(stats.fileBytes / 1024.0 / 1024.0, 0, 'f', 1)
+        .arg(captureFps, 0, 'f', 1)
+        .arg(counters.dropped - m_videoStartCounters.dropped)
+        .arg(counters.duplicated - m_videoStartCounters.duplicated)
+        .arg(stats.preRollFrames);
+    if (timelapse) {
+        QMutexLocker locker(&m_mutex);
+        m_lastRecordingSummary += QString("; таймлапс: отобрано %1 из %2 кадров")
+            .arg(m_timelapse.framesKept()).arg(m_timelapse.framesSeen());
+    }
+    qDebug() << "Recording stats:" << m_lastRecordingSummary;
+    
+    if (success) {
+        qDebug() << "✅ Video saved as AVI:" << m_currentVideoPath << "-" << written << "frames";
+        emit videoRecordingStopped();
+    } else if (written == 0 && m_recorder->lastError().isEmpty()) {
         qDebug() << "❌ No frames captured!";
         emit errorOccurred("Не удалось записать видео - нет кадров");
+    } else {
+        qDebug() << "❌ Video recording failed:" << m_recorder->lastError();
+        emit videoRecordingStopped();
     }
     
-    m_videoFrames.clear();
-    
     qDebug() << "Video recording stopped";
     
-    // Останавливаем граф если превью не активно
-    if (!m_isPreviewActive && m_pMediaControl) {
-        m_pMediaControl->Stop();
-        qDebug() << "Media control stopped";
-    }
+    // Кольцо продолжает работать, пока активно превью
+    updatePreRoll();
+    
+    // Останавливаем источник если превью не активно
+    stopSourceIfIdle();
 }
 
 void CameraWorker::getCameraInfo()
@@ -533,13 +884,71 @@ void CameraWorker::getCameraInfo()
         info = "<p><b>Информация через Windows API недоступна</b></p>";
     }
     
-    // Добавляем информацию от DirectShow
-    info += "<hr><p><b>Информация от DirectShow:</b></p>";
+    // Добавляем информацию от источника кадров
+    info += QString("<hr><p><b>Информация от источника кадров (%1):</b></p>")
+        .arg(m_source ? m_source->name() : QString("нет"));
     
-    if (m_pVideoCapture) {
+    if (m_initialized) {
+        int width = 0;
+        int height = 0;
+        {
+            QMutexLocker locker(&m_mutex);
+            width = m_videoFrameWidth;
+            height = m_videoFrameHeight;
+        }
+        const FrameSource::Counters counters = m_source->counters();
+        
         info += "<p><b>Статус:</b> Камера подключена</p>";
-        info += "<p><b>API:</b> DirectShow (Windows нативный)</p>";
-        info += QString("<p><b>Разрешение:</b> %1x%2</p>").arg(m_videoFrameWidth).arg(m_videoFrameHeight);
+        info += m_source->description();
+        info += QString("<p><b>Разрешение:</b> %1x%2</p>").arg(width).arg(height);
+        
+        QStringList modes;
+        const QList<CaptureMode> supported = m_source->supportedModes();
+        for (int i = 0; i < supported.size(); ++i) {
+            modes << supported[i].toString();
+        }
+        info += QString("<p><b>Режимы захвата:</b> %1</p>")
+            .arg(modes.isEmpty() ? QString("нет данных") : modes.join(", "));
+        info += QString("<p><b>Кадров получено:</b> %1, потеряно: %2, повторов: %3</p>")
+            .arg(counters.delivered).arg(counters.dropped).arg(counters.duplicated);
+        info += QString("<p><b>Кадров превью пропущено:</b> %1 (окно выводит только последний кадр)</p>")
+            .arg(previewFramesSkipped());
+        info += QString("<p><b>Формат записи:</b> %1</p>")
+            .arg(m_recorder->codec() == VideoRecorder::CodecMJPEG ? "Motion-JPEG" : "Без сжатия (BI_RGB)");
+        if (m_recorder->isPreRollActive()) {
+            info += QString("<p><b>Предзапись:</b> до %1 с, в кольце %2 кадров, %3 из %4 МБ</p>")
+                .arg(m_preRollSeconds)
+                .arg(m_recorder->preRollFrameCount())
+                .arg(m_recorder->preRollBytes() / 1024.0 / 1024.0, 0, 'f', 1)
+                .arg(m_preRollBudget / 1024.0 / 1024.0, 0, 'f', 1);
+        }
+        if (isTimelapseEnabled()) {
+            QStringList rules;
+            if (m_timelapseIntervalMs > 0) {
+                rules << QString("кадр раз в %1 с").arg(m_timelapseIntervalMs / 1000.0);
+            }
+            if (m_timelapseThreshold > 0) {
+                rules << QString("при смене сцены (порог %1)").arg(m_timelapseThreshold);
+            }
+            info += QString("<p><b>Таймлапс:</b> %1, воспроизведение %2 кадр/с</p>")
+                .arg(rules.join(", ")).arg(m_timelapseFps);
+        }
+        if (m_motionDetection) {
+            bool active = false;
+            int peak = 0;
+            {
+                QMutexLocker locker(&m_motionMutex);
+                active = m_motion.isActive();
+                peak = m_motion.peakDifference();
+            }
+            info += QString("<p><b>Детектор движения:</b> %1 (разница %2 из 255)%3</p>")
+                .arg(active ? "движение" : "нет движения")
+                .arg(peak)
+                .arg(m_motionRecording ? ", запись по движению" : "");
+        }
+        if (!m_lastRecordingSummary.isEmpty()) {
+            info += QString("<p><b>Последняя запись:</b> %1</p>").arg(m_lastRecordingSummary);
+        }
     } else {
         info += "<p>Камера не найдена</p>";
     }
@@ -547,8 +956,28 @@ void CameraWorker::getCameraInfo()
     emit cameraInfoReady(info);
 }
 
+void CameraWorker::setVideoCodec(VideoRecorder::Codec codec)
+{
+    if (m_isRecordingVideo) {
+        qDebug() << "Video codec change ignored while recording";
+        return;
+    }
+    m_recorder->setCodec(codec);
+}
+
+VideoRecorder::Codec CameraWorker::videoCodec() const
+{
+    return m_recorder->codec();
+}
+
 void CameraWorker::stopAll()
 {
+    // Кадры для фото больше не ждём; уже взятые кадры дописываются пулом
+    {
+        QMutexLocker locker(&m_mutex);
+        m_photosRequested = 0;
+    }
+    
     if (m_isRecordingVideo) {
         stopVideoRecording();
     }
@@ -556,119 +985,325 @@ void CameraWorker::stopAll()
     stopPreview();
 }
 
-void CameraWorker::captureFrame()
+void CameraWorker::formatChanged(const FrameFormat &format)
 {
-    if (!m_pGrabber) {
+    qDebug() << "Frame format:" << format.width << "x" << format.height
+             << FrameFormat::pixelFormatName(format.pixelFormat)
+             << (format.bottomUp ? "bottom-up" : "top-down") << "stride" << format.stride;
+    
+    m_format = format;
+    m_convert = nullptr;
+    m_framePixelFormat = FrameFormat::FormatRGB24;
+    m_convertRow = nullptr;
+    // Кадр RGB888 должен поместиться в QImage (размер в байтах - int)
+    if (!format.isValid() ||
+        qint64(format.width) * 3 * format.height > std::numeric_limits<int>::max()) {
+        qDebug() << "Unsupported frame format, frames are ignored";
         return;
     }
     
+    // Преобразование выбирается один раз на формат; для RGB - строковое
+    // ядро BGR -> RGB (SIMD) или копирование. YUV остаётся в своей раскладке
+    // (в RGB его переводят превью, фото и запись)
+    switch (format.pixelFormat) {
+    case FrameFormat::FormatBGR24:
+        m_convert = &CameraWorker::convertRgb;
+        m_convertRow = PixelConvert::swapRedBlue24Row();
+        break;
+    case FrameFormat::FormatRGB24:
+        m_convert = &CameraWorker::convertRgb;
+        m_convertRow = copyRgb24Row;
+        break;
+    case FrameFormat::FormatYUY2:
+    case FrameFormat::FormatNV12:
+        m_convert = &CameraWorker::copyYuv;
+        m_framePixelFormat = format.pixelFormat;
+        break;
+    case FrameFormat::FormatMJPEG:
+        m_convert = &CameraWorker::decodeMjpeg;
+        break;
+    }
+    // Слоты пула перевыделяются только здесь
+    const QSize bufferSize = VideoFrame::bufferSize(m_framePixelFormat, format.width, format.height);
+    m_framePool.configure(bufferSize.width(), bufferSize.height(),
+                          VideoFrame::bufferFormat(m_framePixelFormat));
+    
     QMutexLocker locker(&m_mutex);
+    m_videoFrameWidth = format.width;
+    m_videoFrameHeight = format.height;
+}
+
+bool CameraWorker::convertRgb(const RawFrame &raw, uchar *dst, int dstStride)
+{
+    PixelConvert::convertImage(m_convertRow, raw.data, m_format.stride, dst, dstStride,
+                               m_format.width, m_format.height, m_format.bottomUp);
+    return true;
+}
+
+bool CameraWorker::copyYuv(const RawFrame &raw, uchar *dst, int dstStride)
+{
+    // Строки Y (и UV у NV12) копируются без преобразования
+    const QSize bufferSize = VideoFrame::bufferSize(m_format.pixelFormat, m_format.width, m_format.height);
+    const int rowBytes = qMin(bufferSize.width(), m_format.stride);
+    for (int y = 0; y < bufferSize.height(); ++y) {
+        memcpy(dst + y * dstStride, raw.data + y * m_format.stride, rowBytes);
+    }
+    return true;
+}
+
+bool CameraWorker::decodeMjpeg(const RawFrame &raw, uchar *dst, int dstStride)
+{
+    // Камеры иногда отдают обрезанные JPEG (особенно при смене экспозиции)
+    QImage decoded;
+    if (!decoded.loadFromData(raw.data, raw.size, "JPG") ||
+        decoded.size() != QSize(m_format.width, m_format.height)) {
+        return false;
+    }
+    if (decoded.format() != QImage::Format_RGB888) {
+        decoded = decoded.convertToFormat(QImage::Format_RGB888);
+    }
+    for (int y = 0; y < m_format.height; ++y) {
+        memcpy(dst + y * dstStride, decoded.constScanLine(y), m_format.width * 3);
+    }
+    return true;
+}
+
+void CameraWorker::frameArrived(const RawFrame &raw)
+{
+    // Кадр короче формата (обрезан драйвером) не преобразуется
+    if (!m_convert || raw.size < m_format.frameBytes()) {
+        return;
+    }
     
-    long bufferSize = 0;
-    HRESULT hr = m_pGrabber->GetCurrentBuffer(&bufferSize, NULL);
-    if (FAILED(hr) || bufferSize == 0) {
+    const qint64 arrivalUs = m_pipelineStats.nowUs();
+    const int width = m_format.width;
+    const int height = m_format.height;
+    
+    // Берём свободный слот пула; если все слоты заняты потребителями,
+    // выделяем отдельный кадр (как раньше)
+    const int slot = m_framePool.acquire();
+    QImage buffer;
+    uchar *dstBase = nullptr;
+    int dstStride = 0;
+    if (slot >= 0) {
+        dstBase = m_framePool.slotData(slot);
+        dstStride = m_framePool.bytesPerLine();
+    } else {
+        buffer = QImage(VideoFrame::bufferSize(m_framePixelFormat, width, height),
+                        VideoFrame::bufferFormat(m_framePixelFormat));
+        dstBase = buffer.bits();
+        dstStride = buffer.bytesPerLine();
+    }
+    m_pipelineStats.recordSince(PipelineStats::StageAcquire, arrivalUs);
+    
+    const qint64 convertStartUs = m_pipelineStats.nowUs();
+    const bool converted = (this->*m_convert)(raw, dstBase, dstStride);
+    m_pipelineStats.recordSince(PipelineStats::StageConvert, convertStartUs);
+    if (!converted) {
+        if (slot >= 0) {
+            m_framePool.release(slot);
+        }
         return;
     }
     
-    char *pBuffer = new(std::nothrow) char[bufferSize];
-    if (!pBuffer) { return; }
-    hr = m_pGrabber->GetCurrentBuffer(&bufferSize, (long*)pBuffer);
+    if (slot >= 0) {
+        buffer = m_framePool.wrap(slot);
+    }
+    const VideoFrame frame(buffer, m_framePixelFormat, width, height);
     
-    if (SUCCEEDED(hr)) {
-        // Получаем формат кадра
-        AM_MEDIA_TYPE mt;
-        hr = m_pGrabber->GetConnectedMediaType(&mt);
-        if (SUCCEEDED(hr) && mt.formattype == FORMAT_VideoInfo) {
-            VIDEOINFOHEADER *pVih = (VIDEOINFOHEADER*)mt.pbFormat;
-            
-            int width = pVih->bmiHeader.biWidth;
-            int height = abs(pVih->bmiHeader.biHeight);
-            
-            m_videoFrameWidth = width;
-            m_videoFrameHeight = height;
-            
-            // Создаем QImage из буфера
-            if (width <= 0 || height <= 0 || width > 4096 || height > 4096) {
-                delete[] pBuffer;
-                return;
-            }
-            QImage frame(width, height, QImage::Format_RGB888);
-            
-            // Копируем данные (BGR -> RGB и переворачиваем)
-            for (int y = 0; y < height; y++) {
-                uchar *dest = frame.scanLine(height - 1 - y);
-                const uchar *src = (const uchar*)(pBuffer + y * width * 3);
-                
-                for (int x = 0; x < width; x++) {
-                    dest[x * 3 + 0] = src[x * 3 + 2]; // R
-                    dest[x * 3 + 1] = src[x * 3 + 1]; // G
-                    dest[x * 3 + 2] = src[x * 3 + 0]; // B
-                }
+    bool preview = false;
+    QSize previewSize;
+    {
+        QMutexLocker locker(&m_mutex);
+        
+        preview = m_isPreviewActive;
+        
+        // Кадры для запрошенных фото (первые кадры после запуска пропускаются)
+        if (m_photosRequested > 0) {
+            if (m_photoWarmupFrames > 0) {
+                m_photoWarmupFrames--;
+            } else {
+                m_photosRequested--;
+                startPhotoTask(frame);
             }
-            
-            m_currentFrame = frame;
-            
-            // Отправляем кадр для превью
-            if (m_isPreviewActive) {
-                emit frameReady(frame);
+        }
+        previewSize = m_previewSize;
+        
+        m_lastArrivalUs = arrivalUs;
+        if (m_videoStopUs >= 0 && arrivalUs >= m_videoStopUs) {
+            m_videoStopReached.wakeAll();
+        }
+        
+        // Отдаём кадр потоку записи (без копирования); с предзаписью
+        // кадры идут в кольцо и до начала записи
+        bool record = m_isRecordingVideo && arrivalUs >= m_videoStartUs &&
+                      (m_videoStopUs < 0 || arrivalUs < m_videoStopUs);
+        // Таймлапс: в файл идут только отобранные кадры (остальные даже
+        // не сжимаются)
+        if (record && m_isTimelapse) {
+            record = m_timelapse.accept(frame, arrivalUs);
+        }
+        if (record || m_isPreRollActive) {
+            m_recorder->pushFrame(frame);
+        }
+        if (record) {
+            m_videoFrameCount++;
+            if (m_videoFirstTimestampUs < 0) {
+                m_videoFirstTimestampUs = raw.timestampUs;
             }
+            m_videoLastTimestampUs = raw.timestampUs;
             
-            // Сохраняем кадр для видео
-            if (m_isRecordingVideo) {
-                m_videoFrames.append(frame);
-                m_videoFrameCount++;
-                
-                if (m_videoFrameCount % 30 == 0) {
-                    qDebug() << "Video: captured" << m_videoFrameCount << "frames";
-                }
-                
-                // Ограничиваем количество кадров (чтобы не забить память)
-                if (m_videoFrames.count() > 300) { // ~10 секунд при 30 FPS
-                    m_videoFrames.removeFirst();
-                }
+            if (m_videoFrameCount % 30 == 0) {
+                qDebug() << "Video: captured" << m_videoFrameCount << "frames"
+                         << "(written:" << m_recorder->framesWritten()
+                         << "dropped:" << m_recorder->framesDropped()
+                         << "pool free:" << m_framePool.freeSlots() << ")";
             }
-            
-            FreeMediaType(mt);
         }
     }
     
-    delete[] pBuffer;
+    // Движение ищется на уменьшенной плоскости яркости, без RGB
+    detectMotion(frame, arrivalUs);
+    
+    // Кадр для превью уменьшается здесь, окну остаётся только вывести его
+    if (preview) {
+        const qint64 scaleStartUs = m_pipelineStats.nowUs();
+        const QImage scaled = scalePreview(frame, previewSize);
+        m_pipelineStats.recordSince(PipelineStats::StageScale, scaleStartUs);
+        postPreviewFrame(scaled, arrivalUs);
+    }
 }
 
-QImage CameraWorker::captureCurrentFrame()
+void CameraWorker::postPreviewFrame(const QImage &preview, qint64 arrivalUs)
 {
-    // Ждем захвата кадра
-    for (int i = 0; i < 10; i++) {
-        QThread::msleep(50);
-        QMutexLocker locker(&m_mutex);
-        if (!m_currentFrame.isNull()) {
-            return m_currentFrame;
+    {
+        QMutexLocker locker(&m_previewMutex);
+        const bool wasPending = m_previewPending;
+        m_previewFrame = preview;
+        m_previewArrivalUs = arrivalUs;
+        m_previewReadyUs = m_pipelineStats.nowUs();
+        m_previewPending = true;
+        if (wasPending) {
+            // Окно ещё не забрало предыдущий кадр - уведомление уже в очереди
+            m_previewSkipped++;
+            return;
         }
     }
     
-    return QImage();
+    // Сигнал доставляется в поток окна через очередь событий
+    emit previewFrameReady();
 }
 
-bool CameraWorker::saveFrame(const QImage &frame, const QString &filePath)
+QImage CameraWorker::takePreviewFrame()
 {
-    if (frame.isNull()) {
-        return false;
+    QMutexLocker locker(&m_previewMutex);
+    QImage frame = m_previewFrame;
+    // Слот пула превью освобождается, как только окно выведет кадр
+    m_previewFrame = QImage();
+    if (m_previewPending) {
+        m_shownArrivalUs = m_previewArrivalUs;
+        m_shownReadyUs = m_previewReadyUs;
+    }
+    m_previewPending = false;
+    return frame;
+}
+
+void CameraWorker::previewFrameShown()
+{
+    qint64 arrivalUs = -1;
+    qint64 readyUs = -1;
+    {
+        QMutexLocker locker(&m_previewMutex);
+        arrivalUs = m_shownArrivalUs;
+        readyUs = m_shownReadyUs;
+        m_shownArrivalUs = -1;
+        m_shownReadyUs = -1;
+    }
+    if (arrivalUs < 0) {
+        return;
     }
     
-    return frame.save(filePath, "JPG", 90);
+    const qint64 nowUs = m_pipelineStats.nowUs();
+    m_pipelineStats.record(PipelineStats::StageDeliver, nowUs - readyUs);
+    m_pipelineStats.record(PipelineStats::StageEndToEnd, nowUs - arrivalUs);
+}
+
+qint64 CameraWorker::previewFramesSkipped() const
+{
+    QMutexLocker locker(&m_previewMutex);
+    return m_previewSkipped;
+}
+
+QImage CameraWorker::scalePreview(const VideoFrame &frame, const QSize &area)
+{
+    if (area.isEmpty()) {
+        // Размер области ещё не известен
+        return frame.toImage();
+    }
+    
+    const QSize target = frame.size().scaled(area, Qt::KeepAspectRatio);
+    if (target.isEmpty()) {
+        return QImage();
+    }
+    
+    const int scratchSize = frame.isYuv()
+        ? PixelConvert::scaleYuvScratchSize(frame.width(), frame.height(), target.width(), target.height())
+        : PixelConvert::scaleScratchSize(frame.width(), frame.height(), target.width(), target.height());
+    if (m_previewScratch.size() < scratchSize) {
+        m_previewScratch.resize(scratchSize);
+    }
+    
+    m_previewPool.configure(target.width(), target.height(), QImage::Format_RGB32);
+    const int slot = m_previewPool.acquire();
+    QImage preview;
+    uchar *dst = nullptr;
+    int dstStride = 0;
+    if (slot >= 0) {
+        dst = m_previewPool.slotData(slot);
+        dstStride = m_previewPool.bytesPerLine();
+    } else {
+        preview = QImage(target, QImage::Format_RGB32);
+        dst = preview.bits();
+        dstStride = preview.bytesPerLine();
+    }
+    
+    // YUV уменьшается и переводится в RGB за один проход (SIMD)
+    uchar *scratch = reinterpret_cast<uchar*>(m_previewScratch.data());
+    if (frame.isYuv()) {
+        const PixelConvert::YuvLayout layout = frame.pixelFormat() == FrameFormat::FormatYUY2
+            ? PixelConvert::YuvYUY2 : PixelConvert::YuvNV12;
+        PixelConvert::scaleYuvToRgb32(layout, frame.constBits(), frame.bytesPerLine(),
+                                      frame.width(), frame.height(),
+                                      dst, dstStride, target.width(), target.height(), scratch);
+    } else {
+        PixelConvert::scaleRgb24ToRgb32(frame.constBits(), frame.bytesPerLine(),
+                                        frame.width(), frame.height(),
+                                        dst, dstStride, target.width(), target.height(), scratch);
+    }
+    
+    if (slot >= 0) {
+        preview = m_previewPool.wrap(slot);
+    }
+    return preview;
 }
 
 QString CameraWorker::generateFileName(const QString &prefix, const QString &extension)
 {
     QDateTime now = QDateTime::currentDateTime();
     QString timestamp = now.toString("yyyyMMdd_HHmmss_zzz");
+    if (!m_name.isEmpty()) {
+        return QString("%1_%2_%3.%4").arg(prefix, m_name, timestamp, extension);
+    }
     return QString("%1_%2.%3").arg(prefix).arg(timestamp).arg(extension);
 }
 
 QString CameraWorker::getOutputDirectory()
 {
-    QString documentsPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
-    QString outputPath = documentsPath + "/Lab4_CameraCaptures";
+    QString outputPath = m_outputDirectory;
+    if (outputPath.isEmpty()) {
+        QString documentsPath = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
+        outputPath = documentsPath + "/Lab4_CameraCaptures";
+    }
     
     QDir dir;
     if (!dir.exists(outputPath)) {
@@ -687,6 +1322,7 @@ QString CameraWorker::getCameraInfoWindows()
 {
     QString result;
     
+#ifdef Q_OS_WIN
     try {
         SP_DEVINFO_DATA deviceInfoData;
         ZeroMemory(&deviceInfoData, sizeof(SP_DEVINFO_DATA));
@@ -782,116 +1418,7 @@ QString CameraWorker::getCameraInfoWindows()
     catch (...) {
         return QString();
     }
+#endif
     
     return result;
 }
-
-// Вспомогательная функция для освобождения AM_MEDIA_TYPE
-void FreeMediaType(AM_MEDIA_TYPE& mt)
-{
-    if (mt.cbFormat != 0) {
-        CoTaskMemFree((PVOID)mt.pbFormat);
-        mt.cbFormat = 0;
-        mt.pbFormat = NULL;
-    }
-    if (mt.pUnk != NULL) {
-        mt.pUnk->Release();
-        mt.pUnk = NULL;
-    }
-}
-
-// Сохранение видео в AVI файл
-bool CameraWorker::saveVideoToAVI(const QString &filePath, const QList<QImage> &frames, int width, int height)
-{
-    if (frames.isEmpty()) {
-        return false;
-    }
-    
-    // Конвертируем QString в wchar_t для Windows API
-    std::wstring wFilePath = filePath.toStdWString();
-    
-    // Создаем AVI файл
-    PAVIFILE pAviFile = nullptr;
-    HRESULT hr = AVIFileOpenW(&pAviFile, wFilePath.c_str(), OF_CREATE | OF_WRITE, nullptr);
-    if (FAILED(hr)) {
-        qDebug() << "Failed to create AVI file:" << filePath;
-        return false;
-    }
-    
-    // Настройка видео потока
-    AVISTREAMINFO aviStreamInfo;
-    memset(&aviStreamInfo, 0, sizeof(AVISTREAMINFO));
-    aviStreamInfo.fccType = streamtypeVIDEO;
-    aviStreamInfo.fccHandler = 0; // BI_RGB (uncompressed)
-    aviStreamInfo.dwScale = 1;
-    aviStreamInfo.dwRate = 30; // 30 FPS
-    aviStreamInfo.dwSuggestedBufferSize = width * height * 3;
-    aviStreamInfo.rcFrame.left = 0;
-    aviStreamInfo.rcFrame.top = 0;
-    aviStreamInfo.rcFrame.right = width;
-    aviStreamInfo.rcFrame.bottom = height;
-    
-    PAVISTREAM pVideoStream = nullptr;
-    hr = AVIFileCreateStreamW(pAviFile, &pVideoStream, &aviStreamInfo);
-    if (FAILED(hr)) {
-        qDebug() << "Failed to create video stream";
-        AVIFileRelease(pAviFile);
-        return false;
-    }
-    
-    // Настройка формата видео (uncompressed BI_RGB)
-    BITMAPINFOHEADER bih;
-    memset(&bih, 0, sizeof(BITMAPINFOHEADER));
-    bih.biSize = sizeof(BITMAPINFOHEADER);
-    bih.biWidth = width;
-    bih.biHeight = height;
-    bih.biPlanes = 1;
-    bih.biBitCount = 24;
-    bih.biCompression = BI_RGB; // uncompressed
-    bih.biSizeImage = width * height * 3;
-    
-    hr = AVIStreamSetFormat(pVideoStream, 0, &bih, sizeof(bih));
-    if (FAILED(hr)) {
-        qDebug() << "Failed to set video format";
-        AVIStreamRelease(pVideoStream);
-        AVIFileRelease(pAviFile);
-        return false;
-    }
-    
-    // Записываем кадры (плотный буфер без выравнивания строк)
-    const LONG bytesPerFrame = width * height * 3;
-    QByteArray packed(bytesPerFrame, 0);
-    for (int i = 0; i < frames.count(); ++i) {
-        const QImage &srcFrame = frames[i];
-        // Конвертируем во внутренний формат для удобного доступа к пикселям
-        QImage rgb = srcFrame.convertToFormat(QImage::Format_RGB888);
-        // Формируем буфер BGR, bottom-up
-        uchar *dst = reinterpret_cast<uchar*>(packed.data());
-        for (int y = 0; y < height; ++y) {
-            const uchar *srcLine = rgb.constScanLine(y);
-            // Целевая строка внизу-вверх
-            int dstRow = (height - 1 - y) * width * 3;
-            for (int x = 0; x < width; ++x) {
-                const int si = x * 3; // RGB
-                const int di = dstRow + x * 3; // BGR
-                dst[di + 0] = srcLine[si + 2]; // B
-                dst[di + 1] = srcLine[si + 1]; // G
-                dst[di + 2] = srcLine[si + 0]; // R
-            }
-        }
-        LONG written = 0;
-        hr = AVIStreamWrite(pVideoStream, i, 1, (LPVOID)packed.data(), bytesPerFrame, AVIIF_KEYFRAME, nullptr, &written);
-        if (FAILED(hr)) {
-            qDebug() << "Failed to write frame" << i << "hr:" << hr;
-            break;
-        }
-    }
-    
-    // Освобождаем ресурсы
-    AVIStreamRelease(pVideoStream);
-    AVIFileRelease(pAviFile);
-    
-    qDebug() << "AVI file saved successfully:" << filePath << "with" << frames.count() << "frames";
-    return true;
-}
-
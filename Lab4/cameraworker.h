@@ -4,32 +4,122 @@
 #include <QObject>
 #include <QImage>
 #include <QString>
-#include <QTimer>
 #include <QMutex>
-#include <windows.h>
-#include <dshow.h>
+#include <QWaitCondition>
+#include <QThreadPool>
+#include <QList>
+#include <QRect>
+#include "framepool.h"
+#include "videoframe.h"
+#include "framesource.h"
+#include "pixelconvert.h"
+#include "videorecorder.h"
+#include "pipelinestats.h"
+#include "timelapsefilter.h"
+#include "motiondetector.h"
 
-// Forward declarations
-struct ISampleGrabber;
-
-class CameraWorker : public QObject
+// Кадры приходят от источника в его потоке (FrameSink::frameArrived).
+// Кадр превью кладётся в одноместный "почтовый ящик": окно забирает
+// последний кадр, а не успевшие к выводу кадры заменяются новыми, поэтому
+// очередь событий не копит устаревшие кадры.
+class CameraWorker : public QObject, private FrameSink
 {
     Q_OBJECT
 
 public:
+    // Источник кадров задаётся переменной окружения LAB4_CAMERA_SOURCE
+    // (см. FrameSource::create), по умолчанию - камера платформы
     explicit CameraWorker(QObject *parent = nullptr);
+    // Работа с заданным источником (CameraWorker становится владельцем)
+    explicit CameraWorker(FrameSource *source, QObject *parent = nullptr);
     ~CameraWorker();
 
     // Управление превью
     void startPreview();
     void stopPreview();
     
-    // Захват фото
-    void takePhoto();
+    // Режимы захвата источника (размер, частота, формат пикселей) и выбор
+    // режима. Смена режима переоткрывает источник; превью продолжается в
+    // новом режиме, во время записи режим не меняется. Режим при запуске
+    // задаётся переменной окружения LAB4_CAPTURE_MODE ("1280x720@30 MJPEG",
+    // см. CaptureMode::fromString)
+    QList<CaptureMode> supportedModes() const;
+    CaptureMode captureMode() const;
+    bool setCaptureMode(const CaptureMode &mode);
+    
+    // Размер области превью. Кадры превью уменьшаются до него
+    // (с сохранением пропорций) в потоке источника, а не в окне
+    void setPreviewSize(const QSize &size);
+    
+    // Последний кадр превью (Format_RGB32, размер области превью).
+    // Пустой, если новых кадров после предыдущего вызова не было
+    QImage takePreviewFrame();
+    
+    // Кадры превью, заменённые более новыми до того, как окно их забрало
+    qint64 previewFramesSkipped() const;
+    
+    // Окно вывело кадр, полученный последним takePreviewFrame() (этапы
+    // deliver и end-to-end). Вызывается в потоке окна
+    void previewFrameShown();
+    
+    // Время этапов конвейера с момента запуска превью (или resetPipelineStats)
+    PipelineStats::Snapshot pipelineStats() const { return m_pipelineStats.snapshot(); }
+    void resetPipelineStats() { m_pipelineStats.reset(); }
+    
+    // Кадры, отброшенные записью видео (очередь переполнена)
+    int videoFramesDropped() const { return m_recorder->framesDropped(); }
+    // Итоги текущей или последней записи
+    VideoRecorder::Stats videoStats() const { return m_recorder->stats(); }
+    
+    // Захват фото: следующие count кадров потока сохраняются в JPEG пулом
+    // потоков, по каждому сохранённому - сигнал photoSaved. Не блокирует
+    // вызывающий поток; серия снимков сжимается параллельно с захватом
+    void takePhoto(int count = 1);
+    
+    // Предзапись: последние seconds секунд потока хранятся сжатыми в кольце
+    // не больше byteBudget байт, пока активно превью, и попадают в начало
+    // следующей записи. 0 секунд - выключена. По умолчанию задаётся
+    // переменными окружения LAB4_PREROLL_SECONDS и LAB4_PREROLL_MB
+    void setPreRoll(int seconds, qint64 byteBudget);
+    
+    // Таймлапс: запись сохраняет кадр раз в intervalMs и/или при смене
+    // сцены (см. TimelapseFilter) и пишет кадры в MJPEG с частотой
+    // playbackFps, поэтому часы съёмки дают небольшой файл. 0 и 0 - обычная
+    // запись. Задаётся до записи; по умолчанию - переменные окружения
+    // LAB4_TIMELAPSE_SECONDS и LAB4_TIMELAPSE_SCENE
+    void setTimelapse(int intervalMs, int sceneThreshold, int playbackFps = 30);
+    bool isTimelapseEnabled() const { return m_timelapseIntervalMs > 0 || m_timelapseThreshold > 0; }
+    
+    // Детектор движения (см. MotionDetector) работает в потоке источника,
+    // пока источник запущен (превью, запись, фото), и сообщает о движении
+    // сигналами motionDetected/motionStopped. Запись по движению: начало
+    // движения запускает запись (с предзаписью файл начнётся раньше
+    // движения), а через MOTION_POST_ROLL_MS после его окончания запись
+    // останавливается. По умолчанию - переменные окружения LAB4_MOTION и
+    // LAB4_MOTION_RECORD
+    void setMotionDetection(bool enabled);
+    bool isMotionDetectionEnabled() const { return m_motionDetection; }
+    void setMotionRecording(bool enabled);
+    bool isMotionRecordingEnabled() const { return m_motionRecording; }
+    // Идущая запись запущена движением
+    bool isRecordingByMotion() const { return m_recordingByMotion; }
+    
+    // Запись видео. startUs/stopUs - общее для нескольких камер время
+    // (PipelineStats::nowUs()): в файл попадают кадры, полученные от
+    // источника в [startUs, stopUs). -1 - с ближайшего / до последнего кадра
+    void startVideoRecording(qint64 startUs = -1);
+    void stopVideoRecording(qint64 stopUs = -1);
+    bool isRecordingVideo() const { return m_isRecordingVideo; }
+    
+    // Имя камеры добавляется к именам файлов (несколько камер пишут в одну папку)
+    void setName(const QString &name) { m_name = name; }
+    QString name() const { return m_name; }
+    
+    // Папка для фото и видео (по умолчанию Documents/Lab4_CameraCaptures)
+    void setOutputDirectory(const QString &path) { m_outputDirectory = path; }
     
-    // Запись видео
-    void startVideoRecording();
-    void stopVideoRecording();
+    // Общий пул сжатия видео для нескольких камер (см. CameraGroup)
+    void setEncoderPool(QThreadPool *pool) { m_recorder->setEncoderPool(pool); }
     
     // Получение информации о камере
     void getCameraInfo();
@@ -45,22 +135,61 @@ public:
 
     // Текущий путь видеофайла (как в обычном режиме)
     QString getCurrentVideoPath() const { return m_currentVideoPath; }
+    
+    // Формат записи видео (по умолчанию MJPEG)
+    void setVideoCodec(VideoRecorder::Codec codec);
+    VideoRecorder::Codec videoCodec() const;
+
+    // Счётчики доставки кадров источником
+    FrameSource::Counters captureCounters() const;
 
 signals:
-    void frameReady(const QImage &frame);
+    // В пустом ящике появился кадр превью (см. takePreviewFrame)
+    void previewFrameReady();
     void videoRecordingStarted();
     void videoRecordingStopped();
     void photoSaved(const QString &path);
     void errorOccurred(const QString &error);
     void cameraInfoReady(const QString &info);
+    
+    // Началось движение (затем - пока оно продолжается, не чаще раза в
+    // MOTION_EVENT_INTERVAL_MS); regions - области в координатах кадра.
+    // Движения нет дольше порога удержания. Из потока источника
+    void motionDetected(const QList<QRect> &regions);
+    void motionStopped();
+    
+    // Фото сжато и записано (из пула потоков, для внутреннего использования)
+    void photoEncoded(const QString &path, bool ok);
 
 private slots:
-    void captureFrame();
+    void onPhotoEncoded(const QString &path, bool ok);
+    // Запуск и остановка записи по движению (поток worker'а)
+    void onMotionDetected(const QList<QRect> &regions);
+    void onMotionStopped();
 
 private:
-    // Инициализация DirectShow
-    bool initializeDirectShow();
-    void releaseDirectShow();
+    class PhotoTask;
+    
+    // Согласованный формат кадров и новый кадр от источника (поток источника)
+    void formatChanged(const FrameFormat &format) override;
+    void frameArrived(const RawFrame &raw) override;
+    
+    // Кадр источника в слот пула (поток источника), выбирается по формату
+    // в formatChanged(). YUY2 и NV12 копируются как есть и преобразуются в
+    // RGB потребителями (VideoFrame), RGB и MJPEG приводятся к RGB888.
+    // false - кадр повреждён и пропускается
+    typedef bool (CameraWorker::*ConvertFunc)(const RawFrame &raw, uchar *dst, int dstStride);
+    bool convertRgb(const RawFrame &raw, uchar *dst, int dstStride);
+    bool copyYuv(const RawFrame &raw, uchar *dst, int dstStride);
+    bool decodeMjpeg(const RawFrame &raw, uchar *dst, int dstStride);
+    
+    // Подключение к источнику кадров
+    bool openSource();
+    void closeSource();
+    
+    // Запуск/остановка источника по состоянию превью и записи
+    bool startSource();
+    void stopSourceIfIdle();
     
     // Генерация имени файла с датой и временем
     QString generateFileName(const QString &prefix, const QString &extension);
@@ -71,41 +200,120 @@ private:
     // Получение информации о камере через Windows API
     QString getCameraInfoWindows();
     
-    // Захват текущего кадра из DirectShow
-    QImage captureCurrentFrame();
+    // Кадр превью по размеру области вывода (поток источника)
+    QImage scalePreview(const VideoFrame &frame, const QSize &area);
+    void postPreviewFrame(const QImage &preview, qint64 arrivalUs);
+    
+    // Кадр для фото (поток источника, под m_mutex)
+    void startPhotoTask(const VideoFrame &frame);
     
-    // Сохранение кадра в файл
-    bool saveFrame(const QImage &frame, const QString &filePath);
+    // Запрошенные кадры так и не пришли
+    void photoTimeout(int generation);
     
-    // Сохранение видео в AVI файл
-    bool saveVideoToAVI(const QString &filePath, const QList<QImage> &frames, int width, int height);
+    // Запуск/остановка предзаписи по состоянию превью и записи
+    void updatePreRoll();
     
-    // DirectShow интерфейсы
-    IGraphBuilder *m_pGraph;
-    ICaptureGraphBuilder2 *m_pCapture;
-    IMediaControl *m_pMediaControl;
-    IBaseFilter *m_pVideoCapture;
-    ISampleGrabber *m_pGrabber;
-    IBaseFilter *m_pGrabberF;
+    // Кадр детектору движения (поток источника, без m_mutex)
+    void detectMotion(const VideoFrame &frame, qint64 arrivalUs);
+    // Забыть состояние детектора (источник остановлен или детектор выключен)
+    void resetMotion();
     
-    // Таймер для захвата кадров
-    QTimer *m_captureTimer;
-    QTimer *m_videoFrameTimer;
+    // Источник кадров (камера, генератор или файл)
+    FrameSource *m_source;
+    QString m_name;
+    QString m_outputDirectory;
     
-    // Мьютекс для потокобезопасности
+    // Мьютекс для потокобезопасности: защищает состояния и запросы фото,
+    // которые читает поток источника
     QMutex m_mutex;
     
     // Состояния
     bool m_initialized;
     bool m_isPreviewActive;
     bool m_isRecordingVideo;
+    bool m_isPreRollActive;
+    
+    // Пул буферов кадров (без выделения памяти на каждый кадр)
+    FramePool m_framePool;
+    
+    // Формат кадров источника, преобразование, раскладка кадров в пуле и
+    // строковое ядро для RGB. Меняются только в formatChanged(),
+    // используются потоком источника
+    FrameFormat m_format;
+    ConvertFunc m_convert;
+    FrameFormat::PixelFormat m_framePixelFormat;
+    PixelConvert::RowFunc m_convertRow;
+    
+    // Уменьшенные кадры превью (поток источника) и размер области превью
+    // (под m_mutex)
+    FramePool m_previewPool;
+    QByteArray m_previewScratch;
+    QSize m_previewSize;
+    
+    // Фото: кадры, которые ещё нужно взять из потока, и пропуск первых
+    // кадров после запуска камеры (под m_mutex)
+    int m_photosRequested;
+    int m_photoWarmupFrames;
+    QString m_photoDirectory;
+    QString m_lastPhotoName;
+    int m_photoNameRepeat;
+    // Пул сжатия фото и номер последнего запроса (поток worker'а)
+    QThreadPool m_photoPool;
+    int m_photoGeneration;
+    
+    // Ящик последнего кадра превью. Метки времени (PipelineStats::nowUs):
+    // получение кадра от источника и готовность кадра превью - для кадра в
+    // ящике и для последнего кадра, забранного окном
+    mutable QMutex m_previewMutex;
+    QImage m_previewFrame;
+    bool m_previewPending;
+    qint64 m_previewSkipped;
+    qint64 m_previewArrivalUs;
+    qint64 m_previewReadyUs;
+    qint64 m_shownArrivalUs;
+    qint64 m_shownReadyUs;
     
-    // Буфер для текущего кадра
-    QImage m_currentFrame;
+    // Время этапов конвейера (пишется из потоков источника, пулов и окна)
+    PipelineStats m_pipelineStats;
     
-    // Для записи видео (упрощенная версия - сохранение кадров)
-    QList<QImage> m_videoFrames;
+    // Потоковая запись видео (кадры пишутся в файл по мере захвата)
+    VideoRecorder *m_recorder;
     QString m_currentVideoPath;
+    QString m_lastRecordingSummary;
+    // Настройки предзаписи (поток worker'а)
+    int m_preRollSeconds;
+    qint64 m_preRollBudget;
+    // Настройки таймлапса (поток worker'а), отбор кадров идущей записи и
+    // признак записи таймлапса (под m_mutex); кодек до записи таймлапса
+    int m_timelapseIntervalMs;
+    int m_timelapseThreshold;
+    int m_timelapseFps;
+    TimelapseFilter m_timelapse;
+    bool m_isTimelapse;
+    VideoRecorder::Codec m_codecBeforeTimelapse;
+    // Детектор движения и время последнего сигнала motionDetected (под
+    // m_motionMutex: детектор работает вне m_mutex, чтобы не задерживать
+    // команды worker'а); настройки и запись по движению (поток worker'а),
+    // номер ожидающей остановки записи по движению
+    QMutex m_motionMutex;
+    MotionDetector m_motion;
+    bool m_motionEnabled;
+    qint64 m_motionEventUs;
+    bool m_motionDetection;
+    bool m_motionRecording;
+    bool m_recordingByMotion;
+    int m_motionStopGeneration;
+    // Метки времени первого/последнего кадра записи и счётчики источника
+    // на момент её начала (для итогов записи)
+    qint64 m_videoFirstTimestampUs;
+    qint64 m_videoLastTimestampUs;
+    FrameSource::Counters m_videoStartCounters;
+    // Границы записи по времени получения кадров и время последнего кадра
+    // (под m_mutex); m_videoStopReached - пришёл кадр после m_videoStopUs
+    qint64 m_videoStartUs;
+    qint64 m_videoStopUs;
+    qint64 m_lastArrivalUs;
+    QWaitCondition m_videoStopReached;
     int m_videoFrameCount;
     int m_videoFrameWidth;
     int m_videoFrameHeight;
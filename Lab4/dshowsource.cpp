@@ -0,0 +1,657 @@
+#include "dshowsource.h"
+#include <QDebug>
+
+#include <initguid.h>
+#include <qedit.h>
+
+// ISampleGrabber interface (qedit.h может не содержать все определения)
+EXTERN_C const CLSID CLSID_SampleGrabber;
+EXTERN_C const CLSID CLSID_NullRenderer;
+EXTERN_C const IID IID_ISampleGrabber;
+
+// Forward declaration вспомогательной функции
+void FreeMediaType(AM_MEDIA_TYPE& mt);
+
+// Подтипы YUV и MJPEG - FourCC в GUID вида XXXXXXXX-0000-0010-8000-00AA00389B71
+// (MinGW старых версий не объявляет MEDIASUBTYPE_NV12 и MEDIASUBTYPE_MJPG)
+static GUID fourccSubtype(DWORD fourcc)
+{
+    GUID guid = { fourcc, 0x0000, 0x0010, { 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 } };
+    return guid;
+}
+
+static bool pixelFormatForSubtype(const GUID &subtype, FrameFormat::PixelFormat *format)
+{
+    if (subtype == MEDIASUBTYPE_RGB24) {
+        *format = FrameFormat::FormatBGR24;
+    } else if (subtype == fourccSubtype(MAKEFOURCC('Y', 'U', 'Y', '2'))) {
+        *format = FrameFormat::FormatYUY2;
+    } else if (subtype == fourccSubtype(MAKEFOURCC('N', 'V', '1', '2'))) {
+        *format = FrameFormat::FormatNV12;
+    } else if (subtype == fourccSubtype(MAKEFOURCC('M', 'J', 'P', 'G'))) {
+        *format = FrameFormat::FormatMJPEG;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Частота по длительности кадра (единицы 100 нс)
+static int fpsForInterval(REFERENCE_TIME interval)
+{
+    return interval > 0 ? qMax(1, int((10000000 + interval / 2) / interval)) : 30;
+}
+
+// Приёмник сэмплов Sample Grabber. Время жизни совпадает с источником,
+// поэтому счётчик ссылок COM не используется.
+class DirectShowSource::GrabberCallback : public ISampleGrabberCB
+{
+public:
+    explicit GrabberCallback(DirectShowSource *owner) : m_owner(owner) {}
+    virtual ~GrabberCallback() {}
+    
+    STDMETHODIMP_(ULONG) AddRef() { return 2; }
+    STDMETHODIMP_(ULONG) Release() { return 1; }
+    
+    STDMETHODIMP QueryInterface(REFIID riid, void **ppv)
+    {
+        if (riid == IID_ISampleGrabberCB || riid == IID_IUnknown) {
+            *ppv = static_cast<ISampleGrabberCB*>(this);
+            return S_OK;
+        }
+        *ppv = NULL;
+        return E_NOINTERFACE;
+    }
+    
+    STDMETHODIMP SampleCB(double SampleTime, IMediaSample *pSample)
+    {
+        m_owner->sampleArrived(SampleTime, pSample);
+        return S_OK;
+    }
+    
+    STDMETHODIMP BufferCB(double, BYTE *, long)
+    {
+        return E_NOTIMPL;
+    }
+    
+private:
+    DirectShowSource *m_owner;
+};
+
+DirectShowSource::DirectShowSource(int deviceIndex)
+    : m_pGraph(nullptr),
+      m_pCapture(nullptr),
+      m_pMediaControl(nullptr),
+      m_pVideoCapture(nullptr),
+      m_pGrabber(nullptr),
+      m_pGrabberF(nullptr),
+      m_pDroppedFrames(nullptr),
+      m_callback(nullptr),
+      m_deviceIndex(deviceIndex),
+      m_initialized(false),
+      m_running(false),
+      m_width(640),
+      m_height(480),
+      m_stride(640 * 3),
+      m_fps(30),
+      m_pixelFormat(FrameFormat::FormatBGR24),
+      m_frameBytes(0),
+      m_requestedMode(640, 480, 30),
+      m_modeRequested(false),
+      m_droppedBefore(0)
+{
+    // Инициализируем COM
+    CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    
+    m_callback = new GrabberCallback(this);
+}
+
+DirectShowSource::~DirectShowSource()
+{
+    close();
+    delete m_callback;
+    
+    CoUninitialize();
+}
+
+bool DirectShowSource::open()
+{
+    if (m_initialized) {
+        return true;
+    }
+    
+    HRESULT hr;
+    
+    // Создаем Filter Graph Manager
+    hr = CoCreateInstance(CLSID_FilterGraph, NULL, CLSCTX_INPROC_SERVER,
+                         IID_IGraphBuilder, (void**)&m_pGraph);
+    if (FAILED(hr)) {
+        qDebug() << "Failed to create FilterGraph:" << hr;
+        setError("Не удалось создать граф DirectShow");
+        return false;
+    }
+    
+    // Создаем Capture Graph Builder
+    hr = CoCreateInstance(CLSID_CaptureGraphBuilder2, NULL, CLSCTX_INPROC_SERVER,
+                         IID_ICaptureGraphBuilder2, (void**)&m_pCapture);
+    if (FAILED(hr)) {
+        qDebug() << "Failed to create CaptureGraphBuilder2:" << hr;
+        setError("Не удалось создать граф DirectShow");
+        m_pGraph->Release();
+        m_pGraph = nullptr;
+        return false;
+    }
+    
+    // Связываем Capture Graph с Filter Graph
+    hr = m_pCapture->SetFiltergraph(m_pGraph);
+    if (FAILED(hr)) {
+        qDebug() << "Failed to set filter graph:" << hr;
+        setError("Не удалось создать граф DirectShow");
+        close();
+        return false;
+    }
+    
+    // Получаем интерфейс Media Control
+    hr = m_pGraph->QueryInterface(IID_IMediaControl, (void**)&m_pMediaControl);
+    if (FAILED(hr)) {
+        qDebug() << "Failed to get MediaControl:" << hr;
+        setError("Не удалось создать граф DirectShow");
+        close();
+        return false;
+    }
+    
+    // Создаем Video Capture Device
+    ICreateDevEnum *pDevEnum = nullptr;
+    IEnumMoniker *pEnum = nullptr;
+    
+    hr = CoCreateInstance(CLSID_SystemDeviceEnum, NULL, CLSCTX_INPROC_SERVER,
+                         IID_ICreateDevEnum, (void**)&pDevEnum);
+    if (FAILED(hr)) {
+        qDebug() << "Failed to create DeviceEnumerator:" << hr;
+        setError("Не удалось перечислить камеры");
+        close();
+        return false;
+    }
+    
+    hr = pDevEnum->CreateClassEnumerator(CLSID_VideoInputDeviceCategory, &pEnum, 0);
+    if (hr == S_OK) {
+        // Пропускаем устройства до нужного номера
+        if (m_deviceIndex <= 0 || pEnum->Skip(m_deviceIndex) == S_OK) {
+            IMoniker *pMoniker = nullptr;
+            if (pEnum->Next(1, &pMoniker, NULL) == S_OK) {
+                hr = pMoniker->BindToObject(NULL, NULL, IID_IBaseFilter, (void**)&m_pVideoCapture);
+                pMoniker->Release();
+            }
+        }
+        pEnum->Release();
+    }
+    pDevEnum->Release();
+    
+    if (m_pVideoCapture == nullptr) {
+        qDebug() << "No video capture device found, index" << m_deviceIndex;
+        setError("Камера не найдена");
+        close();
+        return false;
+    }
+    
+    // Добавляем Video Capture в граф
+    hr = m_pGraph->AddFilter(m_pVideoCapture, L"Video Capture");
+    if (FAILED(hr)) {
+        qDebug() << "Failed to add video capture filter:" << hr;
+        setError("Не удалось добавить камеру в граф DirectShow");
+        close();
+        return false;
+    }
+    
+    // Режим камеры задаётся на выходном контакте до соединения фильтров
+    GUID grabberSubtype = MEDIASUBTYPE_RGB24;
+    {
+        IAMStreamConfig *pConfig = nullptr;
+        hr = m_pCapture->FindInterface(&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
+                                       m_pVideoCapture, IID_IAMStreamConfig, (void**)&pConfig);
+        if (SUCCEEDED(hr) && pConfig) {
+            const bool configured = configureStream(pConfig, &grabberSubtype);
+            pConfig->Release();
+            if (!configured) {
+                close();
+                return false;
+            }
+        } else {
+            qDebug() << "IAMStreamConfig not available or FindInterface failed:" << hr;
+        }
+    }
+    
+    // Создаем Sample Grabber для захвата кадров
+    hr = CoCreateInstance(CLSID_SampleGrabber, NULL, CLSCTX_INPROC_SERVER,
+                         IID_IBaseFilter, (void**)&m_pGrabberF);
+    if (FAILED(hr)) {
+        qDebug() << "Failed to create SampleGrabber filter:" << hr;
+        // Продолжаем без grabber'а (не критично)
+    } else {
+        hr = m_pGraph->AddFilter(m_pGrabberF, L"Sample Grabber");
+        if (SUCCEEDED(hr)) {
+            hr = m_pGrabberF->QueryInterface(IID_ISampleGrabber, (void**)&m_pGrabber);
+            if (SUCCEEDED(hr)) {
+                // Настраиваем Sample Grabber
+                AM_MEDIA_TYPE mt;
+                ZeroMemory(&mt, sizeof(AM_MEDIA_TYPE));
+                mt.majortype = MEDIATYPE_Video;
+                mt.subtype = grabberSubtype;
+                m_pGrabber->SetMediaType(&mt);
+                // Кадры забираются в SampleCB, копия в Sample Grabber не нужна
+                m_pGrabber->SetBufferSamples(FALSE);
+                m_pGrabber->SetOneShot(FALSE);
+                m_pGrabber->SetCallback(m_callback, 0);
+            }
+        }
+    }
+    
+    // Создаем NULL Renderer (чтобы граф работал без отображения)
+    IBaseFilter *pNullRenderer = nullptr;
+    hr = CoCreateInstance(CLSID_NullRenderer, NULL, CLSCTX_INPROC_SERVER,
+                         IID_IBaseFilter, (void**)&pNullRenderer);
+    if (SUCCEEDED(hr)) {
+        m_pGraph->AddFilter(pNullRenderer, L"Null Renderer");
+        
+        // Соединяем фильтры: сначала пробуем CAPTURE, затем PREVIEW как fallback
+        HRESULT hrConnect = E_FAIL;
+        if (m_pGrabberF) {
+            hrConnect = m_pCapture->RenderStream(&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
+                                                 m_pVideoCapture, m_pGrabberF, pNullRenderer);
+            if (FAILED(hrConnect)) {
+                qDebug() << "RenderStream CAPTURE failed, falling back to PREVIEW. hr:" << hrConnect;
+                hrConnect = m_pCapture->RenderStream(&PIN_CATEGORY_PREVIEW, &MEDIATYPE_Video,
+                                                     m_pVideoCapture, m_pGrabberF, pNullRenderer);
+            }
+        } else {
+            hrConnect = m_pCapture->RenderStream(&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
+                                                 m_pVideoCapture, nullptr, pNullRenderer);
+            if (FAILED(hrConnect)) {
+                qDebug() << "RenderStream CAPTURE (no grabber) failed, trying PREVIEW. hr:" << hrConnect;
+                hrConnect = m_pCapture->RenderStream(&PIN_CATEGORY_PREVIEW, &MEDIATYPE_Video,
+                                                     m_pVideoCapture, nullptr, pNullRenderer);
+            }
+        }
+        if (FAILED(hrConnect)) {
+            qDebug() << "Failed to connect capture graph for video stream:" << hrConnect;
+        }
+        
+        pNullRenderer->Release();
+    }
+    
+    // Формат известен после соединения фильтров
+    if (m_pGrabber && !readConnectedFormat()) {
+        qDebug() << "Sample Grabber media type is not FORMAT_VideoInfo";
+    }
+    
+    // Счётчик кадров, потерянных драйвером (есть не у всех камер)
+    hr = m_pCapture->FindInterface(&PIN_CATEGORY_CAPTURE, &MEDIATYPE_Video,
+                                   m_pVideoCapture, IID_IAMDroppedFrames, (void**)&m_pDroppedFrames);
+    if (FAILED(hr)) {
+        m_pDroppedFrames = nullptr;
+    }
+    
+    m_initialized = true;
+    qDebug() << "DirectShow initialized successfully";
+    
+    return true;
+}
+
+void DirectShowSource::close()
+{
+    stop();
+    
+    if (m_pMediaControl) {
+        m_pMediaControl->Release();
+        m_pMediaControl = nullptr;
+    }
+    
+    if (m_pDroppedFrames) {
+        m_pDroppedFrames->Release();
+        m_pDroppedFrames = nullptr;
+    }
+    
+    if (m_pGrabber) {
+        m_pGrabber->SetCallback(NULL, 0);
+        m_pGrabber->Release();
+        m_pGrabber = nullptr;
+    }
+    
+    if (m_pGrabberF) {
+        m_pGraph->RemoveFilter(m_pGrabberF);
+        m_pGrabberF->Release();
+        m_pGrabberF = nullptr;
+    }
+    
+    if (m_pVideoCapture) {
+        m_pGraph->RemoveFilter(m_pVideoCapture);
+        m_pVideoCapture->Release();
+        m_pVideoCapture = nullptr;
+    }
+    
+    if (m_pCapture) {
+        m_pCapture->Release();
+        m_pCapture = nullptr;
+    }
+    
+    if (m_pGraph) {
+        m_pGraph->Release();
+        m_pGraph = nullptr;
+    }
+    
+    m_initialized = false;
+}
+
+bool DirectShowSource::start()
+{
+    if (!m_pMediaControl) {
+        setError("Граф DirectShow не создан");
+        return false;
+    }
+    if (m_running) {
+        return true;
+    }
+    
+    beginStream();
+    HRESULT hr = m_pMediaControl->Run();
+    if (FAILED(hr)) {
+        qDebug() << "Failed to run media control:" << hr;
+        setError("Не удалось запустить граф DirectShow");
+        return false;
+    }
+    m_running = true;
+    return true;
+}
+
+void DirectShowSource::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    
+    // Счётчик драйвера сбрасывается при каждом запуске графа
+    m_droppedBefore += droppedByDriver();
+    
+    // Stop() дожидается завершения потоков графа - SampleCB больше не вызывается
+    if (m_pMediaControl) {
+        m_pMediaControl->Stop();
+    }
+    m_running = false;
+}
+
+bool DirectShowSource::configureStream(IAMStreamConfig *pConfig, GUID *subtype)
+{
+    m_modes.clear();
+    
+    int iCount = 0, iSize = 0;
+    if (FAILED(pConfig->GetNumberOfCapabilities(&iCount, &iSize)) ||
+        iSize != sizeof(VIDEO_STREAM_CONFIG_CAPS)) {
+        return true;
+    }
+    
+    // Режим -> номер возможности контакта
+    QList<int> capIndices;
+    for (int i = 0; i < iCount; ++i) {
+        VIDEO_STREAM_CONFIG_CAPS scc;
+        AM_MEDIA_TYPE *pmt = nullptr;
+        if (FAILED(pConfig->GetStreamCaps(i, &pmt, (BYTE*)&scc)) || !pmt) {
+            continue;
+        }
+        FrameFormat::PixelFormat format;
+        if (pmt->majortype == MEDIATYPE_Video && pmt->formattype == FORMAT_VideoInfo &&
+            pmt->cbFormat >= sizeof(VIDEOINFOHEADER) && pixelFormatForSubtype(pmt->subtype, &format)) {
+            const VIDEOINFOHEADER *vih = (const VIDEOINFOHEADER*)pmt->pbFormat;
+            // Наибольшая частота, которую допускает эта возможность
+            const REFERENCE_TIME interval = scc.MinFrameInterval > 0 ? scc.MinFrameInterval
+                                                                    : vih->AvgTimePerFrame;
+            const CaptureMode mode(vih->bmiHeader.biWidth, abs(vih->bmiHeader.biHeight),
+                                   fpsForInterval(interval), format);
+            if (!m_modes.contains(mode)) {
+                m_modes << mode;
+                capIndices << i;
+            }
+        }
+        FreeMediaType(*pmt);
+        CoTaskMemFree(pmt);
+    }
+    qDebug() << "DirectShow:" << m_modes.size() << "capture modes";
+    
+    const int best = findMode(m_modes, m_requestedMode);
+    if (best < 0) {
+        if (m_modeRequested) {
+            qDebug() << "DirectShow: mode" << m_requestedMode.toString() << "is not supported";
+            setError(QString("Камера не поддерживает режим %1").arg(m_requestedMode.toString()));
+            return false;
+        }
+        // Режим по умолчанию недоступен - остаётся режим камеры, а RGB24
+        // для Sample Grabber получится через преобразователь графа
+        return true;
+    }
+    
+    VIDEO_STREAM_CONFIG_CAPS scc;
+    AM_MEDIA_TYPE *pmt = nullptr;
+    if (FAILED(pConfig->GetStreamCaps(capIndices[best], &pmt, (BYTE*)&scc)) || !pmt) {
+        return true;
+    }
+    
+    // Частота в пределах, которые допускает возможность
+    VIDEOINFOHEADER *vih = (VIDEOINFOHEADER*)pmt->pbFormat;
+    if (m_requestedMode.fps > 0) {
+        REFERENCE_TIME interval = 10000000 / m_requestedMode.fps;
+        if (scc.MinFrameInterval > 0) {
+            interval = qMax(interval, scc.MinFrameInterval);
+        }
+        if (scc.MaxFrameInterval > 0) {
+            interval = qMin(interval, scc.MaxFrameInterval);
+        }
+        vih->AvgTimePerFrame = interval;
+    } else if (scc.MinFrameInterval > 0) {
+        vih->AvgTimePerFrame = scc.MinFrameInterval;
+    }
+    
+    const HRESULT hr = pConfig->SetFormat(pmt);
+    if (SUCCEEDED(hr)) {
+        *subtype = pmt->subtype;
+        qDebug() << "Capture mode set:" << m_modes[best].toString()
+                 << "frame interval" << vih->AvgTimePerFrame;
+    } else {
+        qDebug() << "IAMStreamConfig::SetFormat failed:" << hr;
+    }
+    FreeMediaType(*pmt);
+    CoTaskMemFree(pmt);
+    
+    if (FAILED(hr) && m_modeRequested) {
+        setError(QString("Не удалось установить режим %1").arg(m_modes[best].toString()));
+        return false;
+    }
+    return true;
+}
+
+bool DirectShowSource::readConnectedFormat()
+{
+    AM_MEDIA_TYPE mt;
+    HRESULT hr = m_pGrabber->GetConnectedMediaType(&mt);
+    if (FAILED(hr)) {
+        return false;
+    }
+    
+    const bool ok = applyMediaType(mt);
+    FreeMediaType(mt);
+    return ok;
+}
+
+bool DirectShowSource::applyMediaType(const AM_MEDIA_TYPE &mt)
+{
+    if (mt.formattype != FORMAT_VideoInfo || mt.cbFormat < sizeof(VIDEOINFOHEADER)) {
+        return false;
+    }
+    
+    FrameFormat::PixelFormat pixelFormat;
+    if (!pixelFormatForSubtype(mt.subtype, &pixelFormat)) {
+        qDebug() << "DirectShow: unsupported media subtype";
+        return false;
+    }
+    
+    const VIDEOINFOHEADER *pVih = (const VIDEOINFOHEADER*)mt.pbFormat;
+    m_width = pVih->bmiHeader.biWidth;
+    m_height = abs(pVih->bmiHeader.biHeight);
+    m_fps = fpsForInterval(pVih->AvgTimePerFrame);
+    m_pixelFormat = pixelFormat;
+    
+    FrameFormat format;
+    format.width = m_width;
+    format.height = m_height;
+    format.pixelFormat = pixelFormat;
+    switch (pixelFormat) {
+    case FrameFormat::FormatBGR24:
+        // Строки DIB выровнены на 4 байта; положительная высота - снизу вверх
+        m_stride = (m_width * 3 + 3) & ~3;
+        format.bottomUp = pVih->bmiHeader.biHeight > 0;
+        break;
+    case FrameFormat::FormatYUY2:
+        // Кадры YUV всегда идут сверху вниз
+        m_stride = m_width * 2;
+        format.bottomUp = false;
+        break;
+    case FrameFormat::FormatNV12:
+        m_stride = m_width;
+        format.bottomUp = false;
+        break;
+    default:
+        m_stride = 0;
+        format.bottomUp = false;
+        break;
+    }
+    format.stride = m_stride;
+    m_frameBytes = format.frameBytes();
+    setFormat(format);
+    return true;
+}
+
+void DirectShowSource::sampleArrived(double sampleTime, IMediaSample *pSample)
+{
+    // Тип носителя у сэмпла есть только после пересогласования формата
+    // графом; в остальных кадрах GetMediaType возвращает S_FALSE
+    AM_MEDIA_TYPE *pmt = nullptr;
+    if (pSample->GetMediaType(&pmt) == S_OK && pmt) {
+        qDebug() << "DirectShow: media type changed during streaming";
+        applyMediaType(*pmt);
+        FreeMediaType(*pmt);
+        CoTaskMemFree(pmt);
+    }
+    
+    BYTE *data = nullptr;
+    if (FAILED(pSample->GetPointer(&data)) || !data) {
+        return;
+    }
+    
+    const long size = pSample->GetActualDataLength();
+    if (m_width <= 0 || m_height <= 0 || size <= 0 || size < m_frameBytes) {
+        return;
+    }
+    
+    // Время сэмпла в единицах 100 нс; если не задано - время потока
+    REFERENCE_TIME start = 0;
+    REFERENCE_TIME end = 0;
+    qint64 timestampUs = 0;
+    if (SUCCEEDED(pSample->GetTime(&start, &end))) {
+        timestampUs = start / 10;
+    } else {
+        timestampUs = qint64(sampleTime * 1000000.0);
+    }
+    
+    RawFrame frame;
+    frame.data = (const uchar*)data;
+    frame.size = int(size);
+    frame.timestampUs = timestampUs;
+    frame.sequence = -1;
+    deliver(frame);
+}
+
+long DirectShowSource::droppedByDriver() const
+{
+    long dropped = 0;
+    if (m_pDroppedFrames && FAILED(m_pDroppedFrames->GetNumDropped(&dropped))) {
+        dropped = 0;
+    }
+    return dropped;
+}
+
+FrameSource::Counters DirectShowSource::counters() const
+{
+    Counters c = FrameSource::counters();
+    c.dropped += m_droppedBefore + (m_running ? droppedByDriver() : 0);
+    return c;
+}
+
+QString DirectShowSource::description() const
+{
+    return QString("<p><b>API:</b> DirectShow (Windows нативный)</p>"
+                   "<p><b>Устройство:</b> №%1</p>"
+                   "<p><b>Режим:</b> %2x%3 @ %4 кадр/с, %5 (режимов: %6)</p>")
+        .arg(m_deviceIndex).arg(m_width).arg(m_height).arg(m_fps)
+        .arg(FrameFormat::pixelFormatName(m_pixelFormat)).arg(m_modes.size());
+}
+
+QList<CaptureMode> DirectShowSource::supportedModes() const
+{
+    return m_modes.isEmpty() ? FrameSource::supportedModes() : m_modes;
+}
+
+bool DirectShowSource::setMode(const CaptureMode &mode)
+{
+    if (m_initialized) {
+        setError("Режим меняется только у закрытого источника");
+        return false;
+    }
+    // Режимы известны, если камера уже открывалась
+    if (!m_modes.isEmpty() && findMode(m_modes, mode) < 0) {
+        setError(QString("Камера не поддерживает режим %1").arg(mode.toString()));
+        return false;
+    }
+    m_requestedMode = mode;
+    m_modeRequested = true;
+    return true;
+}
+
+int DirectShowSource::deviceCount()
+{
+    // COM мог быть уже инициализирован в этом потоке в другом режиме
+    const HRESULT comInit = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
+    
+    int count = 0;
+    ICreateDevEnum *pDevEnum = nullptr;
+    if (SUCCEEDED(CoCreateInstance(CLSID_SystemDeviceEnum, NULL, CLSCTX_INPROC_SERVER,
+                                   IID_ICreateDevEnum, (void**)&pDevEnum))) {
+        IEnumMoniker *pEnum = nullptr;
+        if (pDevEnum->CreateClassEnumerator(CLSID_VideoInputDeviceCategory, &pEnum, 0) == S_OK) {
+            IMoniker *pMoniker = nullptr;
+            while (pEnum->Next(1, &pMoniker, NULL) == S_OK) {
+                pMoniker->Release();
+                count++;
+            }
+            pEnum->Release();
+        }
+        pDevEnum->Release();
+    }
+    
+    if (SUCCEEDED(comInit)) {
+        CoUninitialize();
+    }
+    return count;
+}
+
+// Вспомогательная функция для освобождения AM_MEDIA_TYPE
+void FreeMediaType(AM_MEDIA_TYPE& mt)
+{
+    if (mt.cbFormat != 0) {
+        CoTaskMemFree((PVOID)mt.pbFormat);
+        mt.cbFormat = 0;
+        mt.pbFormat = NULL;
+    }
+    if (mt.pUnk != NULL) {
+        mt.pUnk->Release();
+        mt.pUnk = NULL;
+    }
+}
+
@@ -0,0 +1,92 @@
+#ifndef DSHOWSOURCE_H
+#define DSHOWSOURCE_H
+
+#include "framesource.h"
+#include <windows.h>
+#include <dshow.h>
+
+// Forward declarations
+struct ISampleGrabber;
+
+// Камера через DirectShow: Capture -> Sample Grabber -> Null Renderer.
+// Режим (размер, частота, RGB24/YUY2/NV12/MJPEG) выбирается из возможностей
+// выходного контакта камеры (IAMStreamConfig), Sample Grabber принимает
+// кадры в формате режима без преобразования.
+// Кадры приходят в SampleCB в потоке графа - каждый ровно один раз, с меткой
+// времени сэмпла. Потери считает сам драйвер (IAMDroppedFrames).
+class DirectShowSource : public FrameSource
+{
+public:
+    // deviceIndex - номер устройства в категории видеозахвата
+    explicit DirectShowSource(int deviceIndex = 0);
+    ~DirectShowSource();
+    
+    // Число устройств видеозахвата в системе
+    static int deviceCount();
+
+    bool open() override;
+    void close() override;
+    bool isOpen() const override { return m_initialized; }
+
+    bool start() override;
+    void stop() override;
+
+    QString name() const override { return "DirectShow"; }
+    QString description() const override;
+
+    int frameRate() const override { return m_fps; }
+
+    QList<CaptureMode> supportedModes() const override;
+    bool setMode(const CaptureMode &mode) override;
+
+    Counters counters() const override;
+
+private:
+    class GrabberCallback;
+    
+    // Обработка сэмпла из SampleCB (поток графа)
+    void sampleArrived(double sampleTime, IMediaSample *pSample);
+    
+    // Перечисление режимов камеры и установка запрошенного.
+    // subtype - формат, который должен принимать Sample Grabber
+    bool configureStream(IAMStreamConfig *pConfig, GUID *subtype);
+    
+    // Размер кадра по согласованному типу Sample Grabber
+    bool readConnectedFormat();
+    // Формат кадров по типу носителя
+    bool applyMediaType(const AM_MEDIA_TYPE &mt);
+    
+    long droppedByDriver() const;
+
+    // DirectShow интерфейсы
+    IGraphBuilder *m_pGraph;
+    ICaptureGraphBuilder2 *m_pCapture;
+    IMediaControl *m_pMediaControl;
+    IBaseFilter *m_pVideoCapture;
+    ISampleGrabber *m_pGrabber;
+    IBaseFilter *m_pGrabberF;
+    IAMDroppedFrames *m_pDroppedFrames;
+    GrabberCallback *m_callback;
+
+    int m_deviceIndex;
+    bool m_initialized;
+    bool m_running;
+    int m_width;
+    int m_height;
+    int m_stride;
+    int m_fps;
+    FrameFormat::PixelFormat m_pixelFormat;
+    // Минимальный размер сэмпла (у MJPEG - 0, размер меняется)
+    qint64 m_frameBytes;
+    
+    // Режимы камеры (с последнего open()) и запрошенный режим;
+    // m_modeRequested - режим задан явно, а не по умолчанию
+    QList<CaptureMode> m_modes;
+    CaptureMode m_requestedMode;
+    bool m_modeRequested;
+    
+    // Потери драйвера за предыдущие запуски графа
+    qint64 m_droppedBefore;
+};
+
+#endif // DSHOWSOURCE_H
@@ -0,0 +1,336 @@
+#include "filewriter.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+FileWriter::FileWriter()
+    :
+#ifdef _WIN32
+      m_handle(INVALID_HANDLE_VALUE),
+#else
+      m_fd(-1),
+#endif
+      m_buffer(nullptr),
+      m_used(0),
+      m_flushed(0),
+      m_bufferStart(0),
+      m_reserved(0),
+      m_syncInterval(DEFAULT_SYNC_INTERVAL),
+      m_syncedSize(0),
+      m_syncCount(0)
+{
+}
+
+FileWriter::~FileWriter()
+{
+    if (isOpen()) {
+        close();
+    }
+}
+
+bool FileWriter::isOpen() const
+{
+#ifdef _WIN32
+    return m_handle != INVALID_HANDLE_VALUE;
+#else
+    return m_fd >= 0;
+#endif
+}
+
+bool FileWriter::open(const std::string &path, unsigned long long reserve)
+{
+    if (isOpen()) {
+        close();
+    }
+
+    m_error.clear();
+    m_used = 0;
+    m_flushed = 0;
+    m_bufferStart = 0;
+    m_reserved = 0;
+    m_syncedSize = 0;
+    m_syncCount = 0;
+
+    if (!m_buffer) {
+#ifdef _WIN32
+        m_buffer = static_cast<unsigned char*>(_aligned_malloc(BLOCK_SIZE, BLOCK_ALIGNMENT));
+#else
+        void *buffer = nullptr;
+        if (posix_memalign(&buffer, BLOCK_ALIGNMENT, BLOCK_SIZE) == 0) {
+            m_buffer = static_cast<unsigned char*>(buffer);
+        }
+#endif
+        if (!m_buffer) {
+            return fail("out of memory");
+        }
+    }
+
+#ifdef _WIN32
+    // Путь может содержать кириллицу (папка пользователя)
+    int len = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, NULL, 0);
+    std::vector<wchar_t> wpath(len > 0 ? len : 1, L'\0');
+    MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, wpath.data(), len);
+    m_handle = CreateFileW(wpath.data(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+#else
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+#endif
+    if (!isOpen()) {
+        return fail("cannot create file " + path);
+    }
+
+    if (!reserveSpace(reserve > 0 ? reserve : static_cast<unsigned long long>(PREALLOCATE_STEP))) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool FileWriter::write(const void *data, size_t size)
+{
+    if (!isOpen()) {
+        return fail("file is not open");
+    }
+
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    while (size > 0) {
+        if (m_used == 0 && size >= BLOCK_SIZE) {
+            // Целый блок (кадр RGB) пишется из памяти вызывающего без копирования
+            if (!reserveSpace(m_bufferStart + BLOCK_SIZE) ||
+                !writeRaw(m_bufferStart, bytes, BLOCK_SIZE)) {
+                return false;
+            }
+            startWriteback(m_bufferStart);
+            m_bufferStart += BLOCK_SIZE;
+            bytes += BLOCK_SIZE;
+            size -= BLOCK_SIZE;
+        } else {
+            const size_t chunk = std::min<size_t>(size, BLOCK_SIZE - m_used);
+            std::memcpy(m_buffer + m_used, bytes, chunk);
+            m_used += chunk;
+            bytes += chunk;
+            size -= chunk;
+            if (m_used < BLOCK_SIZE) {
+                continue;
+            }
+            if (!reserveSpace(m_bufferStart + BLOCK_SIZE) || !flushBuffer()) {
+                return false;
+            }
+        }
+
+        if (m_syncInterval > 0 && m_bufferStart >= m_syncedSize + m_syncInterval && !syncFile()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FileWriter::writeAt(unsigned long long offset, const void *data, size_t size)
+{
+    if (!isOpen()) {
+        return fail("file is not open");
+    }
+    if (offset + size > this->size()) {
+        return fail("write past the end of file");
+    }
+
+    // Часть, уже отданная ОС, пишется сразу; часть в буфере - в буфер
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    if (offset < m_bufferStart) {
+        const size_t head = size_t(std::min<unsigned long long>(size, m_bufferStart - offset));
+        if (!writeRaw(offset, bytes, head)) {
+            return false;
+        }
+        offset += head;
+        bytes += head;
+        size -= head;
+    }
+    if (size > 0) {
+        // Уже сброшенные байты блока будут переписаны следующим сбросом
+        const size_t position = size_t(offset - m_bufferStart);
+        std::memcpy(m_buffer + position, bytes, size);
+        m_flushed = std::min(m_flushed, position);
+    }
+    return true;
+}
+
+bool FileWriter::flush()
+{
+    if (!isOpen()) {
+        return fail("file is not open");
+    }
+    return flushBuffer();
+}
+
+bool FileWriter::sync()
+{
+    return flush() && syncFile();
+}
+
+bool FileWriter::close()
+{
+    if (!isOpen()) {
+        return false;
+    }
+
+    bool ok = flushBuffer();
+
+    // Резерв за концом данных освобождается
+    const unsigned long long end = size();
+#ifdef _WIN32
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(end);
+    if (!SetFilePointerEx(m_handle, position, NULL, FILE_BEGIN) || !SetEndOfFile(m_handle)) {
+        ok = fail("cannot truncate file");
+    }
+#else
+    if (ftruncate(m_fd, static_cast<off_t>(end)) != 0) {
+        ok = fail("cannot truncate file");
+    }
+#endif
+    ok = syncFile() && ok;
+
+#ifdef _WIN32
+    if (!CloseHandle(m_handle)) {
+        ok = fail("close failed");
+    }
+    m_handle = INVALID_HANDLE_VALUE;
+    _aligned_free(m_buffer);
+#else
+    if (::close(m_fd) != 0) {
+        ok = fail("close failed");
+    }
+    m_fd = -1;
+    std::free(m_buffer);
+#endif
+    m_buffer = nullptr;
+    return ok;
+}
+
+bool FileWriter::flushBuffer()
+{
+    // Без частичных сбросов блок уходит в ОС одной записью целиком;
+    // после них - только ещё не записанные байты
+    if (m_used > m_flushed &&
+        !writeRaw(m_bufferStart + m_flushed, m_buffer + m_flushed, m_used - m_flushed)) {
+        return false;
+    }
+    m_flushed = m_used;
+    // Неполный блок остаётся в буфере, следующие записи его дополнят
+    if (m_used == BLOCK_SIZE) {
+        startWriteback(m_bufferStart);
+        m_bufferStart += BLOCK_SIZE;
+        m_used = 0;
+        m_flushed = 0;
+    }
+    return true;
+}
+
+bool FileWriter::writeRaw(unsigned long long offset, const void *data, size_t size)
+{
+    const char *bytes = static_cast<const char*>(data);
+#ifdef _WIN32
+    while (size > 0) {
+        OVERLAPPED overlapped;
+        std::memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFULL);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD written = 0;
+        const DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 0x40000000));
+        if (!WriteFile(m_handle, bytes, chunk, &written, &overlapped) || written == 0) {
+            return fail("write failed (disk full?)");
+        }
+        offset += written;
+        bytes += written;
+        size -= written;
+    }
+#else
+    while (size > 0) {
+        const ssize_t written = pwrite(m_fd, bytes, size, static_cast<off_t>(offset));
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return fail("write failed (disk full?)");
+        }
+        offset += written;
+        bytes += written;
+        size -= written;
+    }
+#endif
+    return true;
+}
+
+void FileWriter::startWriteback(unsigned long long blockStart)
+{
+#ifdef __linux__
+    // Запись блока на диск начинается сразу, а не когда кэш переполнится,
+    // поэтому периодический fdatasync дожидается лишь последних блоков
+    sync_file_range(m_fd, static_cast<off_t>(blockStart), BLOCK_SIZE, SYNC_FILE_RANGE_WRITE);
+#else
+    (void)blockStart;
+#endif
+}
+
+bool FileWriter::reserveSpace(unsigned long long size)
+{
+    if (size <= m_reserved) {
+        return true;
+    }
+    const unsigned long long reserve = std::max<unsigned long long>(size, m_reserved + PREALLOCATE_STEP);
+
+#ifdef _WIN32
+    // Размер файла увеличивается без заполнения нулями (NTFS выделяет
+    // кластеры, данные пишутся по порядку); лишнее отрезает close()
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(reserve);
+    if (!SetFilePointerEx(m_handle, position, NULL, FILE_BEGIN) || !SetEndOfFile(m_handle)) {
+        if (GetLastError() == ERROR_DISK_FULL) {
+            return fail("not enough disk space");
+        }
+    }
+#elif defined(__linux__)
+    // Размер файла не меняется: после сбоя в конце нет нулей
+    if (fallocate(m_fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(m_reserved),
+                  static_cast<off_t>(reserve - m_reserved)) != 0 && errno == ENOSPC) {
+        return fail("not enough disk space");
+    }
+#endif
+    // Файловая система без резервирования просто пишет как обычно
+    m_reserved = reserve;
+    return true;
+}
+
+bool FileWriter::syncFile()
+{
+#ifdef _WIN32
+    const bool ok = FlushFileBuffers(m_handle) != 0;
+#elif defined(__linux__)
+    const bool ok = fdatasync(m_fd) == 0;
+#else
+    const bool ok = fsync(m_fd) == 0;
+#endif
+    if (!ok) {
+        return fail("sync failed");
+    }
+    m_syncedSize = size();
+    m_syncCount++;
+    return true;
+}
+
+bool FileWriter::fail(const std::string &error)
+{
+    m_error = error;
+    return false;
+}
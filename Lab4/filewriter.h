@@ -0,0 +1,82 @@
+#ifndef FILEWRITER_H
+#define FILEWRITER_H
+
+#include <cstddef>
+#include <string>
+
+// Последовательная запись большого файла (видео, фото).
+// Данные копируются в выровненный буфер BLOCK_SIZE и уходят в ОС целыми
+// блоками по смещениям, кратным BLOCK_SIZE, а не мелкими fwrite на каждый
+// кадр. Место на диске резервируется заранее шагами PREALLOCATE_STEP
+// (файловая система не наращивает файл по кусочку и меньше его
+// фрагментирует); при закрытии файл обрезается до записанного размера.
+// Каждые syncInterval байт данные сбрасываются на диск (fdatasync /
+// FlushFileBuffers): после сбоя файл цел до последней синхронизации,
+// а кэш ОС не копит сотни мегабайт, которые потом пишутся одним рывком.
+// Переносимый C++ без Qt (POSIX или WinAPI).
+class FileWriter
+{
+public:
+    enum {
+        BLOCK_SIZE = 4 * 1024 * 1024,           // буфер и размер записи, байт
+        BLOCK_ALIGNMENT = 4096,                 // выравнивание буфера (страница)
+        PREALLOCATE_STEP = 64 * 1024 * 1024,    // шаг резервирования места
+        DEFAULT_SYNC_INTERVAL = 64 * 1024 * 1024
+    };
+
+    FileWriter();
+    ~FileWriter();
+
+    // path - UTF-8. reserve - сколько места зарезервировать сразу (0 -
+    // PREALLOCATE_STEP); дальше резерв растёт по мере записи
+    bool open(const std::string &path, unsigned long long reserve = 0);
+    bool write(const void *data, size_t size);
+    // Перезапись уже записанных байт (поля заголовков)
+    bool writeAt(unsigned long long offset, const void *data, size_t size);
+    // Данные буфера - в ОС; sync() - ещё и на диск
+    bool flush();
+    bool sync();
+    // Сбрасывает буфер, обрезает резерв, синхронизирует и закрывает файл
+    bool close();
+
+    // 0 - синхронизация только при закрытии
+    void setSyncInterval(unsigned long long bytes) { m_syncInterval = bytes; }
+
+    bool isOpen() const;
+    unsigned long long size() const { return m_bufferStart + m_used; }
+    // Сколько раз данные сбрасывались на диск с открытия файла
+    int syncCount() const { return m_syncCount; }
+    const std::string &lastError() const { return m_error; }
+
+private:
+    bool flushBuffer();
+    bool writeRaw(unsigned long long offset, const void *data, size_t size);
+    void startWriteback(unsigned long long blockStart);
+    bool reserveSpace(unsigned long long size);
+    bool syncFile();
+    bool fail(const std::string &error);
+
+#ifdef _WIN32
+    void *m_handle;     // HANDLE
+#else
+    int m_fd;
+#endif
+    std::string m_error;
+
+    // Буфер блока, начинающегося со смещения m_bufferStart (кратно
+    // BLOCK_SIZE). После частичного сброса (flush, sync) блок остаётся в
+    // буфере, m_flushed - сколько его байт уже отдано ОС
+    unsigned char *m_buffer;
+    size_t m_used;
+    size_t m_flushed;
+    unsigned long long m_bufferStart;
+
+    // Зарезервированное место, период синхронизации и размер на момент
+    // последней синхронизации
+    unsigned long long m_reserved;
+    unsigned long long m_syncInterval;
+    unsigned long long m_syncedSize;
+    int m_syncCount;
+};
+
+#endif // FILEWRITER_H
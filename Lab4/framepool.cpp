@@ -0,0 +1,215 @@
+#include "framepool.h"
+#include <QDebug>
+
+// Выравнивание строк и буферов (удобно для SIMD-преобразований)
+static const int FRAME_ALIGNMENT = 32;
+
+struct FramePool::Slot
+{
+    Data *owner;
+    uchar *data;
+    int capacity;
+    bool busy;
+};
+
+struct FramePool::Data
+{
+    QMutex mutex;
+    QVector<Slot> buffers;
+    int width;
+    int height;
+    int bytesPerLine;
+    QImage::Format format;
+    int exhausted;
+    // Ссылки: сам пул + каждый занятый слот.
+    // Кадр может пережить пул (например, в очереди событий) - память
+    // освобождается вместе с последней ссылкой.
+    int refs;
+    bool alive;
+};
+
+FramePool::FramePool(int slotCount)
+    : d(new Data)
+{
+    d->buffers.resize(qMax(1, slotCount));
+    for (int i = 0; i < d->buffers.size(); ++i) {
+        Slot &slot = d->buffers[i];
+        slot.owner = d;
+        slot.data = nullptr;
+        slot.capacity = 0;
+        slot.busy = false;
+    }
+    d->width = 0;
+    d->height = 0;
+    d->bytesPerLine = 0;
+    d->format = QImage::Format_Invalid;
+    d->exhausted = 0;
+    d->refs = 1;
+    d->alive = true;
+}
+
+FramePool::~FramePool()
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->alive = false;
+        for (int i = 0; i < d->buffers.size(); ++i) {
+            if (!d->buffers[i].busy) {
+                freeSlot(d->buffers[i]);
+            }
+        }
+    }
+    deref(d);
+}
+
+void FramePool::configure(int width, int height, QImage::Format format)
+{
+    QMutexLocker locker(&d->mutex);
+
+    if (d->width == width && d->height == height && d->format == format) {
+        return;
+    }
+
+    const int depth = QImage::toPixelFormat(format).bitsPerPixel();
+    d->width = width;
+    d->height = height;
+    d->format = format;
+    d->bytesPerLine = ((width * depth / 8) + FRAME_ALIGNMENT - 1) & ~(FRAME_ALIGNMENT - 1);
+
+    // Свободные слоты перевыделяем сразу, занятые - при возврате в пул
+    for (int i = 0; i < d->buffers.size(); ++i) {
+        if (!d->buffers[i].busy) {
+            allocateSlot(d, d->buffers[i]);
+        }
+    }
+
+    qDebug() << "FramePool configured:" << width << "x" << height
+             << "stride" << d->bytesPerLine << "slots" << d->buffers.size();
+}
+
+int FramePool::acquire()
+{
+    QMutexLocker locker(&d->mutex);
+
+    for (int i = 0; i < d->buffers.size(); ++i) {
+        Slot &slot = d->buffers[i];
+        if (!slot.busy && slot.data) {
+            slot.busy = true;
+            d->refs++;
+            return i;
+        }
+    }
+
+    d->exhausted++;
+    return -1;
+}
+
+uchar *FramePool::slotData(int slot) const
+{
+    return d->buffers[slot].data;
+}
+
+int FramePool::bytesPerLine() const
+{
+    return d->bytesPerLine;
+}
+
+QImage FramePool::wrap(int slot)
+{
+    Slot &s = d->buffers[slot];
+    // const-конструктор: любая попытка записи в кадр приведёт к копированию,
+    // а не к порче памяти слота
+    return QImage(static_cast<const uchar*>(s.data), d->width, d->height,
+                  d->bytesPerLine, d->format, &FramePool::releaseSlot, &s);
+}
+
+void FramePool::release(int slot)
+{
+    releaseSlot(&d->buffers[slot]);
+}
+
+int FramePool::slotCount() const
+{
+    return d->buffers.size();
+}
+
+int FramePool::freeSlots() const
+{
+    QMutexLocker locker(&d->mutex);
+    int count = 0;
+    for (int i = 0; i < d->buffers.size(); ++i) {
+        if (!d->buffers[i].busy) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int FramePool::exhaustedCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->exhausted;
+}
+
+void FramePool::releaseSlot(void *info)
+{
+    Slot *slot = static_cast<Slot*>(info);
+    Data *owner = slot->owner;
+
+    {
+        QMutexLocker locker(&owner->mutex);
+        slot->busy = false;
+
+        if (!owner->alive) {
+            // Пул уже уничтожен - память слота больше не понадобится
+            freeSlot(*slot);
+        } else {
+            const int needed = owner->bytesPerLine * owner->height;
+            if (slot->capacity != needed) {
+                // Формат сменился, пока кадр был у потребителя
+                allocateSlot(owner, *slot);
+            }
+        }
+    }
+
+    deref(owner);
+}
+
+void FramePool::allocateSlot(Data *d, Slot &slot)
+{
+    const int needed = d->bytesPerLine * d->height;
+    if (slot.data && slot.capacity == needed) {
+        return;
+    }
+
+    freeSlot(slot);
+    if (needed > 0) {
+        slot.data = static_cast<uchar*>(qMallocAligned(needed, FRAME_ALIGNMENT));
+        slot.capacity = slot.data ? needed : 0;
+    }
+}
+
+void FramePool::freeSlot(Slot &slot)
+{
+    if (slot.data) {
+        qFreeAligned(slot.data);
+        slot.data = nullptr;
+    }
+    slot.capacity = 0;
+}
+
+void FramePool::deref(Data *d)
+{
+    bool last = false;
+    {
+        QMutexLocker locker(&d->mutex);
+        last = (--d->refs == 0);
+    }
+
+    if (last) {
+        for (int i = 0; i < d->buffers.size(); ++i) {
+            freeSlot(d->buffers[i]);
+        }
+        delete d;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef FRAMEPOOL_H
+#define FRAMEPOOL_H
+
+#include <QImage>
+#include <QMutex>
+#include <QVector>
+
+// Пул заранее выделенных буферов кадров.
+// Кадр выдаётся потребителям как QImage, который ссылается на память слота
+// (без копирования). QImage разделяется неявно, поэтому слот возвращается
+// в пул только тогда, когда все копии кадра (превью, запись) уничтожены.
+// В установившемся режиме захват не выделяет память под кадры.
+class FramePool
+{
+public:
+    explicit FramePool(int slotCount = 8);
+    ~FramePool();
+
+    // Настройка слотов под формат кадра.
+    // Память перевыделяется только при смене размера/формата.
+    void configure(int width, int height, QImage::Format format);
+
+    // Захват свободного слота; -1 если все слоты заняты потребителями
+    int acquire();
+
+    // Доступ к памяти слота для заполнения кадра
+    uchar *slotData(int slot) const;
+    int bytesPerLine() const;
+
+    // Передача слота в QImage (слот освобождается вместе с последней копией)
+    QImage wrap(int slot);
+
+    // Возврат слота без выдачи кадра (например, при ошибке захвата)
+    void release(int slot);
+
+    // Статистика
+    int slotCount() const;
+    int freeSlots() const;
+    int exhaustedCount() const;
+
+private:
+    struct Data;
+    struct Slot;
+
+    static void releaseSlot(void *info);
+    static void allocateSlot(Data *d, Slot &slot);
+    static void freeSlot(Slot &slot);
+    static void deref(Data *d);
+
+    Data *d;
+
+    Q_DISABLE_COPY(FramePool)
+};
+
+#endif // FRAMEPOOL_H
@@ -0,0 +1,294 @@
+#include "framesource.h"
+#include "syntheticsource.h"
+#include "replaysource.h"
+#include <QRegExp>
+#include <QStringList>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include "dshowsource.h"
+#endif
+#ifdef Q_OS_LINUX
+#include "v4l2source.h"
+#endif
+
+qint64 FrameFormat::frameBytes() const
+{
+    switch (pixelFormat) {
+    case FormatNV12:
+        // Плоскость UV - половина строк той же ширины
+        return qint64(stride) * height + qint64(stride) * ((height + 1) / 2);
+    case FormatMJPEG:
+        return 0;
+    default:
+        return qint64(stride) * height;
+    }
+}
+
+const char *FrameFormat::pixelFormatName(PixelFormat format)
+{
+    switch (format) {
+    case FormatBGR24: return "BGR24";
+    case FormatRGB24: return "RGB24";
+    case FormatYUY2:  return "YUY2";
+    case FormatNV12:  return "NV12";
+    case FormatMJPEG: return "MJPEG";
+    default:          return "?";
+    }
+}
+
+bool CaptureMode::matches(const CaptureMode &request) const
+{
+    return (request.width <= 0 || width == request.width) &&
+           (request.height <= 0 || height == request.height) &&
+           (request.pixelFormat == AnyPixelFormat || pixelFormat == request.pixelFormat);
+}
+
+QString CaptureMode::toString() const
+{
+    QString text = QString("%1x%2").arg(width).arg(height);
+    if (fps > 0) {
+        text += QString("@%1").arg(fps);
+    }
+    if (pixelFormat != AnyPixelFormat) {
+        text += QString(" ") + FrameFormat::pixelFormatName(FrameFormat::PixelFormat(pixelFormat));
+    }
+    return text;
+}
+
+CaptureMode CaptureMode::fromString(const QString &text)
+{
+    CaptureMode mode;
+    QRegExp size("^(\\d+)X(\\d+)(?:@(\\d+))?$");
+    const QStringList parts = text.trimmed().split(' ', QString::SkipEmptyParts);
+    for (int i = 0; i < parts.size(); ++i) {
+        const QString part = parts[i].toUpper();
+        if (size.indexIn(part) == 0) {
+            mode.width = size.cap(1).toInt();
+            mode.height = size.cap(2).toInt();
+            mode.fps = size.cap(3).toInt();
+            continue;
+        }
+        // Названия форматов и их FourCC-варианты (YUYV, MJPG)
+        int format = AnyPixelFormat;
+        for (int f = FrameFormat::FormatBGR24; f <= FrameFormat::FormatMJPEG; ++f) {
+            if (part == FrameFormat::pixelFormatName(FrameFormat::PixelFormat(f))) {
+                format = f;
+            }
+        }
+        if (part == "YUYV") {
+            format = FrameFormat::FormatYUY2;
+        } else if (part == "MJPG") {
+            format = FrameFormat::FormatMJPEG;
+        }
+        if (format == AnyPixelFormat) {
+            qDebug() << "Invalid capture mode:" << text;
+            return CaptureMode();
+        }
+        mode.pixelFormat = format;
+    }
+    return mode;
+}
+
+// true - режим a лучше подходит под запрос, чем b
+static bool isBetterMode(const CaptureMode &a, const CaptureMode &b, const CaptureMode &request)
+{
+    if (request.width <= 0 && request.height <= 0) {
+        const qint64 areaA = qint64(a.width) * a.height;
+        const qint64 areaB = qint64(b.width) * b.height;
+        if (areaA != areaB) {
+            return areaA > areaB;
+        }
+    }
+    if (request.fps > 0) {
+        const int distanceA = qAbs(a.fps - request.fps);
+        const int distanceB = qAbs(b.fps - request.fps);
+        if (distanceA != distanceB) {
+            return distanceA < distanceB;
+        }
+    }
+    if (a.fps != b.fps) {
+        return a.fps > b.fps;
+    }
+    return a.pixelFormat < b.pixelFormat;
+}
+
+int FrameSource::findMode(const QList<CaptureMode> &modes, const CaptureMode &request)
+{
+    int best = -1;
+    for (int i = 0; i < modes.size(); ++i) {
+        if (modes[i].matches(request) &&
+            (best < 0 || isBetterMode(modes[i], modes[best], request))) {
+            best = i;
+        }
+    }
+    return best;
+}
+
+FrameSource::FrameSource()
+    : m_sink(nullptr),
+      m_formatChanged(0),
+      m_lastSequence(-1),
+      m_lastTimestampUs(-1)
+{
+    m_counters.delivered = 0;
+    m_counters.dropped = 0;
+    m_counters.duplicated = 0;
+}
+
+FrameSource::Counters FrameSource::counters() const
+{
+    QMutexLocker locker(&m_stateMutex);
+    return m_counters;
+}
+
+FrameFormat FrameSource::format() const
+{
+    QMutexLocker locker(&m_stateMutex);
+    return m_format;
+}
+
+CaptureMode FrameSource::currentMode() const
+{
+    const FrameFormat current = format();
+    return CaptureMode(current.width, current.height, frameRate(), current.pixelFormat);
+}
+
+QList<CaptureMode> FrameSource::supportedModes() const
+{
+    QList<CaptureMode> modes;
+    if (format().isValid()) {
+        modes << currentMode();
+    }
+    return modes;
+}
+
+bool FrameSource::setMode(const CaptureMode &mode)
+{
+    if (findMode(supportedModes(), mode) < 0) {
+        setError(QString("Режим %1 не поддерживается").arg(mode.toString()));
+        return false;
+    }
+    return true;
+}
+
+void FrameSource::setFormat(const FrameFormat &format)
+{
+    QMutexLocker locker(&m_stateMutex);
+    if (format != m_format) {
+        m_format = format;
+        m_formatChanged.store(1);
+    }
+}
+
+void FrameSource::beginStream()
+{
+    m_lastSequence = -1;
+    m_lastTimestampUs = -1;
+    // Получатель мог смениться - новый поток начинается с формата
+    m_formatChanged.store(1);
+}
+
+void FrameSource::deliver(const RawFrame &frame)
+{
+    qint64 dropped = 0;
+
+    if (frame.sequence >= 0) {
+        if (m_lastSequence >= 0) {
+            if (frame.sequence <= m_lastSequence) {
+                QMutexLocker locker(&m_stateMutex);
+                m_counters.duplicated++;
+                return;
+            }
+            dropped = frame.sequence - m_lastSequence - 1;
+        }
+        m_lastSequence = frame.sequence;
+    } else if (m_lastTimestampUs >= 0 && frame.timestampUs <= m_lastTimestampUs) {
+        // Без номеров повтор определяется по метке времени
+        QMutexLocker locker(&m_stateMutex);
+        m_counters.duplicated++;
+        return;
+    }
+    m_lastTimestampUs = frame.timestampUs;
+
+    {
+        QMutexLocker locker(&m_stateMutex);
+        m_counters.delivered++;
+        m_counters.dropped += dropped;
+    }
+
+    if (!m_sink) {
+        return;
+    }
+    // Проверка одного флага; формат копируется только после его смены
+    if (m_formatChanged.testAndSetOrdered(1, 0)) {
+        m_sink->formatChanged(format());
+    }
+    m_sink->frameArrived(frame);
+}
+
+FrameSource *FrameSource::create(const QString &spec)
+{
+    const QString kind = spec.section(':', 0, 0).trimmed().toLower();
+    const QString argument = spec.section(':', 1).trimmed();
+
+    if (kind.isEmpty() || kind == "camera") {
+#if defined(Q_OS_WIN)
+        return new DirectShowSource();
+#elif defined(Q_OS_LINUX)
+        return new V4L2Source();
+#else
+        qDebug() << "No camera backend on this platform, using synthetic source";
+        return new SyntheticSource();
+#endif
+    }
+
+    if (kind == "dshow") {
+#ifdef Q_OS_WIN
+        return new DirectShowSource(argument.toInt());
+#else
+        qDebug() << "DirectShow source is not available on this platform";
+        return nullptr;
+#endif
+    }
+
+    if (kind == "v4l2") {
+#ifdef Q_OS_LINUX
+        return argument.isEmpty() ? new V4L2Source() : new V4L2Source(argument);
+#else
+        qDebug() << "V4L2 source is not available on this platform";
+        return nullptr;
+#endif
+    }
+
+    if (kind == "synthetic") {
+        // WxH[@fps] [формат], например 1920x1080@60 или 1280x720@30 YUY2
+        if (argument.isEmpty()) {
+            return new SyntheticSource();
+        }
+        const CaptureMode mode = CaptureMode::fromString(argument);
+        if (mode.width <= 0 || mode.height <= 0) {
+            qDebug() << "Invalid synthetic source mode:" << argument;
+            return nullptr;
+        }
+        SyntheticSource *source = new SyntheticSource(mode.width, mode.height,
+                                                      mode.fps > 0 ? mode.fps : 30);
+        if (mode.pixelFormat != CaptureMode::AnyPixelFormat && !source->setMode(mode)) {
+            qDebug() << "Invalid synthetic source mode:" << argument << source->lastError();
+            delete source;
+            return nullptr;
+        }
+        return source;
+    }
+
+    if (kind == "replay") {
+        if (argument.isEmpty()) {
+            qDebug() << "Replay source requires a file path";
+            return nullptr;
+        }
+        return new ReplaySource(argument);
+    }
+
+    qDebug() << "Unknown frame source:" << spec;
+    return nullptr;
+}
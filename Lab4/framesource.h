@@ -0,0 +1,218 @@
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <QString>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QtGlobal>
+
+// Формат кадров источника.
+// Согласуется с устройством при открытии и меняется только при повторном
+// согласовании (смена режима камеры), а не от кадра к кадру.
+struct FrameFormat
+{
+    enum PixelFormat {
+        FormatBGR24,    // DIB / BI_RGB
+        FormatRGB24,
+        FormatYUY2,     // YUV 4:2:2, Y0 U Y1 V (V4L2 YUYV)
+        FormatNV12,     // YUV 4:2:0: плоскость Y, за ней чередующиеся U/V
+        FormatMJPEG     // каждый кадр - отдельный JPEG (размер в RawFrame::size)
+    };
+
+    int width;
+    int height;
+    int stride;         // байт на строку (у NV12 - строки Y и UV; у MJPEG - 0)
+    PixelFormat pixelFormat;
+    bool bottomUp;      // строки идут снизу вверх
+
+    FrameFormat()
+        : width(0), height(0), stride(0), pixelFormat(FormatBGR24), bottomUp(false) {}
+
+    bool isValid() const
+    {
+        return width > 0 && height > 0 && (stride > 0 || pixelFormat == FormatMJPEG);
+    }
+
+    // Размер несжатого кадра в байтах (у MJPEG меняется от кадра к кадру - 0)
+    qint64 frameBytes() const;
+
+    static const char *pixelFormatName(PixelFormat format);
+
+    bool operator==(const FrameFormat &other) const
+    {
+        return width == other.width && height == other.height && stride == other.stride &&
+               pixelFormat == other.pixelFormat && bottomUp == other.bottomUp;
+    }
+    bool operator!=(const FrameFormat &other) const { return !(*this == other); }
+};
+
+// Кадр источника в текущем формате (FrameSink::formatChanged).
+// Память принадлежит источнику и действительна только во время
+// FrameSink::frameArrived().
+struct RawFrame
+{
+    const uchar *data;
+    int size;           // байт в data (для MJPEG - размер JPEG)
+    qint64 timestampUs; // время захвата по часам источника, мкс
+    qint64 sequence;    // номер кадра у источника; -1 - неизвестен
+
+    RawFrame() : data(nullptr), size(0), timestampUs(0), sequence(-1) {}
+};
+
+// Режим захвата: размер, частота и формат пикселей.
+// В запросе (FrameSource::setMode) нулевые поля и AnyPixelFormat означают
+// "любое значение".
+struct CaptureMode
+{
+    enum { AnyPixelFormat = -1 };
+
+    int width;
+    int height;
+    int fps;
+    int pixelFormat;    // FrameFormat::PixelFormat или AnyPixelFormat
+
+    CaptureMode()
+        : width(0), height(0), fps(0), pixelFormat(AnyPixelFormat) {}
+    CaptureMode(int w, int h, int f, int format = AnyPixelFormat)
+        : width(w), height(h), fps(f), pixelFormat(format) {}
+
+    bool operator==(const CaptureMode &other) const
+    {
+        return width == other.width && height == other.height && fps == other.fps &&
+               pixelFormat == other.pixelFormat;
+    }
+    bool operator!=(const CaptureMode &other) const { return !(*this == other); }
+
+    // Запрос допускает этот режим (без учёта частоты)
+    bool matches(const CaptureMode &request) const;
+
+    // "1280x720@30 YUY2"; fromString() разбирает ту же запись, частота и
+    // формат необязательны ("1280x720", "640x480@60", "1920x1080 MJPEG")
+    QString toString() const;
+    static CaptureMode fromString(const QString &text);
+};
+
+// Получатель кадров
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+
+    // Формат следующих кадров. Вызывается в потоке источника перед первым
+    // кадром потока и перед первым кадром после смены формата - здесь
+    // получатель выбирает преобразование и готовит буферы.
+    virtual void formatChanged(const FrameFormat &format) = 0;
+
+    // Вызывается в потоке источника для каждого нового кадра ровно один раз.
+    // Данные нужно скопировать до возврата.
+    virtual void frameArrived(const RawFrame &frame) = 0;
+};
+
+// Источник кадров для CameraWorker.
+// Конвейер превью/записи/фото работает с любым источником: камерой
+// (DirectShow на Windows, V4L2 на Linux), синтетическим генератором или
+// воспроизведением AVI. Последние два позволяют нагружать конвейер без
+// камеры на произвольных разрешениях и частотах кадров.
+//
+// Кадры доставляются по мере появления (SampleCB у DirectShow, poll() у
+// V4L2, собственный поток у генераторов), а не опросом по таймеру.
+class FrameSource
+{
+public:
+    // Счётчики доставки за время жизни источника
+    struct Counters {
+        qint64 delivered;
+        qint64 dropped;     // кадры, потерянные до доставки (пропуски номеров)
+        qint64 duplicated;  // повторно полученные кадры (не доставлены)
+    };
+
+    FrameSource();
+    virtual ~FrameSource() {}
+
+    // Подключение к устройству / файлу
+    virtual bool open() = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+
+    // Запуск и остановка потока кадров.
+    // После возврата из stop() frameArrived() больше не вызывается.
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+
+    // Получатель кадров; задаётся до start()
+    void setSink(FrameSink *sink) { m_sink = sink; }
+
+    // Название API источника ("DirectShow", "V4L2", ...)
+    virtual QString name() const = 0;
+    // Дополнительная информация для окна "Информация о камере" (HTML)
+    virtual QString description() const { return QString(); }
+
+    // Текущий формат кадров (недействителен до open())
+    FrameFormat format() const;
+    int width() const { return format().width; }
+    int height() const { return format().height; }
+    virtual int frameRate() const { return 30; }
+
+    // Режимы, которые поддерживает устройство (известны после open()).
+    // По умолчанию - единственный текущий режим
+    virtual QList<CaptureMode> supportedModes() const;
+
+    // Запрос режима. Применяется при следующем open(), поэтому открытый
+    // источник нужно закрыть (CameraWorker::setCaptureMode делает это сам).
+    // Из подходящих режимов выбирается ближайший по частоте кадров.
+    // false - ни один режим не подходит (причина в lastError())
+    virtual bool setMode(const CaptureMode &mode);
+
+    // Текущий режим (по согласованному формату)
+    CaptureMode currentMode() const;
+
+    virtual Counters counters() const;
+
+    QString lastError() const { return m_lastError; }
+
+    // Создание источника по описанию:
+    //   ""  или "camera"         - камера платформы
+    //   "dshow[:N]"              - DirectShow (Windows), устройство номер N
+    //   "v4l2[:/dev/videoN]"     - V4L2 (Linux)
+    //   "synthetic[:WxH[@fps] [формат]]" - синтетический генератор
+    //                            (BGR24, YUY2 или NV12)
+    //   "replay:<файл.avi>"      - воспроизведение записанного AVI по кругу
+    // nullptr - источник недоступен на этой платформе
+    static FrameSource *create(const QString &spec);
+
+    // Лучший из modes для запроса request: -1, если ни один не подходит.
+    // Поля запроса без значения выбирают больший размер и частоту, среди
+    // равных предпочитаются форматы, которые дешевле обрабатывать
+    static int findMode(const QList<CaptureMode> &modes, const CaptureMode &request);
+
+protected:
+    void setError(const QString &error) { m_lastError = error; }
+
+    // Новый формат кадров. Получатель узнает о нём перед доставкой
+    // следующего кадра; повторная установка того же формата ничего не меняет.
+    void setFormat(const FrameFormat &format);
+
+    // Начало нового потока кадров (номера и метки времени начинаются заново)
+    void beginStream();
+
+    // Передача кадра получателю (из потока доставки).
+    // Кадр с уже доставленным номером/меткой времени считается повтором
+    // и не передаётся; пропуски в номерах считаются потерянными кадрами.
+    void deliver(const RawFrame &frame);
+
+private:
+    FrameSink *m_sink;
+    QString m_lastError;
+
+    // Защищает счётчики и формат (читаются из других потоков)
+    mutable QMutex m_stateMutex;
+    Counters m_counters;
+    FrameFormat m_format;
+    QAtomicInt m_formatChanged;
+    // Используются только потоком доставки
+    qint64 m_lastSequence;
+    qint64 m_lastTimestampUs;
+};
+
+#endif // FRAMESOURCE_H
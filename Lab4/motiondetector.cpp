@@ -0,0 +1,160 @@
+#include "motiondetector.h"
+#include "pixelconvert.h"
+#include <cstring>
+
+MotionDetector::MotionDetector()
+    : m_blockThreshold(12),
+      m_minBlocks(2),
+      m_holdMs(2000),
+      m_pixelFormat(FrameFormat::FormatRGB24),
+      m_factor(1),
+      m_blocksX(0),
+      m_blocksY(0),
+      m_planeStride(0),
+      m_current(0),
+      m_hasPrevious(false),
+      m_changedBlocks(0),
+      m_peakDifference(0),
+      m_active(false),
+      m_lastMotionUs(0)
+{
+}
+
+void MotionDetector::configure(int blockThreshold, int minBlocks, int holdMs)
+{
+    m_blockThreshold = qBound(1, blockThreshold, 255);
+    m_minBlocks = qMax(1, minBlocks);
+    m_holdMs = qMax(0, holdMs);
+    reset();
+}
+
+void MotionDetector::reset()
+{
+    m_hasPrevious = false;
+    m_regions.clear();
+    m_changedBlocks = 0;
+    m_peakDifference = 0;
+    m_active = false;
+}
+
+void MotionDetector::setup(const VideoFrame &frame)
+{
+    // Плоскость не шире MAX_PLANE_WIDTH: 1080p - в 4 раза, 720p - в 3
+    m_frameSize = frame.size();
+    m_pixelFormat = frame.pixelFormat();
+    m_factor = qMax(1, (frame.width() + MAX_PLANE_WIDTH - 1) / MAX_PLANE_WIDTH);
+    m_planeStride = frame.width() / m_factor;
+    const int planeHeight = frame.height() / m_factor;
+    // Неполные блоки у правого и нижнего края не учитываются
+    m_blocksX = m_planeStride / BLOCK_SIZE;
+    m_blocksY = planeHeight / BLOCK_SIZE;
+    for (int i = 0; i < 2; ++i) {
+        m_planes[i].fill(0, m_planeStride * planeHeight);
+    }
+    m_sums.resize(m_blocksX);
+    m_changed.fill(0, m_blocksX * m_blocksY);
+    m_stack.reserve(m_blocksX * m_blocksY);
+    m_hasPrevious = false;
+}
+
+void MotionDetector::process(const VideoFrame &frame, qint64 timeUs)
+{
+    if (frame.isNull()) {
+        return;
+    }
+    if (frame.size() != m_frameSize || frame.pixelFormat() != m_pixelFormat) {
+        setup(frame);
+    }
+
+    const PixelConvert::LumaSource source =
+        m_pixelFormat == FrameFormat::FormatYUY2 ? PixelConvert::LumaYUY2
+      : m_pixelFormat == FrameFormat::FormatNV12 ? PixelConvert::LumaNV12
+      : PixelConvert::LumaRGB24;
+    uchar *current = reinterpret_cast<uchar*>(m_planes[m_current].data());
+    const uchar *previous = reinterpret_cast<const uchar*>(m_planes[1 - m_current].constData());
+    PixelConvert::subsampleLuma(source, frame.constBits(), frame.bytesPerLine(),
+                                frame.width(), frame.height(),
+                                current, m_planeStride, m_factor);
+    m_current = 1 - m_current;
+
+    m_regions.clear();
+    m_changedBlocks = 0;
+    m_peakDifference = 0;
+    if (!m_hasPrevious) {
+        m_hasPrevious = true;
+    } else if (m_blocksX > 0) {
+        // SAD блоков построчно; порог - на сумму по блоку 16x16
+        const PixelConvert::BlockSadRowFunc sadRow = PixelConvert::blockSadRow();
+        const unsigned int threshold = unsigned(m_blockThreshold) * BLOCK_SIZE * BLOCK_SIZE;
+        unsigned int peak = 0;
+        for (int by = 0; by < m_blocksY; ++by) {
+            std::memset(m_sums.data(), 0, sizeof(unsigned int) * m_blocksX);
+            for (int row = by * BLOCK_SIZE; row < (by + 1) * BLOCK_SIZE; ++row) {
+                sadRow(current + row * m_planeStride, previous + row * m_planeStride,
+                       m_sums.data(), m_blocksX);
+            }
+            for (int bx = 0; bx < m_blocksX; ++bx) {
+                const bool changed = m_sums[bx] >= threshold;
+                m_changed[by * m_blocksX + bx] = changed ? 1 : 0;
+                m_changedBlocks += changed ? 1 : 0;
+                peak = qMax(peak, m_sums[bx]);
+            }
+        }
+        m_peakDifference = int(peak / (BLOCK_SIZE * BLOCK_SIZE));
+        if (m_changedBlocks >= m_minBlocks) {
+            findRegions();
+        }
+    }
+
+    if (hasMotion()) {
+        m_active = true;
+        m_lastMotionUs = timeUs;
+    } else if (m_active && timeUs - m_lastMotionUs >= qint64(m_holdMs) * 1000) {
+        m_active = false;
+    }
+}
+
+void MotionDetector::findRegions()
+{
+    // Связные (по сторонам) группы изменившихся блоков; обход стеком,
+    // пройденные блоки сбрасываются в 0
+    const int blockPixels = BLOCK_SIZE * m_factor;
+    const QRect frameRect(QPoint(0, 0), m_frameSize);
+    for (int start = 0; start < m_blocksX * m_blocksY; ++start) {
+        if (!m_changed[start]) {
+            continue;
+        }
+        int left = start % m_blocksX;
+        int right = left;
+        int top = start / m_blocksX;
+        int bottom = top;
+        m_stack.clear();
+        m_stack.append(start);
+        m_changed[start] = 0;
+        while (!m_stack.isEmpty()) {
+            const int block = m_stack.takeLast();
+            const int bx = block % m_blocksX;
+            const int by = block / m_blocksX;
+            left = qMin(left, bx);
+            right = qMax(right, bx);
+            top = qMin(top, by);
+            bottom = qMax(bottom, by);
+
+            const int neighbours[4] = {
+                bx > 0 ? block - 1 : -1,
+                bx + 1 < m_blocksX ? block + 1 : -1,
+                by > 0 ? block - m_blocksX : -1,
+                by + 1 < m_blocksY ? block + m_blocksX : -1
+            };
+            for (int i = 0; i < 4; ++i) {
+                if (neighbours[i] >= 0 && m_changed[neighbours[i]]) {
+                    m_changed[neighbours[i]] = 0;
+                    m_stack.append(neighbours[i]);
+                }
+            }
+        }
+        m_regions.append(QRect(left * blockPixels, top * blockPixels,
+                               (right - left + 1) * blockPixels,
+                               (bottom - top + 1) * blockPixels) & frameRect);
+    }
+}
@@ -0,0 +1,81 @@
+#ifndef MOTIONDETECTOR_H
+#define MOTIONDETECTOR_H
+
+#include <QByteArray>
+#include <QList>
+#include <QRect>
+#include <QVector>
+#include "videoframe.h"
+
+// Детектор движения по разности соседних кадров.
+// Кадр уменьшается до плоскости яркости шириной не больше MAX_PLANE_WIDTH
+// (PixelConvert::subsampleLuma читает лишь часть пикселей и не переводит
+// кадр в RGB), плоскость делится на блоки 16x16, и для каждого блока
+// считается SAD с предыдущим кадром SIMD-ядром. Блоки, где средняя разница
+// не меньше порога, объединяются в связные области.
+// Не потокобезопасен: вызывающий защищает его своим мьютексом.
+class MotionDetector
+{
+public:
+    enum {
+        BLOCK_SIZE = 16,        // блок плоскости яркости, пикселей
+        MAX_PLANE_WIDTH = 480   // 1080p уменьшается в 4 раза
+    };
+
+    MotionDetector();
+
+    // blockThreshold - средняя разница яркости блока (из 255), с которой
+    // блок считается изменившимся; minBlocks - сколько таких блоков нужно
+    // для движения; holdMs - сколько движение считается продолжающимся
+    // после последнего кадра с движением
+    void configure(int blockThreshold, int minBlocks, int holdMs);
+    int blockThreshold() const { return m_blockThreshold; }
+
+    // Забыть предыдущий кадр и состояние
+    void reset();
+
+    // Обработать кадр, полученный в момент timeUs
+    void process(const VideoFrame &frame, qint64 timeUs);
+
+    // Движение в последнем кадре и области движения в координатах кадра
+    bool hasMotion() const { return !m_regions.isEmpty(); }
+    const QList<QRect> &regions() const { return m_regions; }
+    int changedBlocks() const { return m_changedBlocks; }
+    // Наибольшая средняя разница блока в последнем кадре (0..255)
+    int peakDifference() const { return m_peakDifference; }
+
+    // Движение было не раньше чем holdMs назад
+    bool isActive() const { return m_active; }
+
+private:
+    void setup(const VideoFrame &frame);
+    void findRegions();
+
+    int m_blockThreshold;
+    int m_minBlocks;
+    int m_holdMs;
+
+    // Плоскости текущего и предыдущего кадра (по очереди)
+    QSize m_frameSize;
+    FrameFormat::PixelFormat m_pixelFormat;
+    int m_factor;
+    int m_blocksX;
+    int m_blocksY;
+    int m_planeStride;
+    QByteArray m_planes[2];
+    int m_current;
+    bool m_hasPrevious;
+
+    // Суммы SAD строки блоков, признаки изменения и стек обхода областей
+    QVector<unsigned int> m_sums;
+    QVector<uchar> m_changed;
+    QVector<int> m_stack;
+
+    QList<QRect> m_regions;
+    int m_changedBlocks;
+    int m_peakDifference;
+    bool m_active;
+    qint64 m_lastMotionUs;
+};
+
+#endif // MOTIONDETECTOR_H
@@ -0,0 +1,98 @@
+#include "pacedframesource.h"
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDebug>
+
+// Максимальный шаг ожидания: остановка не задерживается дольше
+static const qint64 PACED_MAX_SLEEP_US = 20000;
+
+class PacedFrameSource::Thread : public QThread
+{
+public:
+    explicit Thread(PacedFrameSource *owner) : m_owner(owner) {}
+
+protected:
+    void run() override { m_owner->runLoop(); }
+
+private:
+    PacedFrameSource *m_owner;
+};
+
+PacedFrameSource::PacedFrameSource(int fps)
+    : m_fps(qMax(1, fps)),
+      m_freeRunning(false),
+      m_thread(nullptr),
+      m_stopRequested(0)
+{
+}
+
+PacedFrameSource::~PacedFrameSource()
+{
+    // Производный класс уже разрушен - поток должен быть остановлен в его close()
+    Q_ASSERT(!m_thread);
+}
+
+bool PacedFrameSource::start()
+{
+    if (m_thread) {
+        return true;
+    }
+    if (!isOpen() && !open()) {
+        return false;
+    }
+
+    beginStream();
+    m_stopRequested.store(0);
+    m_thread = new Thread(this);
+    m_thread->start();
+    return true;
+}
+
+void PacedFrameSource::stop()
+{
+    if (!m_thread) {
+        return;
+    }
+
+    m_stopRequested.store(1);
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+}
+
+void PacedFrameSource::runLoop()
+{
+    QElapsedTimer clock;
+    clock.start();
+    qint64 index = 0;
+    int failures = 0;
+
+    while (!m_stopRequested.load()) {
+        const qint64 frameUs = 1000000 / m_fps;
+
+        if (!m_freeRunning) {
+            const qint64 dueUs = index * frameUs;
+            const qint64 nowUs = clock.nsecsElapsed() / 1000;
+            if (nowUs < dueUs) {
+                QThread::usleep(static_cast<unsigned long>(qMin(dueUs - nowUs, PACED_MAX_SLEEP_US)));
+                continue;
+            }
+            // Отстали больше чем на кадр - переходим к текущему
+            const qint64 current = nowUs / frameUs;
+            if (current > index) {
+                index = current;
+            }
+        }
+
+        RawFrame frame;
+        if (renderFrame(index, frame)) {
+            frame.timestampUs = index * frameUs;
+            frame.sequence = index;
+            deliver(frame);
+            failures = 0;
+        } else if (failures++ == 0) {
+            qDebug() << name() << "failed to render frame" << index << lastError();
+        }
+        index++;
+    }
+}
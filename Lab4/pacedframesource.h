@@ -0,0 +1,45 @@
+#ifndef PACEDFRAMESOURCE_H
+#define PACEDFRAMESOURCE_H
+
+#include "framesource.h"
+#include <QAtomicInt>
+
+// Основа для программных источников (генератор, воспроизведение файла):
+// собственный поток выдаёт кадр с номером N в момент N/fps секунды.
+// Если получатель не успевает, поток, как и камера, пропускает кадры
+// (они учитываются как потерянные).
+class PacedFrameSource : public FrameSource
+{
+public:
+    explicit PacedFrameSource(int fps);
+    ~PacedFrameSource();
+
+    bool start() override;
+    void stop() override;
+
+    int frameRate() const override { return m_fps; }
+
+    // true - кадры выдаются без ограничения частоты (для бенчмарков)
+    void setFreeRunning(bool freeRunning) { m_freeRunning = freeRunning; }
+    bool isFreeRunning() const { return m_freeRunning; }
+
+protected:
+    // Подготовка кадра с номером index; вызывается в потоке доставки.
+    // Поля timestampUs и sequence заполняет PacedFrameSource.
+    virtual bool renderFrame(qint64 index, RawFrame &frame) = 0;
+
+    void setFrameRate(int fps) { m_fps = qMax(1, fps); }
+    bool isRunning() const { return m_thread != nullptr; }
+
+private:
+    class Thread;
+
+    void runLoop();
+
+    int m_fps;
+    bool m_freeRunning;
+    Thread *m_thread;
+    QAtomicInt m_stopRequested;
+};
+
+#endif // PACEDFRAMESOURCE_H
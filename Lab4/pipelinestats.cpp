@@ -0,0 +1,117 @@
+#include "pipelinestats.h"
+#include <QElapsedTimer>
+#include <cstring>
+
+PipelineStats::PipelineStats()
+    : m_resetUs(nowUs())
+{
+    std::memset(m_histograms, 0, sizeof(m_histograms));
+}
+
+qint64 PipelineStats::nowUs()
+{
+    // Инициализация статической переменной потокобезопасна (C++11)
+    struct Clock {
+        Clock() { timer.start(); }
+        QElapsedTimer timer;
+    };
+    static const Clock clock;
+    return clock.timer.nsecsElapsed() / 1000;
+}
+
+int PipelineStats::bucketFor(qint64 us)
+{
+    // 0..3 мкс - по корзине на значение, дальше по 4 корзины на октаву:
+    // номер старшего бита и два следующих за ним бита
+    if (us < 4) {
+        return us < 0 ? 0 : int(us);
+    }
+    int msb = 2;
+    while (msb < 62 && (us >> (msb + 1)) != 0) {
+        msb++;
+    }
+    const int sub = int(us >> (msb - 2)) & 3;
+    return qMin(int(BucketCount) - 1, (msb - 1) * 4 + sub);
+}
+
+qint64 PipelineStats::bucketUpperUs(int bucket)
+{
+    if (bucket < 4) {
+        return bucket;
+    }
+    const int msb = bucket / 4 + 1;
+    const int sub = bucket % 4;
+    return (qint64(5 + sub) << (msb - 2)) - 1;
+}
+
+void PipelineStats::record(Stage stage, qint64 durationUs)
+{
+    if (durationUs < 0) {
+        durationUs = 0;
+    }
+    const int bucket = bucketFor(durationUs);
+
+    QMutexLocker locker(&m_mutex);
+    Histogram &histogram = m_histograms[stage];
+    histogram.buckets[bucket]++;
+    histogram.count++;
+    histogram.sumUs += durationUs;
+    histogram.maxUs = qMax(histogram.maxUs, durationUs);
+}
+
+void PipelineStats::reset()
+{
+    QMutexLocker locker(&m_mutex);
+    std::memset(m_histograms, 0, sizeof(m_histograms));
+    m_resetUs = nowUs();
+}
+
+qint64 PipelineStats::percentile(const Histogram &histogram, double fraction)
+{
+    if (histogram.count == 0) {
+        return 0;
+    }
+    // Верхняя граница корзины, в которую попадает заданная доля значений
+    const qint64 rank = qMax<qint64>(1, qint64(histogram.count * fraction + 0.5));
+    qint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += histogram.buckets[i];
+        if (seen >= rank) {
+            return qMin(bucketUpperUs(i), histogram.maxUs);
+        }
+    }
+    return histogram.maxUs;
+}
+
+PipelineStats::Snapshot PipelineStats::snapshot() const
+{
+    Snapshot snapshot;
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < StageCount; ++i) {
+        const Histogram &histogram = m_histograms[i];
+        StageSummary &summary = snapshot.stages[i];
+        summary.count = histogram.count;
+        summary.meanUs = histogram.count > 0 ? double(histogram.sumUs) / histogram.count : 0.0;
+        summary.p50Us = percentile(histogram, 0.50);
+        summary.p95Us = percentile(histogram, 0.95);
+        summary.p99Us = percentile(histogram, 0.99);
+        summary.maxUs = histogram.maxUs;
+    }
+    snapshot.elapsedMs = (nowUs() - m_resetUs) / 1000;
+    return snapshot;
+}
+
+const char *PipelineStats::stageName(Stage stage)
+{
+    switch (stage) {
+    case StageAcquire:  return "acquire";
+    case StageConvert:  return "convert";
+    case StageScale:    return "scale";
+    case StageMotion:   return "motion";
+    case StageDeliver:  return "deliver";
+    case StageEncode:   return "encode";
+    case StageWrite:    return "write";
+    case StageEndToEnd: return "end-to-end";
+    default:            return "?";
+    }
+}
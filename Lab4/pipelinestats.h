@@ -0,0 +1,75 @@
+#ifndef PIPELINESTATS_H
+#define PIPELINESTATS_H
+
+#include <QMutex>
+#include <QtGlobal>
+
+// Время этапов конвейера камеры.
+// Для каждого этапа хранится гистограмма длительностей (мкс) с логарифмическими
+// корзинами: 4 корзины на каждое удвоение, т.е. погрешность процентилей не
+// больше ~25%. Запись - O(1) без выделения памяти, из любого потока.
+class PipelineStats
+{
+public:
+    enum Stage {
+        StageAcquire,   // получение буфера кадра из пула
+        StageConvert,   // кадр источника в буфер пула (RGB888 или YUV как есть)
+        StageScale,     // уменьшение кадра превью
+        StageMotion,    // детектор движения
+        StageDeliver,   // от готовности кадра превью до вывода в окне
+        StageEncode,    // сжатие JPEG (запись видео и фото)
+        StageWrite,     // запись кадра в AVI
+        StageEndToEnd,  // от получения кадра от источника до вывода в окне
+        StageCount
+    };
+
+    struct StageSummary {
+        qint64 count;
+        double meanUs;
+        qint64 p50Us;
+        qint64 p95Us;
+        qint64 p99Us;
+        qint64 maxUs;
+    };
+
+    struct Snapshot {
+        StageSummary stages[StageCount];
+        qint64 elapsedMs;   // время с последнего reset()
+    };
+
+    PipelineStats();
+
+    // Монотонные часы процесса (общие для всех экземпляров, в том числе
+    // разных камер), мкс
+    static qint64 nowUs();
+
+    void record(Stage stage, qint64 durationUs);
+    // Длительность от метки startUs (nowUs()) до текущего момента
+    void recordSince(Stage stage, qint64 startUs) { record(stage, nowUs() - startUs); }
+
+    void reset();
+    Snapshot snapshot() const;
+
+    static const char *stageName(Stage stage);
+
+private:
+    enum { BucketCount = 104 };   // до 2^26 мкс (~67 с)
+
+    static int bucketFor(qint64 us);
+    static qint64 bucketUpperUs(int bucket);
+
+    struct Histogram {
+        qint64 buckets[BucketCount];
+        qint64 count;
+        qint64 sumUs;
+        qint64 maxUs;
+    };
+
+    static qint64 percentile(const Histogram &histogram, double fraction);
+
+    mutable QMutex m_mutex;
+    Histogram m_histograms[StageCount];
+    qint64 m_resetUs;
+};
+
+#endif // PIPELINESTATS_H
@@ -0,0 +1,1327 @@
+#include "pixelconvert.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define PIXELCONVERT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC/MinGW компилирует SIMD-ядра через атрибут target,
+// поэтому весь проект не требует флагов -mssse3/-mavx2
+#if defined(__GNUC__)
+#define PIXELCONVERT_TARGET(x) __attribute__((target(x)))
+#else
+#define PIXELCONVERT_TARGET(x)
+#endif
+
+namespace PixelConvert {
+
+// ---------------------------------------------------------------------------
+// Скалярные ядра
+// ---------------------------------------------------------------------------
+
+static void swapRedBlue24Scalar(const unsigned char *src, unsigned char *dst, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        dst[x * 3 + 0] = src[x * 3 + 2];
+        dst[x * 3 + 1] = src[x * 3 + 1];
+        dst[x * 3 + 2] = src[x * 3 + 0];
+    }
+}
+
+// QImage::Format_RGB32 в памяти (little-endian): B, G, R, 0xFF
+static void rgb24ToRgb32Scalar(const unsigned char *src, unsigned char *dst, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        dst[x * 4 + 0] = src[x * 3 + 2];
+        dst[x * 4 + 1] = src[x * 3 + 1];
+        dst[x * 4 + 2] = src[x * 3 + 0];
+        dst[x * 4 + 3] = 0xFF;
+    }
+}
+
+static void bgr24ToRgb32Scalar(const unsigned char *src, unsigned char *dst, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        dst[x * 4 + 0] = src[x * 3 + 0];
+        dst[x * 4 + 1] = src[x * 3 + 1];
+        dst[x * 4 + 2] = src[x * 3 + 2];
+        dst[x * 4 + 3] = 0xFF;
+    }
+}
+
+#ifdef PIXELCONVERT_X86
+
+// ---------------------------------------------------------------------------
+// SSSE3: 16 пикселей (48 байт) за итерацию.
+// Пиксели на границах 16-байтных регистров собираются из соседних регистров,
+// поэтому каждый выходной регистр - это OR нескольких pshufb.
+// ---------------------------------------------------------------------------
+
+PIXELCONVERT_TARGET("ssse3")
+static inline void swapRedBlue48(__m128i a, __m128i b, __m128i c,
+                                 __m128i &o0, __m128i &o1, __m128i &o2)
+{
+    const __m128i m0a = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, -1);
+    const __m128i m0b = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1);
+    const __m128i m1a = _mm_setr_epi8(-1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m1b = _mm_setr_epi8(0, -1, 4, 3, 2, 7, 6, 5, 10, 9, 8, 13, 12, 11, -1, 15);
+    const __m128i m1c = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1);
+    const __m128i m2b = _mm_setr_epi8(14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m2c = _mm_setr_epi8(-1, 3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10, 15, 14, 13);
+
+    o0 = _mm_or_si128(_mm_shuffle_epi8(a, m0a), _mm_shuffle_epi8(b, m0b));
+    o1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m1a), _mm_shuffle_epi8(b, m1b)),
+                      _mm_shuffle_epi8(c, m1c));
+    o2 = _mm_or_si128(_mm_shuffle_epi8(b, m2b), _mm_shuffle_epi8(c, m2c));
+}
+
+PIXELCONVERT_TARGET("ssse3")
+static void swapRedBlue24SSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i *s = reinterpret_cast<const __m128i*>(src + x * 3);
+        __m128i *d = reinterpret_cast<__m128i*>(dst + x * 3);
+        __m128i o0, o1, o2;
+        swapRedBlue48(_mm_loadu_si128(s), _mm_loadu_si128(s + 1), _mm_loadu_si128(s + 2), o0, o1, o2);
+        _mm_storeu_si128(d, o0);
+        _mm_storeu_si128(d + 1, o1);
+        _mm_storeu_si128(d + 2, o2);
+    }
+    swapRedBlue24Scalar(src + x * 3, dst + x * 3, width - x);
+}
+
+// 4 пикселя (12 байт) -> 16 байт; альфа добавляется через OR
+PIXELCONVERT_TARGET("ssse3")
+static inline void expand48(__m128i a, __m128i b, __m128i c, __m128i mask,
+                            __m128i &o0, __m128i &o1, __m128i &o2, __m128i &o3)
+{
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    o0 = _mm_or_si128(_mm_shuffle_epi8(a, mask), alpha);
+    o1 = _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(b, a, 12), mask), alpha);
+    o2 = _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(c, b, 8), mask), alpha);
+    o3 = _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(c, 4), mask), alpha);
+}
+
+PIXELCONVERT_TARGET("ssse3")
+static inline void expand24To32SSSE3(const unsigned char *src, unsigned char *dst, int width,
+                                     __m128i mask, RowFunc tail)
+{
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i *s = reinterpret_cast<const __m128i*>(src + x * 3);
+        __m128i *d = reinterpret_cast<__m128i*>(dst + x * 4);
+        __m128i o0, o1, o2, o3;
+        expand48(_mm_loadu_si128(s), _mm_loadu_si128(s + 1), _mm_loadu_si128(s + 2), mask, o0, o1, o2, o3);
+        _mm_storeu_si128(d, o0);
+        _mm_storeu_si128(d + 1, o1);
+        _mm_storeu_si128(d + 2, o2);
+        _mm_storeu_si128(d + 3, o3);
+    }
+    tail(src + x * 3, dst + x * 4, width - x);
+}
+
+PIXELCONVERT_TARGET("ssse3")
+static void rgb24ToRgb32SSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+    expand24To32SSSE3(src, dst, width,
+                      _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1),
+                      rgb24ToRgb32Scalar);
+}
+
+PIXELCONVERT_TARGET("ssse3")
+static void bgr24ToRgb32SSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+    expand24To32SSSE3(src, dst, width,
+                      _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1),
+                      bgr24ToRgb32Scalar);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: vpshufb работает внутри 128-битных половин, поэтому в половины
+// загружаются два независимых блока по 48 байт и применяются те же маски,
+// что и в SSSE3. 32 пикселя за итерацию.
+// ---------------------------------------------------------------------------
+
+PIXELCONVERT_TARGET("avx2")
+static inline __m256i loadLanes(const unsigned char *lo, const unsigned char *hi)
+{
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi)), 1);
+}
+
+PIXELCONVERT_TARGET("avx2")
+static inline void storeLanes(unsigned char *lo, unsigned char *hi, __m256i v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lo), _mm256_castsi256_si128(v));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hi), _mm256_extracti128_si256(v, 1));
+}
+
+PIXELCONVERT_TARGET("avx2")
+static void swapRedBlue24AVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+    const __m256i m0a = _mm256_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, -1,
+                                         2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, -1);
+    const __m256i m0b = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1,
+                                         -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1);
+    const __m256i m1a = _mm256_setr_epi8(-1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         -1, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i m1b = _mm256_setr_epi8(0, -1, 4, 3, 2, 7, 6, 5, 10, 9, 8, 13, 12, 11, -1, 15,
+                                         0, -1, 4, 3, 2, 7, 6, 5, 10, 9, 8, 13, 12, 11, -1, 15);
+    const __m256i m1c = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1,
+                                         -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1);
+    const __m256i m2b = _mm256_setr_epi8(14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i m2c = _mm256_setr_epi8(-1, 3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10, 15, 14, 13,
+                                         -1, 3, 2, 1, 6, 5, 4, 9, 8, 7, 12, 11, 10, 15, 14, 13);
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const unsigned char *s = src + x * 3;
+        unsigned char *d = dst + x * 3;
+        const __m256i a = loadLanes(s, s + 48);
+        const __m256i b = loadLanes(s + 16, s + 64);
+        const __m256i c = loadLanes(s + 32, s + 80);
+
+        const __m256i o0 = _mm256_or_si256(_mm256_shuffle_epi8(a, m0a), _mm256_shuffle_epi8(b, m0b));
+        const __m256i o1 = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(a, m1a),
+                                                           _mm256_shuffle_epi8(b, m1b)),
+                                           _mm256_shuffle_epi8(c, m1c));
+        const __m256i o2 = _mm256_or_si256(_mm256_shuffle_epi8(b, m2b), _mm256_shuffle_epi8(c, m2c));
+
+        storeLanes(d, d + 48, o0);
+        storeLanes(d + 16, d + 64, o1);
+        storeLanes(d + 32, d + 80, o2);
+    }
+    swapRedBlue24SSSE3(src + x * 3, dst + x * 3, width - x);
+}
+
+PIXELCONVERT_TARGET("avx2")
+static inline void expand24To32AVX2(const unsigned char *src, unsigned char *dst, int width,
+                                    __m256i mask, RowFunc tail)
+{
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const unsigned char *s = src + x * 3;
+        unsigned char *d = dst + x * 4;
+        const __m256i a = loadLanes(s, s + 48);
+        const __m256i b = loadLanes(s + 16, s + 64);
+        const __m256i c = loadLanes(s + 32, s + 80);
+
+        const __m256i o0 = _mm256_or_si256(_mm256_shuffle_epi8(a, mask), alpha);
+        const __m256i o1 = _mm256_or_si256(_mm256_shuffle_epi8(_mm256_alignr_epi8(b, a, 12), mask), alpha);
+        const __m256i o2 = _mm256_or_si256(_mm256_shuffle_epi8(_mm256_alignr_epi8(c, b, 8), mask), alpha);
+        const __m256i o3 = _mm256_or_si256(_mm256_shuffle_epi8(_mm256_srli_si256(c, 4), mask), alpha);
+
+        storeLanes(d, d + 64, o0);
+        storeLanes(d + 16, d + 80, o1);
+        storeLanes(d + 32, d + 96, o2);
+        storeLanes(d + 48, d + 112, o3);
+    }
+    tail(src + x * 3, dst + x * 4, width - x);
+}
+
+PIXELCONVERT_TARGET("avx2")
+static void rgb24ToRgb32AVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+    expand24To32AVX2(src, dst, width,
+                     _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                                      2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1),
+                     rgb24ToRgb32SSSE3);
+}
+
+PIXELCONVERT_TARGET("avx2")
+static void bgr24ToRgb32AVX2(const unsigned char *src, unsigned char *dst, int width)
+{
+    expand24To32AVX2(src, dst, width,
+                     _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                      0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1),
+                     bgr24ToRgb32SSSE3);
+}
+
+#endif // PIXELCONVERT_X86
+
+// ---------------------------------------------------------------------------
+// Определение возможностей процессора
+// ---------------------------------------------------------------------------
+
+struct CpuFeatures
+{
+    bool ssse3;
+    bool avx2;
+};
+
+static CpuFeatures detectCpuFeatures()
+{
+    CpuFeatures f;
+    f.ssse3 = false;
+    f.avx2 = false;
+
+#if defined(PIXELCONVERT_X86) && defined(__GNUC__)
+    __builtin_cpu_init();
+    f.ssse3 = __builtin_cpu_supports("ssse3") != 0;
+    f.avx2 = __builtin_cpu_supports("avx2") != 0;
+#elif defined(PIXELCONVERT_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    f.ssse3 = (info[2] & (1 << 9)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    // AVX2 можно использовать, только если ОС сохраняет YMM-регистры
+    if (osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        f.avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#endif
+
+    return f;
+}
+
+static const CpuFeatures &cpuFeatures()
+{
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+
+Kernel bestKernel()
+{
+    static const Kernel best = cpuFeatures().avx2 ? KernelAVX2
+                             : cpuFeatures().ssse3 ? KernelSSSE3
+                             : KernelScalar;
+    return best;
+}
+
+bool isKernelSupported(Kernel kernel)
+{
+    switch (kernel) {
+    case KernelScalar:
+        return true;
+    case KernelSSSE3:
+        return cpuFeatures().ssse3;
+    case KernelAVX2:
+        // AVX2-ядра дочищают хвост строки SSSE3-ядром
+        return cpuFeatures().avx2 && cpuFeatures().ssse3;
+    default:
+        return false;
+    }
+}
+
+const char *kernelName(Kernel kernel)
+{
+    switch (kernel) {
+    case KernelScalar: return "scalar";
+    case KernelSSSE3:  return "ssse3";
+    case KernelAVX2:   return "avx2";
+    default:           return "unknown";
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Выбор ядер
+// ---------------------------------------------------------------------------
+
+RowFunc swapRedBlue24Row(Kernel kernel)
+{
+    if (!isKernelSupported(kernel)) {
+        return nullptr;
+    }
+    switch (kernel) {
+#ifdef PIXELCONVERT_X86
+    case KernelSSSE3: return swapRedBlue24SSSE3;
+    case KernelAVX2:  return swapRedBlue24AVX2;
+#endif
+    case KernelScalar: return swapRedBlue24Scalar;
+    default:           return nullptr;
+    }
+}
+
+RowFunc rgb24ToRgb32Row(Kernel kernel)
+{
+    if (!isKernelSupported(kernel)) {
+        return nullptr;
+    }
+    switch (kernel) {
+#ifdef PIXELCONVERT_X86
+    case KernelSSSE3: return rgb24ToRgb32SSSE3;
+    case KernelAVX2:  return rgb24ToRgb32AVX2;
+#endif
+    case KernelScalar: return rgb24ToRgb32Scalar;
+    default:           return nullptr;
+    }
+}
+
+RowFunc bgr24ToRgb32Row(Kernel kernel)
+{
+    if (!isKernelSupported(kernel)) {
+        return nullptr;
+    }
+    switch (kernel) {
+#ifdef PIXELCONVERT_X86
+    case KernelSSSE3: return bgr24ToRgb32SSSE3;
+    case KernelAVX2:  return bgr24ToRgb32AVX2;
+#endif
+    case KernelScalar: return bgr24ToRgb32Scalar;
+    default:           return nullptr;
+    }
+}
+
+RowFunc swapRedBlue24Row()
+{
+    static const RowFunc row = swapRedBlue24Row(bestKernel());
+    return row;
+}
+
+RowFunc rgb24ToRgb32Row()
+{
+    static const RowFunc row = rgb24ToRgb32Row(bestKernel());
+    return row;
+}
+
+RowFunc bgr24ToRgb32Row()
+{
+    static const RowFunc row = bgr24ToRgb32Row(bestKernel());
+    return row;
+}
+
+// ---------------------------------------------------------------------------
+// Преобразование изображений
+// ---------------------------------------------------------------------------
+
+void convertImage(RowFunc row,
+                  const unsigned char *src, int srcStride,
+                  unsigned char *dst, int dstStride,
+                  int width, int height, bool flipVertical)
+{
+    for (int y = 0; y < height; ++y) {
+        const int srcRow = flipVertical ? (height - 1 - y) : y;
+        row(src + srcRow * srcStride, dst + y * dstStride, width);
+    }
+}
+
+void bgr24ToRgb24(const unsigned char *src, int srcStride,
+                  unsigned char *dst, int dstStride,
+                  int width, int height, bool flipVertical)
+{
+    convertImage(swapRedBlue24Row(), src, srcStride, dst, dstStride, width, height, flipVertical);
+}
+
+void rgb24ToBgr24(const unsigned char *src, int srcStride,
+                  unsigned char *dst, int dstStride,
+                  int width, int height, bool flipVertical)
+{
+    convertImage(swapRedBlue24Row(), src, srcStride, dst, dstStride, width, height, flipVertical);
+}
+
+void rgb24ToRgb32(const unsigned char *src, int srcStride,
+                  unsigned char *dst, int dstStride,
+                  int width, int height, bool flipVertical)
+{
+    convertImage(rgb24ToRgb32Row(), src, srcStride, dst, dstStride, width, height, flipVertical);
+}
+
+// ---------------------------------------------------------------------------
+// YUV
+// ---------------------------------------------------------------------------
+
+static inline unsigned char clampByte(int v)
+{
+    return static_cast<unsigned char>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Коэффициенты BT.601 в фиксированной точке (x256).
+// Bgr - порядок байтов BGR24 (DIB), иначе RGB24
+template <bool Bgr>
+static inline void yuvToRgb(int y, int u, int v, unsigned char *dst)
+{
+    const int c = 298 * (y - 16) + 128;
+    const int d = u - 128;
+    const int e = v - 128;
+    dst[Bgr ? 2 : 0] = clampByte((c + 409 * e) >> 8);
+    dst[1] = clampByte((c - 100 * d - 208 * e) >> 8);
+    dst[Bgr ? 0 : 2] = clampByte((c + 516 * d) >> 8);
+}
+
+template <bool Bgr>
+static void yuy2ToRgb24Scalar(const unsigned char *src, unsigned char *dst, int width)
+{
+    int x = 0;
+    for (; x + 1 < width; x += 2, src += 4, dst += 6) {
+        yuvToRgb<Bgr>(src[0], src[1], src[3], dst);
+        yuvToRgb<Bgr>(src[2], src[1], src[3], dst + 3);
+    }
+    if (x < width) {
+        yuvToRgb<Bgr>(src[0], src[1], src[3], dst);
+    }
+}
+
+template <bool Bgr>
+static void nv12ToRgb24Scalar(const unsigned char *luma, const unsigned char *uv,
+                              unsigned char *dst, int width)
+{
+    int x = 0;
+    for (; x + 1 < width; x += 2, uv += 2, dst += 6) {
+        yuvToRgb<Bgr>(luma[x], uv[0], uv[1], dst);
+        yuvToRgb<Bgr>(luma[x + 1], uv[0], uv[1], dst + 3);
+    }
+    if (x < width) {
+        yuvToRgb<Bgr>(luma[x], uv[0], uv[1], dst);
+    }
+}
+
+#ifdef PIXELCONVERT_X86
+
+// SSSE3: 8 пикселей за итерацию. Формулы те же, что у скалярного ядра:
+// пары (Y, V), (Y, U), (V, 1) умножаются на пары коэффициентов pmaddwd,
+// поэтому результат совпадает со скалярным побитово.
+// y, u, v - 8 значений int16; u и v уже продублированы на пары пикселей
+template <bool Bgr>
+PIXELCONVERT_TARGET("ssse3")
+static inline void yuvToRgb24x8(__m128i y, __m128i u, __m128i v, unsigned char *dst)
+{
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i round = _mm_set1_epi32(128);
+    const __m128i kR = _mm_setr_epi16(298, 409, 298, 409, 298, 409, 298, 409);
+    const __m128i kB = _mm_setr_epi16(298, 516, 298, 516, 298, 516, 298, 516);
+    const __m128i kG1 = _mm_setr_epi16(298, -100, 298, -100, 298, -100, 298, -100);
+    const __m128i kG2 = _mm_setr_epi16(-208, 128, -208, 128, -208, 128, -208, 128);
+
+    y = _mm_sub_epi16(y, _mm_set1_epi16(16));
+    u = _mm_sub_epi16(u, _mm_set1_epi16(128));
+    v = _mm_sub_epi16(v, _mm_set1_epi16(128));
+
+    const __m128i yvLo = _mm_unpacklo_epi16(y, v);
+    const __m128i yvHi = _mm_unpackhi_epi16(y, v);
+    const __m128i yuLo = _mm_unpacklo_epi16(y, u);
+    const __m128i yuHi = _mm_unpackhi_epi16(y, u);
+    const __m128i vLo = _mm_unpacklo_epi16(v, one);
+    const __m128i vHi = _mm_unpackhi_epi16(v, one);
+
+    const __m128i r = _mm_packs_epi32(
+        _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvLo, kR), round), 8),
+        _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yvHi, kR), round), 8));
+    const __m128i g = _mm_packs_epi32(
+        _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, kG1), _mm_madd_epi16(vLo, kG2)), 8),
+        _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, kG1), _mm_madd_epi16(vHi, kG2)), 8));
+    const __m128i b = _mm_packs_epi32(
+        _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuLo, kB), round), 8),
+        _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(yuHi, kB), round), 8));
+
+    // Насыщение до 0..255 и раскладка по 24 байтам: для BGR24 R и B
+    // просто меняются местами до раскладки
+    const __m128i first = Bgr ? b : r;
+    const __m128i third = Bgr ? r : b;
+    const __m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(first, first), _mm_packus_epi16(g, g));
+    const __m128i b8 = _mm_packus_epi16(third, third);
+    const __m128i m0rg = _mm_setr_epi8(0, 1, -1, 2, 3, -1, 4, 5, -1, 6, 7, -1, 8, 9, -1, 10);
+    const __m128i m0b = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    const __m128i m1rg = _mm_setr_epi8(11, -1, 12, 13, -1, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m1b = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst),
+                     _mm_or_si128(_mm_shuffle_epi8(rg, m0rg), _mm_shuffle_epi8(b8, m0b)));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + 16),
+                     _mm_or_si128(_mm_shuffle_epi8(rg, m1rg), _mm_shuffle_epi8(b8, m1b)));
+}
+
+template <bool Bgr>
+PIXELCONVERT_TARGET("ssse3")
+static void yuy2ToRgb24SSSE3(const unsigned char *src, unsigned char *dst, int width)
+{
+    const __m128i maskY = _mm_setr_epi8(0, -1, 2, -1, 4, -1, 6, -1, 8, -1, 10, -1, 12, -1, 14, -1);
+    const __m128i maskU = _mm_setr_epi8(1, -1, 1, -1, 5, -1, 5, -1, 9, -1, 9, -1, 13, -1, 13, -1);
+    const __m128i maskV = _mm_setr_epi8(3, -1, 3, -1, 7, -1, 7, -1, 11, -1, 11, -1, 15, -1, 15, -1);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+        yuvToRgb24x8<Bgr>(_mm_shuffle_epi8(pixels, maskY), _mm_shuffle_epi8(pixels, maskU),
+                          _mm_shuffle_epi8(pixels, maskV), dst + x * 3);
+    }
+    yuy2ToRgb24Scalar<Bgr>(src + x * 2, dst + x * 3, width - x);
+}
+
+template <bool Bgr>
+PIXELCONVERT_TARGET("ssse3")
+static void nv12ToRgb24SSSE3(const unsigned char *luma, const unsigned char *uv,
+                             unsigned char *dst, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i maskU = _mm_setr_epi8(0, -1, 0, -1, 2, -1, 2, -1, 4, -1, 4, -1, 6, -1, 6, -1);
+    const __m128i maskV = _mm_setr_epi8(1, -1, 1, -1, 3, -1, 3, -1, 5, -1, 5, -1, 7, -1, 7, -1);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m128i y = _mm_unpacklo_epi8(
+            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(luma + x)), zero);
+        const __m128i chroma = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(uv + x));
+        yuvToRgb24x8<Bgr>(y, _mm_shuffle_epi8(chroma, maskU), _mm_shuffle_epi8(chroma, maskV),
+                          dst + x * 3);
+    }
+    nv12ToRgb24Scalar<Bgr>(luma + x, uv + x, dst + x * 3, width - x);
+}
+
+#endif // PIXELCONVERT_X86
+
+// Для YUV отдельного AVX2-варианта нет: на таких процессорах работает SSSE3
+RowFunc yuy2ToRgb24Row(Kernel kernel)
+{
+    if (!isKernelSupported(kernel)) {
+        return nullptr;
+    }
+    switch (kernel) {
+#ifdef PIXELCONVERT_X86
+    case KernelSSSE3:
+    case KernelAVX2:   return yuy2ToRgb24SSSE3<false>;
+#endif
+    case KernelScalar: return yuy2ToRgb24Scalar<false>;
+    default:           return nullptr;
+    }
+}
+
+Nv12RowFunc nv12ToRgb24Row(Kernel kernel)
+{
+    if (!isKernelSupported(kernel)) {
+        return nullptr;
+    }
+    switch (kernel) {
+#ifdef PIXELCONVERT_X86
+    case KernelSSSE3:
+    case KernelAVX2:   return nv12ToRgb24SSSE3<false>;
+#endif
+    case KernelScalar: return nv12ToRgb24Scalar<false>;
+    default:           return nullptr;
+    }
+}
+
+RowFunc yuy2ToBgr24Row(Kernel kernel)
+{
+    if (!isKernelSupported(kernel)) {
+        return nullptr;
+    }
+    switch (kernel) {
+#ifdef PIXELCONVERT_X86
+    case KernelSSSE3:
+    case KernelAVX2:   return yuy2ToRgb24SSSE3<true>;
+#endif
+    case KernelScalar: return yuy2ToRgb24Scalar<true>;
+    default:           return nullptr;
+    }
+}
+
+Nv12RowFunc nv12ToBgr24Row(Kernel kernel)
+{
+    if (!isKernelSupported(kernel)) {
+        return nullptr;
+    }
+    switch (kernel) {
+#ifdef PIXELCONVERT_X86
+    case KernelSSSE3:
+    case KernelAVX2:   return nv12ToRgb24SSSE3<true>;
+#endif
+    case KernelScalar: return nv12ToRgb24Scalar<true>;
+    default:           return nullptr;
+    }
+}
+
+RowFunc yuy2ToRgb24Row()
+{
+    static const RowFunc row = yuy2ToRgb24Row(bestKernel());
+    return row;
+}
+
+Nv12RowFunc nv12ToRgb24Row()
+{
+    static const Nv12RowFunc row = nv12ToRgb24Row(bestKernel());
+    return row;
+}
+
+RowFunc yuy2ToBgr24Row()
+{
+    static const RowFunc row = yuy2ToBgr24Row(bestKernel());
+    return row;
+}
+
+Nv12RowFunc nv12ToBgr24Row()
+{
+    static const Nv12RowFunc row = nv12ToBgr24Row(bestKernel());
+    return row;
+}
+
+void yuy2ToRgb24(const unsigned char *src, int srcStride,
+                 unsigned char *dst, int dstStride,
+                 int width, int height)
+{
+    convertImage(yuy2ToRgb24Row(), src, srcStride, dst, dstStride, width, height, false);
+}
+
+void nv12ToRgb24(const unsigned char *src, int srcStride,
+                 unsigned char *dst, int dstStride,
+                 int width, int height)
+{
+    const Nv12RowFunc row = nv12ToRgb24Row();
+    const unsigned char *uvPlane = src + srcStride * height;
+    for (int y = 0; y < height; ++y) {
+        // Одна строка UV на две строки Y
+        row(src + y * srcStride, uvPlane + (y / 2) * srcStride, dst + y * dstStride, width);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Масштабирование
+// ---------------------------------------------------------------------------
+
+// Отсчёт билинейной интерполяции: два соседних пикселя и вес второго (из 256)
+struct ScaleTap
+{
+    int first;
+    int second;
+    int weight;
+};
+
+// Сумма строки в 16-битный аккумулятор (до 257 строк без переполнения)
+static void accumulateRowScalar(const unsigned char *src, unsigned short *acc, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        acc[i] = static_cast<unsigned short>(acc[i] + src[i]);
+    }
+}
+
+// dst = (a * (256 - weight) + b * weight) / 256, weight в [0, 256]
+static void blendRowsScalar(const unsigned char *a, const unsigned char *b,
+                            unsigned char *dst, int count, int weight)
+{
+    const int wa = 256 - weight;
+    for (int i = 0; i < count; ++i) {
+        dst[i] = static_cast<unsigned char>((a[i] * wa + b[i] * weight) >> 8);
+    }
+}
+
+// Усреднение пикселей строки аккумулятора группами по k (сумма k x k)
+static void boxReduceRowScalar(const unsigned short *acc, unsigned char *dst, int dstWidth,
+                               int k, unsigned long long reciprocal)
+{
+    for (int x = 0; x < dstWidth; ++x) {
+        const unsigned short *p = acc + x * k * 3;
+        unsigned int r = 0, g = 0, b = 0;
+        for (int i = 0; i < k; ++i, p += 3) {
+            r += p[0];
+            g += p[1];
+            b += p[2];
+        }
+        dst[x * 3 + 0] = static_cast<unsigned char>(std::min(255ULL, (r * reciprocal + (1 << 23)) >> 24));
+        dst[x * 3 + 1] = static_cast<unsigned char>(std::min(255ULL, (g * reciprocal + (1 << 23)) >> 24));
+        dst[x * 3 + 2] = static_cast<unsigned char>(std::min(255ULL, (b * reciprocal + (1 << 23)) >> 24));
+    }
+}
+
+// Горизонтальная интерполяция смешанной строки RGB24 (rowBytes байт)
+// с записью в Format_RGB32 (в памяти B, G, R, 0xFF)
+static void blendPixelsScalar(const unsigned char *row, int rowBytes, const ScaleTap *taps,
+                              unsigned char *dst, int width)
+{
+    (void)rowBytes;
+    for (int x = 0; x < width; ++x, dst += 4) {
+        const unsigned char *p0 = row + taps[x].first;
+        const unsigned char *p1 = row + taps[x].second;
+        const int w1 = taps[x].weight;
+        const int w0 = 256 - w1;
+        dst[0] = static_cast<unsigned char>((p0[2] * w0 + p1[2] * w1) >> 8);
+        dst[1] = static_cast<unsigned char>((p0[1] * w0 + p1[1] * w1) >> 8);
+        dst[2] = static_cast<unsigned char>((p0[0] * w0 + p1[0] * w1) >> 8);
+        dst[3] = 0xFF;
+    }
+}
+
+#ifdef PIXELCONVERT_X86
+
+// Вертикальные проходы работают с байтами строки независимо от раскладки
+// пикселей, поэтому хватает SSE2 (входит в SSSE3). 16 байт за итерацию.
+
+PIXELCONVERT_TARGET("ssse3")
+static void accumulateRowSSSE3(const unsigned char *src, unsigned short *acc, int count)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i *a = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), _mm_unpacklo_epi8(s, zero)));
+        _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1), _mm_unpackhi_epi8(s, zero)));
+    }
+    accumulateRowScalar(src + i, acc + i, count - i);
+}
+
+PIXELCONVERT_TARGET("ssse3")
+static void blendRowsSSSE3(const unsigned char *a, const unsigned char *b,
+                           unsigned char *dst, int count, int weight)
+{
+    // Сумма не превышает 255 * 256 и помещается в беззнаковые 16 бит
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wa = _mm_set1_epi16(static_cast<short>(256 - weight));
+    const __m128i wb = _mm_set1_epi16(static_cast<short>(weight));
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        const __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(va, zero), wa),
+                                                        _mm_mullo_epi16(_mm_unpacklo_epi8(vb, zero), wb)), 8);
+        const __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(va, zero), wa),
+                                                        _mm_mullo_epi16(_mm_unpackhi_epi8(vb, zero), wb)), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(lo, hi));
+    }
+    blendRowsScalar(a + i, b + i, dst + i, count - i, weight);
+}
+
+// (s * reciprocal + 2^23) >> 24 для восьми 16-битных сумм, как в скалярном
+// ядре: произведение до 40 бит, поэтому умножение 32 x 32 -> 64 (pmuludq)
+PIXELCONVERT_TARGET("ssse3")
+static inline __m128i divideSums(__m128i sums, __m128i reciprocal)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set_epi32(0, 1 << 23, 0, 1 << 23);
+    __m128i halves[2] = { _mm_unpacklo_epi16(sums, zero), _mm_unpackhi_epi16(sums, zero) };
+    for (int h = 0; h < 2; ++h) {
+        const __m128i even = _mm_srli_epi64(
+            _mm_add_epi64(_mm_mul_epu32(halves[h], reciprocal), round), 24);
+        const __m128i odd = _mm_srli_epi64(
+            _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(halves[h], 32), reciprocal), round), 24);
+        halves[h] = _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+    }
+    return _mm_packs_epi32(halves[0], halves[1]);
+}
+
+// Горизонтальное усреднение: 4 выходных пикселя за итерацию, блок каждого
+// читается по 4 значения (R, G, B и лишнее), суммы остаются 16-битными до
+// k = 16. Последний пиксель всегда скалярный: чтение 4 значений у него
+// вышло бы за строку аккумулятора
+PIXELCONVERT_TARGET("ssse3")
+static void boxReduceRowSSSE3(const unsigned short *acc, unsigned char *dst, int dstWidth,
+                              int k, unsigned long long reciprocal)
+{
+    if (k > 16) {
+        boxReduceRowScalar(acc, dst, dstWidth, k, reciprocal);
+        return;
+    }
+    const __m128i factor = _mm_set_epi32(0, static_cast<int>(reciprocal), 0, static_cast<int>(reciprocal));
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const int step = k * 3;
+    int x = 0;
+    for (; x + 4 < dstWidth; x += 4) {
+        const unsigned short *p = acc + x * step;
+        __m128i first = _mm_setzero_si128();
+        __m128i second = _mm_setzero_si128();
+        for (int i = 0; i < k; ++i, p += 3) {
+            first = _mm_add_epi16(first, _mm_unpacklo_epi64(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)),
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + step))));
+            second = _mm_add_epi16(second, _mm_unpacklo_epi64(
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 2 * step)),
+                _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 3 * step))));
+        }
+        const __m128i rgb = _mm_shuffle_epi8(
+            _mm_packus_epi16(divideSums(first, factor), divideSums(second, factor)), pack);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x * 3), rgb);
+        const int tail = _mm_cvtsi128_si32(_mm_srli_si128(rgb, 8));
+        std::memcpy(dst + x * 3 + 8, &tail, 4);
+    }
+    boxReduceRowScalar(acc + x * step, dst + x * 3, dstWidth - x, k, reciprocal);
+}
+
+// Горизонтальная интерполяция по 4 пикселя: каждый пиксель читается
+// 4 байтами, поэтому векторная часть идёт, пока чтение не выходит за строку
+PIXELCONVERT_TARGET("ssse3")
+static void blendPixelsSSSE3(const unsigned char *row, int rowBytes, const ScaleTap *taps,
+                             unsigned char *dst, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(256);
+    const __m128i toBgra = _mm_setr_epi8(2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    int x = 0;
+    for (; x + 4 <= width && taps[x + 3].second + 4 <= rowBytes; x += 4) {
+        int p0[4], p1[4];
+        for (int j = 0; j < 4; ++j) {
+            std::memcpy(&p0[j], row + taps[x + j].first, 4);
+            std::memcpy(&p1[j], row + taps[x + j].second, 4);
+        }
+        const __m128i a = _mm_setr_epi32(p0[0], p0[1], p0[2], p0[3]);
+        const __m128i b = _mm_setr_epi32(p1[0], p1[1], p1[2], p1[3]);
+        const short w0 = static_cast<short>(taps[x].weight);
+        const short w1 = static_cast<short>(taps[x + 1].weight);
+        const short w2 = static_cast<short>(taps[x + 2].weight);
+        const short w3 = static_cast<short>(taps[x + 3].weight);
+        const __m128i wLo = _mm_setr_epi16(w0, w0, w0, w0, w1, w1, w1, w1);
+        const __m128i wHi = _mm_setr_epi16(w2, w2, w2, w2, w3, w3, w3, w3);
+        // Как в blendRowsSSSE3: сумма не превышает 255 * 256
+        const __m128i lo = _mm_srli_epi16(_mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), _mm_sub_epi16(full, wLo)),
+            _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), wLo)), 8);
+        const __m128i hi = _mm_srli_epi16(_mm_add_epi16(
+            _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), _mm_sub_epi16(full, wHi)),
+            _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), wHi)), 8);
+        const __m128i pixels = _mm_or_si128(_mm_shuffle_epi8(_mm_packus_epi16(lo, hi), toBgra), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), pixels);
+    }
+    blendPixelsScalar(row, rowBytes, taps + x, dst + x * 4, width - x);
+}
+
+#endif // PIXELCONVERT_X86
+
+// Центры выходных пикселей проецируются на исходные
+static ScaleTap scaleTap(int dstIndex, int srcCount, int dstCount)
+{
+    const long long position = (2LL * dstIndex + 1) * srcCount * 256 / (2LL * dstCount) - 128;
+    const long long clamped = std::max(0LL, std::min(position, (srcCount - 1) * 256LL));
+    ScaleTap tap;
+    tap.first = static_cast<int>(clamped >> 8);
+    tap.second = std::min(tap.first + 1, srcCount - 1);
+    tap.weight = static_cast<int>(clamped & 255);
+    return tap;
+}
+
+// Коэффициент предварительного усреднения: уменьшение после него - менее 2 раз
+static int boxFactor(int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+{
+    return std::max(1, std::min(255, std::min(srcWidth / dstWidth, srcHeight / dstHeight)));
+}
+
+static unsigned int alignScratch(unsigned int size)
+{
+    return (size + 15) & ~15u;
+}
+
+unsigned int scaleScratchSize(int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+{
+    const int k = boxFactor(srcWidth, srcHeight, dstWidth, dstHeight);
+    const int midWidth = srcWidth / k;
+    const int midHeight = srcHeight / k;
+
+    unsigned int size = alignScratch(sizeof(ScaleTap) * dstWidth)     // отсчёты по X
+                      + alignScratch(midWidth * 3);                   // строка после смешивания
+    if (k > 1) {
+        size += alignScratch(sizeof(unsigned short) * srcWidth * 3)   // аккумулятор
+              + alignScratch(midWidth * 3 * midHeight);               // усреднённое изображение
+    }
+    return size;
+}
+
+unsigned int scaleYuvScratchSize(int srcWidth, int srcHeight, int dstWidth, int dstHeight)
+{
+    // Аккумулятор RGB24 (srcWidth * 3) вмещает и аккумуляторы YUV
+    // (не больше srcWidth + 2 на Y и столько же на U/V), а без усреднения
+    // нужны две преобразованные строки
+    return scaleScratchSize(srcWidth, srcHeight, dstWidth, dstHeight)
+         + 2 * alignScratch(srcWidth * 3 + 6);
+}
+
+// Строки RGB24 для билинейного прохода. slot - буфер вызывающего (0 или 1):
+// две строки, полученные с разными slot, действительны одновременно
+class RgbRowSource
+{
+public:
+    virtual ~RgbRowSource() {}
+    virtual const unsigned char *row(int y, int slot) = 0;
+};
+
+class PlainRgbRows : public RgbRowSource
+{
+public:
+    PlainRgbRows(const unsigned char *base, int stride) : m_base(base), m_stride(stride) {}
+    const unsigned char *row(int y, int) override { return m_base + y * m_stride; }
+
+private:
+    const unsigned char *m_base;
+    int m_stride;
+};
+
+// Строки кадра YUV, преобразованные в RGB24 по требованию. Два буфера
+// не привязаны к slot: строка, уже лежащая в одном из них, повторно не
+// преобразуется (нижняя строка пары становится верхней в следующей)
+class YuvRgbRows : public RgbRowSource
+{
+public:
+    YuvRgbRows(YuvLayout layout, const unsigned char *src, int stride, int width, int height,
+               unsigned char *buffers, int bufferSize, Kernel kernel)
+        : m_layout(layout), m_src(src), m_stride(stride), m_width(width), m_height(height),
+          m_yuy2(yuy2ToRgb24Row(kernel)), m_nv12(nv12ToRgb24Row(kernel))
+    {
+        m_buffers[0] = buffers;
+        m_buffers[1] = buffers + bufferSize;
+        m_cached[0] = -1;
+        m_cached[1] = -1;
+        m_used[0] = 0;
+        m_used[1] = 1;
+    }
+
+    const unsigned char *row(int y, int slot) override
+    {
+        int index = m_cached[0] == y ? 0 : (m_cached[1] == y ? 1 : -1);
+        if (index < 0) {
+            // Буфер, не занятый строкой другого slot
+            index = 1 - m_used[1 - slot];
+            if (m_layout == YuvYUY2) {
+                m_yuy2(m_src + y * m_stride, m_buffers[index], m_width);
+            } else {
+                m_nv12(m_src + y * m_stride, m_src + (m_height + y / 2) * m_stride,
+                       m_buffers[index], m_width);
+            }
+            m_cached[index] = y;
+        }
+        m_used[slot] = index;
+        return m_buffers[index];
+    }
+
+private:
+    YuvLayout m_layout;
+    const unsigned char *m_src;
+    int m_stride;
+    int m_width;
+    int m_height;
+    RowFunc m_yuy2;
+    Nv12RowFunc m_nv12;
+    unsigned char *m_buffers[2];
+    int m_cached[2];
+    int m_used[2];
+};
+
+// Ядра масштабирования. Для AVX2 используются SSSE3-варианты
+struct ScaleKernels
+{
+    void (*accumulateRow)(const unsigned char *src, unsigned short *acc, int count);
+    void (*blendRows)(const unsigned char *a, const unsigned char *b,
+                      unsigned char *dst, int count, int weight);
+    void (*boxReduceRow)(const unsigned short *acc, unsigned char *dst, int dstWidth,
+                         int k, unsigned long long reciprocal);
+    void (*blendPixels)(const unsigned char *row, int rowBytes, const ScaleTap *taps,
+                        unsigned char *dst, int width);
+    RowFunc toRgb32;
+};
+
+static ScaleKernels selectScaleKernels(Kernel kernel)
+{
+    ScaleKernels kernels;
+    kernels.accumulateRow = accumulateRowScalar;
+    kernels.blendRows = blendRowsScalar;
+    kernels.boxReduceRow = boxReduceRowScalar;
+    kernels.blendPixels = blendPixelsScalar;
+    kernels.toRgb32 = rgb24ToRgb32Row(KernelScalar);
+#ifdef PIXELCONVERT_X86
+    if (kernel != KernelScalar && isKernelSupported(kernel)) {
+        kernels.accumulateRow = accumulateRowSSSE3;
+        kernels.blendRows = blendRowsSSSE3;
+        kernels.boxReduceRow = boxReduceRowSSSE3;
+        kernels.blendPixels = blendPixelsSSSE3;
+        kernels.toRgb32 = rgb24ToRgb32Row(kernel);
+    }
+#else
+    (void)kernel;
+#endif
+    return kernels;
+}
+
+// Билинейная интерполяция изображения RGB24 midWidth x midHeight до
+// точного размера с записью в Format_RGB32
+static void blendToRgb32(RgbRowSource &mid, int midWidth, int midHeight,
+                         unsigned char *dst, int dstStride, int dstWidth, int dstHeight,
+                         ScaleTap *taps, unsigned char *blended, const ScaleKernels &kernels)
+{
+    for (int x = 0; x < dstWidth; ++x) {
+        taps[x] = scaleTap(x, midWidth, dstWidth);
+        taps[x].first *= 3;
+        taps[x].second *= 3;
+    }
+
+    for (int y = 0; y < dstHeight; ++y) {
+        const ScaleTap row = scaleTap(y, midHeight, dstHeight);
+        // Нулевой вес - строка (пиксель) берётся как есть: так бывает, когда
+        // усреднение уже дало точный размер (720p и 1080p в окно 640x360)
+        const unsigned char *line = mid.row(row.first, 0);
+        if (row.weight != 0) {
+            kernels.blendRows(line, mid.row(row.second, 1), blended, midWidth * 3, row.weight);
+            line = blended;
+        }
+        if (midWidth == dstWidth) {
+            kernels.toRgb32(line, dst + y * dstStride, dstWidth);
+        } else {
+            kernels.blendPixels(line, midWidth * 3, taps, dst + y * dstStride, dstWidth);
+        }
+    }
+}
+
+void scaleRgb24ToRgb32(const unsigned char *src, int srcStride, int srcWidth, int srcHeight,
+                       unsigned char *dst, int dstStride, int dstWidth, int dstHeight,
+                       unsigned char *scratch, Kernel kernel)
+{
+    // Размер совпадает - достаточно преобразования пикселей
+    if (srcWidth == dstWidth && srcHeight == dstHeight && isKernelSupported(kernel)) {
+        convertImage(rgb24ToRgb32Row(kernel), src, srcStride, dst, dstStride,
+                     dstWidth, dstHeight, false);
+        return;
+    }
+
+    const ScaleKernels kernels = selectScaleKernels(kernel);
+
+    const int k = boxFactor(srcWidth, srcHeight, dstWidth, dstHeight);
+    const int midWidth = srcWidth / k;
+    const int midHeight = srcHeight / k;
+
+    ScaleTap *taps = reinterpret_cast<ScaleTap*>(scratch);
+    unsigned char *blended = scratch + alignScratch(sizeof(ScaleTap) * dstWidth);
+    unsigned char *next = blended + alignScratch(midWidth * 3);
+
+    // 1. Усреднение блоков k x k
+    const unsigned char *mid = src;
+    int midStride = srcStride;
+    if (k > 1) {
+        unsigned short *acc = reinterpret_cast<unsigned short*>(next);
+        unsigned char *reduced = next + alignScratch(sizeof(unsigned short) * srcWidth * 3);
+        // Деление на k * k заменяется умножением (24 бита дробной части)
+        const unsigned long long reciprocal = ((1ULL << 24) + (k * k) / 2) / (k * k);
+        for (int y = 0; y < midHeight; ++y) {
+            std::fill(acc, acc + srcWidth * 3, static_cast<unsigned short>(0));
+            for (int i = 0; i < k; ++i) {
+                kernels.accumulateRow(src + (y * k + i) * srcStride, acc, midWidth * k * 3);
+            }
+            kernels.boxReduceRow(acc, reduced + y * midWidth * 3, midWidth, k, reciprocal);
+        }
+        mid = reduced;
+        midStride = midWidth * 3;
+    }
+
+    // 2. Билинейная интерполяция до точного размера
+    PlainRgbRows rows(mid, midStride);
+    blendToRgb32(rows, midWidth, midHeight, dst, dstStride, dstWidth, dstHeight,
+                 taps, blended, kernels);
+}
+
+void scaleRgb24ToRgb32(const unsigned char *src, int srcStride, int srcWidth, int srcHeight,
+                       unsigned char *dst, int dstStride, int dstWidth, int dstHeight,
+                       unsigned char *scratch)
+{
+    scaleRgb24ToRgb32(src, srcStride, srcWidth, srcHeight, dst, dstStride, dstWidth, dstHeight,
+                      scratch, bestKernel());
+}
+
+// Усреднение блоков k x k в YUV с преобразованием результата в RGB24.
+// Y пикселя xs - accY[xs * yStep], его U и V - accC[(xs / 2) * cStep] и
+// accC[(xs / 2) * cStep + vOffset] (цветность общая на пару пикселей)
+static void boxReduceYuvRow(const unsigned short *accY, int yStep,
+                            const unsigned short *accC, int cStep, int vOffset,
+                            unsigned char *dst, int dstWidth, int k, unsigned long long reciprocal)
+{
+    for (int x = 0; x < dstWidth; ++x) {
+        unsigned int y = 0, u = 0, v = 0;
+        for (int xs = x * k; xs < x * k + k; ++xs) {
+            const unsigned short *c = accC + (xs / 2) * cStep;
+            y += accY[xs * yStep];
+            u += c[0];
+            v += c[vOffset];
+        }
+        yuvToRgb<false>(static_cast<int>((y * reciprocal + (1 << 23)) >> 24),
+                        static_cast<int>((u * reciprocal + (1 << 23)) >> 24),
+                        static_cast<int>((v * reciprocal + (1 << 23)) >> 24),
+                        dst + x * 3);
+    }
+}
+
+void scaleYuvToRgb32(YuvLayout layout, const unsigned char *src, int srcStride,
+                     int srcWidth, int srcHeight,
+                     unsigned char *dst, int dstStride, int dstWidth, int dstHeight,
+                     unsigned char *scratch, Kernel kernel)
+{
+    if (!isKernelSupported(kernel)) {
+        kernel = KernelScalar;
+    }
+    const ScaleKernels kernels = selectScaleKernels(kernel);
+
+    const int k = boxFactor(srcWidth, srcHeight, dstWidth, dstHeight);
+    const int midWidth = srcWidth / k;
+    const int midHeight = srcHeight / k;
+
+    ScaleTap *taps = reinterpret_cast<ScaleTap*>(scratch);
+    unsigned char *blended = scratch + alignScratch(sizeof(ScaleTap) * dstWidth);
+    unsigned char *next = blended + alignScratch(midWidth * 3);
+
+    if (k == 1) {
+        // Уменьшения меньше чем в 2 раза: строки преобразуются по мере
+        // надобности, полный кадр RGB не создаётся
+        const int rowSize = alignScratch(srcWidth * 3 + 6);
+        YuvRgbRows rows(layout, src, srcStride, srcWidth, srcHeight,
+                        next, rowSize, kernel);
+        if (srcWidth == dstWidth && srcHeight == dstHeight) {
+            const RowFunc toRgb32 = rgb24ToRgb32Row(kernel);
+            for (int y = 0; y < dstHeight; ++y) {
+                toRgb32(rows.row(y, 0), dst + y * dstStride, dstWidth);
+            }
+            return;
+        }
+        blendToRgb32(rows, midWidth, midHeight, dst, dstStride, dstWidth, dstHeight,
+                     taps, blended, kernels);
+        return;
+    }
+
+    // Усреднение блоков k x k прямо в YUV: в RGB преобразуется только
+    // уменьшенное изображение. Пары пикселей с общей цветностью
+    // суммируются целиком, поэтому аккумулируется чётное число пикселей
+    const int pairs = (midWidth * k + 1) / 2;
+    unsigned short *accY = reinterpret_cast<unsigned short*>(next);
+    unsigned short *accC = accY + pairs * 2;
+    unsigned char *reduced = next + alignScratch(sizeof(unsigned short) * srcWidth * 3);
+    const unsigned long long reciprocal = ((1ULL << 24) + (k * k) / 2) / (k * k);
+    for (int y = 0; y < midHeight; ++y) {
+        if (layout == YuvYUY2) {
+            // Y0 U Y1 V: один аккумулятор на строку
+            std::fill(accY, accY + pairs * 4, static_cast<unsigned short>(0));
+            for (int i = 0; i < k; ++i) {
+                kernels.accumulateRow(src + (y * k + i) * srcStride, accY, pairs * 4);
+            }
+            boxReduceYuvRow(accY, 2, accY + 1, 4, 2, reduced + y * midWidth * 3,
+                            midWidth, k, reciprocal);
+        } else {
+            // Плоскость Y и строка U/V, общая для двух строк Y
+            std::fill(accY, accY + pairs * 4, static_cast<unsigned short>(0));
+            for (int i = 0; i < k; ++i) {
+                const int srcRow = y * k + i;
+                kernels.accumulateRow(src + srcRow * srcStride, accY, pairs * 2);
+                kernels.accumulateRow(src + (srcHeight + srcRow / 2) * srcStride, accC, pairs * 2);
+            }
+            boxReduceYuvRow(accY, 1, accC, 2, 1, reduced + y * midWidth * 3,
+                            midWidth, k, reciprocal);
+        }
+    }
+
+    PlainRgbRows rows(reduced, midWidth * 3);
+    blendToRgb32(rows, midWidth, midHeight, dst, dstStride, dstWidth, dstHeight,
+                 taps, blended, kernels);
+}
+
+void scaleYuvToRgb32(YuvLayout layout, const unsigned char *src, int srcStride,
+                     int srcWidth, int srcHeight,
+                     unsigned char *dst, int dstStride, int dstWidth, int dstHeight,
+                     unsigned char *scratch)
+{
+    scaleYuvToRgb32(layout, src, srcStride, srcWidth, srcHeight, dst, dstStride,
+                    dstWidth, dstHeight, scratch, bestKernel());
+}
+
+// ---------------------------------------------------------------------------
+// Яркость и разность кадров (детектор движения)
+// ---------------------------------------------------------------------------
+
+// Яркость пикселя: Y у YUV, у RGB24 - BT.601 в целых (0..255)
+static inline int lumaAt(LumaSource source, const unsigned char *row, int x)
+{
+    switch (source) {
+    case LumaYUY2:
+        return row[x * 2];
+    case LumaNV12:
+        return row[x];
+    default: {
+        const unsigned char *p = row + x * 3;
+        return (77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8;
+    }
+    }
+}
+
+void subsampleLuma(LumaSource source, const unsigned char *src, int srcStride,
+                   int srcWidth, int srcHeight,
+                   unsigned char *dst, int dstStride, int factor)
+{
+    // Среднее 2x2 в начале каждого блока factor x factor: читается
+    // четверть пикселей при factor = 4 и меньше при больших factor
+    const int dstWidth = srcWidth / factor;
+    const int dstHeight = srcHeight / factor;
+    const int dx = factor > 1 ? 1 : 0;
+    for (int y = 0; y < dstHeight; ++y) {
+        const unsigned char *row0 = src + (y * factor) * srcStride;
+        const unsigned char *row1 = row0 + dx * srcStride;
+        unsigned char *d = dst + y * dstStride;
+        for (int x = 0; x < dstWidth; ++x) {
+            const int sx = x * factor;
+            const int sum = lumaAt(source, row0, sx) + lumaAt(source, row0, sx + dx) +
+                            lumaAt(source, row1, sx) + lumaAt(source, row1, sx + dx);
+            d[x] = static_cast<unsigned char>((sum + 2) >> 2);
+        }
+    }
+}
+
+static void blockSadRowScalar(const unsigned char *a, const unsigned char *b,
+                              unsigned int *sums, int blocks)
+{
+    for (int i = 0; i < blocks; ++i, a += 16, b += 16) {
+        unsigned int sum = 0;
+        for (int j = 0; j < 16; ++j) {
+            sum += static_cast<unsigned int>(std::abs(int(a[j]) - int(b[j])));
+        }
+        sums[i] += sum;
+    }
+}
+
+#ifdef PIXELCONVERT_X86
+
+// psadbw считает сумму |a - b| по 8 байтам за инструкцию (SSE2)
+PIXELCONVERT_TARGET("ssse3")
+static void blockSadRowSSSE3(const unsigned char *a, const unsigned char *b,
+                             unsigned int *sums, int blocks)
+{
+    for (int i = 0; i < blocks; ++i) {
+        const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i * 16));
+        const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i * 16));
+        const __m128i sad = _mm_sad_epu8(va, vb);
+        sums[i] += static_cast<unsigned int>(_mm_cvtsi128_si32(sad) +
+                                             _mm_cvtsi128_si32(_mm_srli_si128(sad, 8)));
+    }
+}
+
+// Два блока за итерацию: четыре 64-битные суммы, по две на блок
+PIXELCONVERT_TARGET("avx2")
+static void blockSadRowAVX2(const unsigned char *a, const unsigned char *b,
+                            unsigned int *sums, int blocks)
+{
+    int i = 0;
+    for (; i + 2 <= blocks; i += 2) {
+        const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i * 16));
+        const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i * 16));
+        const __m256i sad = _mm256_sad_epu8(va, vb);
+        // Суммы в младших 32 битах каждой 64-битной половины
+        const __m128i lo = _mm256_castsi256_si128(sad);
+        const __m128i hi = _mm256_extracti128_si256(sad, 1);
+        sums[i] += static_cast<unsigned int>(_mm_cvtsi128_si32(lo) +
+                                             _mm_cvtsi128_si32(_mm_srli_si128(lo, 8)));
+        sums[i + 1] += static_cast<unsigned int>(_mm_cvtsi128_si32(hi) +
+                                                 _mm_cvtsi128_si32(_mm_srli_si128(hi, 8)));
+    }
+    blockSadRowSSSE3(a + i * 16, b + i * 16, sums + i, blocks - i);
+}
+
+#endif // PIXELCONVERT_X86
+
+BlockSadRowFunc blockSadRow(Kernel kernel)
+{
+    if (!isKernelSupported(kernel)) {
+        return nullptr;
+    }
+    switch (kernel) {
+#ifdef PIXELCONVERT_X86
+    case KernelSSSE3:  return blockSadRowSSSE3;
+    case KernelAVX2:   return blockSadRowAVX2;
+#endif
+    case KernelScalar: return blockSadRowScalar;
+    default:           return nullptr;
+    }
+}
+
+BlockSadRowFunc blockSadRow()
+{
+    static const BlockSadRowFunc row = blockSadRow(bestKernel());
+    return row;
+}
+
+} // namespace PixelConvert
@@ -0,0 +1,134 @@
+#ifndef PIXELCONVERT_H
+#define PIXELCONVERT_H
+
+// Преобразование пикселей для конвейера камеры.
+// Строковые ядра есть в трёх вариантах (скалярное, SSSE3, AVX2);
+// подходящий вариант выбирается один раз по возможностям процессора.
+// Модуль не зависит от Qt и Windows API.
+
+namespace PixelConvert {
+
+enum Kernel {
+    KernelScalar = 0,
+    KernelSSSE3,
+    KernelAVX2,
+    KernelCount
+};
+
+// Преобразование одной строки из width пикселей.
+// src и dst не должны пересекаться.
+typedef void (*RowFunc)(const unsigned char *src, unsigned char *dst, int width);
+
+// Лучшее ядро, доступное на этом процессоре
+Kernel bestKernel();
+bool isKernelSupported(Kernel kernel);
+const char *kernelName(Kernel kernel);
+
+// Строковые ядра. Без аргумента - лучшее доступное,
+// с аргументом - конкретная реализация (nullptr, если не поддерживается)
+RowFunc swapRedBlue24Row();                  // BGR24 <-> RGB24
+RowFunc swapRedBlue24Row(Kernel kernel);
+RowFunc rgb24ToRgb32Row();                   // RGB24 -> QImage::Format_RGB32
+RowFunc rgb24ToRgb32Row(Kernel kernel);
+RowFunc bgr24ToRgb32Row();                   // BGR24 (DIB) -> QImage::Format_RGB32
+RowFunc bgr24ToRgb32Row(Kernel kernel);
+
+// Преобразование изображения построчно.
+// flipVertical = true: строки src идут снизу вверх (DIB bottom-up)
+void convertImage(RowFunc row,
+                  const unsigned char *src, int srcStride,
+                  unsigned char *dst, int dstStride,
+                  int width, int height, bool flipVertical);
+
+// Удобные обёртки над convertImage с лучшим ядром
+void bgr24ToRgb24(const unsigned char *src, int srcStride,
+                  unsigned char *dst, int dstStride,
+                  int width, int height, bool flipVertical);
+void rgb24ToBgr24(const unsigned char *src, int srcStride,
+                  unsigned char *dst, int dstStride,
+                  int width, int height, bool flipVertical);
+void rgb24ToRgb32(const unsigned char *src, int srcStride,
+                  unsigned char *dst, int dstStride,
+                  int width, int height, bool flipVertical);
+
+// YUV (BT.601, ограниченный диапазон) -> RGB24.
+// YUY2 (YUYV) 4:2:2 - строка Y0 U Y1 V; NV12 4:2:0 - плоскость Y и за ней
+// плоскость UV (чередующиеся U, V) на вдвое меньшее число строк с тем же
+// шагом. Кадры этих форматов идут по конвейеру как есть и преобразуются
+// только там, где нужен RGB. Ядро AVX2 совпадает с SSSE3.
+typedef void (*Nv12RowFunc)(const unsigned char *luma, const unsigned char *uv,
+                            unsigned char *dst, int width);
+
+RowFunc yuy2ToRgb24Row();
+RowFunc yuy2ToRgb24Row(Kernel kernel);
+Nv12RowFunc nv12ToRgb24Row();
+Nv12RowFunc nv12ToRgb24Row(Kernel kernel);
+
+// То же сразу в BGR24 (DIB, запись AVI) без отдельной перестановки R и B
+RowFunc yuy2ToBgr24Row();
+RowFunc yuy2ToBgr24Row(Kernel kernel);
+Nv12RowFunc nv12ToBgr24Row();
+Nv12RowFunc nv12ToBgr24Row(Kernel kernel);
+
+void yuy2ToRgb24(const unsigned char *src, int srcStride,
+                 unsigned char *dst, int dstStride,
+                 int width, int height);
+void nv12ToRgb24(const unsigned char *src, int srcStride,
+                 unsigned char *dst, int dstStride,
+                 int width, int height);
+
+// Масштабирование RGB24 -> QImage::Format_RGB32 для превью.
+// При уменьшении в 2 раза и более блоки k x k сначала усредняются (box),
+// затем изображение доводится до точного размера билинейной интерполяцией.
+// scratch - рабочая память вызывающего размером scaleScratchSize(),
+// чтобы не выделять её на каждый кадр.
+unsigned int scaleScratchSize(int srcWidth, int srcHeight, int dstWidth, int dstHeight);
+void scaleRgb24ToRgb32(const unsigned char *src, int srcStride, int srcWidth, int srcHeight,
+                       unsigned char *dst, int dstStride, int dstWidth, int dstHeight,
+                       unsigned char *scratch);
+void scaleRgb24ToRgb32(const unsigned char *src, int srcStride, int srcWidth, int srcHeight,
+                       unsigned char *dst, int dstStride, int dstWidth, int dstHeight,
+                       unsigned char *scratch, Kernel kernel);
+
+// То же для кадров YUV. Блоки усредняются прямо в YUV, в RGB
+// преобразуется уже уменьшенное изображение; без усреднения строки
+// преобразуются по одной, полный кадр RGB не создаётся.
+enum YuvLayout {
+    YuvYUY2,
+    YuvNV12
+};
+
+unsigned int scaleYuvScratchSize(int srcWidth, int srcHeight, int dstWidth, int dstHeight);
+void scaleYuvToRgb32(YuvLayout layout, const unsigned char *src, int srcStride,
+                     int srcWidth, int srcHeight,
+                     unsigned char *dst, int dstStride, int dstWidth, int dstHeight,
+                     unsigned char *scratch);
+void scaleYuvToRgb32(YuvLayout layout, const unsigned char *src, int srcStride,
+                     int srcWidth, int srcHeight,
+                     unsigned char *dst, int dstStride, int dstWidth, int dstHeight,
+                     unsigned char *scratch, Kernel kernel);
+
+// Детектор движения: уменьшенная плоскость яркости и разность кадров.
+// subsampleLuma - яркость среднего 2x2 каждого блока factor x factor, без
+// преобразования всего кадра; dst - (srcWidth / factor) x (srcHeight / factor)
+enum LumaSource {
+    LumaRGB24,
+    LumaYUY2,
+    LumaNV12    // достаточно плоскости Y
+};
+
+void subsampleLuma(LumaSource source, const unsigned char *src, int srcStride,
+                   int srcWidth, int srcHeight,
+                   unsigned char *dst, int dstStride, int factor);
+
+// SAD (сумма |a - b|) строки по блокам шириной 16 байт:
+// sums[i] += SAD байт [16 * i, 16 * i + 16)
+typedef void (*BlockSadRowFunc)(const unsigned char *a, const unsigned char *b,
+                                unsigned int *sums, int blocks);
+
+BlockSadRowFunc blockSadRow();
+BlockSadRowFunc blockSadRow(Kernel kernel);
+
+} // namespace PixelConvert
+
+#endif // PIXELCONVERT_H
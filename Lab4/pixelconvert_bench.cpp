@@ -0,0 +1,150 @@
+// Микро-бенчмарк ядер преобразования пикселей (PixelConvert).
+// Для каждого ядра и разрешения выводит пропускную способность в ГБ/с
+// (считаются прочитанные + записанные байты), а также время уменьшения
+// кадра RGB24 и YUY2 до размера окна превью.
+//
+// Запуск: pixelconvert_bench [секунд_на_замер]
+
+#include "pixelconvert.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace PixelConvert;
+
+struct Resolution
+{
+    const char *name;
+    int width;
+    int height;
+};
+
+struct Operation
+{
+    const char *name;
+    RowFunc (*select)(Kernel);
+    int srcBytesPerPixel;
+    int dstBytesPerPixel;
+    bool flip;
+};
+
+static double measure(const Operation &op, Kernel kernel, const Resolution &res,
+                      const std::vector<unsigned char> &src, std::vector<unsigned char> &dst,
+                      double seconds)
+{
+    RowFunc row = op.select(kernel);
+    const int srcStride = res.width * op.srcBytesPerPixel;
+    const int dstStride = res.width * op.dstBytesPerPixel;
+    const double bytesPerFrame = double(srcStride + dstStride) * res.height;
+
+    // Прогрев кэшей и TLB
+    convertImage(row, src.data(), srcStride, dst.data(), dstStride, res.width, res.height, op.flip);
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    long frames = 0;
+    double elapsed = 0.0;
+    do {
+        convertImage(row, src.data(), srcStride, dst.data(), dstStride, res.width, res.height, op.flip);
+        ++frames;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < seconds);
+
+    return bytesPerFrame * frames / elapsed / 1e9;
+}
+
+// Время масштабирования одного кадра в окно 640x480 с сохранением пропорций, мс.
+// yuy2 - кадр YUY2 (уменьшение вместе с преобразованием в RGB)
+static double measureScale(Kernel kernel, const Resolution &res, bool yuy2,
+                           const std::vector<unsigned char> &src, double seconds)
+{
+    int dstWidth = 640;
+    int dstHeight = res.height * 640 / res.width;
+    if (dstHeight > 480) {
+        dstHeight = 480;
+        dstWidth = res.width * 480 / res.height;
+    }
+    std::vector<unsigned char> scratch(yuy2 ? scaleYuvScratchSize(res.width, res.height, dstWidth, dstHeight)
+                                            : scaleScratchSize(res.width, res.height, dstWidth, dstHeight));
+    std::vector<unsigned char> dst(size_t(dstWidth) * dstHeight * 4);
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    long frames = 0;
+    double elapsed = 0.0;
+    do {
+        if (yuy2) {
+            scaleYuvToRgb32(YuvYUY2, src.data(), res.width * 2, res.width, res.height,
+                            dst.data(), dstWidth * 4, dstWidth, dstHeight, scratch.data(), kernel);
+        } else {
+            scaleRgb24ToRgb32(src.data(), res.width * 3, res.width, res.height,
+                              dst.data(), dstWidth * 4, dstWidth, dstHeight, scratch.data(), kernel);
+        }
+        ++frames;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < seconds);
+
+    return elapsed * 1000.0 / frames;
+}
+
+int main(int argc, char *argv[])
+{
+    const double seconds = argc > 1 ? std::atof(argv[1]) : 0.5;
+
+    const Resolution resolutions[] = {
+        { "640x480",   640,  480 },
+        { "1280x720",  1280, 720 },
+        { "1920x1080", 1920, 1080 },
+        { "3840x2160", 3840, 2160 },
+    };
+
+    const Operation operations[] = {
+        { "bgr24->rgb24 flip", swapRedBlue24Row, 3, 3, true  },
+        { "rgb24->rgb32",      rgb24ToRgb32Row,  3, 4, false },
+        { "bgr24->rgb32 flip", bgr24ToRgb32Row,  3, 4, true  },
+        { "yuy2->rgb24",       yuy2ToRgb24Row,   2, 3, false },
+        { "yuy2->bgr24 flip",  yuy2ToBgr24Row,   2, 3, true  },
+    };
+
+    std::printf("Best kernel: %s\n\n", kernelName(bestKernel()));
+    std::printf("%-20s %-10s %-8s %10s\n", "operation", "size", "kernel", "GB/s");
+
+    for (size_t r = 0; r < sizeof(resolutions) / sizeof(resolutions[0]); ++r) {
+        const Resolution &res = resolutions[r];
+        std::vector<unsigned char> src(size_t(res.width) * res.height * 3);
+        std::vector<unsigned char> dst(size_t(res.width) * res.height * 4);
+        for (size_t i = 0; i < src.size(); ++i) {
+            src[i] = static_cast<unsigned char>(i * 31 + (i >> 8));
+        }
+
+        for (size_t o = 0; o < sizeof(operations) / sizeof(operations[0]); ++o) {
+            for (int k = 0; k < KernelCount; ++k) {
+                const Kernel kernel = static_cast<Kernel>(k);
+                if (!isKernelSupported(kernel)) {
+                    continue;
+                }
+                const double gbps = measure(operations[o], kernel, res, src, dst, seconds);
+                std::printf("%-20s %-10s %-8s %10.2f\n",
+                            operations[o].name, res.name, kernelName(kernel), gbps);
+            }
+        }
+
+        for (int k = 0; k < KernelCount; ++k) {
+            const Kernel kernel = static_cast<Kernel>(k);
+            if (!isKernelSupported(kernel)) {
+                continue;
+            }
+            std::printf("%-20s %-10s %-8s %7.2f ms\n",
+                        "scale to preview", res.name, kernelName(kernel),
+                        measureScale(kernel, res, false, src, seconds));
+            std::printf("%-20s %-10s %-8s %7.2f ms\n",
+                        "scale yuy2 preview", res.name, kernelName(kernel),
+                        measureScale(kernel, res, true, src, seconds));
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,21 @@
+QT -= core gui
+
+TARGET = pixelconvert_bench
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+SOURCES += \
+    pixelconvert_bench.cpp \
+    pixelconvert.cpp
+
+HEADERS += \
+    pixelconvert.h
+
+# Бенчмарк имеет смысл только с оптимизацией
+CONFIG += release
+gcc {
+    QMAKE_CXXFLAGS_RELEASE -= -O2
+    QMAKE_CXXFLAGS_RELEASE += -O3
+}
@@ -0,0 +1,91 @@
+#include "prerollbuffer.h"
+#include <cstring>
+
+PreRollBuffer::PreRollBuffer()
+    : m_first(0),
+      m_count(0),
+      m_writePos(0),
+      m_bytesUsed(0)
+{
+}
+
+void PreRollBuffer::configure(qint64 byteBudget, int maxFrames)
+{
+    // Смещения хранятся в int - кольцо не больше 1 ГБ
+    const int capacity = static_cast<int>(qBound<qint64>(0, byteBudget, 1 << 30));
+    if (capacity == 0 || maxFrames <= 0) {
+        m_data = QByteArray();
+        m_entries = QVector<Entry>();
+    } else {
+        m_data.resize(capacity);
+        m_entries.resize(maxFrames);
+    }
+    clear();
+}
+
+void PreRollBuffer::clear()
+{
+    m_first = 0;
+    m_count = 0;
+    m_writePos = 0;
+    m_bytesUsed = 0;
+}
+
+const PreRollBuffer::Entry &PreRollBuffer::entry(int index) const
+{
+    return m_entries[(m_first + index) % m_entries.size()];
+}
+
+void PreRollBuffer::evictOldest()
+{
+    m_bytesUsed -= m_entries[m_first].size;
+    m_first = (m_first + 1) % m_entries.size();
+    m_count--;
+}
+
+bool PreRollBuffer::append(const char *data, int size)
+{
+    if (!isEnabled() || size <= 0 || size > m_data.size()) {
+        return false;
+    }
+
+    if (m_count == m_entries.size()) {
+        evictOldest();
+    }
+    if (m_count == 0) {
+        m_writePos = 0;
+    }
+
+    // Кадры лежат в кольце по порядку, поэтому впереди позиции записи
+    // (по кругу) находятся самые старые. Кадр хранится непрерывно: если он
+    // не помещается до конца кольца, хвост пропускается вместе с кадрами в нём
+    int pos = m_writePos;
+    if (pos + size > m_data.size()) {
+        while (m_count > 0 && entry(0).offset >= m_writePos) {
+            evictOldest();
+        }
+        pos = 0;
+    }
+    while (m_count > 0 && entry(0).offset >= pos && entry(0).offset < pos + size) {
+        evictOldest();
+    }
+
+    std::memcpy(m_data.data() + pos, data, size);
+    Entry &added = m_entries[(m_first + m_count) % m_entries.size()];
+    added.offset = pos;
+    added.size = size;
+    m_count++;
+    m_bytesUsed += size;
+    m_writePos = pos + size;
+    return true;
+}
+
+const char *PreRollBuffer::frameData(int index) const
+{
+    return m_data.constData() + entry(index).offset;
+}
+
+int PreRollBuffer::frameSize(int index) const
+{
+    return entry(index).size;
+}
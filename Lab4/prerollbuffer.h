@@ -0,0 +1,52 @@
+#ifndef PREROLLBUFFER_H
+#define PREROLLBUFFER_H
+
+#include <QByteArray>
+#include <QVector>
+
+// Кольцевой буфер сжатых кадров для предзаписи.
+// Память (байтовое кольцо и таблица кадров) выделяется один раз в
+// configure(); новый кадр вытесняет самые старые, поэтому объём ограничен
+// бюджетом в байтах, а длительность - числом кадров.
+// Не потокобезопасен: используется только потоком записи.
+class PreRollBuffer
+{
+public:
+    PreRollBuffer();
+
+    // byteBudget - размер кольца, maxFrames - не больше кадров (секунды * fps).
+    // 0 освобождает память
+    void configure(qint64 byteBudget, int maxFrames);
+    void clear();
+
+    // false - кадр больше всего кольца и не сохранён
+    bool append(const char *data, int size);
+
+    bool isEnabled() const { return !m_data.isEmpty(); }
+    int frameCount() const { return m_count; }
+    qint64 bytesUsed() const { return m_bytesUsed; }
+    qint64 capacity() const { return m_data.size(); }
+
+    // Кадр index: 0 - самый старый
+    const char *frameData(int index) const;
+    int frameSize(int index) const;
+
+private:
+    struct Entry
+    {
+        int offset;
+        int size;
+    };
+
+    const Entry &entry(int index) const;
+    void evictOldest();
+
+    QByteArray m_data;
+    QVector<Entry> m_entries;   // кольцо: m_first - самый старый кадр
+    int m_first;
+    int m_count;
+    int m_writePos;
+    qint64 m_bytesUsed;
+};
+
+#endif // PREROLLBUFFER_H
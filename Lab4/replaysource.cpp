@@ -0,0 +1,101 @@
+#include "replaysource.h"
+#include <QFileInfo>
+#include <QDebug>
+
+ReplaySource::ReplaySource(const QString &filePath)
+    : PacedFrameSource(30),
+      m_filePath(filePath)
+{
+}
+
+ReplaySource::~ReplaySource()
+{
+    close();
+}
+
+bool ReplaySource::open()
+{
+    if (m_reader.isOpen()) {
+        return true;
+    }
+
+    if (!m_reader.open(m_filePath.toUtf8().toStdString())) {
+        setError(QString("Не удалось открыть видео %1: %2")
+                 .arg(m_filePath, QString::fromStdString(m_reader.lastError())));
+        qDebug() << "Replay source failed:" << m_filePath << m_reader.lastError().c_str();
+        return false;
+    }
+
+    // Кадры выдаются с частотой файла. Строки BI_RGB и распакованного
+    // MJPEG (QImage RGB888) выровнены одинаково - на 4 байта
+    setFrameRate(m_reader.fps());
+    const bool mjpeg = m_reader.codec() == AviReader::CodecMJPEG;
+    FrameFormat format;
+    format.width = m_reader.width();
+    format.height = m_reader.height();
+    format.stride = (format.width * 3 + 3) & ~3;
+    format.pixelFormat = mjpeg ? FrameFormat::FormatRGB24 : FrameFormat::FormatBGR24;
+    format.bottomUp = mjpeg ? false : m_reader.bottomUp();
+    setFormat(format);
+
+    qDebug() << "Replay source opened:" << m_filePath << m_reader.width() << "x" << m_reader.height()
+             << "@" << m_reader.fps() << "frames:" << m_reader.frameCount();
+    return true;
+}
+
+void ReplaySource::close()
+{
+    stop();
+    m_reader.close();
+    m_chunk.clear();
+    m_decoded = QImage();
+}
+
+bool ReplaySource::renderFrame(qint64 index, RawFrame &frame)
+{
+    // Файл воспроизводится по кругу
+    const unsigned int fileIndex = static_cast<unsigned int>(index % m_reader.frameCount());
+    if (!m_reader.readFrame(fileIndex, m_chunk)) {
+        setError(QString::fromStdString(m_reader.lastError()));
+        return false;
+    }
+
+    const int width = m_reader.width();
+    const int height = m_reader.height();
+    const int stride = (width * 3 + 3) & ~3;
+
+    if (m_reader.codec() == AviReader::CodecMJPEG) {
+        QImage image;
+        if (!image.loadFromData(reinterpret_cast<const uchar*>(m_chunk.data()),
+                                static_cast<int>(m_chunk.size()), "JPG")) {
+            setError(QString("Кадр %1 повреждён").arg(fileIndex));
+            return false;
+        }
+        if (image.size() != QSize(width, height)) {
+            setError(QString("Кадр %1 другого размера").arg(fileIndex));
+            return false;
+        }
+        m_decoded = image.convertToFormat(QImage::Format_RGB888);
+        frame.data = m_decoded.constBits();
+        frame.size = m_decoded.byteCount();
+        return true;
+    }
+
+    if (m_chunk.size() < static_cast<size_t>(stride) * height) {
+        setError(QString("Кадр %1 обрезан").arg(fileIndex));
+        return false;
+    }
+    frame.data = reinterpret_cast<const uchar*>(m_chunk.data());
+    frame.size = stride * height;
+    return true;
+}
+
+QString ReplaySource::description() const
+{
+    return QString("<p><b>Файл:</b> %1</p>"
+                   "<p><b>Формат:</b> %2, %3x%4 @ %5 кадр/с, %6 кадров</p>")
+        .arg(QFileInfo(m_filePath).fileName())
+        .arg(m_reader.codec() == AviReader::CodecMJPEG ? "Motion-JPEG" : "BI_RGB")
+        .arg(m_reader.width()).arg(m_reader.height())
+        .arg(m_reader.fps()).arg(m_reader.frameCount());
+}
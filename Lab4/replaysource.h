@@ -0,0 +1,35 @@
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include "pacedframesource.h"
+#include "avireader.h"
+#include <QImage>
+#include <vector>
+
+// Воспроизведение записанного AVI (BI_RGB или MJPEG) по кругу с частотой
+// файла. Позволяет прогонять конвейер на реальных кадрах без камеры.
+class ReplaySource : public PacedFrameSource
+{
+public:
+    explicit ReplaySource(const QString &filePath);
+    ~ReplaySource();
+
+    bool open() override;
+    void close() override;
+    bool isOpen() const override { return m_reader.isOpen(); }
+
+    QString name() const override { return "AVI replay"; }
+    QString description() const override;
+
+protected:
+    bool renderFrame(qint64 index, RawFrame &frame) override;
+
+private:
+    QString m_filePath;
+    AviReader m_reader;
+
+    std::vector<char> m_chunk;
+    QImage m_decoded;           // распакованный кадр MJPEG
+};
+
+#endif // REPLAYSOURCE_H
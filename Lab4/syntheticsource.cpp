@@ -0,0 +1,265 @@
+#include "syntheticsource.h"
+#include <QDebug>
+#include <cstring>
+
+// Цвета полос (BGR)
+static const uchar BAR_COLORS[8][3] = {
+    { 255, 255, 255 },  // белый
+    {   0, 255, 255 },  // жёлтый
+    { 255, 255,   0 },  // голубой
+    {   0, 255,   0 },  // зелёный
+    { 255,   0, 255 },  // пурпурный
+    {   0,   0, 255 },  // красный
+    { 255,   0,   0 },  // синий
+    {  32,  32,  32 }   // почти чёрный
+};
+
+// Белый в YUV (ограниченный диапазон)
+static const uchar WHITE_Y = 235;
+static const uchar NEUTRAL_UV = 128;
+
+// BGR -> YUV BT.601, ограниченный диапазон (обратное к PixelConvert)
+static void bgrToYuv(const uchar *bgr, int &y, int &u, int &v)
+{
+    const int b = bgr[0];
+    const int g = bgr[1];
+    const int r = bgr[2];
+    y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+    u = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+    v = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+}
+
+SyntheticSource::SyntheticSource(int width, int height, int fps)
+    : PacedFrameSource(fps),
+      m_width(qMax(16, width)),
+      m_height(qMax(16, height)),
+      m_stride(0),
+      m_bytesPerPixel(3),
+      m_pixelFormat(FrameFormat::FormatBGR24),
+      m_open(false),
+      m_patternRow(0)
+{
+    updateLayout();
+}
+
+SyntheticSource::~SyntheticSource()
+{
+    close();
+}
+
+void SyntheticSource::updateLayout()
+{
+    switch (m_pixelFormat) {
+    case FrameFormat::FormatYUY2:
+        m_bytesPerPixel = 2;
+        m_stride = m_width * 2;
+        break;
+    case FrameFormat::FormatNV12:
+        m_bytesPerPixel = 1;
+        m_stride = m_width;
+        break;
+    default:
+        m_bytesPerPixel = 3;
+        m_stride = (m_width * 3 + 3) & ~3;
+        break;
+    }
+}
+
+bool SyntheticSource::open()
+{
+    if (m_open) {
+        return true;
+    }
+
+    // Две строки шаблона удвоенной ширины: полосы и градиент серого
+    const int patternWidth = m_width * 2;
+    QByteArray bgrPattern(patternWidth * 3 * 2, 0);
+    uchar *bars = reinterpret_cast<uchar*>(bgrPattern.data());
+    uchar *ramp = bars + patternWidth * 3;
+    for (int x = 0; x < patternWidth; ++x) {
+        const int bar = (x % m_width) * 8 / m_width;
+        const uchar gray = static_cast<uchar>((x % m_width) * 255 / (m_width - 1));
+        for (int c = 0; c < 3; ++c) {
+            bars[x * 3 + c] = BAR_COLORS[bar][c];
+            ramp[x * 3 + c] = gray;
+        }
+    }
+
+    // Шаблон в формате кадра: цветность YUV - среднее пары пикселей
+    m_patternRow = patternWidth * m_bytesPerPixel;
+    const bool nv12 = m_pixelFormat == FrameFormat::FormatNV12;
+    m_pattern.fill(0, m_patternRow * (nv12 ? 4 : 2));
+    uchar *pattern = reinterpret_cast<uchar*>(m_pattern.data());
+    for (int kind = 0; kind < 2; ++kind) {
+        const uchar *src = bars + kind * patternWidth * 3;
+        uchar *dst = pattern + kind * m_patternRow;
+        if (m_pixelFormat == FrameFormat::FormatBGR24) {
+            std::memcpy(dst, src, m_patternRow);
+            continue;
+        }
+        uchar *chroma = pattern + (2 + kind) * m_patternRow;
+        for (int x = 0; x < patternWidth; x += 2) {
+            int y0, u0, v0, y1, u1, v1;
+            bgrToYuv(src + x * 3, y0, u0, v0);
+            bgrToYuv(src + x * 3 + 3, y1, u1, v1);
+            const uchar u = static_cast<uchar>((u0 + u1 + 1) / 2);
+            const uchar v = static_cast<uchar>((v0 + v1 + 1) / 2);
+            if (nv12) {
+                dst[x] = static_cast<uchar>(y0);
+                dst[x + 1] = static_cast<uchar>(y1);
+                chroma[x] = u;
+                chroma[x + 1] = v;
+            } else {
+                dst[x * 2] = static_cast<uchar>(y0);
+                dst[x * 2 + 1] = u;
+                dst[x * 2 + 2] = static_cast<uchar>(y1);
+                dst[x * 2 + 3] = v;
+            }
+        }
+    }
+
+    m_frame.fill(0, m_stride * (nv12 ? m_height + m_height / 2 : m_height));
+
+    FrameFormat format;
+    format.width = m_width;
+    format.height = m_height;
+    format.stride = m_stride;
+    format.pixelFormat = m_pixelFormat;
+    format.bottomUp = m_pixelFormat == FrameFormat::FormatBGR24;
+    setFormat(format);
+
+    m_open = true;
+    qDebug() << "Synthetic source opened:" << m_width << "x" << m_height << "@" << frameRate()
+             << FrameFormat::pixelFormatName(m_pixelFormat);
+    return true;
+}
+
+void SyntheticSource::close()
+{
+    stop();
+    m_pattern.clear();
+    m_frame.clear();
+    m_open = false;
+}
+
+bool SyntheticSource::renderFrame(qint64 index, RawFrame &frame)
+{
+    const uchar *pattern = reinterpret_cast<const uchar*>(m_pattern.constData());
+    uchar *base = reinterpret_cast<uchar*>(m_frame.data());
+    const bool bottomUp = m_pixelFormat == FrameFormat::FormatBGR24;
+    const bool nv12 = m_pixelFormat == FrameFormat::FormatNV12;
+
+    // Полосы сдвигаются на 4 пикселя за кадр (пары YUV не разбиваются),
+    // нижняя четверть - градиент
+    const int shift = static_cast<int>((index * 4) % m_width);
+    const int rampStart = m_height * 3 / 4;
+    for (int y = 0; y < m_height; ++y) {
+        uchar *row = base + (bottomUp ? m_height - 1 - y : y) * m_stride;
+        const uchar *src = pattern + (y < rampStart ? 0 : m_patternRow) + shift * m_bytesPerPixel;
+        std::memcpy(row, src, m_width * m_bytesPerPixel);
+    }
+    if (nv12) {
+        uchar *uv = base + m_height * m_stride;
+        for (int y = 0; y < m_height / 2; ++y) {
+            const uchar *src = pattern + (y * 2 < rampStart ? 2 : 3) * m_patternRow + shift;
+            std::memcpy(uv + y * m_stride, src, m_width);
+        }
+    }
+
+    // Квадрат, движущийся по диагонали (у YUV - с чётными границами)
+    const int align = bottomUp ? 1 : 2;
+    const int size = qMax(8, m_height / 8) & ~(align - 1);
+    const int rangeX = qMax(1, m_width - size);
+    const int rangeY = qMax(1, m_height - size);
+    const int left = static_cast<int>((index * 7) % rangeX) & ~(align - 1);
+    const int top = static_cast<int>((index * 5) % rangeY) & ~(align - 1);
+    const int right = qMin(m_width, left + size);
+    const int bottom = qMin(m_height, top + size);
+    for (int y = top; y < bottom; ++y) {
+        uchar *row = base + (bottomUp ? m_height - 1 - y : y) * m_stride;
+        switch (m_pixelFormat) {
+        case FrameFormat::FormatYUY2:
+            for (int x = left; x < right; x += 2) {
+                row[x * 2] = WHITE_Y;
+                row[x * 2 + 1] = NEUTRAL_UV;
+                row[x * 2 + 2] = WHITE_Y;
+                row[x * 2 + 3] = NEUTRAL_UV;
+            }
+            break;
+        case FrameFormat::FormatNV12:
+            std::memset(row + left, WHITE_Y, right - left);
+            if (y % 2 == 0) {
+                std::memset(base + (m_height + y / 2) * m_stride + left, NEUTRAL_UV, right - left);
+            }
+            break;
+        default:
+            std::memset(row + left * 3, 0xFF, (right - left) * 3);
+            break;
+        }
+    }
+
+    frame.data = reinterpret_cast<const uchar*>(m_frame.constData());
+    frame.size = m_frame.size();
+    return true;
+}
+
+QList<CaptureMode> SyntheticSource::supportedModes() const
+{
+    static const int sizes[][2] = { { 640, 480 }, { 1280, 720 }, { 1920, 1080 } };
+    QList<CaptureMode> modes;
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        modes << CaptureMode(sizes[i][0], sizes[i][1], 30, FrameFormat::FormatBGR24)
+              << CaptureMode(sizes[i][0], sizes[i][1], 60, FrameFormat::FormatBGR24)
+              << CaptureMode(sizes[i][0], sizes[i][1], 30, FrameFormat::FormatYUY2)
+              << CaptureMode(sizes[i][0], sizes[i][1], 30, FrameFormat::FormatNV12);
+    }
+    // Режим, заданный при создании, тоже в списке
+    const CaptureMode current(m_width, m_height, frameRate(), m_pixelFormat);
+    if (!modes.contains(current)) {
+        modes.prepend(current);
+    }
+    return modes;
+}
+
+bool SyntheticSource::setMode(const CaptureMode &mode)
+{
+    if (mode.pixelFormat != CaptureMode::AnyPixelFormat &&
+        mode.pixelFormat != FrameFormat::FormatBGR24 &&
+        mode.pixelFormat != FrameFormat::FormatYUY2 &&
+        mode.pixelFormat != FrameFormat::FormatNV12) {
+        setError("Синтетический источник выдаёт только BGR24, YUY2 и NV12");
+        return false;
+    }
+    if (m_open) {
+        setError("Режим меняется только у закрытого источника");
+        return false;
+    }
+
+    if (mode.width > 0) {
+        m_width = qMax(16, mode.width);
+    }
+    if (mode.height > 0) {
+        m_height = qMax(16, mode.height);
+    }
+    if (mode.pixelFormat != CaptureMode::AnyPixelFormat) {
+        m_pixelFormat = FrameFormat::PixelFormat(mode.pixelFormat);
+    }
+    // Пары пикселей YUV делят цветность: размер чётный
+    if (m_pixelFormat != FrameFormat::FormatBGR24) {
+        m_width &= ~1;
+        m_height &= ~1;
+    }
+    updateLayout();
+    if (mode.fps > 0) {
+        setFrameRate(mode.fps);
+    }
+    return true;
+}
+
+QString SyntheticSource::description() const
+{
+    return QString("<p><b>Режим:</b> %1x%2 @ %3 кадр/с, %4 (%5)</p>")
+        .arg(m_width).arg(m_height).arg(frameRate())
+        .arg(FrameFormat::pixelFormatName(m_pixelFormat))
+        .arg(isFreeRunning() ? "без ограничения частоты" : "в реальном времени");
+}
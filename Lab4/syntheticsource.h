@@ -0,0 +1,51 @@
+#ifndef SYNTHETICSOURCE_H
+#define SYNTHETICSOURCE_H
+
+#include "pacedframesource.h"
+#include <QByteArray>
+
+// Синтетический источник кадров: бегущие цветные полосы и движущийся
+// квадрат. Содержимое кадра зависит только от его номера, поэтому прогоны
+// воспроизводимы. По умолчанию кадры выдаются в том же виде, что и у
+// DirectShow (BGR24, снизу вверх, строки выровнены на 4 байта); режимы
+// YUY2 и NV12 повторяют типичные форматы веб-камер (сверху вниз).
+class SyntheticSource : public PacedFrameSource
+{
+public:
+    SyntheticSource(int width = 640, int height = 480, int fps = 30);
+    ~SyntheticSource();
+
+    bool open() override;
+    void close() override;
+    bool isOpen() const override { return m_open; }
+
+    QString name() const override { return "Synthetic"; }
+    QString description() const override;
+
+    // Любой размер (от 16x16, у YUV - чётный) и частота; форматы BGR24,
+    // YUY2 и NV12. supportedModes() - типичные режимы камер для списка в окне
+    QList<CaptureMode> supportedModes() const override;
+    bool setMode(const CaptureMode &mode) override;
+
+protected:
+    bool renderFrame(qint64 index, RawFrame &frame) override;
+
+private:
+    // Шаг строк и байт на пиксель основной плоскости для m_pixelFormat
+    void updateLayout();
+
+    int m_width;
+    int m_height;
+    int m_stride;
+    int m_bytesPerPixel;
+    FrameFormat::PixelFormat m_pixelFormat;
+    bool m_open;
+
+    // Полосы и градиент удвоенной ширины в формате кадра: строка кадра -
+    // окно в этом буфере. У NV12 за строками Y идут строки UV
+    QByteArray m_pattern;
+    int m_patternRow;
+    QByteArray m_frame;
+};
+
+#endif // SYNTHETICSOURCE_H
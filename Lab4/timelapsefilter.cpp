@@ -0,0 +1,98 @@
+#include "timelapsefilter.h"
+#include <cstdlib>
+#include <cstring>
+
+TimelapseFilter::TimelapseFilter()
+    : m_intervalMs(0),
+      m_sceneThreshold(0)
+{
+    reset();
+}
+
+void TimelapseFilter::configure(int intervalMs, int sceneThreshold)
+{
+    m_intervalMs = qMax(0, intervalMs);
+    m_sceneThreshold = qBound(0, sceneThreshold, 255);
+    reset();
+}
+
+void TimelapseFilter::reset()
+{
+    m_lastKeptUs = -1;
+    m_framesSeen = 0;
+    m_framesKept = 0;
+    m_lastDifference = -1;
+    std::memset(m_keptThumb, 0, sizeof(m_keptThumb));
+}
+
+bool TimelapseFilter::accept(const VideoFrame &frame, qint64 timeUs)
+{
+    if (frame.isNull()) {
+        return false;
+    }
+    m_framesSeen++;
+
+    const qint64 sinceKeptUs = m_lastKeptUs < 0 ? -1 : timeUs - m_lastKeptUs;
+    bool keep = sinceKeptUs < 0 ||
+                (m_intervalMs > 0 && sinceKeptUs >= qint64(m_intervalMs) * 1000);
+
+    // Миниатюра нужна для сравнения сцен и как образец для следующих кадров
+    const bool scene = m_sceneThreshold > 0;
+    if (scene && (keep || sinceKeptUs >= qint64(SCENE_MIN_GAP_MS) * 1000)) {
+        sampleLuma(frame, m_thumb);
+        if (!keep) {
+            int sum = 0;
+            for (int i = 0; i < THUMB_WIDTH * THUMB_HEIGHT; ++i) {
+                sum += std::abs(int(m_thumb[i]) - int(m_keptThumb[i]));
+            }
+            m_lastDifference = sum / (THUMB_WIDTH * THUMB_HEIGHT);
+            keep = m_lastDifference >= m_sceneThreshold;
+        }
+        if (keep) {
+            std::memcpy(m_keptThumb, m_thumb, sizeof(m_thumb));
+        }
+    }
+
+    if (keep) {
+        m_lastKeptUs = timeUs;
+        m_framesKept++;
+    }
+    return keep;
+}
+
+void TimelapseFilter::sampleLuma(const VideoFrame &frame, uchar *thumb)
+{
+    // Среднее 2x2 в центре каждой клетки сетки
+    const uchar *bits = frame.constBits();
+    const int stride = frame.bytesPerLine();
+    const int width = frame.width();
+    const int height = frame.height();
+    const FrameFormat::PixelFormat format = frame.pixelFormat();
+
+    for (int ty = 0; ty < THUMB_HEIGHT; ++ty) {
+        const int y0 = qMin(height - 1, (2 * ty + 1) * height / (2 * THUMB_HEIGHT));
+        const int y1 = qMin(height - 1, y0 + 1);
+        for (int tx = 0; tx < THUMB_WIDTH; ++tx) {
+            const int x0 = qMin(width - 1, (2 * tx + 1) * width / (2 * THUMB_WIDTH));
+            const int x1 = qMin(width - 1, x0 + 1);
+            const int xs[2] = { x0, x1 };
+            const int ys[2] = { y0, y1 };
+            int sum = 0;
+            for (int j = 0; j < 2; ++j) {
+                const uchar *row = bits + ys[j] * stride;
+                for (int i = 0; i < 2; ++i) {
+                    if (format == FrameFormat::FormatYUY2) {
+                        sum += row[xs[i] * 2];
+                    } else if (format == FrameFormat::FormatNV12) {
+                        sum += row[xs[i]];
+                    } else {
+                        // RGB24: яркость BT.601 в целых
+                        const uchar *p = row + xs[i] * 3;
+                        sum += (77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8;
+                    }
+                }
+            }
+            thumb[ty * THUMB_WIDTH + tx] = static_cast<uchar>(sum / 4);
+        }
+    }
+}
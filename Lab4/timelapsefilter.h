@@ -0,0 +1,62 @@
+#ifndef TIMELAPSEFILTER_H
+#define TIMELAPSEFILTER_H
+
+#include <QtGlobal>
+#include "videoframe.h"
+
+// Отбор кадров для таймлапса.
+// Кадр сохраняется раз в заданный интервал и/или при смене сцены. Сцена
+// сравнивается по миниатюре яркости THUMB_WIDTH x THUMB_HEIGHT, которая
+// берётся выборкой прямо из кадра (RGB24, YUY2, NV12) без преобразования
+// всего кадра, поэтому решение стоит несколько тысяч чтений на кадр.
+// Не потокобезопасен: используется потоком источника (под мьютексом
+// CameraWorker).
+class TimelapseFilter
+{
+public:
+    enum {
+        THUMB_WIDTH = 64,
+        THUMB_HEIGHT = 48
+    };
+
+    TimelapseFilter();
+
+    // intervalMs > 0 - кадр не реже чем раз в intervalMs.
+    // sceneThreshold > 0 - кадр, когда средняя разница яркости миниатюры с
+    // последним сохранённым кадром не меньше sceneThreshold (из 255), но не
+    // чаще чем раз в SCENE_MIN_GAP_MS. Оба условия могут действовать вместе
+    void configure(int intervalMs, int sceneThreshold);
+    bool isEnabled() const { return m_intervalMs > 0 || m_sceneThreshold > 0; }
+    int intervalMs() const { return m_intervalMs; }
+    int sceneThreshold() const { return m_sceneThreshold; }
+
+    // Новая запись: следующий кадр сохраняется
+    void reset();
+
+    // true - кадр идёт в таймлапс. timeUs - время получения кадра
+    bool accept(const VideoFrame &frame, qint64 timeUs);
+
+    qint64 framesSeen() const { return m_framesSeen; }
+    qint64 framesKept() const { return m_framesKept; }
+    // Разница сцены на последнем проверенном кадре (-1 - не считалась)
+    int lastDifference() const { return m_lastDifference; }
+
+    // Кадры по смене сцены - не чаще, чем раз в столько мс
+    static const int SCENE_MIN_GAP_MS = 1000;
+
+private:
+    static void sampleLuma(const VideoFrame &frame, uchar *thumb);
+
+    int m_intervalMs;
+    int m_sceneThreshold;
+    qint64 m_lastKeptUs;        // -1 - кадров ещё не было
+    qint64 m_framesSeen;
+    qint64 m_framesKept;
+    int m_lastDifference;
+
+    // Миниатюры последнего сохранённого и текущего кадра
+    uchar m_keptThumb[THUMB_WIDTH * THUMB_HEIGHT];
+    uchar m_thumb[THUMB_WIDTH * THUMB_HEIGHT];
+};
+
+#endif // TIMELAPSEFILTER_H
@@ -0,0 +1,465 @@
+#include "v4l2source.h"
+#include <QThread>
+#include <QDebug>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <linux/videodev2.h>
+
+// Число буферов драйвера: один у потребителя, остальные заполняются
+static const int V4L2_BUFFER_COUNT = 4;
+
+// Период проверки запроса остановки в poll(), мс
+static const int V4L2_POLL_TIMEOUT_MS = 100;
+
+static int xioctl(int fd, unsigned long request, void *arg)
+{
+    int result;
+    do {
+        result = ioctl(fd, request, arg);
+    } while (result == -1 && errno == EINTR);
+    return result;
+}
+
+static QString fourccName(unsigned int fourcc)
+{
+    return QString::fromLatin1(reinterpret_cast<const char*>(&fourcc), 4);
+}
+
+// Форматы, которые принимает конвейер, в порядке предпочтения
+static const struct {
+    unsigned int fourcc;
+    FrameFormat::PixelFormat format;
+} V4L2_FORMATS[] = {
+    { V4L2_PIX_FMT_BGR24, FrameFormat::FormatBGR24 },
+    { V4L2_PIX_FMT_RGB24, FrameFormat::FormatRGB24 },
+    { V4L2_PIX_FMT_YUYV,  FrameFormat::FormatYUY2 },
+    { V4L2_PIX_FMT_NV12,  FrameFormat::FormatNV12 },
+    { V4L2_PIX_FMT_MJPEG, FrameFormat::FormatMJPEG }
+};
+static const int V4L2_FORMAT_COUNT = sizeof(V4L2_FORMATS) / sizeof(V4L2_FORMATS[0]);
+
+static bool pixelFormatFor(unsigned int fourcc, FrameFormat::PixelFormat *format)
+{
+    for (int i = 0; i < V4L2_FORMAT_COUNT; ++i) {
+        if (V4L2_FORMATS[i].fourcc == fourcc) {
+            *format = V4L2_FORMATS[i].format;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Байт на строку, если драйвер не сообщил bytesperline
+static int defaultStride(FrameFormat::PixelFormat format, int width)
+{
+    switch (format) {
+    case FrameFormat::FormatYUY2:  return width * 2;
+    case FrameFormat::FormatNV12:  return width;
+    case FrameFormat::FormatMJPEG: return 0;
+    default:                       return width * 3;
+    }
+}
+
+class V4L2Source::Thread : public QThread
+{
+public:
+    explicit Thread(V4L2Source *owner) : m_owner(owner) {}
+
+protected:
+    void run() override { m_owner->runLoop(); }
+
+private:
+    V4L2Source *m_owner;
+};
+
+V4L2Source::V4L2Source(const QString &device)
+    : m_device(device),
+      m_fd(-1),
+      m_streaming(false),
+      m_width(640),
+      m_height(480),
+      m_stride(0),
+      m_fps(30),
+      m_pixelFormat(0),
+      m_requestedMode(640, 480, 30),
+      m_modeRequested(false),
+      m_thread(nullptr),
+      m_stopRequested(0)
+{
+}
+
+V4L2Source::~V4L2Source()
+{
+    close();
+}
+
+bool V4L2Source::open()
+{
+    if (m_fd >= 0) {
+        return true;
+    }
+
+    m_fd = ::open(m_device.toLocal8Bit().constData(), O_RDWR | O_NONBLOCK);
+    if (m_fd < 0) {
+        qDebug() << "V4L2: cannot open" << m_device << strerror(errno);
+        setError(errno == ENOENT ? QString("Камера не найдена")
+                                 : QString("Не удалось открыть %1: %2").arg(m_device, strerror(errno)));
+        return false;
+    }
+
+    v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (xioctl(m_fd, VIDIOC_QUERYCAP, &cap) < 0 ||
+        !(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) ||
+        !(cap.capabilities & V4L2_CAP_STREAMING)) {
+        qDebug() << "V4L2:" << m_device << "is not a streaming capture device";
+        setError(QString("%1 не поддерживает потоковый захват").arg(m_device));
+        close();
+        return false;
+    }
+    m_card = QString::fromUtf8(reinterpret_cast<const char*>(cap.card));
+
+    // Запрошенный режим выбирается из режимов устройства. Режим по
+    // умолчанию (640x480) драйвер может заменить ближайшим своим
+    enumerateModes();
+    CaptureMode wanted = m_requestedMode;
+    const int best = findMode(m_modes, m_requestedMode);
+    if (best >= 0) {
+        wanted = m_modes[best];
+    } else if (m_modeRequested && !m_modes.isEmpty()) {
+        qDebug() << "V4L2: mode" << m_requestedMode.toString() << "is not supported";
+        setError(QString("Камера не поддерживает режим %1").arg(m_requestedMode.toString()));
+        close();
+        return false;
+    }
+    if (wanted.width <= 0 || wanted.height <= 0) {
+        wanted.width = 640;
+        wanted.height = 480;
+    }
+
+    // Без заданного формата пробуем форматы по порядку предпочтения
+    bool formatSet = false;
+    v4l2_format fmt;
+    for (int i = 0; i < V4L2_FORMAT_COUNT && !formatSet; ++i) {
+        if (wanted.pixelFormat != CaptureMode::AnyPixelFormat &&
+            wanted.pixelFormat != V4L2_FORMATS[i].format) {
+            continue;
+        }
+        memset(&fmt, 0, sizeof(fmt));
+        fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        fmt.fmt.pix.width = wanted.width;
+        fmt.fmt.pix.height = wanted.height;
+        fmt.fmt.pix.pixelformat = V4L2_FORMATS[i].fourcc;
+        fmt.fmt.pix.field = V4L2_FIELD_NONE;
+        // Драйвер может подставить другой формат - проверяем результат
+        formatSet = xioctl(m_fd, VIDIOC_S_FMT, &fmt) == 0 &&
+                    fmt.fmt.pix.pixelformat == V4L2_FORMATS[i].fourcc;
+    }
+    if (!formatSet) {
+        qDebug() << "V4L2: no supported pixel format (BGR24/RGB24/YUYV/NV12/MJPEG)";
+        setError("Камера не поддерживает форматы RGB24/YUYV/NV12/MJPEG");
+        close();
+        return false;
+    }
+
+    FrameFormat format;
+    pixelFormatFor(fmt.fmt.pix.pixelformat, &format.pixelFormat);
+    m_width = fmt.fmt.pix.width;
+    m_height = fmt.fmt.pix.height;
+    m_pixelFormat = fmt.fmt.pix.pixelformat;
+    m_stride = fmt.fmt.pix.bytesperline > 0 && format.pixelFormat != FrameFormat::FormatMJPEG
+             ? int(fmt.fmt.pix.bytesperline) : defaultStride(format.pixelFormat, m_width);
+
+    // Кадры отдаются как есть; преобразует получатель
+    format.width = m_width;
+    format.height = m_height;
+    format.stride = m_stride;
+    format.bottomUp = false;
+    setFormat(format);
+
+    // Частота режима (не все драйверы позволяют её менять)
+    v4l2_streamparm parm;
+    memset(&parm, 0, sizeof(parm));
+    parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    parm.parm.capture.timeperframe.numerator = 1;
+    parm.parm.capture.timeperframe.denominator = wanted.fps > 0 ? wanted.fps : 30;
+    if (xioctl(m_fd, VIDIOC_S_PARM, &parm) == 0 && parm.parm.capture.timeperframe.numerator > 0) {
+        m_fps = qMax(1, qRound(double(parm.parm.capture.timeperframe.denominator) /
+                               parm.parm.capture.timeperframe.numerator));
+    }
+
+    v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = V4L2_BUFFER_COUNT;
+    req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(m_fd, VIDIOC_REQBUFS, &req) < 0 || req.count < 2) {
+        qDebug() << "V4L2: VIDIOC_REQBUFS failed" << strerror(errno);
+        setError("Не удалось выделить буферы камеры");
+        close();
+        return false;
+    }
+
+    m_buffers.resize(req.count);
+    for (int i = 0; i < m_buffers.size(); ++i) {
+        m_buffers[i].start = MAP_FAILED;
+        m_buffers[i].length = 0;
+    }
+    for (int i = 0; i < m_buffers.size(); ++i) {
+        v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (xioctl(m_fd, VIDIOC_QUERYBUF, &buf) < 0) {
+            setError("Не удалось получить буфер камеры");
+            close();
+            return false;
+        }
+        m_buffers[i].length = buf.length;
+        m_buffers[i].start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED,
+                                  m_fd, buf.m.offset);
+        if (m_buffers[i].start == MAP_FAILED) {
+            setError("Не удалось отобразить буфер камеры");
+            close();
+            return false;
+        }
+    }
+
+    qDebug() << "V4L2 opened:" << m_device << m_card << m_width << "x" << m_height
+             << fourccName(m_pixelFormat) << "@" << m_fps << "fps," << m_buffers.size() << "buffers";
+    return true;
+}
+
+void V4L2Source::close()
+{
+    stop();
+    unmapBuffers();
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void V4L2Source::unmapBuffers()
+{
+    for (int i = 0; i < m_buffers.size(); ++i) {
+        if (m_buffers[i].start != MAP_FAILED) {
+            munmap(m_buffers[i].start, m_buffers[i].length);
+        }
+    }
+    m_buffers.clear();
+}
+
+bool V4L2Source::start()
+{
+    if (m_fd < 0 && !open()) {
+        return false;
+    }
+    if (m_streaming) {
+        return true;
+    }
+
+    for (int i = 0; i < m_buffers.size(); ++i) {
+        if (!requeue(i)) {
+            setError("Не удалось поставить буфер в очередь камеры");
+            return false;
+        }
+    }
+
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (xioctl(m_fd, VIDIOC_STREAMON, &type) < 0) {
+        qDebug() << "V4L2: VIDIOC_STREAMON failed" << strerror(errno);
+        setError("Не удалось запустить поток камеры");
+        return false;
+    }
+    m_streaming = true;
+
+    beginStream();
+    m_stopRequested.store(0);
+    m_thread = new Thread(this);
+    m_thread->start();
+    return true;
+}
+
+void V4L2Source::stop()
+{
+    if (!m_streaming) {
+        return;
+    }
+
+    m_stopRequested.store(1);
+    m_thread->wait();
+    delete m_thread;
+    m_thread = nullptr;
+
+    // STREAMOFF возвращает все буферы драйверу
+    v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    xioctl(m_fd, VIDIOC_STREAMOFF, &type);
+    m_streaming = false;
+}
+
+bool V4L2Source::requeue(int index)
+{
+    v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+    return xioctl(m_fd, VIDIOC_QBUF, &buf) == 0;
+}
+
+void V4L2Source::runLoop()
+{
+    pollfd pfd;
+    pfd.fd = m_fd;
+    pfd.events = POLLIN;
+
+    while (!m_stopRequested.load()) {
+        pfd.revents = 0;
+        const int ready = poll(&pfd, 1, V4L2_POLL_TIMEOUT_MS);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            qDebug() << "V4L2: poll failed" << strerror(errno);
+            break;
+        }
+        if (ready == 0) {
+            continue;
+        }
+        if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            // Камера отключена
+            qDebug() << "V4L2: device error, capture stopped";
+            break;
+        }
+
+        v4l2_buffer buf;
+        memset(&buf, 0, sizeof(buf));
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        if (xioctl(m_fd, VIDIOC_DQBUF, &buf) < 0) {
+            if (errno != EAGAIN) {
+                qDebug() << "V4L2: VIDIOC_DQBUF failed" << strerror(errno);
+            }
+            continue;
+        }
+
+        if (!(buf.flags & V4L2_BUF_FLAG_ERROR) && buf.bytesused > 0) {
+            processBuffer(buf.index, buf);
+        }
+        requeue(buf.index);
+    }
+}
+
+void V4L2Source::processBuffer(int index, const v4l2_buffer &buf)
+{
+    // Буфер драйвера отдаётся без копирования
+    RawFrame frame;
+    frame.data = static_cast<const uchar*>(m_buffers[index].start);
+    frame.size = int(buf.bytesused);
+    frame.timestampUs = qint64(buf.timestamp.tv_sec) * 1000000 + buf.timestamp.tv_usec;
+    frame.sequence = buf.sequence;
+    deliver(frame);
+}
+
+void V4L2Source::enumerateModes()
+{
+    m_modes.clear();
+
+    v4l2_fmtdesc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    for (desc.index = 0; xioctl(m_fd, VIDIOC_ENUM_FMT, &desc) == 0; ++desc.index) {
+        FrameFormat::PixelFormat format;
+        if (!pixelFormatFor(desc.pixelformat, &format)) {
+            continue;
+        }
+
+        v4l2_frmsizeenum size;
+        memset(&size, 0, sizeof(size));
+        size.pixel_format = desc.pixelformat;
+        for (size.index = 0; xioctl(m_fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0; ++size.index) {
+            if (size.type == V4L2_FRMSIZE_TYPE_DISCRETE) {
+                addModes(desc.pixelformat, format, size.discrete.width, size.discrete.height);
+                continue;
+            }
+            // Непрерывный диапазон: в списке наименьший и наибольший размер,
+            // промежуточные можно запросить явно
+            addModes(desc.pixelformat, format, size.stepwise.min_width, size.stepwise.min_height);
+            addModes(desc.pixelformat, format, size.stepwise.max_width, size.stepwise.max_height);
+            break;
+        }
+    }
+
+    qDebug() << "V4L2:" << m_modes.size() << "capture modes";
+}
+
+void V4L2Source::addModes(unsigned int fourcc, FrameFormat::PixelFormat format, int width, int height)
+{
+    v4l2_frmivalenum interval;
+    memset(&interval, 0, sizeof(interval));
+    interval.pixel_format = fourcc;
+    interval.width = width;
+    interval.height = height;
+
+    bool added = false;
+    for (interval.index = 0; xioctl(m_fd, VIDIOC_ENUM_FRAMEINTERVALS, &interval) == 0; ++interval.index) {
+        // У диапазона берём наименьший интервал (наибольшую частоту)
+        const v4l2_fract &period = interval.type == V4L2_FRMIVAL_TYPE_DISCRETE
+                                 ? interval.discrete : interval.stepwise.min;
+        if (period.numerator > 0 && period.denominator > 0) {
+            const CaptureMode mode(width, height,
+                                   qMax(1, qRound(double(period.denominator) / period.numerator)),
+                                   format);
+            if (!m_modes.contains(mode)) {
+                m_modes << mode;
+            }
+            added = true;
+        }
+        if (interval.type != V4L2_FRMIVAL_TYPE_DISCRETE) {
+            break;
+        }
+    }
+
+    // Драйвер не сообщает частоты
+    if (!added) {
+        m_modes << CaptureMode(width, height, 30, format);
+    }
+}
+
+QList<CaptureMode> V4L2Source::supportedModes() const
+{
+    return m_modes.isEmpty() ? FrameSource::supportedModes() : m_modes;
+}
+
+bool V4L2Source::setMode(const CaptureMode &mode)
+{
+    if (m_fd >= 0) {
+        setError("Режим меняется только у закрытого источника");
+        return false;
+    }
+    // Режимы известны, если устройство уже открывалось
+    if (!m_modes.isEmpty() && findMode(m_modes, mode) < 0) {
+        setError(QString("Камера не поддерживает режим %1").arg(mode.toString()));
+        return false;
+    }
+    m_requestedMode = mode;
+    m_modeRequested = true;
+    return true;
+}
+
+QString V4L2Source::description() const
+{
+    return QString("<p><b>API:</b> Video4Linux2</p>"
+                   "<p><b>Устройство:</b> %1 (%2)</p>"
+                   "<p><b>Формат:</b> %3, %4x%5 @ %6 кадр/с (режимов: %7)</p>")
+        .arg(m_device, m_card.isEmpty() ? QString("?") : m_card, fourccName(m_pixelFormat))
+        .arg(m_width).arg(m_height).arg(m_fps).arg(m_modes.size());
+}
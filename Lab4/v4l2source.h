@@ -0,0 +1,77 @@
+#ifndef V4L2SOURCE_H
+#define V4L2SOURCE_H
+
+#include "framesource.h"
+#include <QVector>
+#include <QAtomicInt>
+
+// Камера через Video4Linux2 (Linux): потоковый ввод через mmap-буферы.
+// Поток доставки ждёт готовый буфер в poll(), отдаёт кадр получателю и
+// сразу возвращает буфер драйверу. Пропуски определяются по номеру кадра
+// драйвера (v4l2_buffer::sequence).
+// Кадры отдаются в формате устройства без преобразования (BGR24, RGB24,
+// YUYV, NV12 или MJPEG); режим выбирается из перечисленных драйвером
+// (VIDIOC_ENUM_FMT / ENUM_FRAMESIZES / ENUM_FRAMEINTERVALS).
+class V4L2Source : public FrameSource
+{
+public:
+    explicit V4L2Source(const QString &device = "/dev/video0");
+    ~V4L2Source();
+
+    bool open() override;
+    void close() override;
+    bool isOpen() const override { return m_fd >= 0; }
+
+    bool start() override;
+    void stop() override;
+
+    QString name() const override { return "V4L2"; }
+    QString description() const override;
+
+    int frameRate() const override { return m_fps; }
+
+    QList<CaptureMode> supportedModes() const override;
+    bool setMode(const CaptureMode &mode) override;
+
+private:
+    class Thread;
+
+    struct Buffer
+    {
+        void *start;
+        size_t length;
+    };
+
+    bool requeue(int index);
+    void unmapBuffers();
+    void runLoop();
+    void processBuffer(int index, const struct v4l2_buffer &buf);
+
+    // Перечисление режимов устройства в m_modes
+    void enumerateModes();
+    void addModes(unsigned int fourcc, FrameFormat::PixelFormat format, int width, int height);
+
+    QString m_device;
+    QString m_card;
+    int m_fd;
+    bool m_streaming;
+
+    int m_width;
+    int m_height;
+    int m_stride;
+    int m_fps;
+    unsigned int m_pixelFormat;
+
+    QVector<Buffer> m_buffers;
+
+    // Режимы устройства (с последнего open()) и запрошенный режим;
+    // m_modeRequested - режим задан явно, а не по умолчанию
+    QList<CaptureMode> m_modes;
+    CaptureMode m_requestedMode;
+    bool m_modeRequested;
+
+    Thread *m_thread;
+    QAtomicInt m_stopRequested;
+};
+
+#endif // V4L2SOURCE_H
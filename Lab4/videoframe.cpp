@@ -0,0 +1,104 @@
+#include "videoframe.h"
+#include "pixelconvert.h"
+#include <cstring>
+
+VideoFrame::VideoFrame()
+    : m_pixelFormat(FrameFormat::FormatRGB24),
+      m_width(0),
+      m_height(0)
+{
+}
+
+VideoFrame::VideoFrame(const QImage &rgb)
+    : m_buffer(rgb),
+      m_pixelFormat(FrameFormat::FormatRGB24),
+      m_width(rgb.width()),
+      m_height(rgb.height())
+{
+    Q_ASSERT(rgb.isNull() || rgb.format() == QImage::Format_RGB888);
+}
+
+VideoFrame::VideoFrame(const QImage &buffer, FrameFormat::PixelFormat format, int width, int height)
+    : m_buffer(buffer),
+      m_pixelFormat(format),
+      m_width(width),
+      m_height(height)
+{
+    Q_ASSERT(format == FrameFormat::FormatRGB24 || format == FrameFormat::FormatYUY2 ||
+             format == FrameFormat::FormatNV12);
+}
+
+QSize VideoFrame::bufferSize(FrameFormat::PixelFormat format, int width, int height)
+{
+    switch (format) {
+    case FrameFormat::FormatYUY2:
+        return QSize(width * 2, height);
+    case FrameFormat::FormatNV12:
+        // Плоскость UV: по строке на две строки Y, пары U/V на два пикселя
+        return QSize((width + 1) & ~1, height + (height + 1) / 2);
+    default:
+        return QSize(width, height);
+    }
+}
+
+QImage::Format VideoFrame::bufferFormat(FrameFormat::PixelFormat format)
+{
+    // Байты YUV хранятся в 8-битном QImage, который не выводится на экран
+    return format == FrameFormat::FormatYUY2 || format == FrameFormat::FormatNV12
+        ? QImage::Format_Indexed8 : QImage::Format_RGB888;
+}
+
+bool VideoFrame::isYuv() const
+{
+    return m_pixelFormat == FrameFormat::FormatYUY2 || m_pixelFormat == FrameFormat::FormatNV12;
+}
+
+QImage VideoFrame::toImage() const
+{
+    if (isNull() || !isYuv()) {
+        return m_buffer;
+    }
+    QImage image(m_width, m_height, QImage::Format_RGB888);
+    toRgb24(image.bits(), image.bytesPerLine());
+    return image;
+}
+
+void VideoFrame::toRgb24(uchar *dst, int dstStride) const
+{
+    switch (m_pixelFormat) {
+    case FrameFormat::FormatYUY2:
+        PixelConvert::yuy2ToRgb24(constBits(), bytesPerLine(), dst, dstStride, m_width, m_height);
+        break;
+    case FrameFormat::FormatNV12:
+        PixelConvert::nv12ToRgb24(constBits(), bytesPerLine(), dst, dstStride, m_width, m_height);
+        break;
+    default:
+        for (int y = 0; y < m_height; ++y) {
+            memcpy(dst + y * dstStride, constBits() + y * bytesPerLine(), m_width * 3);
+        }
+        break;
+    }
+}
+
+void VideoFrame::toBgr24(uchar *dst, int dstStride, bool flipVertical) const
+{
+    if (!isYuv()) {
+        PixelConvert::rgb24ToBgr24(constBits(), bytesPerLine(), dst, dstStride,
+                                   m_width, m_height, flipVertical);
+        return;
+    }
+
+    // YUV -> BGR24 одним проходом прямо в строки dst
+    const PixelConvert::RowFunc yuy2 = PixelConvert::yuy2ToBgr24Row();
+    const PixelConvert::Nv12RowFunc nv12 = PixelConvert::nv12ToBgr24Row();
+    const int uvOffset = m_height * bytesPerLine();
+    for (int y = 0; y < m_height; ++y) {
+        const uchar *src = constBits() + y * bytesPerLine();
+        uchar *d = dst + (flipVertical ? m_height - 1 - y : y) * dstStride;
+        if (m_pixelFormat == FrameFormat::FormatYUY2) {
+            yuy2(src, d, m_width);
+        } else {
+            nv12(src, constBits() + uvOffset + (y / 2) * bytesPerLine(), d, m_width);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef VIDEOFRAME_H
+#define VIDEOFRAME_H
+
+#include <QImage>
+#include <QSize>
+#include "framesource.h"
+
+// Кадр конвейера камеры в исходной раскладке пикселей.
+// RGB24 хранится как QImage::Format_RGB888, кадры YUY2 и NV12 - как есть
+// в байтовом QImage (слот FramePool), поэтому поток захвата только копирует
+// их, а в RGB кадр преобразуется там, где он действительно нужен: превью,
+// сжатие JPEG, запись BI_RGB. Копирование VideoFrame не копирует пиксели.
+class VideoFrame
+{
+public:
+    VideoFrame();
+    // Кадр RGB888
+    explicit VideoFrame(const QImage &rgb);
+    // Кадр в раскладке format (FormatRGB24, FormatYUY2 или FormatNV12);
+    // buffer - байты кадра, строки по buffer.bytesPerLine()
+    VideoFrame(const QImage &buffer, FrameFormat::PixelFormat format, int width, int height);
+
+    // Байтовый буфер под кадр width x height в раскладке format
+    // (см. FramePool::configure)
+    static QSize bufferSize(FrameFormat::PixelFormat format, int width, int height);
+    static QImage::Format bufferFormat(FrameFormat::PixelFormat format);
+
+    bool isNull() const { return m_buffer.isNull(); }
+    FrameFormat::PixelFormat pixelFormat() const { return m_pixelFormat; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    QSize size() const { return QSize(m_width, m_height); }
+    bool isYuv() const;
+
+    const uchar *constBits() const { return m_buffer.constBits(); }
+    int bytesPerLine() const { return m_buffer.bytesPerLine(); }
+
+    // Кадр в RGB888. Для RGB24 - тот же буфер без копирования
+    QImage toImage() const;
+
+    // Преобразование в буфер вызывающего (SIMD). flipVertical - строки
+    // в dst снизу вверх (DIB)
+    void toRgb24(uchar *dst, int dstStride) const;
+    void toBgr24(uchar *dst, int dstStride, bool flipVertical) const;
+
+private:
+    QImage m_buffer;
+    FrameFormat::PixelFormat m_pixelFormat;
+    int m_width;
+    int m_height;
+};
+
+#endif // VIDEOFRAME_H
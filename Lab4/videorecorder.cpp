@@ -0,0 +1,561 @@
+#include "videorecorder.h"
+#include <QRunnable>
+#include <QBuffer>
+#include <QDebug>
+
+// Сжатие одного кадра в JPEG в пуле потоков
+class VideoRecorder::EncodeTask : public QRunnable
+{
+public:
+    EncodeTask(VideoRecorder *recorder, qint64 sequence, const VideoFrame &frame, int quality)
+        : m_recorder(recorder), m_sequence(sequence), m_frame(frame), m_quality(quality)
+    {
+    }
+
+    void run() override
+    {
+        PipelineStats *stats = m_recorder->m_pipelineStats;
+        const qint64 startUs = stats ? stats->nowUs() : 0;
+        QByteArray jpeg;
+        QBuffer buffer(&jpeg);
+        buffer.open(QIODevice::WriteOnly);
+        if (!m_frame.toImage().save(&buffer, "JPG", m_quality)) {
+            jpeg.clear();
+        }
+        // Кадр больше не нужен - слот пула освобождается до записи на диск
+        m_frame = VideoFrame();
+        if (stats) {
+            stats->recordSince(PipelineStats::StageEncode, startUs);
+        }
+        m_recorder->frameEncoded(m_sequence, jpeg);
+    }
+
+private:
+    VideoRecorder *m_recorder;
+    qint64 m_sequence;
+    VideoFrame m_frame;
+    int m_quality;
+};
+
+VideoRecorder::VideoRecorder(QObject *parent)
+    : QThread(parent),
+      m_nextSequence(0),
+      m_nextToWrite(0),
+      m_queueCapacity(6),
+      m_stopRequested(false),
+      m_running(false),
+      m_preRoll(false),
+      m_fileStart(-1),
+      m_fileEnd(-1),
+      m_fileOpen(false),
+      m_fileFailed(false),
+      m_preRollMaxFrames(0),
+      m_preRollBudget(0),
+      m_preRollFrameCount(0),
+      m_preRollBytes(0),
+      m_preRollWritten(0),
+      m_codec(CodecMJPEG),
+      m_jpegQuality(85),
+      m_encoderPool(&m_ownEncoderPool),
+      m_encodesInFlight(0),
+      m_pipelineStats(nullptr),
+      m_fps(30),
+      m_framesWritten(0),
+      m_framesDropped(0),
+      m_rawBytes(0),
+      m_fileBytes(0),
+      m_writeMs(0)
+{
+    // Один поток оставляем захвату и записи
+    m_ownEncoderPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+VideoRecorder::~VideoRecorder()
+{
+    if (m_running && m_preRoll) {
+        stopPreRoll();
+    } else if (m_running) {
+        stopRecording();
+    }
+}
+
+void VideoRecorder::resetStats()
+{
+    m_framesWritten = 0;
+    m_framesDropped = 0;
+    m_rawBytes = 0;
+    m_fileBytes = 0;
+    m_writeMs = 0;
+    m_preRollWritten = 0;
+    m_lastError.clear();
+}
+
+void VideoRecorder::startThread(const QSize &frameSize, int fps, int queueCapacity)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_ready.clear();
+        m_nextSequence = 0;
+        m_nextToWrite = 0;
+        m_frameSize = frameSize;
+        m_queueCapacity = qMax(1, queueCapacity);
+        m_stopRequested = false;
+        m_fps = fps;
+        m_fileOpen = false;
+        m_fileFailed = false;
+        m_preRollFrameCount = 0;
+        m_preRollBytes = 0;
+    }
+
+    m_running = true;
+    start();
+}
+
+bool VideoRecorder::startRecording(const QString &filePath, const QSize &frameSize,
+                                   int fps, int queueCapacity)
+{
+    if (frameSize.isEmpty()) {
+        return false;
+    }
+
+    if (m_running && m_preRoll) {
+        // Поток уже работает: файл начнётся с кадров предзаписи
+        QMutexLocker locker(&m_mutex);
+        if (m_fileStart >= 0 || frameSize != m_frameSize) {
+            return false;
+        }
+        m_filePath = filePath;
+        resetStats();
+        m_fileStart = m_nextSequence;
+        m_fileEnd = -1;
+        m_frameReady.wakeOne();
+        return true;
+    }
+
+    if (m_running) {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_preRoll = false;
+        m_filePath = filePath;
+        m_fileStart = 0;
+        m_fileEnd = -1;
+        resetStats();
+    }
+    startThread(frameSize, fps, queueCapacity);
+    return true;
+}
+
+bool VideoRecorder::startPreRoll(const QSize &frameSize, int fps, int maxSeconds,
+                                 qint64 byteBudget, int queueCapacity)
+{
+    if (m_running || frameSize.isEmpty() || maxSeconds <= 0 || byteBudget <= 0) {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        m_preRoll = true;
+        m_fileStart = -1;
+        m_fileEnd = -1;
+        m_preRollMaxFrames = maxSeconds * qMax(1, fps);
+        m_preRollBudget = byteBudget;
+        resetStats();
+    }
+    startThread(frameSize, fps, queueCapacity);
+    qDebug() << "VideoRecorder: pre-roll started," << maxSeconds << "s,"
+             << byteBudget / (1024 * 1024) << "MB";
+    return true;
+}
+
+void VideoRecorder::stopPreRoll()
+{
+    if (!m_running || !m_preRoll) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        // Незакрытый файл дописывается до последнего принятого кадра
+        if (m_fileStart >= 0 && m_fileEnd < 0) {
+            m_fileEnd = m_nextSequence;
+        }
+        m_stopRequested = true;
+        m_frameReady.wakeOne();
+    }
+
+    wait();
+    waitForEncoders();
+    m_running = false;
+    m_preRoll = false;
+    qDebug() << "VideoRecorder: pre-roll stopped";
+}
+
+bool VideoRecorder::isRecording() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_running && m_fileStart >= 0;
+}
+
+int VideoRecorder::preRollFrameCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_preRollFrameCount;
+}
+
+qint64 VideoRecorder::preRollBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_preRollBytes;
+}
+
+bool VideoRecorder::pushFrame(const VideoFrame &frame)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // Ошибка файла в режиме предзаписи не останавливает кольцевой буфер
+    if (!m_running || m_stopRequested || (!m_preRoll && !m_lastError.isEmpty())) {
+        return false;
+    }
+
+    // Формат камеры сменился во время записи - такие кадры пропускаем
+    if (frame.size() != m_frameSize) {
+        m_framesDropped++;
+        return false;
+    }
+
+    // Кадры в работе (сжимаются или ждут записи). Если запись не успевает,
+    // отбрасываем кадр, а не блокируем захват
+    if (m_nextSequence - m_nextToWrite >= m_queueCapacity) {
+        m_framesDropped++;
+        return false;
+    }
+
+    const qint64 sequence = m_nextSequence++;
+
+    // Предзапись хранит только сжатые кадры
+    if (m_codec == CodecMJPEG || m_preRoll) {
+        // Кадр не копируется: задача держит ссылку на слот пула
+        m_encodesInFlight++;
+        m_encoderPool->start(new EncodeTask(this, sequence, frame, m_jpegQuality));
+    } else {
+        PendingFrame pending;
+        pending.image = frame;
+        pending.failed = false;
+        m_ready.insert(sequence, pending);
+        m_frameReady.wakeOne();
+    }
+    return true;
+}
+
+void VideoRecorder::frameEncoded(qint64 sequence, const QByteArray &jpeg)
+{
+    QMutexLocker locker(&m_mutex);
+    PendingFrame pending;
+    pending.encoded = jpeg;
+    pending.failed = jpeg.isEmpty();
+    m_ready.insert(sequence, pending);
+    m_frameReady.wakeOne();
+    if (--m_encodesInFlight == 0) {
+        m_encodersIdle.wakeAll();
+    }
+}
+
+void VideoRecorder::waitForEncoders()
+{
+    // Поздние кадры прерванной записи не должны попасть в следующую
+    QMutexLocker locker(&m_mutex);
+    while (m_encodesInFlight > 0) {
+        m_encodersIdle.wait(&m_mutex);
+    }
+}
+
+void VideoRecorder::setEncoderPool(QThreadPool *pool)
+{
+    if (m_running) {
+        qDebug() << "VideoRecorder: encoder pool change ignored while running";
+        return;
+    }
+    m_encoderPool = pool ? pool : &m_ownEncoderPool;
+}
+
+bool VideoRecorder::stopRecording()
+{
+    if (!m_running) {
+        return false;
+    }
+
+    if (m_preRoll) {
+        // Поток продолжает предзапись; ждём только закрытия файла
+        QMutexLocker locker(&m_mutex);
+        if (m_fileStart < 0) {
+            return false;
+        }
+        m_fileEnd = m_nextSequence;
+        m_frameReady.wakeOne();
+        while (m_fileStart >= 0) {
+            m_fileClosed.wait(&m_mutex);
+        }
+    } else {
+        {
+            QMutexLocker locker(&m_mutex);
+            m_stopRequested = true;
+            m_frameReady.wakeOne();
+        }
+
+        wait();
+        waitForEncoders();
+        m_running = false;
+    }
+
+    Stats s = stats();
+    qDebug() << "VideoRecorder stopped:" << m_filePath
+             << "written" << s.framesWritten << "(pre-roll" << s.preRollFrames << ")"
+             << "dropped" << s.framesDropped
+             << "compression" << QString::number(s.compressionRatio, 'f', 1) + ":1"
+             << "sustained" << QString::number(s.sustainedFps, 'f', 1) << "fps";
+
+    QMutexLocker locker(&m_mutex);
+    return m_lastError.isEmpty() && m_framesWritten > 0;
+}
+
+int VideoRecorder::framesWritten() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_framesWritten;
+}
+
+int VideoRecorder::framesDropped() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_framesDropped;
+}
+
+VideoRecorder::Stats VideoRecorder::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    Stats s;
+    s.framesWritten = m_framesWritten;
+    s.framesDropped = m_framesDropped;
+    s.rawBytes = m_rawBytes;
+    s.fileBytes = m_fileBytes;
+    s.compressionRatio = m_fileBytes > 0 ? double(m_rawBytes) / m_fileBytes : 0.0;
+    s.sustainedFps = m_writeMs > 0 ? m_framesWritten * 1000.0 / m_writeMs : 0.0;
+    s.preRollFrames = m_preRollWritten;
+    return s;
+}
+
+QString VideoRecorder::lastError() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_lastError;
+}
+
+void VideoRecorder::run()
+{
+    if (m_preRoll) {
+        m_preRollBuffer.configure(m_preRollBudget, m_preRollMaxFrames);
+    }
+
+    forever {
+        PendingFrame frame;
+        bool toFile = false;
+        bool openNow = false;
+        bool closeFile = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            // Ждём кадр с очередным номером или момент открытия/закрытия
+            // файла; при остановке - пока не будут записаны все принятые кадры.
+            // С предзаписью файл открывается, как только все кадры до начала
+            // записи попали в кольцевой буфер, не дожидаясь следующего кадра:
+            // иначе остановка сразу после старта теряла бы предзапись
+            forever {
+                openNow = m_preRoll && m_fileStart >= 0 && !m_fileOpen && !m_fileFailed &&
+                          m_nextToWrite >= m_fileStart;
+                closeFile = !openNow && m_fileStart >= 0 && m_fileEnd >= 0 &&
+                            m_nextToWrite >= m_fileEnd;
+                if (openNow || closeFile || m_ready.contains(m_nextToWrite) ||
+                    (m_stopRequested && m_nextToWrite == m_nextSequence)) {
+                    break;
+                }
+                m_frameReady.wait(&m_mutex);
+            }
+            if (!openNow && !closeFile) {
+                if (!m_ready.contains(m_nextToWrite)) {
+                    break;
+                }
+                toFile = m_fileStart >= 0 && m_nextToWrite >= m_fileStart;
+                frame = m_ready.take(m_nextToWrite);
+                m_nextToWrite++;
+            }
+        }
+
+        if (openNow) {
+            openFile();
+            continue;
+        }
+
+        if (closeFile) {
+            closeWriter();
+            QMutexLocker locker(&m_mutex);
+            m_fileStart = -1;
+            m_fileEnd = -1;
+            m_fileOpen = false;
+            m_fileFailed = false;
+            m_fileClosed.wakeAll();
+            continue;
+        }
+
+        if (frame.failed) {
+            QMutexLocker locker(&m_mutex);
+            m_framesDropped++;
+            continue;
+        }
+
+        if (toFile) {
+            writeFileFrame(frame);
+            // Без предзаписи ошибка файла завершает поток
+            if (!m_preRoll) {
+                QMutexLocker locker(&m_mutex);
+                if (m_fileFailed) {
+                    break;
+                }
+            }
+        } else {
+            m_preRollBuffer.append(frame.encoded.constData(), frame.encoded.size());
+            QMutexLocker locker(&m_mutex);
+            m_preRollFrameCount = m_preRollBuffer.frameCount();
+            m_preRollBytes = m_preRollBuffer.bytesUsed();
+        }
+    }
+
+    closeWriter();
+    m_preRollBuffer.configure(0, 0);
+    QMutexLocker locker(&m_mutex);
+    m_fileStart = -1;
+    m_fileEnd = -1;
+    m_fileClosed.wakeAll();
+}
+
+bool VideoRecorder::openFile()
+{
+    if (!openWriter()) {
+        QMutexLocker locker(&m_mutex);
+        m_fileFailed = true;
+        return false;
+    }
+
+    // Файл начинается с предзаписи: кадры уже сжаты, поэтому это только
+    // последовательная запись на диск
+    const int preRollCount = m_preRollBuffer.frameCount();
+    for (int i = 0; i < preRollCount; ++i) {
+        if (!writeChunk(m_preRollBuffer.frameData(i), m_preRollBuffer.frameSize(i))) {
+            QMutexLocker locker(&m_mutex);
+            m_fileFailed = true;
+            return false;
+        }
+    }
+    m_preRollBuffer.clear();
+    QMutexLocker locker(&m_mutex);
+    m_fileOpen = true;
+    m_preRollWritten = preRollCount;
+    m_preRollFrameCount = 0;
+    m_preRollBytes = 0;
+    return true;
+}
+
+void VideoRecorder::writeFileFrame(const PendingFrame &frame)
+{
+    bool failed;
+    bool open;
+    {
+        QMutexLocker locker(&m_mutex);
+        failed = m_fileFailed;
+        open = m_fileOpen;
+    }
+
+    if (failed || (!open && !openFile())) {
+        QMutexLocker locker(&m_mutex);
+        m_framesDropped++;
+        return;
+    }
+
+    if (!writeFrame(frame)) {
+        QMutexLocker locker(&m_mutex);
+        m_fileFailed = true;
+    }
+}
+
+bool VideoRecorder::openWriter()
+{
+    // Размер и кодек не меняются до конца записи
+    const QSize frameSize = m_frameSize;
+    const bool compressed = m_codec == CodecMJPEG || m_preRoll;
+
+    AviWriter::Codec codec = compressed ? AviWriter::CodecMJPEG : AviWriter::CodecRGB24;
+    if (!m_writer.open(m_filePath.toUtf8().toStdString(),
+                       frameSize.width(), frameSize.height(), m_fps, codec)) {
+        QString error = QString::fromStdString(m_writer.lastError());
+        qDebug() << "VideoRecorder: failed to open" << m_filePath << error;
+        setError(error);
+        emit recordingError(QString("Не удалось создать видеофайл: %1").arg(error));
+        return false;
+    }
+    if (!compressed) {
+        m_packed.resize(AviWriter::rgb24Stride(frameSize.width()) * frameSize.height());
+    }
+    m_writeTimer.start();
+    return true;
+}
+
+void VideoRecorder::closeWriter()
+{
+    if (m_writer.isOpen() && !m_writer.close()) {
+        setError(QString::fromStdString(m_writer.lastError()));
+    }
+}
+
+bool VideoRecorder::writeFrame(const PendingFrame &frame)
+{
+    if (!frame.encoded.isEmpty()) {
+        return writeChunk(frame.encoded.constData(), frame.encoded.size());
+    }
+
+    // RGB или YUV top-down -> BGR bottom-up (формат BI_RGB), размер
+    // проверен в pushFrame
+    const QSize frameSize = m_frameSize;
+    frame.image.toBgr24(reinterpret_cast<uchar*>(m_packed.data()),
+                        AviWriter::rgb24Stride(frameSize.width()), true);
+    return writeChunk(m_packed.constData(), m_packed.size());
+}
+
+bool VideoRecorder::writeChunk(const char *data, int size)
+{
+    const qint64 startUs = m_pipelineStats ? m_pipelineStats->nowUs() : 0;
+    if (!m_writer.writeFrame(data, size)) {
+        QString error = QString::fromStdString(m_writer.lastError());
+        qDebug() << "VideoRecorder: write failed" << error;
+        setError(error);
+        emit recordingError(QString("Ошибка записи видео: %1").arg(error));
+        return false;
+    }
+    if (m_pipelineStats) {
+        m_pipelineStats->recordSince(PipelineStats::StageWrite, startUs);
+    }
+
+    const QSize frameSize = m_frameSize;
+    QMutexLocker locker(&m_mutex);
+    m_framesWritten++;
+    m_rawBytes += qint64(frameSize.width()) * frameSize.height() * 3;
+    m_fileBytes += size;
+    m_writeMs = qMax<qint64>(1, m_writeTimer.elapsed());
+    return true;
+}
+
+void VideoRecorder::setError(const QString &error)
+{
+    QMutexLocker locker(&m_mutex);
+    m_lastError = error;
+}
@@ -0,0 +1,174 @@
+#ifndef VIDEORECORDER_H
+#define VIDEORECORDER_H
+
+#include <QThread>
+#include <QThreadPool>
+#include <QImage>
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QString>
+#include "aviwriter.h"
+#include "prerollbuffer.h"
+#include "pipelinestats.h"
+#include "videoframe.h"
+
+// Потоковая запись видео в отдельном потоке.
+// Кадры поступают через ограниченную очередь и сразу дописываются в AVI,
+// поэтому память не растёт с длительностью записи, а остановка занимает
+// время записи лишь нескольких оставшихся в очереди кадров.
+//
+// В режиме MJPEG кадры сжимаются пулом потоков. Кадры нумеруются при
+// постановке в очередь, а поток записи забирает их строго по порядку,
+// даже если сжатие завершилось в другом порядке.
+//
+// В режиме предзаписи поток работает постоянно: пока файл не пишется,
+// кадры сжимаются в MJPEG и хранятся в кольцевом буфере (PreRollBuffer).
+// startRecording() начинает файл с этих кадров, не останавливая захват.
+class VideoRecorder : public QThread
+{
+    Q_OBJECT
+
+public:
+    enum Codec {
+        CodecUncompressed,  // BI_RGB, ~6 МБ на кадр 1080p
+        CodecMJPEG          // Motion-JPEG
+    };
+
+    // Итоги записи
+    struct Stats {
+        int framesWritten;
+        int framesDropped;
+        qint64 rawBytes;        // объём кадров до сжатия
+        qint64 fileBytes;       // объём видеоданных в файле
+        double compressionRatio;
+        double sustainedFps;    // кадров в секунду, записанных на диск
+        int preRollFrames;      // из них взято из предзаписи
+    };
+
+    explicit VideoRecorder(QObject *parent = nullptr);
+    ~VideoRecorder();
+
+    // Начать запись кадров размера frameSize (формат источника).
+    // Файл и буферы готовятся один раз под этот формат
+    bool startRecording(const QString &filePath, const QSize &frameSize,
+                        int fps = 30, int queueCapacity = 6);
+
+    // Поставить кадр в очередь (не блокирует поток захвата). Кадры YUV
+    // переводятся в RGB в задачах сжатия и в потоке записи.
+    // false - очередь переполнена, кадр отброшен
+    bool pushFrame(const VideoFrame &frame);
+
+    // Дописать очередь, закрыть файл и дождаться потока.
+    // В режиме предзаписи поток продолжает работать
+    bool stopRecording();
+
+    // Предзапись: последние кадры (не больше maxSeconds секунд и byteBudget
+    // байт) хранятся сжатыми, пока файл не пишется. Файлы в этом режиме
+    // всегда пишутся в MJPEG
+    bool startPreRoll(const QSize &frameSize, int fps, int maxSeconds, qint64 byteBudget,
+                      int queueCapacity = 6);
+    void stopPreRoll();
+    bool isPreRollActive() const { return m_running && m_preRoll; }
+    int preRollFrameCount() const;
+    qint64 preRollBytes() const;
+
+    void setCodec(Codec codec) { m_codec = codec; }
+    Codec codec() const { return m_codec; }
+    void setJpegQuality(int quality) { m_jpegQuality = quality; }
+
+    // Общий пул сжатия для нескольких камер (nullptr - собственный пул).
+    // Задаётся до записи; пул должен жить дольше записи
+    void setEncoderPool(QThreadPool *pool);
+
+    // Время сжатия и записи кадров (этапы encode/write); задаётся до записи
+    void setPipelineStats(PipelineStats *stats) { m_pipelineStats = stats; }
+
+    bool isRecording() const;
+    QString filePath() const { return m_filePath; }
+    int framesWritten() const;
+    int framesDropped() const;
+    Stats stats() const;
+    QString lastError() const;
+
+signals:
+    void recordingError(const QString &error);
+
+protected:
+    void run() override;
+
+private:
+    class EncodeTask;
+
+    // Кадр, готовый к записи: исходный (BI_RGB) или сжатый (MJPEG)
+    struct PendingFrame {
+        VideoFrame image;
+        QByteArray encoded;
+        bool failed;
+    };
+
+    void startThread(const QSize &frameSize, int fps, int queueCapacity);
+    void resetStats();
+    void frameEncoded(qint64 sequence, const QByteArray &jpeg);
+    void waitForEncoders();
+    bool openWriter();
+    void closeWriter();
+    bool writeFrame(const PendingFrame &frame);
+    bool writeChunk(const char *data, int size);
+    bool openFile();
+    void writeFileFrame(const PendingFrame &frame);
+    void setError(const QString &error);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_frameReady;
+    QMap<qint64, PendingFrame> m_ready;
+    qint64 m_nextSequence;      // номер следующего принятого кадра
+    qint64 m_nextToWrite;       // номер следующего кадра для записи
+    QSize m_frameSize;          // размер задаётся при запуске записи
+    int m_queueCapacity;
+    bool m_stopRequested;
+    bool m_running;
+
+    // Предзапись: кадры с номерами [m_fileStart, m_fileEnd) идут в файл,
+    // остальные - в кольцевой буфер. Без предзаписи в файл идут все кадры
+    bool m_preRoll;
+    qint64 m_fileStart;         // -1 - файл не пишется
+    qint64 m_fileEnd;           // -1 - конец не задан
+    bool m_fileOpen;
+    bool m_fileFailed;
+    QWaitCondition m_fileClosed;
+    int m_preRollMaxFrames;
+    qint64 m_preRollBudget;
+    int m_preRollFrameCount;
+    qint64 m_preRollBytes;
+    int m_preRollWritten;
+
+    Codec m_codec;
+    int m_jpegQuality;
+    QThreadPool m_ownEncoderPool;
+    QThreadPool *m_encoderPool;
+    // Задачи сжатия этого рекордера в пуле (пул может быть общим, поэтому
+    // waitForDone() не подходит)
+    int m_encodesInFlight;
+    QWaitCondition m_encodersIdle;
+    PipelineStats *m_pipelineStats;
+
+    QString m_filePath;
+    int m_fps;
+    int m_framesWritten;
+    int m_framesDropped;
+    qint64 m_rawBytes;
+    qint64 m_fileBytes;
+    qint64 m_writeMs;
+    QString m_lastError;
+
+    // Используются только потоком записи
+    AviWriter m_writer;
+    PreRollBuffer m_preRollBuffer;
+    QByteArray m_packed;
+    QElapsedTimer m_writeTimer;
+};
+
+#endif // VIDEORECORDER_H
@@ -0,0 +1,190 @@
+// Бенчмарк записи видеофайла на диск.
+// Сравнивает прежний способ (fwrite каждого кадра через буфер stdio) с
+// FileWriter (резерв места, выровненные блоки по 4 МБ, периодическая
+// синхронизация) на одном и том же диске. Кадры - куски размера MJPEG
+// 1080p (~250 КБ, размер меняется от кадра к кадру) и несжатого
+// RGB24 1080p (~6 МБ).
+//
+// Для каждого способа выводится:
+//  - "write MB/s" - пока вызовы записи возвращаются (данные могут быть
+//    ещё в кэше ОС);
+//  - "disk MB/s" - с учётом сброса на диск при закрытии (fsync), т.е.
+//    устойчивая скорость записи;
+//  - наибольшее время записи одного кадра (задержки потока записи
+//    переполняют очередь VideoRecorder и приводят к потере кадров).
+//
+// Запуск: write_bench [каталог] [МБ_на_замер]
+
+#include "filewriter.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+struct Workload
+{
+    const char *name;
+    unsigned int frameSize;
+    unsigned int jitter;    // размер кадра меняется в пределах +-jitter
+};
+
+struct Result
+{
+    double writeSeconds;
+    double totalSeconds;
+    double maxFrameMs;
+    bool ok;
+};
+
+// Размеры кадров одинаковы для всех способов
+static std::vector<unsigned int> frameSizes(const Workload &workload, unsigned long long totalBytes)
+{
+    std::vector<unsigned int> sizes;
+    unsigned long long bytes = 0;
+    unsigned int seed = 12345;
+    while (bytes < totalBytes) {
+        seed = seed * 1103515245u + 12345u;
+        const unsigned int jitter = workload.jitter > 0 ? (seed >> 8) % (2 * workload.jitter) : 0;
+        const unsigned int size = workload.frameSize - workload.jitter + jitter;
+        sizes.push_back(size);
+        bytes += size + 8;
+    }
+    return sizes;
+}
+
+// Прежний способ AviWriter: заголовок чанка и кадр через fwrite
+static Result writeStdio(const std::string &path, const std::vector<unsigned int> &sizes,
+                         const std::vector<char> &data)
+{
+    Result result = { 0.0, 0.0, 0.0, false };
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return result;
+    }
+
+    result.ok = true;
+    const Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < sizes.size() && result.ok; ++i) {
+        const Clock::time_point frameStart = Clock::now();
+        const char header[8] = { '0', '0', 'd', 'c', 0, 0, 0, 0 };
+        result.ok = std::fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+                    std::fwrite(data.data(), 1, sizes[i], file) == sizes[i];
+        result.maxFrameMs = std::max(result.maxFrameMs, secondsSince(frameStart) * 1000.0);
+    }
+    result.writeSeconds = secondsSince(start);
+
+    result.ok = std::fflush(file) == 0 && result.ok;
+#ifdef _WIN32
+    result.ok = _commit(_fileno(file)) == 0 && result.ok;
+#else
+    result.ok = fsync(fileno(file)) == 0 && result.ok;
+#endif
+    result.ok = std::fclose(file) == 0 && result.ok;
+    result.totalSeconds = secondsSince(start);
+    return result;
+}
+
+static Result writeBlocks(const std::string &path, const std::vector<unsigned int> &sizes,
+                          const std::vector<char> &data, unsigned long long syncInterval)
+{
+    Result result = { 0.0, 0.0, 0.0, false };
+    FileWriter file;
+    file.setSyncInterval(syncInterval);
+    if (!file.open(path)) {
+        std::fprintf(stderr, "write_bench: %s\n", file.lastError().c_str());
+        return result;
+    }
+
+    result.ok = true;
+    const Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < sizes.size() && result.ok; ++i) {
+        const Clock::time_point frameStart = Clock::now();
+        const char header[8] = { '0', '0', 'd', 'c', 0, 0, 0, 0 };
+        result.ok = file.write(header, sizeof(header)) && file.write(data.data(), sizes[i]);
+        result.maxFrameMs = std::max(result.maxFrameMs, secondsSince(frameStart) * 1000.0);
+    }
+    result.writeSeconds = secondsSince(start);
+
+    result.ok = file.close() && result.ok;
+    result.totalSeconds = secondsSince(start);
+    if (!result.ok) {
+        std::fprintf(stderr, "write_bench: %s\n", file.lastError().c_str());
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string directory = argc > 1 ? argv[1] : ".";
+    const double megabytes = argc > 2 ? std::atof(argv[2]) : 512.0;
+    if (megabytes <= 0) {
+        std::fprintf(stderr, "usage: write_bench [directory] [megabytes]\n");
+        return 1;
+    }
+    const unsigned long long totalBytes = static_cast<unsigned long long>(megabytes * 1024 * 1024);
+    const std::string path = directory + "/write_bench.tmp";
+
+    const Workload workloads[] = {
+        { "mjpeg 1080p", 250 * 1024, 60 * 1024 },
+        { "rgb24 1080p", 1920 * 3 * 1080, 0 }
+    };
+
+    // Данные кадров - псевдослучайные, чтобы сжатие ФС не влияло
+    std::vector<char> data(1920 * 3 * 1080 + 64 * 1024);
+    unsigned int seed = 1;
+    for (size_t i = 0; i < data.size(); ++i) {
+        seed = seed * 1103515245u + 12345u;
+        data[i] = static_cast<char>(seed >> 16);
+    }
+
+    std::printf("%.0f MB per run, file %s\n\n", megabytes, path.c_str());
+    std::printf("%-12s %-24s %12s %12s %14s\n", "frames", "method", "write MB/s", "disk MB/s",
+                "max frame ms");
+    for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); ++w) {
+        const std::vector<unsigned int> sizes = frameSizes(workloads[w], totalBytes);
+        for (int method = 0; method < 3; ++method) {
+            Result result;
+            const char *name = "";
+            switch (method) {
+            case 0:
+                name = "fwrite (stdio)";
+                result = writeStdio(path, sizes, data);
+                break;
+            case 1:
+                name = "FileWriter, sync 64 MB";
+                result = writeBlocks(path, sizes, data, FileWriter::DEFAULT_SYNC_INTERVAL);
+                break;
+            default:
+                name = "FileWriter, sync at end";
+                result = writeBlocks(path, sizes, data, 0);
+                break;
+            }
+            std::remove(path.c_str());
+
+            if (!result.ok) {
+                std::printf("%-12s %-24s %12s\n", workloads[w].name, name, "failed");
+                continue;
+            }
+            const double mb = totalBytes / (1024.0 * 1024.0);
+            std::printf("%-12s %-24s %12.1f %12.1f %14.2f\n", workloads[w].name, name,
+                        mb / result.writeSeconds, mb / result.totalSeconds, result.maxFrameMs);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,16 @@
+QT -= core gui
+
+TARGET = write_bench
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle qt
+
+SOURCES += \
+    write_bench.cpp \
+    filewriter.cpp
+
+HEADERS += \
+    filewriter.h
+
+CONFIG += release
@@ -2,12 +2,9 @@
 #include "bluetoothlogger.h"
 #include <QDebug>
 
-#pragma comment(lib, "ws2_32.lib")
-
 BluetoothConnection::BluetoothConnection(BluetoothLogger *logger, QObject *parent)
     : QObject(parent)
     , logger(logger)
-    , btSocket(INVALID_SOCKET)
     , connected(false)
 {
     if (logger) {
@@ -18,98 +15,31 @@ BluetoothConnection::BluetoothConnection(BluetoothLogger *logger, QObject *paren
 BluetoothConnection::~BluetoothConnection()
 {
     disconnect();
-    cleanupWinsock();
 }
 
-bool BluetoothConnection::initializeWinsock()
-{
-    if (logger) {
-        logger->debug("Connection", "═══════════════════════════════════════");
-        logger->debug("Connection", "ИНИЦИАЛИЗАЦИЯ WINSOCK");
-        logger->debug("Connection", "═══════════════════════════════════════");
-    }
-    
-    WSADATA wsaData;
-    
-    if (logger) {
-        logger->logApiCall("WSAStartup", "MAKEWORD(2,2)");
-    }
-    
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    
-    if (result != 0) {
-        if (logger) {
-            logger->logApiResult("WSAStartup", QString("FAILED - Error: %1").arg(result), false);
-            logger->error("Connection", QString("WSAStartup failed: %1").arg(result));
-        }
-        return false;
-    }
-    
-    if (logger) {
-        logger->logApiResult("WSAStartup", "SUCCESS", true);
-        logger->success("Connection", QString("✓ Winsock версия: %1.%2")
-            .arg(LOBYTE(wsaData.wVersion))
-            .arg(HIBYTE(wsaData.wVersion)));
-        logger->debug("Connection", "");
-    }
-    
-    return true;
-}
-
-void BluetoothConnection::cleanupWinsock()
-{
-    if (logger) {
-        logger->debug("Connection", "Очистка Winsock...");
-        logger->logApiCall("WSACleanup", "");
-    }
-    
-    WSACleanup();
-    
-    if (logger) {
-        logger->debug("Connection", "✓ Winsock очищен");
-    }
-}
-
-bool BluetoothConnection::parseMacAddress(const QString &address, BLUETOOTH_ADDRESS &btAddr)
+bool BluetoothConnection::parseMacAddress(const QString &address, quint64 &btAddr)
 {
     if (logger) {
         logger->debug("Connection", QString("Парсинг MAC адреса: %1").arg(address));
     }
     
     // Формат: XX:XX:XX:XX:XX:XX
-    QStringList bytes = address.split(":");
-    
-    if (bytes.size() != 6) {
+    if (!RfcommTransport::parseAddress(address, btAddr)) {
         if (logger) {
-            logger->error("Connection", QString("Неверный формат MAC адреса! Ожидается 6 байт, получено: %1").arg(bytes.size()));
+            logger->error("Connection", QString("Неверный формат MAC адреса! Ожидается XX:XX:XX:XX:XX:XX, получено: %1").arg(address));
         }
         return false;
     }
     
-    ZeroMemory(&btAddr, sizeof(btAddr));
-    
-    for (int i = 0; i < 6; ++i) {
-        bool ok;
-        quint8 byte = bytes[i].toUInt(&ok, 16);
-        if (!ok) {
-            if (logger) {
-                logger->error("Connection", QString("Неверный байт в позиции %1: %2").arg(i).arg(bytes[i]));
-            }
-            return false;
-        }
-        // Bluetooth адрес в обратном порядке
-        btAddr.rgBytes[5 - i] = byte;
-    }
-    
     if (logger) {
         logger->success("Connection", "✓ MAC адрес распознан");
         logger->debug("Connection", QString("Байты: %1 %2 %3 %4 %5 %6")
-            .arg(btAddr.rgBytes[5], 2, 16, QChar('0'))
-            .arg(btAddr.rgBytes[4], 2, 16, QChar('0'))
-            .arg(btAddr.rgBytes[3], 2, 16, QChar('0'))
-            .arg(btAddr.rgBytes[2], 2, 16, QChar('0'))
-            .arg(btAddr.rgBytes[1], 2, 16, QChar('0'))
-            .arg(btAddr.rgBytes[0], 2, 16, QChar('0')).toUpper());
+            .arg((btAddr >> 40) & 0xFF, 2, 16, QChar('0'))
+            .arg((btAddr >> 32) & 0xFF, 2, 16, QChar('0'))
+            .arg((btAddr >> 24) & 0xFF, 2, 16, QChar('0'))
+            .arg((btAddr >> 16) & 0xFF, 2, 16, QChar('0'))
+            .arg((btAddr >> 8) & 0xFF, 2, 16, QChar('0'))
+            .arg(btAddr & 0xFF, 2, 16, QChar('0')).toUpper());
     }
     
     return true;
@@ -126,48 +56,13 @@ bool BluetoothConnection::connectToDevice(const QString &deviceAddress, const QS
         logger->info("Connection", "");
     }
     
-    // Шаг 1: Инициализация Winsock
-    if (!initializeWinsock()) {
-        emit connectionFailed("Не удалось инициализировать Winsock");
-        return false;
-    }
-    
-    // Шаг 2: Создание Bluetooth сокета
+    // Шаг 1: Парсинг MAC адреса
     if (logger) {
-        logger->info("Connection", "ШАГ 1: Создание Bluetooth сокета");
-        logger->logApiCall("socket", "AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM");
-    }
-    
-    btSocket = socket(AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM);
-    
-    if (btSocket == INVALID_SOCKET) {
-        QString error = getLastSocketError();
-        if (logger) {
-            logger->logApiResult("socket", QString("FAILED - %1").arg(error), false);
-            logger->error("Connection", QString("Не удалось создать сокет: %1").arg(error));
-        }
-        cleanupWinsock();
-        emit connectionFailed("Не удалось создать Bluetooth сокет");
-        return false;
+        logger->info("Connection", "ШАГ 1: Парсинг MAC адреса устройства");
     }
     
-    if (logger) {
-        logger->logApiResult("socket", QString("SUCCESS - Socket Handle = 0x%1").arg((quintptr)btSocket, 0, 16), true);
-        logger->success("Connection", "✓ Bluetooth сокет создан");
-        logger->debug("Connection", QString("Socket handle: 0x%1").arg((quintptr)btSocket, 0, 16));
-        logger->debug("Connection", "");
-    }
-    
-    // Шаг 3: Парсинг MAC адреса
-    if (logger) {
-        logger->info("Connection", "ШАГ 2: Парсинг MAC адреса устройства");
-    }
-    
-    BLUETOOTH_ADDRESS btAddr;
+    quint64 btAddr = 0;
     if (!parseMacAddress(deviceAddress, btAddr)) {
-        closesocket(btSocket);
-        btSocket = INVALID_SOCKET;
-        cleanupWinsock();
         emit connectionFailed("Неверный формат MAC адреса");
         return false;
     }
@@ -176,40 +71,20 @@ bool BluetoothConnection::connectToDevice(const QString &deviceAddress, const QS
         logger->debug("Connection", "");
     }
     
-    // Шаг 4: Настройка адреса для подключения
-    if (logger) {
-        logger->info("Connection", "ШАГ 3: Настройка параметров подключения");
-    }
-    
-    SOCKADDR_BTH sockAddrBth;
-    ZeroMemory(&sockAddrBth, sizeof(sockAddrBth));
-    sockAddrBth.addressFamily = AF_BTH;
-    sockAddrBth.btAddr = btAddr.ullLong;
-    sockAddrBth.serviceClassId = RFCOMM_PROTOCOL_UUID;  // Serial Port Profile
-    sockAddrBth.port = BT_PORT_ANY;  // Автоматический выбор порта
-    
+    // Шаг 2: Подключение (сокет AF_BTH создает RfcommTransport)
     if (logger) {
+        logger->info("Connection", "ШАГ 2: Инициация подключения");
         logger->debug("Connection", "Параметры:");
         logger->debug("Connection", "  • addressFamily: AF_BTH");
-        logger->debug("Connection", QString("  • btAddr: 0x%1").arg(btAddr.ullLong, 0, 16));
+        logger->debug("Connection", QString("  • btAddr: 0x%1").arg(btAddr, 0, 16));
         logger->debug("Connection", "  • serviceClassId: RFCOMM_PROTOCOL_UUID");
         logger->debug("Connection", "  • port: BT_PORT_ANY (автоматически)");
-        logger->debug("Connection", "");
-    }
-    
-    // Шаг 5: Подключение
-    if (logger) {
-        logger->info("Connection", "ШАГ 4: Инициация подключения");
         logger->warning("Connection", "⏱ Это может занять 5-30 секунд...");
-        logger->logApiCall("connect", QString("socket=0x%1, addr=%2")
-            .arg((quintptr)btSocket, 0, 16)
-            .arg(deviceAddress));
+        logger->logApiCall("connect", QString("addr=%1").arg(deviceAddress));
     }
     
-    int connectResult = ::connect(btSocket, (SOCKADDR*)&sockAddrBth, sizeof(sockAddrBth));
-    
-    if (connectResult == SOCKET_ERROR) {
-        QString error = getLastSocketError();
+    if (!transport.connectToDevice(deviceAddress, RfcommTransport::RfcommProtocol)) {
+        QString error = transport.lastError();
         
         if (logger) {
             logger->logApiResult("connect", QString("FAILED - %1").arg(error), false);
@@ -227,37 +102,18 @@ bool BluetoothConnection::connectToDevice(const QString &deviceAddress, const QS
             logger->warning("Connection", "");
         }
         
-        closesocket(btSocket);
-        btSocket = INVALID_SOCKET;
-        cleanupWinsock();
         emit connectionFailed(QString("Не удалось подключиться: %1").arg(error));
         return false;
     }
     
-    // Успех!
+    // Успех! Транспорт всегда неблокирующий - recv() не подвесит UI
     connected = true;
     connectedDeviceName = deviceName;
     connectedDeviceAddress = deviceAddress;
     
-    // КРИТИЧНО: Делаем сокет НЕБЛОКИРУЮЩИМ для предотвращения зависания UI!
-    u_long nonBlocking = 1;  // 1 = неблокирующий режим, 0 = блокирующий
-    int ioctlResult = ioctlsocket(btSocket, FIONBIO, &nonBlocking);
-    
-    if (ioctlResult == SOCKET_ERROR) {
-        int error = WSAGetLastError();
-        if (logger) {
-            logger->warning("Connection", QString("⚠ Не удалось установить неблокирующий режим: %1").arg(error));
-            logger->warning("Connection", "recv() будет блокирующим - возможно зависание UI!");
-        }
-    } else {
-        if (logger) {
-            logger->success("Connection", "✓ Сокет переведен в НЕБЛОКИРУЮЩИЙ режим");
-            logger->debug("Connection", "recv() не будет блокировать UI поток");
-        }
-    }
-    
     if (logger) {
         logger->logApiResult("connect", "SUCCESS - Подключено!", true);
+        logger->debug("Connection", QString("Socket handle: 0x%1").arg((quintptr)transport.socketDescriptor(), 0, 16));
         logger->success("Connection", "");
         logger->success("Connection", "✓✓✓ ПОДКЛЮЧЕНИЕ УСПЕШНО! ✓✓✓");
         logger->success("Connection", "");
@@ -273,14 +129,13 @@ bool BluetoothConnection::connectToDevice(const QString &deviceAddress, const QS
 
 void BluetoothConnection::disconnect()
 {
-    if (btSocket != INVALID_SOCKET) {
+    if (transport.isOpen()) {
         if (logger) {
             logger->info("Connection", "Закрытие соединения...");
-            logger->logApiCall("closesocket", QString("0x%1").arg((quintptr)btSocket, 0, 16));
+            logger->logApiCall("closesocket", QString("0x%1").arg((quintptr)transport.socketDescriptor(), 0, 16));
         }
         
-        closesocket(btSocket);
-        btSocket = INVALID_SOCKET;
+        transport.close();
         
         if (logger) {
             logger->logApiResult("closesocket", "SUCCESS", true);
@@ -296,7 +151,7 @@ void BluetoothConnection::disconnect()
 
 qint64 BluetoothConnection::sendData(const QByteArray &data)
 {
-    if (!connected || btSocket == INVALID_SOCKET) {
+    if (!connected || !transport.isOpen()) {
         if (logger) {
             logger->error("Connection", "Попытка отправки без подключения!");
         }
@@ -305,25 +160,23 @@ qint64 BluetoothConnection::sendData(const QByteArray &data)
     
     if (logger) {
         logger->debug("Connection", QString("Отправка %1 байт...").arg(data.size()));
-        logger->logApiCall("send", QString("socket=0x%1, size=%2").arg((quintptr)btSocket, 0, 16).arg(data.size()));
+        logger->logApiCall("send", QString("size=%1").arg(data.size()));
     }
     
-    int bytesSent = ::send(btSocket, data.constData(), data.size(), 0);
+    int bytesSent = transport.send(data.constData(), data.size());
     
-    if (bytesSent == SOCKET_ERROR) {
-        int error = WSAGetLastError();
-        
-        // WSAEWOULDBLOCK (10035) - буфер отправки полон, НЕ фатальная ошибка
-        if (error == WSAEWOULDBLOCK || error == 10035) {
-            if (logger) {
-                logger->logApiResult("send", "WOULD_BLOCK - Буфер полон", false);
-                logger->debug("Connection", "Буфер отправки полон, повторить позже");
-            }
-            return 0;  // Возвращаем 0 = "попробуй позже"
+    if (bytesSent == ByteTransport::WouldBlock) {
+        // Буфер отправки полон, НЕ фатальная ошибка
+        if (logger) {
+            logger->logApiResult("send", "WOULD_BLOCK - Буфер полон", false);
+            logger->debug("Connection", "Буфер отправки полон, повторить позже");
         }
-        
+        return 0;  // Возвращаем 0 = "попробуй позже"
+    }
+    
+    if (bytesSent < 0) {
         // Реальная ошибка
-        QString errorStr = getLastSocketError();
+        QString errorStr = transport.lastError();
         if (logger) {
             logger->logApiResult("send", QString("FAILED - %1").arg(errorStr), false);
             logger->error("Connection", QString("Ошибка отправки: %1").arg(errorStr));
@@ -341,7 +194,7 @@ qint64 BluetoothConnection::sendData(const QByteArray &data)
 
 QByteArray BluetoothConnection::receiveData(int maxSize)
 {
-    if (!connected || btSocket == INVALID_SOCKET) {
+    if (!connected || !transport.isOpen()) {
         return QByteArray();
     }
     
@@ -351,20 +204,16 @@ QByteArray BluetoothConnection::receiveData(int maxSize)
     // НЕ логируем вызов recv() каждый раз - слишком много записей
     // Логируем только когда есть данные или ошибки
     
-    int bytesReceived = ::recv(btSocket, buffer, bytesToRead, 0);
+    int bytesReceived = transport.receive(buffer, bytesToRead);
     
-    if (bytesReceived == SOCKET_ERROR) {
-        int error = WSAGetLastError();
-        
-        // WSAEWOULDBLOCK (10035) - это НОРМАЛЬНО для неблокирующего сокета
-        // Означает что данных пока нет, просто возвращаем пустой массив
-        if (error == WSAEWOULDBLOCK || error == 10035) {
-            // Данных пока нет - это не ошибка
-            return QByteArray();
-        }
-        
+    if (bytesReceived == ByteTransport::WouldBlock) {
+        // Данных пока нет - это НОРМАЛЬНО для неблокирующего сокета
+        return QByteArray();
+    }
+    
+    if (bytesReceived < 0) {
         // Реальная ошибка
-        QString errorStr = QString("Error %1").arg(error);
+        QString errorStr = transport.lastError();
         if (logger) {
             logger->logApiResult("recv", QString("FAILED - %1").arg(errorStr), false);
             logger->error("Connection", QString("Ошибка приема данных: %1").arg(errorStr));
@@ -382,43 +231,9 @@ QByteArray BluetoothConnection::receiveData(int maxSize)
     
     // Успешно получены данные - ТЕПЕРЬ логируем
     if (logger) {
-        logger->logApiCall("recv", QString("socket=0x%1, maxSize=%2").arg((quintptr)btSocket, 0, 16).arg(bytesToRead));
+        logger->logApiCall("recv", QString("maxSize=%1").arg(bytesToRead));
         logger->logApiResult("recv", QString("SUCCESS - Получено %1 байт").arg(bytesReceived), true);
     }
     
     return QByteArray(buffer, bytesReceived);
 }
-
-QString BluetoothConnection::getLastSocketError()
-{
-    int error = WSAGetLastError();
-    
-    QString errorMsg;
-    switch (error) {
-    case WSAETIMEDOUT:
-        errorMsg = "WSAETIMEDOUT (10060): Таймаут подключения";
-        break;
-    case WSAECONNREFUSED:
-        errorMsg = "WSAECONNREFUSED (10061): Подключение отклонено";
-        break;
-    case WSAEHOSTUNREACH:
-        errorMsg = "WSAEHOSTUNREACH (10065): Устройство недоступно";
-        break;
-    case WSAENOTCONN:
-        errorMsg = "WSAENOTCONN (10057): Сокет не подключен";
-        break;
-    case WSAENOTSOCK:
-        errorMsg = "WSAENOTSOCK (10038): Неверный сокет";
-        break;
-    default:
-        errorMsg = QString("WSA Error %1").arg(error);
-        break;
-    }
-    
-    if (logger) {
-        logger->debug("Connection", QString("WSAGetLastError(): 0x%1 - %2").arg(error, 0, 16).arg(errorMsg));
-    }
-    
-    return errorMsg;
-}
-
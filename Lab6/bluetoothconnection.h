@@ -2,10 +2,7 @@
 #define BLUETOOTHCONNECTION_H
 
 #include <QObject>
-#include <Windows.h>
-#include <winsock2.h>
-#include <ws2bth.h>
-#include <BluetoothAPIs.h>
+#include "bytetransport.h"
 
 class BluetoothLogger;
 
@@ -41,20 +38,13 @@ signals:
     
 private:
     BluetoothLogger *logger;
-    SOCKET btSocket;
+    RfcommTransport transport;
     bool connected;
     QString connectedDeviceName;
     QString connectedDeviceAddress;
     
-    // Инициализация Winsock
-    bool initializeWinsock();
-    void cleanupWinsock();
-    
     // Парсинг MAC адреса
-    bool parseMacAddress(const QString &address, BLUETOOTH_ADDRESS &btAddr);
-    
-    // Форматирование ошибок
-    QString getLastSocketError();
+    bool parseMacAddress(const QString &address, quint64 &btAddr);
 };
 
 #endif // BLUETOOTHCONNECTION_H
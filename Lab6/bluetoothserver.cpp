@@ -4,9 +4,15 @@
 #include <QFileInfo>
 #include <QDateTime>
 #include <QDir>
-#include <bthdef.h>  // Для системного RFCOMM_PROTOCOL_UUID
 
-// RFCOMM Protocol UUID для ПК-ПК передачи (используем системный RFCOMM_PROTOCOL_UUID)
+// Размер блока приема: данные пишутся в файл такими порциями
+static const int RECEIVE_BUFFER_SIZE = 64 * 1024;
+
+// Сколько ждать данных от клиента, прежде чем считать передачу оборванной, мс
+static const int RECEIVE_TIMEOUT_MS = 30000;
+
+// Период проверки флага остановки при ожидании, мс
+static const int STOP_CHECK_MS = 500;
 
 BluetoothServer::BluetoothServer(BluetoothLogger *logger, QObject *parent)
     : QObject(parent)
@@ -14,7 +20,7 @@ BluetoothServer::BluetoothServer(BluetoothLogger *logger, QObject *parent)
     , serverThread(nullptr)
     , running(false)
     , shouldStop(false)
-    , serverSocket(INVALID_SOCKET)
+    , tcpPort(0)
 {
 }
 
@@ -53,15 +59,10 @@ void BluetoothServer::stopServer()
 {
     if (!running) return;
     
+    // Цикл сервера проверяет флаг между ожиданиями (не реже STOP_CHECK_MS)
     shouldStop = true;
     running = false;
     
-    // Закрываем сокет если он открыт
-    if (serverSocket != INVALID_SOCKET) {
-        closesocket(serverSocket);
-        serverSocket = INVALID_SOCKET;
-    }
-    
     // Останавливаем поток
     if (serverThread && serverThread->isRunning()) {
         serverThread->quit();
@@ -78,95 +79,49 @@ void BluetoothServer::runServer()
     logger->info("Server", "═══════════════════════════════════════");
     logger->info("Server", "");
     
-    // Инициализация Winsock
-    if (!initWinsock()) {
-        logger->error("Server", "Ошибка инициализации Winsock");
-        emit transferFailed("Ошибка инициализации Winsock");
-        running = false;
-        return;
-    }
-    
-    // Создание серверного сокета
-    logger->info("Server", "ШАГ 1: Создание серверного сокета");
-    serverSocket = socket(AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM);
-    
-    if (serverSocket == INVALID_SOCKET) {
-        logger->error("Server", QString("Не удалось создать сокет: %1").arg(getLastSocketError()));
-        cleanupWinsock();
-        emit transferFailed("Не удалось создать серверный сокет");
-        running = false;
-        return;
-    }
-    
-    logger->success("Server", "✓ Серверный сокет создан");
-    logger->info("Server", "");
-    
-    // Настройка адреса сервера
-    logger->info("Server", "ШАГ 2: Настройка адреса сервера");
-    SOCKADDR_BTH serverAddress;
-    ZeroMemory(&serverAddress, sizeof(serverAddress));
-    serverAddress.addressFamily = AF_BTH;
-    serverAddress.port = 11;  // Стандартный порт для RFCOMM
-    serverAddress.serviceClassId = RFCOMM_PROTOCOL_UUID;
-    
-    logger->debug("Server", "Параметры сервера:");
-    logger->debug("Server", "  • addressFamily: AF_BTH");
-    logger->debug("Server", "  • port: 11");
-    logger->debug("Server", "  • serviceClassId: RFCOMM_PROTOCOL_UUID");
-    logger->info("Server", "");
-    
-    // Привязка сокета к адресу
-    logger->info("Server", "ШАГ 3: Привязка сокета к адресу");
-    if (bind(serverSocket, (SOCKADDR*)&serverAddress, sizeof(serverAddress)) == SOCKET_ERROR) {
-        logger->error("Server", QString("Ошибка привязки: %1").arg(getLastSocketError()));
-        closesocket(serverSocket);
-        serverSocket = INVALID_SOCKET;
-        cleanupWinsock();
-        emit transferFailed("Ошибка привязки сокета");
-        running = false;
-        return;
-    }
-    
-    logger->success("Server", "✓ Сокет привязан к адресу");
-    logger->info("Server", "");
+    SocketListener listener;
     
-    // Перевод сокета в режим прослушивания
-    logger->info("Server", "ШАГ 4: Запуск прослушивания");
-    if (listen(serverSocket, 1) == SOCKET_ERROR) {
-        logger->error("Server", QString("Ошибка запуска прослушивания: %1").arg(getLastSocketError()));
-        closesocket(serverSocket);
-        serverSocket = INVALID_SOCKET;
-        cleanupWinsock();
-        emit transferFailed("Ошибка запуска прослушивания");
-        running = false;
-        return;
+    if (tcpPort != 0) {
+        // TCP вместо Bluetooth: тот же прием файла без радиомодуля
+        logger->info("Server", "ШАГ 1: Запуск TCP сервера (замена RFCOMM)");
+        logger->debug("Server", QString("  • адрес: 127.0.0.1:%1").arg(tcpPort));
+        if (!listener.listenTcp(tcpPort)) {
+            logger->error("Server", QString("Ошибка запуска сервера: %1").arg(listener.lastError()));
+            emit transferFailed("Не удалось запустить TCP сервер");
+            running = false;
+            return;
+        }
+        logger->success("Server", "✓ Сервер запущен и ожидает подключений");
+        logger->info("Server", QString("Порт: %1 (TCP)").arg(listener.port()));
+    } else {
+        logger->info("Server", "ШАГ 1: Запуск RFCOMM сервера");
+        logger->debug("Server", "Параметры сервера:");
+        logger->debug("Server", "  • addressFamily: AF_BTH");
+        logger->debug("Server", QString("  • port: %1").arg(RfcommTransport::DirectTransferPort));
+        logger->debug("Server", "  • serviceClassId: RFCOMM_PROTOCOL_UUID");
+        if (!listener.listenRfcomm(RfcommTransport::DirectTransferPort)) {
+            logger->error("Server", QString("Ошибка запуска сервера: %1").arg(listener.lastError()));
+            emit transferFailed("Не удалось запустить Bluetooth сервер");
+            running = false;
+            return;
+        }
+        logger->success("Server", "✓ Сервер запущен и ожидает подключений");
+        logger->info("Server", QString("Порт: %1 (RFCOMM)").arg(listener.port()));
     }
     
-    logger->success("Server", "✓ Сервер запущен и ожидает подключений");
-    logger->info("Server", "Порт: 11 (RFCOMM)");
     logger->info("Server", "Готов к приему файлов...");
     logger->info("Server", "");
+    logger->info("Server", "⏳ Ожидание подключения клиента...");
     
     // Основной цикл сервера
     while (!shouldStop && running) {
-        logger->info("Server", "⏳ Ожидание подключения клиента...");
-        
         // Ожидание подключения клиента
-        SOCKET clientSocket = accept(serverSocket, NULL, NULL);
-        
-        if (clientSocket == INVALID_SOCKET) {
-            if (shouldStop) {
-                logger->info("Server", "Сервер остановлен");
-                break;
-            }
-            
-            int error = WSAGetLastError();
-            if (error == WSAEINTR) {
-                // Прервано сигналом - нормально при остановке
-                break;
+        SocketTransport client;
+        if (!listener.accept(client, STOP_CHECK_MS)) {
+            if (!listener.lastError().isEmpty()) {
+                logger->warning("Server", QString("Ошибка принятия соединения: %1").arg(listener.lastError()));
+                QThread::msleep(STOP_CHECK_MS);
             }
-            
-            logger->warning("Server", QString("Ошибка принятия соединения: %1").arg(error));
             continue;
         }
         
@@ -174,30 +129,26 @@ void BluetoothServer::runServer()
         logger->info("Server", "");
         
         // Принимаем файл от клиента
-        receiveFile(clientSocket);
+        receiveFile(&client);
         
         // Закрываем клиентский сокет
-        closesocket(clientSocket);
+        client.close();
         
         if (!shouldStop) {
             logger->info("Server", "Готов к следующему подключению...");
             logger->info("Server", "");
+            logger->info("Server", "⏳ Ожидание подключения клиента...");
         }
     }
     
     // Очистка ресурсов
-    if (serverSocket != INVALID_SOCKET) {
-        closesocket(serverSocket);
-        serverSocket = INVALID_SOCKET;
-    }
-    
-    cleanupWinsock();
+    listener.close();
     
     logger->info("Server", "Сервер остановлен");
     running = false;
 }
 
-void BluetoothServer::receiveFile(SOCKET clientSocket)
+bool BluetoothServer::receiveFile(ByteTransport *client)
 {
     logger->info("Server", "═══════════════════════════════════════");
     logger->info("Server", "ПРИЕМ ФАЙЛА ОТ КЛИЕНТА");
@@ -218,7 +169,7 @@ void BluetoothServer::receiveFile(SOCKET clientSocket)
     if (!file.open(QIODevice::WriteOnly)) {
         logger->error("Server", QString("Не удалось создать файл: %1").arg(file.errorString()));
         emit transferFailed("Не удалось создать файл для записи");
-        return;
+        return false;
     }
     
     logger->success("Server", "✓ Файл создан для записи");
@@ -227,26 +178,40 @@ void BluetoothServer::receiveFile(SOCKET clientSocket)
     // Прием данных
     logger->info("Server", "ШАГ 1: Прием данных от клиента");
     
-    const int bufferSize = 1024;
-    char buffer[bufferSize];
-    int totalReceived = 0;
+    QByteArray buffer(RECEIVE_BUFFER_SIZE, 0);
+    qint64 totalReceived = 0;
     int chunkNumber = 0;
+    int idleMs = 0;
     
     while (true) {
-        int bytesReceived = recv(clientSocket, buffer, bufferSize, 0);
+        int bytesReceived = client->receive(buffer.data(), buffer.size());
         
-        if (bytesReceived == SOCKET_ERROR) {
-            int error = WSAGetLastError();
-            if (error == WSAEWOULDBLOCK) {
-                // Нет данных пока - ждем
-                Sleep(10);
-                continue;
-            } else {
-                logger->error("Server", QString("Ошибка получения данных: %1").arg(error));
+        if (bytesReceived == ByteTransport::WouldBlock) {
+            // Нет данных пока - ждем их появления, проверяя остановку сервера
+            if (shouldStop) {
+                logger->warning("Server", "Прием прерван остановкой сервера");
                 file.close();
-                emit transferFailed("Ошибка получения данных");
-                return;
+                emit transferFailed("Прием прерван");
+                return false;
             }
+            if (!client->waitForReadable(STOP_CHECK_MS)) {
+                idleMs += STOP_CHECK_MS;
+                if (idleMs >= RECEIVE_TIMEOUT_MS) {
+                    logger->error("Server", "Таймаут: клиент перестал передавать данные");
+                    file.close();
+                    emit transferFailed("Таймаут приема данных");
+                    return false;
+                }
+            }
+            continue;
+        }
+        idleMs = 0;
+        
+        if (bytesReceived < 0) {
+            logger->error("Server", QString("Ошибка получения данных: %1").arg(client->lastError()));
+            file.close();
+            emit transferFailed("Ошибка получения данных");
+            return false;
         }
         
         if (bytesReceived == 0) {
@@ -256,19 +221,19 @@ void BluetoothServer::receiveFile(SOCKET clientSocket)
         }
         
         // Записываем полученные данные в файл
-        qint64 written = file.write(buffer, bytesReceived);
+        qint64 written = file.write(buffer.constData(), bytesReceived);
         if (written != bytesReceived) {
             logger->error("Server", "Ошибка записи в файл");
             file.close();
             emit transferFailed("Ошибка записи в файл");
-            return;
+            return false;
         }
         
         totalReceived += bytesReceived;
         chunkNumber++;
         
-        // Логируем прогресс каждые 10 блоков
-        if (chunkNumber % 10 == 0) {
+        // Логируем прогресс каждые 16 блоков
+        if (chunkNumber % 16 == 0) {
             logger->debug("Server", QString("Принято: %1 байт (блоков: %2)")
                 .arg(totalReceived).arg(chunkNumber));
             emit transferProgress(totalReceived, -1); // -1 означает неизвестный общий размер
@@ -287,49 +252,5 @@ void BluetoothServer::receiveFile(SOCKET clientSocket)
     
     emit fileReceived(fileName);
     emit transferCompleted(fileName);
-}
-
-bool BluetoothServer::initWinsock()
-{
-    WSADATA wsaData;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    
-    if (result != 0) {
-        if (logger) {
-            logger->error("Server", QString("Ошибка WSAStartup: %1").arg(result));
-        }
-        return false;
-    }
-    
-    if (logger) {
-        logger->debug("Server", "✓ Winsock инициализирован");
-    }
-    
     return true;
 }
-
-void BluetoothServer::cleanupWinsock()
-{
-    WSACleanup();
-    if (logger) {
-        logger->debug("Server", "✓ Winsock очищен");
-    }
-}
-
-QString BluetoothServer::getLastSocketError()
-{
-    int error = WSAGetLastError();
-    
-    switch (error) {
-    case WSAETIMEDOUT:
-        return QString("WSAETIMEDOUT (%1): Таймаут").arg(error);
-    case WSAECONNREFUSED:
-        return QString("WSAECONNREFUSED (%1): Подключение отклонено").arg(error);
-    case WSAEWOULDBLOCK:
-        return QString("WSAEWOULDBLOCK (%1): Операция заблокирована").arg(error);
-    case WSAEINTR:
-        return QString("WSAEINTR (%1): Прервано сигналом").arg(error);
-    default:
-        return QString("WSA Error %1").arg(error);
-    }
-}
@@ -4,8 +4,7 @@
 #include <QObject>
 #include <QThread>
 #include <QString>
-#include <winsock2.h>
-#include <ws2bth.h>
+#include "bytetransport.h"
 
 class BluetoothLogger;
 
@@ -27,6 +26,13 @@ public:
     // Проверка статуса сервера
     bool isRunning() const { return running; }
     
+    // Прием по TCP на 127.0.0.1 вместо RFCOMM (проверка без Bluetooth);
+    // 0 - RFCOMM. Задается до startServer()
+    void setTcpPort(quint16 port) { tcpPort = port; }
+    
+    // Прием одного файла из уже установленного соединения
+    bool receiveFile(ByteTransport *client);
+    
 signals:
     void serverStarted();
     void serverStopped();
@@ -43,17 +49,7 @@ private:
     QThread *serverThread;
     bool running;
     bool shouldStop;
-    SOCKET serverSocket;
-    
-    // Инициализация Winsock
-    bool initWinsock();
-    void cleanupWinsock();
-    
-    // Прием файла
-    void receiveFile(SOCKET clientSocket);
-    
-    // Получение ошибки сокета
-    QString getLastSocketError();
+    quint16 tcpPort;
 };
 
 #endif // BLUETOOTHSERVER_H
@@ -0,0 +1,578 @@
+#include "bytetransport.h"
+#include <QByteArray>
+#include <QStringList>
+#include <cstring>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2bth.h>
+#else
+#include <cerrno>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+typedef SOCKET NativeSocket;
+typedef int SocketLength;
+#else
+typedef int NativeSocket;
+typedef socklen_t SocketLength;
+#endif
+
+// INVALID_SOCKET (Winsock) и -1 (POSIX) в qintptr - одно и то же значение -1
+NativeSocket nativeSocket(qintptr handle)
+{
+    return (NativeSocket)handle;
+}
+
+int lastSocketError()
+{
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+bool isWouldBlock(int error)
+{
+#ifdef _WIN32
+    return error == WSAEWOULDBLOCK || error == WSAEINTR;
+#else
+    return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+#endif
+}
+
+QString socketErrorText(int error)
+{
+#ifdef _WIN32
+    switch (error) {
+    case WSAETIMEDOUT:
+        return QString("WSAETIMEDOUT (%1): Таймаут").arg(error);
+    case WSAECONNREFUSED:
+        return QString("WSAECONNREFUSED (%1): Подключение отклонено").arg(error);
+    case WSAECONNRESET:
+        return QString("WSAECONNRESET (%1): Соединение сброшено").arg(error);
+    case WSAEHOSTUNREACH:
+        return QString("WSAEHOSTUNREACH (%1): Устройство недоступно").arg(error);
+    case WSAENOTCONN:
+        return QString("WSAENOTCONN (%1): Сокет не подключен").arg(error);
+    default:
+        return QString("WSA Error %1").arg(error);
+    }
+#else
+    return QString("%1 (errno %2)").arg(QString::fromLocal8Bit(strerror(error))).arg(error);
+#endif
+}
+
+void closeSocket(qintptr handle)
+{
+#ifdef _WIN32
+    closesocket(nativeSocket(handle));
+#else
+    ::close(nativeSocket(handle));
+#endif
+}
+
+bool setNonBlocking(qintptr handle)
+{
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    return ioctlsocket(nativeSocket(handle), FIONBIO, &nonBlocking) == 0;
+#else
+    int flags = fcntl(nativeSocket(handle), F_GETFL, 0);
+    return flags != -1 && fcntl(nativeSocket(handle), F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+// Готовность сокета: > 0 - готов, 0 - таймаут, < 0 - ошибка
+int waitSocket(qintptr handle, bool write, int timeoutMs)
+{
+#ifdef _WIN32
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(nativeSocket(handle), &set);
+    timeval timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    return select(0, write ? NULL : &set, write ? &set : NULL, NULL, timeoutMs < 0 ? NULL : &timeout);
+#else
+    pollfd descriptor;
+    descriptor.fd = nativeSocket(handle);
+    descriptor.events = write ? POLLOUT : POLLIN;
+    descriptor.revents = 0;
+    int result;
+    do {
+        result = poll(&descriptor, 1, timeoutMs);
+    } while (result < 0 && errno == EINTR);
+    return result;
+#endif
+}
+
+// OBEX - запрос-ответ короткими пакетами: алгоритм Нейгла их задерживает
+void setNoDelay(qintptr handle)
+{
+    int noDelay = 1;
+    setsockopt(nativeSocket(handle), IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+}
+
+#ifdef _WIN32
+// UUID сервиса Bluetooth из 16-битного значения (Bluetooth Base UUID)
+GUID bluetoothUuid(quint16 serviceClass)
+{
+    GUID uuid = { serviceClass, 0x0000, 0x1000, { 0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB } };
+    return uuid;
+}
+#endif
+
+} // namespace
+
+bool ByteTransport::sendAll(const char *data, int size, int timeoutMs)
+{
+    int sent = 0;
+    while (sent < size) {
+        int result = send(data + sent, size - sent);
+        if (result == WouldBlock) {
+            if (!waitForWritable(timeoutMs)) {
+                return false;
+            }
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        sent += result;
+    }
+    return true;
+}
+
+int ByteTransport::receiveWait(char *data, int maxSize, int timeoutMs)
+{
+    int result;
+    while ((result = receive(data, maxSize)) == WouldBlock) {
+        if (!waitForReadable(timeoutMs)) {
+            return WouldBlock;
+        }
+    }
+    return result;
+}
+
+bool ByteTransport::finishSending(int timeoutMs)
+{
+    shutdownSend();
+    
+    // Все, что еще придет от другой стороны, не нужно
+    char buffer[256];
+    for (;;) {
+        int result = receiveWait(buffer, sizeof(buffer), timeoutMs);
+        if (result == 0) {
+            return true;
+        }
+        if (result < 0) {
+            return false;
+        }
+    }
+}
+
+SocketTransport::SocketTransport()
+    : handle(-1)
+{
+#ifdef _WIN32
+    // Winsock считает вызовы WSAStartup/WSACleanup, каждому транспорту - свой
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+SocketTransport::~SocketTransport()
+{
+    close();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+int SocketTransport::send(const char *data, int size)
+{
+    if (!isOpen()) {
+        fail("Соединение не установлено");
+        return -1;
+    }
+
+#ifdef MSG_NOSIGNAL
+    // Запись в закрытое соединение - ошибка, а не SIGPIPE
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    int result = (int)::send(nativeSocket(handle), data, size, flags);
+    if (result >= 0) {
+        return result;
+    }
+    
+    int error = lastSocketError();
+    if (isWouldBlock(error)) {
+        return WouldBlock;
+    }
+    fail(QString("Ошибка отправки: %1").arg(socketErrorText(error)));
+    return -1;
+}
+
+int SocketTransport::receive(char *data, int maxSize)
+{
+    if (!isOpen()) {
+        fail("Соединение не установлено");
+        return -1;
+    }
+    
+    int result = (int)::recv(nativeSocket(handle), data, maxSize, 0);
+    if (result >= 0) {
+        return result;
+    }
+    
+    int error = lastSocketError();
+    if (isWouldBlock(error)) {
+        return WouldBlock;
+    }
+    fail(QString("Ошибка приема: %1").arg(socketErrorText(error)));
+    return -1;
+}
+
+bool SocketTransport::waitForReadable(int timeoutMs)
+{
+    return waitFor(false, timeoutMs);
+}
+
+bool SocketTransport::waitForWritable(int timeoutMs)
+{
+    return waitFor(true, timeoutMs);
+}
+
+bool SocketTransport::isReadable()
+{
+    return isOpen() && waitSocket(handle, false, 0) > 0;
+}
+
+bool SocketTransport::waitFor(bool write, int timeoutMs)
+{
+    if (!isOpen()) {
+        return fail("Соединение не установлено");
+    }
+    
+    int result = waitSocket(handle, write, timeoutMs);
+    if (result == 0) {
+        return fail(QString("Таймаут ожидания (%1 сек)").arg(timeoutMs / 1000.0));
+    }
+    if (result < 0) {
+        return failWithSocketError("select");
+    }
+    return true;
+}
+
+void SocketTransport::shutdownSend()
+{
+    if (isOpen()) {
+#ifdef _WIN32
+        shutdown(nativeSocket(handle), SD_SEND);
+#else
+        shutdown(nativeSocket(handle), SHUT_WR);
+#endif
+    }
+}
+
+void SocketTransport::close()
+{
+    if (isOpen()) {
+        closeSocket(handle);
+        handle = -1;
+    }
+}
+
+bool SocketTransport::adopt(qintptr socketDescriptor)
+{
+    close();
+    errorString.clear();
+    handle = socketDescriptor;
+    
+    // Как и раньше для Bluetooth сокетов: без блокировок, ожидание - через select
+    if (!setNonBlocking(handle)) {
+        failWithSocketError("ioctlsocket(FIONBIO)");
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SocketTransport::createPair(SocketTransport &first, SocketTransport &second)
+{
+#ifdef _WIN32
+    // socketpair в Winsock нет: соединение с самим собой через 127.0.0.1
+    SocketListener listener;
+    if (!listener.listenTcp(0)) {
+        return first.fail(listener.lastError());
+    }
+    if (!first.connectTcp("127.0.0.1", listener.port())) {
+        return false;
+    }
+    if (!listener.accept(second, 5000)) {
+        first.close();
+        return first.fail(listener.lastError());
+    }
+    return true;
+#else
+    int descriptors[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, descriptors) != 0) {
+        return first.failWithSocketError("socketpair");
+    }
+    if (!first.adopt(descriptors[0])) {
+        closeSocket(descriptors[1]);
+        return false;
+    }
+    return second.adopt(descriptors[1]);
+#endif
+}
+
+bool SocketTransport::connectSocket(qintptr socketDescriptor, const void *address, int addressSize)
+{
+    // Подключение блокирующее (Bluetooth - 5-30 секунд), дальше сокет
+    // неблокирующий
+    if (::connect(nativeSocket(socketDescriptor), (const sockaddr*)address, addressSize) != 0) {
+        QString error = socketErrorText(lastSocketError());
+        closeSocket(socketDescriptor);
+        return fail(QString("Не удалось подключиться: %1").arg(error));
+    }
+    return adopt(socketDescriptor);
+}
+
+bool SocketTransport::connectTcp(const QString &host, quint16 port)
+{
+    close();
+    
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    
+    QByteArray hostName = host.toLatin1();
+    address.sin_addr.s_addr = inet_addr(hostName.constData());
+    if (address.sin_addr.s_addr == INADDR_NONE) {
+        hostent *entry = gethostbyname(hostName.constData());
+        if (!entry || entry->h_addrtype != AF_INET) {
+            return fail(QString("Не удалось найти узел %1").arg(host));
+        }
+        memcpy(&address.sin_addr, entry->h_addr_list[0], sizeof(address.sin_addr));
+    }
+    
+    qintptr socketDescriptor = (qintptr)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (socketDescriptor == -1) {
+        return failWithSocketError("socket");
+    }
+    setNoDelay(socketDescriptor);
+    return connectSocket(socketDescriptor, &address, sizeof(address));
+}
+
+bool SocketTransport::fail(const QString &error)
+{
+    errorString = error;
+    return false;
+}
+
+bool SocketTransport::failWithSocketError(const QString &operation)
+{
+    return fail(QString("%1: %2").arg(operation).arg(socketErrorText(lastSocketError())));
+}
+
+bool RfcommTransport::connectToDevice(const QString &address, quint16 serviceClass, int port)
+{
+    close();
+    
+    quint64 btAddr = 0;
+    if (!parseAddress(address, btAddr)) {
+        return fail("Неверный формат MAC адреса");
+    }
+
+#ifdef _WIN32
+    qintptr socketDescriptor = (qintptr)socket(AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM);
+    if (socketDescriptor == -1) {
+        return failWithSocketError("socket(AF_BTH)");
+    }
+    
+    SOCKADDR_BTH sockAddrBth;
+    ZeroMemory(&sockAddrBth, sizeof(sockAddrBth));
+    sockAddrBth.addressFamily = AF_BTH;
+    sockAddrBth.btAddr = btAddr;
+    sockAddrBth.serviceClassId = bluetoothUuid(serviceClass);
+    sockAddrBth.port = port == AnyPort ? BT_PORT_ANY : (ULONG)port;
+    return connectSocket(socketDescriptor, &sockAddrBth, sizeof(sockAddrBth));
+#else
+    Q_UNUSED(serviceClass);
+    Q_UNUSED(port);
+    return fail("Bluetooth RFCOMM доступен только в Windows (используйте TCP)");
+#endif
+}
+
+bool RfcommTransport::parseAddress(const QString &address, quint64 &btAddr)
+{
+    // Формат: XX:XX:XX:XX:XX:XX, старший байт первый
+    QStringList bytes = address.split(":");
+    if (bytes.size() != 6) {
+        return false;
+    }
+    
+    btAddr = 0;
+    for (int i = 0; i < 6; i++) {
+        bool ok;
+        uint byte = bytes[i].toUInt(&ok, 16);
+        if (!ok || byte > 0xFF) {
+            return false;
+        }
+        btAddr = (btAddr << 8) | byte;
+    }
+    return true;
+}
+
+SocketListener::SocketListener()
+    : handle(-1)
+    , boundPort(0)
+{
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+SocketListener::~SocketListener()
+{
+    close();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool SocketListener::listenTcp(quint16 port)
+{
+    close();
+    errorString.clear();
+    
+    handle = (qintptr)socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (handle == -1) {
+        return failWithSocketError("socket");
+    }
+
+#ifndef _WIN32
+    // Повторный запуск на том же порту сразу после остановки
+    int reuse = 1;
+    setsockopt(nativeSocket(handle), SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+#endif
+    // Принятые сокеты наследуют TCP_NODELAY от слушающего
+    setNoDelay(handle);
+    
+    // Только локальные соединения: это замена Bluetooth для тестов
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(nativeSocket(handle), (const sockaddr*)&address, sizeof(address)) != 0) {
+        return failWithSocketError("bind");
+    }
+    if (listen(nativeSocket(handle), 1) != 0) {
+        return failWithSocketError("listen");
+    }
+    
+    SocketLength length = sizeof(address);
+    if (getsockname(nativeSocket(handle), (sockaddr*)&address, &length) == 0) {
+        boundPort = ntohs(address.sin_port);
+    }
+    return true;
+}
+
+bool SocketListener::listenRfcomm(int port)
+{
+    close();
+    errorString.clear();
+
+#ifdef _WIN32
+    handle = (qintptr)socket(AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM);
+    if (handle == -1) {
+        return failWithSocketError("socket(AF_BTH)");
+    }
+    
+    SOCKADDR_BTH address;
+    ZeroMemory(&address, sizeof(address));
+    address.addressFamily = AF_BTH;
+    address.port = port;
+    address.serviceClassId = bluetoothUuid(RfcommTransport::RfcommProtocol);
+    if (bind(nativeSocket(handle), (const sockaddr*)&address, sizeof(address)) == SOCKET_ERROR) {
+        return failWithSocketError("bind");
+    }
+    if (listen(nativeSocket(handle), 1) == SOCKET_ERROR) {
+        return failWithSocketError("listen");
+    }
+    boundPort = (quint16)port;
+    return true;
+#else
+    Q_UNUSED(port);
+    return fail("Bluetooth RFCOMM доступен только в Windows (используйте TCP)");
+#endif
+}
+
+bool SocketListener::accept(SocketTransport &client, int timeoutMs)
+{
+    errorString.clear();
+    if (!isListening()) {
+        return fail("Сервер не запущен");
+    }
+    
+    // Ожидание с таймаутом вместо блокирующего accept: сервер проверяет
+    // флаг остановки между ожиданиями
+    int ready = waitSocket(handle, false, timeoutMs);
+    if (ready == 0) {
+        return false;
+    }
+    if (ready < 0) {
+        return failWithSocketError("select");
+    }
+    
+    qintptr socketDescriptor = (qintptr)::accept(nativeSocket(handle), NULL, NULL);
+    if (socketDescriptor == -1) {
+        int error = lastSocketError();
+        if (isWouldBlock(error)) {
+            return false;
+        }
+        return fail(QString("accept: %1").arg(socketErrorText(error)));
+    }
+    if (!client.adopt(socketDescriptor)) {
+        return fail(client.lastError());
+    }
+    return true;
+}
+
+void SocketListener::close()
+{
+    if (isListening()) {
+        closeSocket(handle);
+        handle = -1;
+        boundPort = 0;
+    }
+}
+
+bool SocketListener::fail(const QString &error)
+{
+    errorString = error;
+    return false;
+}
+
+bool SocketListener::failWithSocketError(const QString &operation)
+{
+    QString error = QString("%1: %2").arg(operation).arg(socketErrorText(lastSocketError()));
+    close();
+    return fail(error);
+}
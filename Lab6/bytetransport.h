@@ -0,0 +1,150 @@
+#ifndef BYTETRANSPORT_H
+#define BYTETRANSPORT_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Поток байтов между двумя сторонами. Протокольный код (OBEX, прямая
+// передача файла по RFCOMM) работает только через этот интерфейс, поэтому
+// тот же код идет и по Bluetooth, и по TCP, и через пару сокетов внутри
+// одного процесса (тесты и бенчмарки без Bluetooth адаптера)
+class ByteTransport
+{
+public:
+    enum {
+        WouldBlock = -2     // send/receive: буфер полон / данных пока нет
+    };
+    
+    virtual ~ByteTransport() {}
+    
+    virtual bool isOpen() const = 0;
+    
+    // Неблокирующие операции. Результат: > 0 - передано байт,
+    // 0 - (receive) другая сторона закрыла соединение, -1 - ошибка,
+    // WouldBlock - нужно дождаться готовности
+    virtual int send(const char *data, int size) = 0;
+    virtual int receive(char *data, int maxSize) = 0;
+    
+    // Ожидание готовности без опроса; false - таймаут или ошибка
+    virtual bool waitForReadable(int timeoutMs) = 0;
+    virtual bool waitForWritable(int timeoutMs) = 0;
+    
+    // Есть ли что прочитать прямо сейчас (данные или закрытие соединения).
+    // Проверка без ожидания: "нет данных" не считается ошибкой и не меняет
+    // lastError
+    virtual bool isReadable() = 0;
+    
+    // Данных больше не будет: другая сторона получит 0 из receive
+    virtual void shutdownSend() = 0;
+    virtual void close() = 0;
+    
+    virtual QString lastError() const = 0;
+    
+    // Отправка всего буфера; timeoutMs - наибольшее ожидание готовности
+    bool sendAll(const char *data, int size, int timeoutMs);
+    
+    // Прием с ожиданием данных до timeoutMs. Результат как у receive,
+    // WouldBlock - таймаут
+    int receiveWait(char *data, int maxSize, int timeoutMs);
+    
+    // Завершение передачи: shutdownSend и ожидание, пока другая сторона
+    // дочитает данные и закроет соединение
+    bool finishSending(int timeoutMs);
+};
+
+// Транспорт поверх потокового сокета (Winsock или POSIX). Сокет всегда
+// неблокирующий. Сам по себе - пара сокетов и принятые соединения
+class SocketTransport : public ByteTransport
+{
+public:
+    SocketTransport();
+    ~SocketTransport();
+    
+    bool isOpen() const override { return handle != -1; }
+    int send(const char *data, int size) override;
+    int receive(char *data, int maxSize) override;
+    bool waitForReadable(int timeoutMs) override;
+    bool waitForWritable(int timeoutMs) override;
+    bool isReadable() override;
+    void shutdownSend() override;
+    void close() override;
+    QString lastError() const override { return errorString; }
+    
+    // Передача уже подключенного сокета во владение транспорта
+    bool adopt(qintptr socketDescriptor);
+    qintptr socketDescriptor() const { return handle; }
+    
+    // Два соединенных между собой транспорта в одном процессе
+    // (socketpair, в Windows - соединение через 127.0.0.1)
+    static bool createPair(SocketTransport &first, SocketTransport &second);
+    
+protected:
+    bool fail(const QString &error);
+    bool failWithSocketError(const QString &operation);
+    bool waitFor(bool write, int timeoutMs);
+    bool connectSocket(qintptr socketDescriptor, const void *address, int addressSize);
+    bool connectTcp(const QString &host, quint16 port);
+    
+    qintptr handle;
+    QString errorString;
+};
+
+// TCP: замена Bluetooth для прогона протоколов между процессами
+class TcpTransport : public SocketTransport
+{
+public:
+    bool connectToHost(const QString &host, quint16 port) { return connectTcp(host, port); }
+};
+
+// Bluetooth RFCOMM (Winsock AF_BTH). Сервис задается 16-битным UUID на
+// основе Bluetooth Base UUID. На других платформах подключение
+// возвращает ошибку
+class RfcommTransport : public SocketTransport
+{
+public:
+    enum Service {
+        RfcommProtocol = 0x0003,    // RFCOMM_PROTOCOL_UUID: передача ПК-ПК
+        ObexObjectPush = 0x1105     // OBEX Object Push (телефоны)
+    };
+    
+    enum {
+        AnyPort = -1,               // порт по SDP
+        DirectTransferPort = 11     // сервер приема ПК-ПК (BluetoothServer)
+    };
+    
+    bool connectToDevice(const QString &address, quint16 serviceClass, int port = AnyPort);
+    
+    // Разбор адреса вида XX:XX:XX:XX:XX:XX в 48-битное значение
+    static bool parseAddress(const QString &address, quint64 &btAddr);
+};
+
+// Прием входящих соединений (TCP на 127.0.0.1 или RFCOMM)
+class SocketListener
+{
+public:
+    SocketListener();
+    ~SocketListener();
+    
+    // port 0 - любой свободный, см. port()
+    bool listenTcp(quint16 port);
+    bool listenRfcomm(int port);
+    
+    // Ожидание соединения до timeoutMs; false и пустой lastError() -
+    // таймаут
+    bool accept(SocketTransport &client, int timeoutMs);
+    
+    bool isListening() const { return handle != -1; }
+    quint16 port() const { return boundPort; }
+    void close();
+    QString lastError() const { return errorString; }
+    
+private:
+    bool fail(const QString &error);
+    bool failWithSocketError(const QString &operation);
+    
+    qintptr handle;
+    quint16 boundPort;
+    QString errorString;
+};
+
+#endif // BYTETRANSPORT_H
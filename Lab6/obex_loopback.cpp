@@ -0,0 +1,418 @@
+// Прогон передачи файла без Bluetooth адаптера.
+// ObexFileSender и BluetoothServer работают через ByteTransport, поэтому
+// тот же код протокола идет по паре сокетов в одном процессе или по TCP
+// между двумя процессами (в том числе в Linux). Принимающая сторона:
+//  - obex: минимальный OBEX сервер (CONNECT с Maximum Packet Length,
+//    CONTINUE/SUCCESS на PUT, Single Response Mode, DISCONNECT), данные
+//    Body не сохраняются;
+//  - raw: BluetoothServer::receiveFile, как прием ПК-ПК по RFCOMM.
+// Отправляется файл из псевдослучайных байт; принятые данные сверяются
+// по контрольной сумме. Выводится скорость, МБ/с.
+//
+// Запуск:
+//   obex_loopback [--mode obex|raw] [--size МБ] [--packet байт]
+//                 [--no-srm] [--refuse-srm] [--delay мс]
+//   obex_loopback --listen ПОРТ [--mode ...] [--packet ...]   (прием)
+//   obex_loopback --connect ХОСТ:ПОРТ [--mode ...] [--size ...] (отправка)
+// --no-srm - отправитель не запрашивает SRM, --refuse-srm - сервер его не
+// поддерживает (проверка перехода к ответу на каждый пакет), --delay МС -
+// задержка каждого ответа OBEX сервера (время ответа телефона по Bluetooth).
+// Подробный ход передачи - в логах BluetoothLogger.
+
+#include "obexfilesender.h"
+#include "obexframeparser.h"
+#include "bluetoothserver.h"
+#include "bluetoothlogger.h"
+#include "bytetransport.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QThread>
+#include <cstdio>
+
+static const int IO_TIMEOUT_MS = 30000;
+
+// Сколько места под прием выделять в буфере парсера
+static const int RECEIVE_CHUNK_SIZE = 64 * 1024;
+
+// FNV-1a: сверка отправленного и принятого без хранения данных
+static quint64 checksum(quint64 hash, const char *data, qint64 size)
+{
+    for (qint64 i = 0; i < size; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static const quint64 CHECKSUM_INIT = 14695981039346656037ULL;
+
+struct ReceiverOptions
+{
+    bool obex;
+    quint16 maxPacketLength;
+    bool allowSrm;
+    int responseDelayMs;
+};
+
+struct ReceiveResult
+{
+    bool ok;
+    qint64 bytes;
+    quint64 checksum;
+    int packets;
+    QString error;
+};
+
+// Следующий пакет клиента: прием прямо в буфер парсера, пока пакет не
+// соберется целиком
+static bool receiveFrame(ByteTransport *transport, ObexFrameParser &parser, QString &error)
+{
+    while (true) {
+        ObexFrameParser::Status status = parser.next();
+        if (status == ObexFrameParser::FrameReady) {
+            return true;
+        }
+        if (status == ObexFrameParser::InvalidFrame) {
+            error = parser.errorString();
+            return false;
+        }
+        char *buffer = parser.receiveBuffer(RECEIVE_CHUNK_SIZE);
+        int received = transport->receiveWait(buffer, parser.receiveSpace(), IO_TIMEOUT_MS);
+        if (received <= 0) {
+            error = received == 0 ? "соединение закрыто до DISCONNECT" : "пакет не принят";
+            return false;
+        }
+        parser.commit(received);
+    }
+}
+
+static bool sendResponse(ByteTransport *transport, int delayMs, unsigned char code, const QByteArray &fields = QByteArray())
+{
+    if (delayMs > 0) {
+        QThread::msleep(delayMs);
+    }
+    QByteArray response;
+    response.append((char)code);
+    quint16 length = 3 + fields.size();
+    response.append((char)(length >> 8));
+    response.append((char)(length & 0xFF));
+    response.append(fields);
+    return transport->sendAll(response.constData(), response.size(), IO_TIMEOUT_MS);
+}
+
+// OBEX сервер Object Push в минимальном объеме: CONNECT, PUT, DISCONNECT
+static ReceiveResult serveObex(ByteTransport *transport, const ReceiverOptions &options)
+{
+    const quint16 maxPacketLength = options.maxPacketLength;
+    const int delayMs = options.responseDelayMs;
+    ReceiveResult result = { false, 0, CHECKSUM_INIT, 0, QString() };
+    ObexFrameParser parser(maxPacketLength);
+    bool srmActive = false;
+    
+    while (true) {
+        if (!receiveFrame(transport, parser, result.error)) {
+            return result;
+        }
+        unsigned char opcode = parser.code();
+        result.packets++;
+        
+        if (opcode == OBEX_CONNECT) {
+            // Версия, флаги, Maximum Packet Length, Connection ID
+            QByteArray fields;
+            fields.append((char)0x10);
+            fields.append((char)0x00);
+            fields.append((char)(maxPacketLength >> 8));
+            fields.append((char)(maxPacketLength & 0xFF));
+            fields.append((char)OBEX_HDR_CONNECTION);
+            fields.append(QByteArray("\0\0\0\1", 4));
+            if (!sendResponse(transport, delayMs, OBEX_RSP_SUCCESS, fields)) break;
+        } else if (opcode == OBEX_PUT || opcode == OBEX_PUT_FINAL) {
+            if (!parser.parseHeaders()) {
+                result.error = parser.errorString();
+                return result;
+            }
+            bool srmRequested = false;
+            for (int i = 0; i < parser.headerCount(); ++i) {
+                const ObexHeader &header = parser.header(i);
+                if (header.id == OBEX_HDR_SRM && header.toByte() == OBEX_SRM_ENABLE) {
+                    srmRequested = true;
+                }
+                if (header.id == OBEX_HDR_BODY || header.id == OBEX_HDR_END_OF_BODY) {
+                    result.checksum = checksum(result.checksum, header.data, header.size);
+                    result.bytes += header.size;
+                }
+            }
+            if (opcode == OBEX_PUT_FINAL) {
+                srmActive = false;
+                if (!sendResponse(transport, delayMs, OBEX_RSP_SUCCESS)) break;
+            } else if (srmRequested && options.allowSrm && !srmActive) {
+                // Подтверждение SRM; дальше ответ только на PUT FINAL
+                srmActive = true;
+                QByteArray fields;
+                fields.append((char)OBEX_HDR_SRM);
+                fields.append((char)OBEX_SRM_ENABLE);
+                if (!sendResponse(transport, delayMs, OBEX_RSP_CONTINUE, fields)) break;
+            } else if (!srmActive) {
+                if (!sendResponse(transport, delayMs, OBEX_RSP_CONTINUE)) break;
+            }
+        } else if (opcode == OBEX_DISCONNECT) {
+            sendResponse(transport, delayMs, OBEX_RSP_SUCCESS);
+            result.ok = true;
+            return result;
+        } else {
+            if (!sendResponse(transport, delayMs, OBEX_RSP_BAD_REQUEST)) break;
+        }
+    }
+    
+    result.error = QString("ошибка отправки ответа: %1").arg(transport->lastError());
+    return result;
+}
+
+// Прием тем же кодом, что и сервер ПК-ПК; файл сверяется и удаляется
+static ReceiveResult serveRaw(ByteTransport *transport, BluetoothLogger *logger)
+{
+    ReceiveResult result = { false, 0, CHECKSUM_INIT, 0, QString() };
+    BluetoothServer server(logger);
+    QString fileName;
+    QObject::connect(&server, &BluetoothServer::fileReceived,
+                     [&fileName](const QString &name) { fileName = name; });
+    
+    bool received = server.receiveFile(transport);
+    transport->close();
+    if (!received || fileName.isEmpty()) {
+        result.error = "BluetoothServer::receiveFile завершился ошибкой";
+        return result;
+    }
+    
+    QFile file(QDir::currentPath() + "/" + fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.error = QString("принятый файл не открывается: %1").arg(file.errorString());
+        return result;
+    }
+    QByteArray buffer(1024 * 1024, 0);
+    qint64 read;
+    while ((read = file.read(buffer.data(), buffer.size())) > 0) {
+        result.checksum = checksum(result.checksum, buffer.constData(), read);
+        result.bytes += read;
+    }
+    file.remove();
+    result.ok = true;
+    return result;
+}
+
+static ReceiveResult serve(ByteTransport *transport, const ReceiverOptions &options, BluetoothLogger *logger)
+{
+    if (options.obex) {
+        ReceiveResult result = serveObex(transport, options);
+        transport->close();
+        return result;
+    }
+    return serveRaw(transport, logger);
+}
+
+// Прием в отдельном потоке при прогоне внутри одного процесса
+class ReceiverThread : public QThread
+{
+public:
+    ReceiverThread(ByteTransport *transport, const ReceiverOptions &options, BluetoothLogger *logger)
+        : transport(transport), options(options), logger(logger)
+    {
+        result.ok = false;
+    }
+    
+    ReceiveResult result;
+    
+protected:
+    void run() override
+    {
+        result = serve(transport, options, logger);
+    }
+    
+private:
+    ByteTransport *transport;
+    ReceiverOptions options;
+    BluetoothLogger *logger;
+};
+
+// Тестовый файл из псевдослучайных байт
+static bool createTestFile(const QString &path, qint64 size, quint64 &sum)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    sum = CHECKSUM_INIT;
+    QByteArray block(1024 * 1024, 0);
+    quint32 seed = 12345;
+    for (qint64 written = 0; written < size; written += block.size()) {
+        for (int i = 0; i < block.size(); ++i) {
+            seed = seed * 1103515245u + 12345u;
+            block[i] = (char)(seed >> 16);
+        }
+        qint64 chunk = qMin<qint64>(block.size(), size - written);
+        sum = checksum(sum, block.constData(), chunk);
+        if (file.write(block.constData(), chunk) != chunk) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool sendFile(ByteTransport *transport, bool obex, bool srm, const QString &path, BluetoothLogger *logger)
+{
+    ObexFileSender sender(logger);
+    sender.setSingleResponseMode(srm);
+    bool ok = obex ? sender.sendFileOverObex(path, transport)
+                   : sender.sendFileRaw(path, transport);
+    transport->close();
+    return ok;
+}
+
+static int report(const char *mode, qint64 size, qint64 elapsedMs, bool sent, quint64 expected, const ReceiveResult &received)
+{
+    double seconds = qMax<qint64>(elapsedMs, 1) / 1000.0;
+    std::printf("obex_loopback: %s, %lld bytes, %.2f s, %.1f MB/s\n",
+                mode, (long long)size, seconds, size / 1024.0 / 1024.0 / seconds);
+    if (!sent) {
+        std::fprintf(stderr, "obex_loopback: sender failed\n");
+        return 1;
+    }
+    if (!received.ok) {
+        std::fprintf(stderr, "obex_loopback: receiver failed: %s\n", received.error.toLocal8Bit().constData());
+        return 1;
+    }
+    if (received.bytes != size || received.checksum != expected) {
+        std::fprintf(stderr, "obex_loopback: data mismatch (received %lld bytes)\n", (long long)received.bytes);
+        return 1;
+    }
+    std::printf("obex_loopback: data verified\n");
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    
+    bool obex = true;
+    qint64 sizeMb = 64;
+    int maxPacketLength = OBEX_MAX_PACKET_LENGTH;
+    bool srm = true;
+    bool allowSrm = true;
+    int delayMs = 0;
+    int listenPort = -1;
+    QString connectHost;
+    quint16 connectPort = 0;
+    const QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i] == "--mode" && i + 1 < args.size()) {
+            const QString mode = args[++i];
+            if (mode != "obex" && mode != "raw") {
+                std::fprintf(stderr, "obex_loopback: --mode must be obex or raw\n");
+                return 2;
+            }
+            obex = (mode == "obex");
+        } else if (args[i] == "--size" && i + 1 < args.size()) {
+            sizeMb = qMax(0, args[++i].toInt());
+        } else if (args[i] == "--packet" && i + 1 < args.size()) {
+            maxPacketLength = qBound(OBEX_MIN_PACKET_LENGTH, args[++i].toInt(), OBEX_MAX_PACKET_LENGTH);
+        } else if (args[i] == "--no-srm") {
+            srm = false;
+        } else if (args[i] == "--refuse-srm") {
+            allowSrm = false;
+        } else if (args[i] == "--delay" && i + 1 < args.size()) {
+            delayMs = qMax(0, args[++i].toInt());
+        } else if (args[i] == "--listen" && i + 1 < args.size()) {
+            listenPort = args[++i].toUInt();
+        } else if (args[i] == "--connect" && i + 1 < args.size()) {
+            const QStringList parts = args[++i].split(':');
+            connectHost = parts[0];
+            connectPort = parts.size() > 1 ? parts[1].toUInt() : 0;
+        } else {
+            std::fprintf(stderr, "usage: obex_loopback [--mode obex|raw] [--size MB] [--packet bytes] "
+                                 "[--no-srm] [--refuse-srm] [--delay ms] [--listen PORT | --connect HOST:PORT]\n");
+            return 2;
+        }
+    }
+    
+    const char *mode = obex ? (srm && allowSrm ? "obex+srm" : "obex") : "raw";
+    const ReceiverOptions options = { obex, (quint16)maxPacketLength, allowSrm, delayMs };
+    BluetoothLogger logger;
+    
+    // Прием во втором процессе
+    if (listenPort >= 0) {
+        SocketListener listener;
+        if (!listener.listenTcp(listenPort)) {
+            std::fprintf(stderr, "obex_loopback: %s\n", listener.lastError().toLocal8Bit().constData());
+            return 1;
+        }
+        std::printf("obex_loopback: listening on 127.0.0.1:%u (%s)\n", listener.port(), mode);
+        std::fflush(stdout);
+        
+        SocketTransport client;
+        while (!listener.accept(client, 1000)) {
+            if (!listener.lastError().isEmpty()) {
+                std::fprintf(stderr, "obex_loopback: %s\n", listener.lastError().toLocal8Bit().constData());
+                return 1;
+            }
+        }
+        ReceiveResult result = serve(&client, options, &logger);
+        if (!result.ok) {
+            std::fprintf(stderr, "obex_loopback: receiver failed: %s\n", result.error.toLocal8Bit().constData());
+            return 1;
+        }
+        std::printf("obex_loopback: received %lld bytes, checksum %016llx\n",
+                    (long long)result.bytes, (unsigned long long)result.checksum);
+        return 0;
+    }
+    
+    const QString path = QDir::temp().filePath("obex_loopback.bin");
+    const qint64 size = sizeMb * 1024 * 1024;
+    quint64 expected = 0;
+    if (!createTestFile(path, size, expected)) {
+        std::fprintf(stderr, "obex_loopback: cannot create %s\n", path.toLocal8Bit().constData());
+        return 1;
+    }
+    
+    int status;
+    if (!connectHost.isEmpty()) {
+        // Отправка в другой процесс; проверку данных делает он
+        TcpTransport transport;
+        if (!transport.connectToHost(connectHost, connectPort)) {
+            std::fprintf(stderr, "obex_loopback: %s\n", transport.lastError().toLocal8Bit().constData());
+            QFile::remove(path);
+            return 1;
+        }
+        QElapsedTimer timer;
+        timer.start();
+        bool sent = sendFile(&transport, obex, srm, path, &logger);
+        double seconds = qMax<qint64>(timer.elapsed(), 1) / 1000.0;
+        std::printf("obex_loopback: %s, %lld bytes, %.2f s, %.1f MB/s, checksum %016llx\n",
+                    mode, (long long)size, seconds, size / 1024.0 / 1024.0 / seconds,
+                    (unsigned long long)expected);
+        status = sent ? 0 : 1;
+    } else {
+        // Обе стороны в одном процессе
+        SocketTransport senderSide;
+        SocketTransport receiverSide;
+        if (!SocketTransport::createPair(senderSide, receiverSide)) {
+            std::fprintf(stderr, "obex_loopback: %s\n", senderSide.lastError().toLocal8Bit().constData());
+            QFile::remove(path);
+            return 1;
+        }
+        ReceiverThread receiver(&receiverSide, options, &logger);
+        QElapsedTimer timer;
+        timer.start();
+        receiver.start();
+        bool sent = sendFile(&senderSide, obex, srm, path, &logger);
+        receiver.wait();
+        status = report(mode, size, timer.elapsed(), sent, expected, receiver.result);
+    }
+    
+    QFile::remove(path);
+    std::printf("obex_loopback: log %s\n", logger.getLogFilePath().toLocal8Bit().constData());
+    return status;
+}
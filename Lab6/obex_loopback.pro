@@ -0,0 +1,27 @@
+QT += core
+QT -= gui
+
+TARGET = obex_loopback
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += \
+    obex_loopback.cpp \
+    obexfilesender.cpp \
+    obexframeparser.cpp \
+    bluetoothserver.cpp \
+    bluetoothlogger.cpp \
+    bytetransport.cpp
+
+HEADERS += \
+    obexfilesender.h \
+    obexframeparser.h \
+    bluetoothserver.h \
+    bluetoothlogger.h \
+    bytetransport.h
+
+win32: LIBS += -lws2_32
+
+CONFIG += release
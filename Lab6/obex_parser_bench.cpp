@@ -0,0 +1,418 @@
+// Бенчмарк и fuzz-проверка ObexFrameParser.
+//
+// Бенчмарк: поток OBEX пакетов (PUT по 64 КБ с Body, короткие ответы
+// CONTINUE/SUCCESS, ответ CONNECT с заголовками) подается в парсер
+// порциями разного размера - как их отдает recv(): по 7 байт, по MTU,
+// по 64 КБ и целиком. Для каждого размера выводится скорость разбора
+// (МБ/с) и пакетов в секунду, с разбором заголовков.
+//
+// Fuzz (--fuzz N): N случайных потоков.
+//  - Корректные пакеты со случайными заголовками всех четырех форматов,
+//    порезанные на случайные части (от 1 байта до нескольких пакетов
+//    сразу): каждый пакет и каждый заголовок должен выйти без изменений.
+//  - Те же потоки с испорченными байтами: парсер не должен выходить за
+//    границы буфера, выдавать пакет неверной длины или продолжать после
+//    InvalidFrame.
+// Код возврата 1 - найдено расхождение (выводится seed для повтора).
+//
+// Запуск: obex_parser_bench [--seconds N] [--fuzz N] [--seed S]
+
+#include "obexframeparser.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QVector>
+#include <cstdio>
+#include <cstring>
+
+// Воспроизводимый генератор для fuzz: один seed - один и тот же поток
+class Random
+{
+public:
+    explicit Random(quint64 seed) : state(seed * 2862933555777941757ULL + 3037000493ULL) {}
+    
+    quint32 next()
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (quint32)(state >> 33);
+    }
+    
+    // [0, bound)
+    int below(int bound) { return bound > 0 ? (int)(next() % (quint32)bound) : 0; }
+    
+private:
+    quint64 state;
+};
+
+struct GeneratedHeader
+{
+    quint8 id;
+    int offset;     // Значение: смещение в пакете и размер
+    int size;
+};
+
+struct GeneratedFrame
+{
+    int offset;     // Смещение пакета в потоке
+    int length;
+    QVector<GeneratedHeader> headers;
+};
+
+static void appendUInt16(QByteArray &data, int value)
+{
+    data.append((char)((value >> 8) & 0xFF));
+    data.append((char)(value & 0xFF));
+}
+
+// Случайный корректный пакет длиной не больше maxLength в конец потока
+static void generateFrame(Random &random, int maxLength, QByteArray &stream, QVector<GeneratedFrame> &frames)
+{
+    GeneratedFrame frame;
+    frame.offset = stream.size();
+    
+    stream.append((char)random.next());
+    appendUInt16(stream, 0);
+    
+    int budget = 3 + random.below(maxLength - 2);
+    int length = 3;
+    while (length < budget) {
+        static const quint8 encodings[] = { 0x00, 0x40, 0x80, 0xC0 };
+        quint8 id = encodings[random.below(4)] | (quint8)random.below(0x40);
+        int room = budget - length;
+        
+        GeneratedHeader header;
+        header.id = id;
+        int valueOffset;
+        if ((id & 0xC0) == 0x80) {
+            valueOffset = 1;
+            header.size = 1;
+        } else if ((id & 0xC0) == 0xC0) {
+            valueOffset = 1;
+            header.size = 4;
+        } else {
+            valueOffset = 3;
+            // Чаще короткие заголовки, иногда на весь остаток пакета
+            int maxSize = room - 3;
+            header.size = random.below(4) == 0 ? maxSize : random.below(qMin(maxSize, 64) + 1);
+        }
+        if (header.size < 0 || valueOffset + header.size > room) {
+            break;
+        }
+        
+        stream.append((char)id);
+        if (valueOffset == 3) {
+            appendUInt16(stream, header.size + 3);
+        }
+        header.offset = length + valueOffset;
+        for (int i = 0; i < header.size; ++i) {
+            stream.append((char)random.next());
+        }
+        length += valueOffset + header.size;
+        frame.headers.append(header);
+    }
+    
+    frame.length = length;
+    stream[frame.offset + 1] = (char)((length >> 8) & 0xFF);
+    stream[frame.offset + 2] = (char)(length & 0xFF);
+    frames.append(frame);
+}
+
+// Размер очередной порции: от 1 байта до нескольких пакетов
+static int chunkSize(Random &random)
+{
+    switch (random.below(4)) {
+    case 0: return 1 + random.below(8);
+    case 1: return 1 + random.below(512);
+    case 2: return 1 + random.below(8192);
+    default: return 1 + random.below(200000);
+    }
+}
+
+static bool fuzzValid(quint64 seed)
+{
+    Random random(seed);
+    int maxLength = random.below(2) ? ObexFrameParser::MaxFrameLength : 3 + random.below(1024);
+    
+    QByteArray stream;
+    QVector<GeneratedFrame> frames;
+    int frameCount = 1 + random.below(64);
+    for (int i = 0; i < frameCount; ++i) {
+        generateFrame(random, maxLength, stream, frames);
+    }
+    
+    ObexFrameParser parser(maxLength);
+    int fed = 0;
+    int parsed = 0;
+    while (parsed < frames.size()) {
+        ObexFrameParser::Status status = parser.next();
+        if (status == ObexFrameParser::InvalidFrame) {
+            std::fprintf(stderr, "fuzz seed %llu: valid frame %d rejected: %s\n", (unsigned long long)seed,
+                         parsed, parser.errorString().toLocal8Bit().constData());
+            return false;
+        }
+        if (status == ObexFrameParser::NeedMoreData) {
+            if (fed == stream.size()) {
+                std::fprintf(stderr, "fuzz seed %llu: frame %d not returned\n", (unsigned long long)seed, parsed);
+                return false;
+            }
+            int chunk = qMin(chunkSize(random), stream.size() - fed);
+            if (random.below(2)) {
+                // Прием прямо в буфер, иногда с запасом места больше порции
+                char *buffer = parser.receiveBuffer(chunk + random.below(4096));
+                std::memcpy(buffer, stream.constData() + fed, chunk);
+                parser.commit(chunk);
+            } else {
+                parser.append(stream.constData() + fed, chunk);
+            }
+            fed += chunk;
+            continue;
+        }
+        
+        const GeneratedFrame &expected = frames[parsed];
+        const char *original = stream.constData() + expected.offset;
+        if (parser.frameLength() != expected.length ||
+            std::memcmp(parser.frameData(), original, expected.length) != 0) {
+            std::fprintf(stderr, "fuzz seed %llu: frame %d differs\n", (unsigned long long)seed, parsed);
+            return false;
+        }
+        if (!parser.parseHeaders() || parser.headerCount() != expected.headers.size()) {
+            std::fprintf(stderr, "fuzz seed %llu: frame %d headers differ\n", (unsigned long long)seed, parsed);
+            return false;
+        }
+        for (int i = 0; i < expected.headers.size(); ++i) {
+            const ObexHeader &header = parser.header(i);
+            const GeneratedHeader &generated = expected.headers[i];
+            if (header.id != generated.id || header.size != generated.size ||
+                header.data != parser.frameData() + generated.offset ||
+                parser.findHeader(header.id) == nullptr) {
+                std::fprintf(stderr, "fuzz seed %llu: frame %d header %d differs\n",
+                             (unsigned long long)seed, parsed, i);
+                return false;
+            }
+        }
+        parsed++;
+    }
+    
+    if (parser.next() != ObexFrameParser::NeedMoreData || parser.pendingBytes() != 0 || fed != stream.size()) {
+        std::fprintf(stderr, "fuzz seed %llu: data left after last frame\n", (unsigned long long)seed);
+        return false;
+    }
+    return true;
+}
+
+static bool fuzzCorrupted(quint64 seed)
+{
+    Random random(seed);
+    int maxLength = random.below(2) ? ObexFrameParser::MaxFrameLength : 3 + random.below(1024);
+    
+    QByteArray stream;
+    QVector<GeneratedFrame> frames;
+    int frameCount = 1 + random.below(16);
+    for (int i = 0; i < frameCount; ++i) {
+        // Часть пакетов длиннее, чем принимает парсер
+        generateFrame(random, random.below(8) ? maxLength : ObexFrameParser::MaxFrameLength, stream, frames);
+    }
+    
+    // Порча: замена, вставка и удаление байт
+    int damage = 1 + random.below(16);
+    for (int i = 0; i < damage && !stream.isEmpty(); ++i) {
+        int pos = random.below(stream.size());
+        switch (random.below(3)) {
+        case 0:
+            stream[pos] = (char)random.next();
+            break;
+        case 1:
+            stream.insert(pos, (char)random.next());
+            break;
+        default:
+            stream.remove(pos, 1 + random.below(8));
+            break;
+        }
+    }
+    
+    ObexFrameParser parser(maxLength);
+    int fed = 0;
+    bool invalid = false;
+    while (true) {
+        ObexFrameParser::Status status = parser.next();
+        if (status == ObexFrameParser::InvalidFrame) {
+            invalid = true;
+            // Поток рассинхронизирован - дальше только InvalidFrame
+            parser.append(stream.constData(), qMin(stream.size(), 16));
+            if (parser.next() != ObexFrameParser::InvalidFrame) {
+                std::fprintf(stderr, "fuzz seed %llu: parser continued after InvalidFrame\n", (unsigned long long)seed);
+                return false;
+            }
+            break;
+        }
+        if (status == ObexFrameParser::NeedMoreData) {
+            if (fed == stream.size()) break;
+            int chunk = qMin(chunkSize(random), stream.size() - fed);
+            parser.append(stream.constData() + fed, chunk);
+            fed += chunk;
+            continue;
+        }
+        
+        int length = parser.frameLength();
+        const char *frame = parser.frameData();
+        int declared = ((quint8)frame[1] << 8) | (quint8)frame[2];
+        if (length < 3 || length > maxLength || length != declared) {
+            std::fprintf(stderr, "fuzz seed %llu: bad frame length %d\n", (unsigned long long)seed, length);
+            return false;
+        }
+        
+        // Заголовки (в том числе с другого смещения, как у CONNECT)
+        int offset = random.below(4) ? 3 : random.below(length + 2);
+        bool ok = parser.parseHeaders(offset);
+        int end = offset;
+        for (int i = 0; i < parser.headerCount(); ++i) {
+            const ObexHeader &header = parser.header(i);
+            if (header.size < 0 || header.data < frame + offset || header.data + header.size > frame + length) {
+                std::fprintf(stderr, "fuzz seed %llu: header outside of frame\n", (unsigned long long)seed);
+                return false;
+            }
+            end = header.data + header.size - frame;
+        }
+        if (ok && parser.headerCount() > 0 && end != length) {
+            std::fprintf(stderr, "fuzz seed %llu: headers do not cover frame\n", (unsigned long long)seed);
+            return false;
+        }
+    }
+    
+    // Сброс возвращает парсер к работе
+    if (invalid) {
+        parser.reset();
+        QByteArray frame("\xA0\x00\x03", 3);
+        parser.append(frame.constData(), frame.size());
+        if (parser.next() != ObexFrameParser::FrameReady || parser.code() != 0xA0) {
+            std::fprintf(stderr, "fuzz seed %llu: parser unusable after reset\n", (unsigned long long)seed);
+            return false;
+        }
+    }
+    return true;
+}
+
+static int runFuzz(int iterations, quint64 seed)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < iterations; ++i) {
+        if (!fuzzValid(seed + i) || !fuzzCorrupted(seed + i)) {
+            std::printf("obex_parser_bench: fuzz FAILED (repeat: --fuzz 1 --seed %llu)\n",
+                        (unsigned long long)(seed + i));
+            return 1;
+        }
+    }
+    std::printf("obex_parser_bench: fuzz OK, %d streams (seed %llu), %.1f s\n",
+                iterations, (unsigned long long)seed, timer.elapsed() / 1000.0);
+    return 0;
+}
+
+// Поток для бенчмарка: типичный обмен при передаче файла
+static QByteArray benchmarkStream(int &frameCount)
+{
+    QByteArray stream;
+    frameCount = 0;
+    QByteArray body(65535 - 3 - 5 - 3, 'x');
+    
+    // Ответ CONNECT: версия, флаги, размер пакета, Connection ID
+    stream.append(QByteArray("\xA0\x00\x0C\x10\x00\xFF\xFF\xCB\x00\x00\x00\x01", 12));
+    frameCount++;
+    
+    for (int i = 0; i < 64; ++i) {
+        // PUT: Connection ID и Body на весь пакет
+        stream.append((char)0x02);
+        appendUInt16(stream, 65535);
+        stream.append(QByteArray("\xCB\x00\x00\x00\x01", 5));
+        stream.append((char)0x48);
+        appendUInt16(stream, body.size() + 3);
+        stream.append(body);
+        frameCount++;
+        
+        // CONTINUE, в начале - с подтверждением SRM
+        if (i == 0) {
+            stream.append(QByteArray("\x90\x00\x05\x97\x01", 5));
+        } else {
+            stream.append(QByteArray("\x90\x00\x03", 3));
+        }
+        frameCount++;
+    }
+    return stream;
+}
+
+static bool runBenchmark(double seconds)
+{
+    int framesPerStream = 0;
+    const QByteArray stream = benchmarkStream(framesPerStream);
+    const int chunks[] = { 7, 1500, 65536, stream.size() };
+    const char *names[] = { "7 B", "MTU 1500 B", "64 KB", "whole stream" };
+    
+    std::printf("obex_parser_bench: stream %d bytes, %d frames\n", stream.size(), framesPerStream);
+    std::printf("%-14s %12s %14s\n", "chunk", "MB/s", "frames/s");
+    
+    bool ok = true;
+    for (int c = 0; c < 4; ++c) {
+        ObexFrameParser parser;
+        qint64 bytes = 0;
+        qint64 frames = 0;
+        QElapsedTimer timer;
+        timer.start();
+        do {
+            int fed = 0;
+            int streamFrames = 0;
+            while (fed < stream.size()) {
+                int chunk = qMin(chunks[c], stream.size() - fed);
+                char *buffer = parser.receiveBuffer(chunk);
+                std::memcpy(buffer, stream.constData() + fed, chunk);
+                parser.commit(chunk);
+                fed += chunk;
+                while (parser.next() == ObexFrameParser::FrameReady) {
+                    // Ответ CONNECT (первый пакет) - заголовки после его полей
+                    parser.parseHeaders(streamFrames == 0 ? 7 : 3);
+                    streamFrames++;
+                }
+            }
+            if (streamFrames != framesPerStream) {
+                std::fprintf(stderr, "obex_parser_bench: %d frames parsed, %d expected\n",
+                             streamFrames, framesPerStream);
+                ok = false;
+                break;
+            }
+            bytes += stream.size();
+            frames += streamFrames;
+        } while (timer.elapsed() < seconds * 1000);
+        
+        double elapsed = qMax<qint64>(timer.elapsed(), 1) / 1000.0;
+        std::printf("%-14s %12.1f %14.0f\n", names[c], bytes / 1024.0 / 1024.0 / elapsed, frames / elapsed);
+        if (!ok) break;
+    }
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    
+    double seconds = 1.0;
+    int fuzzIterations = 0;
+    quint64 seed = 1;
+    const QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        if (args[i] == "--seconds" && i + 1 < args.size()) {
+            seconds = qMax(0.1, args[++i].toDouble());
+        } else if (args[i] == "--fuzz" && i + 1 < args.size()) {
+            fuzzIterations = qMax(1, args[++i].toInt());
+        } else if (args[i] == "--seed" && i + 1 < args.size()) {
+            seed = args[++i].toULongLong();
+        } else {
+            std::fprintf(stderr, "usage: obex_parser_bench [--seconds N] [--fuzz N] [--seed S]\n");
+            return 2;
+        }
+    }
+    
+    if (fuzzIterations > 0) {
+        return runFuzz(fuzzIterations, seed);
+    }
+    return runBenchmark(seconds) ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+QT += core
+QT -= gui
+
+TARGET = obex_parser_bench
+TEMPLATE = app
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+SOURCES += \
+    obex_parser_bench.cpp \
+    obexframeparser.cpp
+
+HEADERS += \
+    obexframeparser.h
+
+CONFIG += release
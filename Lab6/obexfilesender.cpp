@@ -3,22 +3,34 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QDataStream>
+#include <QElapsedTimer>
+#include <QThread>
+
+// Прямая передача ПК-ПК: файл читается и отправляется блоками этого размера
+static const int RAW_CHUNK_SIZE = 64 * 1024;
+
+// Сколько ждать готовности соединения при отправке, мс
+static const int SEND_TIMEOUT_MS = 30000;
+
+// Сколько ждать ответа OBEX сервера (телефон ждет решения пользователя), мс
+static const int RESPONSE_TIMEOUT_MS = 30000;
+
+// Сколько места под прием ответа выделять в буфере парсера
+static const int RESPONSE_CHUNK_SIZE = 4096;
 
 ObexFileSender::ObexFileSender(BluetoothLogger *logger, QObject *parent)
     : QObject(parent)
     , logger(logger)
-    , obexSocket(INVALID_SOCKET)
+    , transport(nullptr)
     , connected(false)
     , connectionId(0)
+    , maxPacketLength(OBEX_MIN_PACKET_LENGTH)
+    , srmRequested(true)
 {
 }
 
 ObexFileSender::~ObexFileSender()
 {
-    if (obexSocket != INVALID_SOCKET) {
-        closesocket(obexSocket);
-        cleanupWinsock();
-    }
 }
 
 bool ObexFileSender::sendFileViaObex(const QString &filePath, const QString &deviceAddress, const QString &deviceName)
@@ -49,100 +61,63 @@ bool ObexFileSender::sendFileViaObex(const QString &filePath, const QString &dev
         logger->info("OBEX", "");
     }
     
-    // Открываем файл
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        logger->error("OBEX", QString("Не удалось открыть файл: %1").arg(file.errorString()));
-        return false;
-    }
-    
-    QFileInfo fileInfo(filePath);
-    QByteArray fileData = file.readAll();
-    file.close();
-    
-    logger->info("OBEX", QString("Размер файла: %1 байт (%2 MB)")
-        .arg(fileData.size())
-        .arg(fileData.size() / 1024.0 / 1024.0, 0, 'f', 2));
-    logger->info("OBEX", "");
-    
-    emit transferStarted(fileInfo.fileName());
-    
-    // Инициализация Winsock
-    if (!initWinsock()) {
-        emit transferFailed("Ошибка инициализации Winsock");
-        return false;
-    }
-    
-    // Создание RFCOMM сокета
-    logger->info("OBEX", "ШАГ 1: Создание Bluetooth сокета");
-    obexSocket = socket(AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM);
+    // Подключение к OBEX Push (Object Push Profile)
+    logger->info("OBEX", "ШАГ 1: Подключение к OBEX Push сервису");
+    logger->debug("OBEX", "UUID: 00001105-0000-1000-8000-00805f9b34fb (Object Push)");
+    logger->info("OBEX", "Подключение к устройству...");
+    logger->warning("OBEX", "⏱ Это может занять 5-15 секунд...");
     
-    if (obexSocket == INVALID_SOCKET) {
-        logger->error("OBEX", QString("Не удалось создать сокет: %1").arg(getLastSocketError()));
-        cleanupWinsock();
-        emit transferFailed("Не удалось создать сокет");
+    RfcommTransport rfcomm;
+    if (!rfcomm.connectToDevice(deviceAddress, RfcommTransport::ObexObjectPush)) {
+        logger->error("OBEX", QString("Ошибка подключения: %1").arg(rfcomm.lastError()));
+        emit transferFailed(QString("Не удалось подключиться к OBEX сервису: %1").arg(rfcomm.lastError()));
         return false;
     }
     
-    logger->success("OBEX", "✓ Bluetooth сокет создан");
+    logger->success("OBEX", "✓ Подключено к OBEX Push сервису!");
     logger->info("OBEX", "");
     
-    // Парсинг MAC адреса
-    logger->info("OBEX", "ШАГ 2: Парсинг MAC адреса");
-    BLUETOOTH_ADDRESS btAddr;
-    if (!parseMacAddress(deviceAddress, btAddr)) {
-        logger->error("OBEX", "Неверный формат MAC адреса");
-        closesocket(obexSocket);
-        obexSocket = INVALID_SOCKET;
-        cleanupWinsock();
-        emit transferFailed("Неверный формат MAC адреса");
+    if (!sendFileOverObex(filePath, &rfcomm)) {
         return false;
     }
     
-    logger->success("OBEX", "✓ MAC адрес распознан");
+    logger->info("OBEX", "На телефоне должен был появиться диалог 'Принять файл?'");
     logger->info("OBEX", "");
+    return true;
+}
+
+bool ObexFileSender::sendFileOverObex(const QString &filePath, ByteTransport *transport)
+{
+    if (!logger || !transport || !transport->isOpen()) return false;
     
-    // Настройка адреса для OBEX Push (Object Push Profile)
-    logger->info("OBEX", "ШАГ 3: Подключение к OBEX Push сервису");
-    logger->debug("OBEX", "UUID: 00001105-0000-1000-8000-00805f9b34fb (Object Push)");
-    
-    SOCKADDR_BTH sockAddrBth;
-    ZeroMemory(&sockAddrBth, sizeof(sockAddrBth));
-    sockAddrBth.addressFamily = AF_BTH;
-    sockAddrBth.btAddr = btAddr.ullLong;
-    sockAddrBth.serviceClassId = OBEX_PUSH_SERVICE_UUID;  // Object Push Profile
-    sockAddrBth.port = BT_PORT_ANY;
-    
-    logger->info("OBEX", "Подключение к устройству...");
-    logger->warning("OBEX", "⏱ Это может занять 5-15 секунд...");
-    
-    int connectResult = ::connect(obexSocket, (SOCKADDR*)&sockAddrBth, sizeof(sockAddrBth));
-    
-    if (connectResult == SOCKET_ERROR) {
-        QString error = getLastSocketError();
-        logger->error("OBEX", QString("Ошибка подключения: %1").arg(error));
-        closesocket(obexSocket);
-        obexSocket = INVALID_SOCKET;
-        cleanupWinsock();
-        emit transferFailed(QString("Не удалось подключиться к OBEX сервису: %1").arg(error));
+    // Файл не читается в память целиком: obexPut читает его по частям
+    // прямо в пакеты, поэтому расход памяти не зависит от размера файла
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        logger->error("OBEX", QString("Не удалось открыть файл: %1").arg(file.errorString()));
+        emit transferFailed("Не удалось открыть файл");
         return false;
     }
     
-    logger->success("OBEX", "✓ Подключено к OBEX Push сервису!");
-    logger->info("OBEX", "");
+    QFileInfo fileInfo(filePath);
+    qint64 fileSize = file.size();
     
-    // Делаем сокет неблокирующим
-    u_long nonBlocking = 1;
-    ioctlsocket(obexSocket, FIONBIO, &nonBlocking);
-    logger->debug("OBEX", "✓ Сокет переведен в неблокирующий режим");
+    logger->info("OBEX", QString("Размер файла: %1 байт (%2 MB)")
+        .arg(fileSize)
+        .arg(fileSize / 1024.0 / 1024.0, 0, 'f', 2));
     logger->info("OBEX", "");
     
+    emit transferStarted(fileInfo.fileName());
+    
+    this->transport = transport;
+    response.reset();
+    connected = false;
+    connectionId = 0;
+    
     // OBEX CONNECT
-    logger->info("OBEX", "ШАГ 4: OBEX CONNECT");
+    logger->info("OBEX", "ШАГ 2: OBEX CONNECT");
     if (!obexConnect()) {
-        closesocket(obexSocket);
-        obexSocket = INVALID_SOCKET;
-        cleanupWinsock();
+        this->transport = nullptr;
         emit transferFailed("Ошибка OBEX CONNECT");
         return false;
     }
@@ -151,16 +126,14 @@ bool ObexFileSender::sendFileViaObex(const QString &filePath, const QString &dev
     logger->info("OBEX", "");
     
     // OBEX PUT
-    logger->info("OBEX", "ШАГ 5: OBEX PUT (отправка файла)");
+    logger->info("OBEX", "ШАГ 3: OBEX PUT (отправка файла)");
     logger->info("OBEX", QString("Имя файла: %1").arg(fileInfo.fileName()));
-    logger->info("OBEX", QString("Размер данных: %1 байт").arg(fileData.size()));
+    logger->info("OBEX", QString("Размер данных: %1 байт").arg(fileSize));
     logger->info("OBEX", "");
     
-    if (!obexPut(fileInfo.fileName(), fileData)) {
+    if (!obexPut(fileInfo.fileName(), file)) {
         obexDisconnect();
-        closesocket(obexSocket);
-        obexSocket = INVALID_SOCKET;
-        cleanupWinsock();
+        this->transport = nullptr;
         emit transferFailed("Ошибка OBEX PUT");
         return false;
     }
@@ -169,19 +142,13 @@ bool ObexFileSender::sendFileViaObex(const QString &filePath, const QString &dev
     logger->info("OBEX", "");
     
     // OBEX DISCONNECT
-    logger->info("OBEX", "ШАГ 6: OBEX DISCONNECT");
+    logger->info("OBEX", "ШАГ 4: OBEX DISCONNECT");
     obexDisconnect();
+    this->transport = nullptr;
     
     logger->success("OBEX", "");
     logger->success("OBEX", "✓✓✓ ФАЙЛ УСПЕШНО ОТПРАВЛЕН ЧЕРЕЗ OBEX! ✓✓✓");
     logger->success("OBEX", "");
-    logger->info("OBEX", "На телефоне должен был появиться диалог 'Принять файл?'");
-    logger->info("OBEX", "");
-    
-    // Закрываем соединение
-    closesocket(obexSocket);
-    obexSocket = INVALID_SOCKET;
-    cleanupWinsock();
     
     emit transferCompleted(fileInfo.fileName());
     return true;
@@ -199,85 +166,18 @@ bool ObexFileSender::sendFileViaRfcomm(const QString &filePath, const QString &d
     logger->info("RFCOMM", QString("Файл: %1").arg(filePath));
     logger->info("RFCOMM", "");
     
-    // Открываем файл
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        logger->error("RFCOMM", QString("Не удалось открыть файл: %1").arg(file.errorString()));
-        emit transferFailed("Не удалось открыть файл");
-        return false;
-    }
-    
-    QFileInfo fileInfo(filePath);
-    qint64 fileSize = file.size();
-    
-    logger->info("RFCOMM", QString("Размер файла: %1 байт (%2 MB)")
-        .arg(fileSize)
-        .arg(fileSize / 1024.0 / 1024.0, 0, 'f', 2));
-    logger->info("RFCOMM", "");
-    
-    emit transferStarted(fileInfo.fileName());
-    
-    // Инициализация Winsock
-    if (!initWinsock()) {
-        emit transferFailed("Ошибка инициализации Winsock");
-        file.close();
-        return false;
-    }
-    
-    // Создание Bluetooth сокета
-    logger->info("RFCOMM", "ШАГ 1: Создание Bluetooth сокета");
-    SOCKET btSocket = socket(AF_BTH, SOCK_STREAM, BTHPROTO_RFCOMM);
-    
-    if (btSocket == INVALID_SOCKET) {
-        logger->error("RFCOMM", QString("Не удалось создать сокет: %1").arg(getLastSocketError()));
-        cleanupWinsock();
-        file.close();
-        emit transferFailed("Не удалось создать Bluetooth сокет");
-        return false;
-    }
-    
-    logger->success("RFCOMM", "✓ Bluetooth сокет создан");
-    logger->info("RFCOMM", "");
-    
-    // Парсинг MAC адреса
-    logger->info("RFCOMM", "ШАГ 2: Парсинг MAC адреса");
-    BLUETOOTH_ADDRESS btAddr;
-    if (!parseMacAddress(deviceAddress, btAddr)) {
-        logger->error("RFCOMM", "Неверный формат MAC адреса");
-        closesocket(btSocket);
-        cleanupWinsock();
-        file.close();
-        emit transferFailed("Неверный формат MAC адреса");
-        return false;
-    }
-    
-    logger->success("RFCOMM", "✓ MAC адрес распознан");
-    logger->info("RFCOMM", "");
-    
-    // Настройка адреса для RFCOMM подключения
-    logger->info("RFCOMM", "ШАГ 3: Настройка RFCOMM подключения");
-    SOCKADDR_BTH remoteAddress;
-    ZeroMemory(&remoteAddress, sizeof(remoteAddress));
-    remoteAddress.addressFamily = AF_BTH;
-    remoteAddress.btAddr = btAddr.ullLong;
-    remoteAddress.serviceClassId = RFCOMM_PROTOCOL_UUID;  // RFCOMM протокол
-    remoteAddress.port = 11;  // Стандартный порт для RFCOMM
-    
+    // Подключение к удаленному устройству
+    logger->info("RFCOMM", "ШАГ 1: Подключение к устройству");
     logger->debug("RFCOMM", "Параметры подключения:");
-    logger->debug("RFCOMM", QString("  • addressFamily: AF_BTH"));
-    logger->debug("RFCOMM", QString("  • btAddr: 0x%1").arg(btAddr.ullLong, 12, 16, QChar('0')));
+    logger->debug("RFCOMM", QString("  • MAC: %1").arg(deviceAddress));
     logger->debug("RFCOMM", QString("  • serviceClassId: RFCOMM_PROTOCOL_UUID"));
-    logger->debug("RFCOMM", QString("  • port: 11"));
-    logger->info("RFCOMM", "");
-    
-    // Подключение к удаленному устройству
-    logger->info("RFCOMM", "ШАГ 4: Подключение к устройству");
+    logger->debug("RFCOMM", QString("  • port: %1").arg(RfcommTransport::DirectTransferPort));
     logger->warning("RFCOMM", "⏱ Это может занять 5-15 секунд...");
     
-    int connectResult = ::connect(btSocket, (SOCKADDR*)&remoteAddress, sizeof(remoteAddress));
-    
-    if (connectResult == SOCKET_ERROR) {
-        QString error = getLastSocketError();
+    RfcommTransport rfcomm;
+    if (!rfcomm.connectToDevice(deviceAddress, RfcommTransport::RfcommProtocol,
+                                RfcommTransport::DirectTransferPort)) {
+        QString error = rfcomm.lastError();
         logger->error("RFCOMM", QString("Ошибка подключения: %1").arg(error));
         logger->warning("RFCOMM", "ВОЗМОЖНЫЕ ПРИЧИНЫ:");
         logger->warning("RFCOMM", "1. Устройство не запущено в режиме сервера");
@@ -290,9 +190,6 @@ bool ObexFileSender::sendFileViaRfcomm(const QString &filePath, const QString &d
         logger->info("RFCOMM", "2. Проверьте что устройство видимо для других");
         logger->info("RFCOMM", "3. Попробуйте перезапустить Bluetooth на устройстве");
         
-        closesocket(btSocket);
-        cleanupWinsock();
-        file.close();
         emit transferFailed(QString("Не удалось подключиться к устройству: %1").arg(error));
         return false;
     }
@@ -300,129 +197,96 @@ bool ObexFileSender::sendFileViaRfcomm(const QString &filePath, const QString &d
     logger->success("RFCOMM", "✓ Подключено к устройству!");
     logger->info("RFCOMM", "");
     
-    // Делаем сокет неблокирующим
-    u_long nonBlocking = 1;
-    ioctlsocket(btSocket, FIONBIO, &nonBlocking);
-    logger->debug("RFCOMM", "✓ Сокет переведен в неблокирующий режим");
+    if (!sendFileRaw(filePath, &rfcomm)) {
+        return false;
+    }
+    
+    logger->info("RFCOMM", "На принимающем ПК должен появиться файл");
     logger->info("RFCOMM", "");
+    return true;
+}
+
+bool ObexFileSender::sendFileRaw(const QString &filePath, ByteTransport *transport)
+{
+    if (!logger || !transport || !transport->isOpen()) return false;
+    
+    // Открываем файл
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        logger->error("RFCOMM", QString("Не удалось открыть файл: %1").arg(file.errorString()));
+        emit transferFailed("Не удалось открыть файл");
+        return false;
+    }
+    
+    QFileInfo fileInfo(filePath);
+    qint64 fileSize = file.size();
+    
+    logger->info("RFCOMM", QString("Размер файла: %1 байт (%2 MB)")
+        .arg(fileSize)
+        .arg(fileSize / 1024.0 / 1024.0, 0, 'f', 2));
+    logger->info("RFCOMM", "");
+    
+    emit transferStarted(fileInfo.fileName());
     
     // Отправка файла
-    logger->info("RFCOMM", "ШАГ 5: Отправка файла");
+    logger->info("RFCOMM", "ШАГ 2: Отправка файла");
     logger->info("RFCOMM", QString("Начинаем передачу: %1").arg(fileInfo.fileName()));
     logger->info("RFCOMM", "");
     
-    const int bufferSize = 1024;
-    char buffer[bufferSize];
+    QByteArray buffer(RAW_CHUNK_SIZE, 0);
     qint64 totalSent = 0;
     int chunkNumber = 0;
     
+    QElapsedTimer timer;
+    timer.start();
+    
     while (!file.atEnd()) {
-        qint64 bytesRead = file.read(buffer, bufferSize);
+        qint64 bytesRead = file.read(buffer.data(), buffer.size());
         if (bytesRead <= 0) break;
         
-        qint64 bytesSent = 0;
-        while (bytesSent < bytesRead) {
-            int result = ::send(btSocket, buffer + bytesSent, bytesRead - bytesSent, 0);
-            
-            if (result == SOCKET_ERROR) {
-                int error = WSAGetLastError();
-                if (error == WSAEWOULDBLOCK) {
-                    // Буфер полон - ждем
-                    Sleep(10);
-                    continue;
-                } else {
-                    logger->error("RFCOMM", QString("Ошибка отправки: %1").arg(getLastSocketError()));
-                    closesocket(btSocket);
-                    cleanupWinsock();
-                    file.close();
-                    emit transferFailed("Ошибка отправки данных");
-                    return false;
-                }
-            }
-            
-            bytesSent += result;
-            totalSent += result;
+        // Буфер полон - ждем готовности соединения, а не спим
+        if (!transport->sendAll(buffer.constData(), bytesRead, SEND_TIMEOUT_MS)) {
+            logger->error("RFCOMM", QString("Ошибка отправки: %1").arg(transport->lastError()));
+            emit transferFailed("Ошибка отправки данных");
+            return false;
         }
         
+        totalSent += bytesRead;
         chunkNumber++;
         
-        // Логируем прогресс каждые 10 блоков
-        if (chunkNumber % 10 == 0) {
-            int progress = (totalSent * 100) / fileSize;
+        // Логируем прогресс каждые 16 блоков (1 MB)
+        if (chunkNumber % 16 == 0) {
+            int progress = fileSize > 0 ? (totalSent * 100) / fileSize : 100;
             logger->debug("RFCOMM", QString("Отправлено: %1/%2 байт (%3%)")
                 .arg(totalSent).arg(fileSize).arg(progress));
-            emit transferProgress(totalSent, fileSize);
         }
+        emit transferProgress(totalSent, fileSize);
     }
     
     file.close();
     
-    // Ждем завершения передачи
-    logger->info("RFCOMM", "ШАГ 6: Завершение передачи");
+    // Ждем, пока получатель дочитает данные и закроет соединение
+    logger->info("RFCOMM", "ШАГ 3: Завершение передачи");
     logger->info("RFCOMM", "⏱ Ожидание завершения...");
-    Sleep(2000);  // 2 секунды
+    if (!transport->finishSending(SEND_TIMEOUT_MS)) {
+        logger->warning("RFCOMM", QString("Получатель не закрыл соединение: %1").arg(transport->lastError()));
+    }
     
-    // Закрываем соединение
-    closesocket(btSocket);
-    cleanupWinsock();
+    double seconds = qMax<qint64>(timer.elapsed(), 1) / 1000.0;
     
     logger->success("RFCOMM", "");
     logger->success("RFCOMM", "✓✓✓ ФАЙЛ УСПЕШНО ОТПРАВЛЕН! ✓✓✓");
     logger->success("RFCOMM", QString("Отправлено блоков: %1").arg(chunkNumber));
     logger->success("RFCOMM", QString("Всего байт: %1").arg(totalSent));
-    logger->info("RFCOMM", "");
-    logger->info("RFCOMM", "На принимающем ПК должен появиться файл");
+    logger->success("RFCOMM", QString("Скорость: %1 KB/s (%2 с)")
+        .arg(totalSent / 1024.0 / seconds, 0, 'f', 1)
+        .arg(seconds, 0, 'f', 2));
     logger->info("RFCOMM", "");
     
     emit transferCompleted(fileInfo.fileName());
     return true;
 }
 
-bool ObexFileSender::initWinsock()
-{
-    WSADATA wsaData;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    
-    if (result != 0) {
-        if (logger) {
-            logger->error("OBEX", QString("Ошибка WSAStartup: %1").arg(result));
-        }
-        return false;
-    }
-    
-    if (logger) {
-        logger->debug("OBEX", "✓ Winsock инициализирован");
-    }
-    
-    return true;
-}
-
-void ObexFileSender::cleanupWinsock()
-{
-    WSACleanup();
-    if (logger) {
-        logger->debug("OBEX", "✓ Winsock очищен");
-    }
-}
-
-bool ObexFileSender::parseMacAddress(const QString &address, BLUETOOTH_ADDRESS &btAddr)
-{
-    ZeroMemory(&btAddr, sizeof(btAddr));
-    
-    QStringList bytes = address.split(":");
-    if (bytes.size() != 6) {
-        return false;
-    }
-    
-    for (int i = 0; i < 6; i++) {
-        bool ok;
-        btAddr.rgBytes[5 - i] = bytes[i].toUInt(&ok, 16);
-        if (!ok) return false;
-    }
-    
-    return true;
-}
-
 bool ObexFileSender::obexConnect()
 {
     logger->debug("OBEX", "Формирование OBEX CONNECT пакета...");
@@ -438,31 +302,39 @@ bool ObexFileSender::obexConnect()
     }
     
     logger->debug("OBEX", "Ожидание ответа...");
-    QByteArray response = receiveObexResponse();
     
-    if (response.isEmpty() || (unsigned char)response[0] != OBEX_RSP_SUCCESS) {
-        if (!response.isEmpty()) {
-            logger->error("OBEX", QString("OBEX CONNECT отклонен: 0x%1").arg((unsigned char)response[0], 2, 16, QChar('0')));
-        } else {
-            logger->error("OBEX", "Нет ответа от OBEX сервера");
-        }
+    if (!receiveObexResponse()) {
+        logger->error("OBEX", "Нет ответа от OBEX сервера");
+        return false;
+    }
+    if (response.code() != OBEX_RSP_SUCCESS) {
+        logger->error("OBEX", QString("OBEX CONNECT отклонен: 0x%1").arg(response.code(), 2, 16, QChar('0')));
         return false;
     }
     
     logger->success("OBEX", "✓ OBEX CONNECT SUCCESS (0xA0)");
     
-    // Извлекаем Connection ID если есть
-    if (response.size() >= 7) {
-        // Проверяем наличие Connection ID header (0xCB)
-        for (int i = 3; i < response.size() - 4; i++) {
-            if ((unsigned char)response[i] == OBEX_HDR_CONNECTION) {
-                connectionId = ((unsigned char)response[i+1] << 24) |
-                              ((unsigned char)response[i+2] << 16) |
-                              ((unsigned char)response[i+3] << 8) |
-                              ((unsigned char)response[i+4]);
-                logger->debug("OBEX", QString("Connection ID: 0x%1").arg(connectionId, 8, 16, QChar('0')));
-                break;
-            }
+    // Ответ на CONNECT: код, длина, версия, флаги, Maximum Packet Length
+    // сервера (2 байта), затем заголовки. Пакеты не должны превышать ни
+    // его размер, ни наш (OBEX_MAX_PACKET_LENGTH в CONNECT)
+    maxPacketLength = OBEX_MIN_PACKET_LENGTH;
+    if (response.frameLength() >= 7) {
+        const char *frame = response.frameData();
+        quint16 peerMaxLength = ((unsigned char)frame[5] << 8) | (unsigned char)frame[6];
+        maxPacketLength = qBound((quint16)OBEX_MIN_PACKET_LENGTH, peerMaxLength, (quint16)OBEX_MAX_PACKET_LENGTH);
+        logger->debug("OBEX", QString("Maximum Packet Length сервера: %1 байт").arg(peerMaxLength));
+    }
+    logger->info("OBEX", QString("Размер OBEX пакета: %1 байт").arg(maxPacketLength));
+    
+    // Извлекаем Connection ID если есть (заголовки - после полей CONNECT)
+    if (response.frameLength() >= 7) {
+        if (!response.parseHeaders(7)) {
+            logger->warning("OBEX", QString("Заголовки ответа CONNECT: %1").arg(response.errorString()));
+        }
+        const ObexHeader *header = response.findHeader(OBEX_HDR_CONNECTION);
+        if (header) {
+            connectionId = header->toUInt32();
+            logger->debug("OBEX", QString("Connection ID: 0x%1").arg(connectionId, 8, 16, QChar('0')));
         }
     }
     
@@ -470,195 +342,197 @@ bool ObexFileSender::obexConnect()
     return true;
 }
 
-bool ObexFileSender::obexPut(const QString &fileName, const QByteArray &fileData)
+bool ObexFileSender::obexPut(const QString &fileName, QFile &file)
 {
+    const qint64 fileSize = file.size();
+    
     logger->debug("OBEX", "Формирование OBEX PUT пакета...");
     logger->debug("OBEX", QString("Имя файла: %1").arg(fileName));
-    logger->debug("OBEX", QString("Размер данных: %1 байт").arg(fileData.size()));
+    logger->debug("OBEX", QString("Размер данных: %1 байт").arg(fileSize));
     
-    const int MAX_OBEX_PACKET = 32000;  // Максимальный размер OBEX пакета (32 KB)
+    // Каждый пакет заполняется данными до согласованного в CONNECT размера:
+    // без SRM на каждый пакет приходится ожидание ответа, чем их меньше -
+    // тем быстрее
+    int bodyPerPacket = maxPacketLength - 3 - (connectionId != 0 ? 5 : 0) - 3;
     
-    // Если файл маленький - отправляем за один раз
-    if (fileData.size() <= MAX_OBEX_PACKET) {
+    // Один буфер на всю передачу: заголовки пакета собираются в его
+    // начале, а часть файла читается сразу за ними, без промежуточных копий
+    QByteArray packet;
+    packet.reserve(maxPacketLength);
+    
+    if (fileSize <= bodyPerPacket) {
         logger->info("OBEX", "Файл маленький - отправка одним пакетом");
+    } else {
+        logger->info("OBEX", "Файл большой - многопакетная отправка");
+        logger->info("OBEX", QString("Будет отправлено пакетов: ~%1 по %2 байт")
+            .arg((fileSize / bodyPerPacket) + 1).arg(maxPacketLength));
+    }
+    logger->info("OBEX", "⏱ На телефоне должен появиться диалог 'Принять файл?'");
+    logger->info("OBEX", "");
+    
+    qint64 offset = 0;
+    int packetNum = 0;
+    bool srmActive = false;  // Сервер подтвердил SRM
+    bool srmWait = false;    // Сервер попросил ждать ответа (SRMP)
+    
+    // Ответ на первый пакет приходит только после подтверждения на
+    // телефоне, поэтому ожидание "Принять файл?" и скорость передачи
+    // измеряются отдельно: скорость - от ответа на первый пакет до ответа
+    // на последний
+    QElapsedTimer acceptTimer;
+    acceptTimer.start();
+    QElapsedTimer timer;
+    qint64 firstChunkSize = 0;
+    
+    do {
+        // Первый пакет несет имя и размер файла. Он определяется по номеру,
+        // а не по смещению: если заголовки заняли весь пакет, данных в нем
+        // нет и следующий пакет тоже начинается со смещения 0
+        bool firstPacket = (packetNum == 0);
+        buildPutPacket(packet, fileName, fileSize, firstPacket);
         
-        // Формируем PUT FINAL пакет
-        QByteArray packet;
-        
-        // Opcode: PUT FINAL (0x82)
-        packet.append((char)OBEX_PUT_FINAL);
-        
-        // Packet Length (будет заполнено позже)
-        packet.append((char)0x00);
-        packet.append((char)0x00);
-        
-        // Connection ID header (если есть)
-        if (connectionId != 0) {
-            packet.append((char)OBEX_HDR_CONNECTION);
-            writeUInt32BE(packet, connectionId);
+        qint64 room = maxPacketLength - packet.size() - 3;
+        if (room < 0 || (room == 0 && !firstPacket)) {
+            logger->error("OBEX", "Заголовки не помещаются в OBEX пакет (слишком длинное имя файла)");
+            return false;
+        }
+        qint64 chunkSize = qMin(room, fileSize - offset);
+        bool isLast = (offset + chunkSize >= fileSize);
+        if (isLast) {
+            packet[0] = (char)OBEX_PUT_FINAL;
         }
         
-        // Name header
-        QByteArray nameUnicode = encodeUnicode(fileName);
-        packet.append((char)OBEX_HDR_NAME);
-        writeUInt16BE(packet, nameUnicode.size() + 3);
-        packet.append(nameUnicode);
-        
-        // Length header
-        packet.append((char)OBEX_HDR_LENGTH);
-        writeUInt32BE(packet, fileData.size());
+        packetNum++;
+        logger->debug("OBEX", QString("Пакет %1: offset=%2, size=%3, last=%4")
+            .arg(packetNum).arg(offset).arg(chunkSize).arg(isLast ? "ДА" : "НЕТ"));
         
-        // End of Body header
-        packet.append((char)OBEX_HDR_END_OF_BODY);
-        writeUInt16BE(packet, fileData.size() + 3);
-        packet.append(fileData);
+        // Body или End of Body: данные читаются из файла прямо в пакет
+        packet.append((char)(isLast ? OBEX_HDR_END_OF_BODY : OBEX_HDR_BODY));
+        writeUInt16BE(packet, chunkSize + 3);
+        int bodyStart = packet.size();
+        packet.resize(bodyStart + chunkSize);
+        if (chunkSize > 0 && file.read(packet.data() + bodyStart, chunkSize) != chunkSize) {
+            logger->error("OBEX", QString("Ошибка чтения файла: %1").arg(file.errorString()));
+            return false;
+        }
         
-        // Заполняем длину пакета
+        // Длина пакета
         quint16 totalLength = packet.size();
         packet[1] = (totalLength >> 8) & 0xFF;
         packet[2] = totalLength & 0xFF;
         
-        logger->debug("OBEX", QString("Размер PUT пакета: %1 байт").arg(packet.size()));
-        logger->info("OBEX", "Отправка OBEX PUT...");
-        logger->info("OBEX", "⏱ На телефоне должен появиться диалог 'Принять файл?'");
-        logger->info("OBEX", "");
+        logger->debug("OBEX", QString("Отправка пакета %1 (%2 байт)...").arg(packetNum).arg(packet.size()));
         
         if (!sendObexPacket(packet)) {
-            logger->error("OBEX", "Ошибка отправки OBEX PUT");
+            logger->error("OBEX", QString("Ошибка отправки пакета %1").arg(packetNum));
             return false;
         }
         
-        logger->debug("OBEX", "Ожидание ответа от телефона...");
-        logger->info("OBEX", "💡 Если вы ПРИНЯЛИ файл на телефоне - ждите ответа...");
-        logger->info("OBEX", "");
-        
-        QByteArray response = receiveObexResponse();
-        
-        if (response.isEmpty()) {
-            logger->error("OBEX", "");
-            logger->error("OBEX", "✗ НЕТ ОТВЕТА ОТ ТЕЛЕФОНА");
-            logger->error("OBEX", "");
-            logger->warning("OBEX", "ВОЗМОЖНЫЕ ПРИЧИНЫ:");
-            logger->warning("OBEX", "1. Вы ПРИНЯЛИ файл, но ответ не дошел (проблема Bluetooth)");
-            logger->warning("OBEX", "2. Проверьте телефон - файл может быть там!");
-            logger->warning("OBEX", "3. Таймаут ожидания истек (30 секунд)");
-            logger->warning("OBEX", "");
-            return false;
+        // В SRM сервер отвечает только на последний пакет (и на те, перед
+        // которыми попросил подождать через SRMP); ошибку он может прислать
+        // в любой момент, поэтому она проверяется без ожидания (ответ мог
+        // уже прийти вместе с предыдущим и лежать в буфере парсера)
+        bool waitResponse = isLast || !srmActive || srmWait;
+        if (!waitResponse && response.pendingBytes() == 0 && !transport->isReadable()) {
+            offset += chunkSize;
+            emit transferProgress(offset, fileSize);
+            continue;
         }
         
-        unsigned char responseCode = (unsigned char)response[0];
-        
-        if (responseCode != OBEX_RSP_SUCCESS) {
-            logger->error("OBEX", QString("OBEX PUT отклонен: 0x%1").arg(responseCode, 2, 16, QChar('0')));
-            
-            if (responseCode == OBEX_RSP_FORBIDDEN) {
-                logger->warning("OBEX", "Пользователь ОТКЛОНИЛ файл на телефоне");
+        // Ждем ответ
+        if (!receiveObexResponse()) {
+            logger->error("OBEX", QString("Нет ответа на пакет %1").arg(packetNum));
+            if (packetNum == 1) {
+                logger->warning("OBEX", "ВОЗМОЖНЫЕ ПРИЧИНЫ:");
+                logger->warning("OBEX", "1. Вы ПРИНЯЛИ файл, но ответ не дошел (проблема Bluetooth)");
+                logger->warning("OBEX", "2. Проверьте телефон - файл может быть там!");
+                logger->warning("OBEX", "3. Таймаут ожидания истек (30 секунд)");
+                logger->warning("OBEX", "");
             }
             return false;
         }
         
-        logger->success("OBEX", "✓ OBEX PUT SUCCESS (0xA0)");
-        logger->success("OBEX", "Файл принят телефоном!");
-        
-        return true;
-    } else {
-        // Файл большой - отправляем по частям
-        logger->info("OBEX", "Файл большой - многопакетная отправка");
-        logger->info("OBEX", QString("Будет отправлено пакетов: %1").arg((fileData.size() / MAX_OBEX_PACKET) + 1));
-        logger->info("OBEX", "");
+        unsigned char responseCode = response.code();
         
-        qint64 offset = 0;
-        int packetNum = 0;
-        
-        while (offset < fileData.size()) {
-            qint64 chunkSize = qMin((qint64)MAX_OBEX_PACKET, fileData.size() - offset);
-            bool isLast = (offset + chunkSize >= fileData.size());
-            
-            packetNum++;
-            logger->debug("OBEX", QString("Пакет %1: offset=%2, size=%3, last=%4")
-                .arg(packetNum).arg(offset).arg(chunkSize).arg(isLast ? "ДА" : "НЕТ"));
-            
-            QByteArray packet;
-            
-            // Opcode: PUT или PUT FINAL
-            packet.append((char)(isLast ? OBEX_PUT_FINAL : OBEX_PUT));
-            packet.append((char)0x00);
-            packet.append((char)0x00);
-            
-            // Connection ID
-            if (connectionId != 0) {
-                packet.append((char)OBEX_HDR_CONNECTION);
-                writeUInt32BE(packet, connectionId);
-            }
-            
-            // Первый пакет - добавляем имя и размер
-            if (offset == 0) {
-                QByteArray nameUnicode = encodeUnicode(fileName);
-                packet.append((char)OBEX_HDR_NAME);
-                writeUInt16BE(packet, nameUnicode.size() + 3);
-                packet.append(nameUnicode);
-                
-                packet.append((char)OBEX_HDR_LENGTH);
-                writeUInt32BE(packet, fileData.size());
-            }
-            
-            // Body или End of Body
-            QByteArray chunk = fileData.mid(offset, chunkSize);
-            packet.append((char)(isLast ? OBEX_HDR_END_OF_BODY : OBEX_HDR_BODY));
-            writeUInt16BE(packet, chunk.size() + 3);
-            packet.append(chunk);
-            
-            // Длина пакета
-            quint16 totalLength = packet.size();
-            packet[1] = (totalLength >> 8) & 0xFF;
-            packet[2] = totalLength & 0xFF;
-            
-            logger->debug("OBEX", QString("Отправка пакета %1 (%2 байт)...").arg(packetNum).arg(packet.size()));
-            
-            if (!sendObexPacket(packet)) {
-                logger->error("OBEX", QString("Ошибка отправки пакета %1").arg(packetNum));
+        if (isLast) {
+            // Последний пакет - ждем SUCCESS
+            if (responseCode != OBEX_RSP_SUCCESS) {
+                logger->error("OBEX", QString("OBEX PUT отклонен: 0x%1").arg(responseCode, 2, 16, QChar('0')));
+                if (responseCode == OBEX_RSP_FORBIDDEN) {
+                    logger->warning("OBEX", "Пользователь ОТКЛОНИЛ файл на телефоне");
+                }
                 return false;
             }
-            
-            // Ждем ответ
-            QByteArray response = receiveObexResponse();
-            
-            if (response.isEmpty()) {
-                logger->error("OBEX", QString("Нет ответа на пакет %1").arg(packetNum));
+            logger->success("OBEX", "✓ OBEX PUT FINAL SUCCESS!");
+        } else {
+            // Промежуточный пакет - ждем CONTINUE
+            if (responseCode != OBEX_RSP_CONTINUE && responseCode != OBEX_RSP_SUCCESS) {
+                logger->error("OBEX", QString("Ошибка на пакете %1: 0x%2").arg(packetNum).arg(responseCode, 2, 16, QChar('0')));
+                if (responseCode == OBEX_RSP_FORBIDDEN) {
+                    logger->warning("OBEX", "Пользователь ОТКЛОНИЛ файл на телефоне");
+                }
                 return false;
             }
-            
-            unsigned char responseCode = (unsigned char)response[0];
-            
-            if (isLast) {
-                // Последний пакет - ждем SUCCESS
-                if (responseCode != OBEX_RSP_SUCCESS) {
-                    logger->error("OBEX", QString("OBEX PUT отклонен: 0x%1").arg(responseCode, 2, 16, QChar('0')));
-                    return false;
-                }
-                logger->success("OBEX", "✓ OBEX PUT FINAL SUCCESS!");
+            logger->debug("OBEX", QString("✓ Пакет %1 принят (0x%2)").arg(packetNum).arg(responseCode, 2, 16, QChar('0')));
+        }
+        
+        if (!response.parseHeaders()) {
+            logger->warning("OBEX", QString("Заголовки ответа: %1").arg(response.errorString()));
+        }
+        
+        if (packetNum == 1) {
+            logger->info("OBEX", QString("Файл принят на телефоне через %1 с")
+                .arg(acceptTimer.elapsed() / 1000.0, 0, 'f', 2));
+            firstChunkSize = chunkSize;
+            timer.start();
+        }
+        
+        // Ответ на первый пакет решает, включен ли SRM; если нет - обычный
+        // режим с ответом на каждый пакет
+        if (packetNum == 1 && srmRequested) {
+            const ObexHeader *srm = response.findHeader(OBEX_HDR_SRM);
+            srmActive = (srm && srm->toByte() == OBEX_SRM_ENABLE);
+            if (srmActive) {
+                logger->success("OBEX", "✓ Single Response Mode включен: пакеты идут без ожидания ответа");
             } else {
-                // Промежуточный пакет - ждем CONTINUE
-                if (responseCode != OBEX_RSP_CONTINUE && responseCode != OBEX_RSP_SUCCESS) {
-                    logger->error("OBEX", QString("Ошибка на пакете %1: 0x%2").arg(packetNum).arg(responseCode, 2, 16, QChar('0')));
-                    return false;
-                }
-                logger->debug("OBEX", QString("✓ Пакет %1 принят (0x%2)").arg(packetNum).arg(responseCode, 2, 16, QChar('0')));
+                logger->info("OBEX", "Сервер не поддерживает SRM - ожидание ответа на каждый пакет");
             }
-            
-            offset += chunkSize;
-            
-            // Прогресс
-            emit transferProgress(offset, fileData.size());
         }
         
-        logger->success("OBEX", "");
-        logger->success("OBEX", "✓ Все пакеты отправлены успешно!");
-        logger->success("OBEX", "Файл принят телефоном!");
-        logger->success("OBEX", "");
+        // SRMP wait: перед следующим пакетом снова дождаться ответа
+        if (srmActive) {
+            const ObexHeader *srmp = response.findHeader(OBEX_HDR_SRMP);
+            srmWait = (srmp && srmp->toByte() == OBEX_SRMP_WAIT);
+            if (srmWait) {
+                logger->debug("OBEX", "Сервер просит подождать ответа (SRMP wait)");
+            }
+        }
+        
+        offset += chunkSize;
         
-        return true;
+        // Прогресс
+        emit transferProgress(offset, fileSize);
+    } while (offset < fileSize);
+    
+    // Данные первого пакета ушли до подтверждения и в скорость не входят
+    qint64 measuredBytes = fileSize - firstChunkSize;
+    double seconds = qMax<qint64>(timer.elapsed(), 1) / 1000.0;
+    
+    logger->success("OBEX", "");
+    logger->success("OBEX", "✓ Все пакеты отправлены успешно!");
+    logger->success("OBEX", "Файл принят телефоном!");
+    if (measuredBytes > 0) {
+        logger->success("OBEX", QString("Скорость: %1 KB/s (%2 байт за %3 с, пакетов: %4 по %5 байт, SRM: %6)")
+            .arg(measuredBytes / 1024.0 / seconds, 0, 'f', 1)
+            .arg(measuredBytes)
+            .arg(seconds, 0, 'f', 2)
+            .arg(packetNum)
+            .arg(maxPacketLength)
+            .arg(srmActive ? "да" : "нет"));
     }
+    logger->success("OBEX", "");
+    
+    return true;
 }
 
 bool ObexFileSender::obexDisconnect()
@@ -683,97 +557,101 @@ bool ObexFileSender::obexDisconnect()
 
 bool ObexFileSender::sendObexPacket(const QByteArray &packet)
 {
-    if (obexSocket == INVALID_SOCKET) {
+    if (!transport || !transport->isOpen()) {
         return false;
     }
     
     logger->logApiCall("send", QString("OBEX пакет, размер=%1").arg(packet.size()));
     
-    int sent = ::send(obexSocket, packet.constData(), packet.size(), 0);
-    
-    if (sent == SOCKET_ERROR) {
-        QString error = getLastSocketError();
-        logger->logApiResult("send", QString("FAILED - %1").arg(error), false);
+    // Большой пакет может уйти по частям, а при заполненном буфере
+    // отправки транспорт ждет готовности соединения
+    if (!transport->sendAll(packet.constData(), packet.size(), SEND_TIMEOUT_MS)) {
+        logger->logApiResult("send", QString("FAILED - %1").arg(transport->lastError()), false);
         return false;
     }
     
-    logger->logApiResult("send", QString("SUCCESS - %1 байт").arg(sent), true);
+    logger->logApiResult("send", QString("SUCCESS - %1 байт").arg(packet.size()), true);
     
-    return (sent == packet.size());
+    return true;
 }
 
-QByteArray ObexFileSender::receiveObexResponse()
+bool ObexFileSender::receiveObexResponse()
 {
-    if (obexSocket == INVALID_SOCKET) {
-        return QByteArray();
+    if (!transport || !transport->isOpen()) {
+        return false;
     }
     
-    // Ждем данных с таймаутом
-    char buffer[1024];
-    int totalReceived = 0;
-    int attempts = 0;
-    const int maxAttempts = 300;  // 30 секунд (300 * 100ms) - больше времени для телефона
-    
     logger->debug("OBEX", "Ожидание ответа от телефона...");
     
-    while (attempts < maxAttempts) {
-        int received = ::recv(obexSocket, buffer + totalReceived, sizeof(buffer) - totalReceived, 0);
+    // Ответ может прийти по частям, а может вместе со следующим - парсер
+    // собирает пакеты в своем буфере и выдает их по одному
+    QElapsedTimer timer;
+    timer.start();
+    qint64 lastLog = 0;
+    
+    while (true) {
+        ObexFrameParser::Status status = response.next();
         
-        if (received == SOCKET_ERROR) {
-            int error = WSAGetLastError();
-            if (error == WSAEWOULDBLOCK) {
-                // Нет данных пока - ждем
-                Sleep(100);
-                attempts++;
-                
-                // Логируем каждые 5 секунд
-                if (attempts % 50 == 0) {
-                    logger->debug("OBEX", QString("Ожидание... (%1 сек)").arg(attempts / 10));
-                }
-                continue;
-            }
+        if (status == ObexFrameParser::FrameReady) {
+            logger->debug("OBEX", QString("Response Code: 0x%1").arg(response.code(), 2, 16, QChar('0')));
+            logger->success("OBEX", QString("✓ Получен полный ответ (%1 байт)").arg(response.frameLength()));
             
-            logger->error("OBEX", QString("Ошибка recv: %1").arg(error));
-            return QByteArray();
+            // Проверяем response code
+            unsigned char responseCode = response.code();
+            if (responseCode == OBEX_RSP_SUCCESS) {
+                logger->success("OBEX", "✓ Response: SUCCESS (0xA0)");
+            } else if (responseCode == OBEX_RSP_CONTINUE) {
+                logger->info("OBEX", "→ Response: CONTINUE (0x90)");
+            } else if (responseCode == OBEX_RSP_FORBIDDEN) {
+                logger->warning("OBEX", "⚠ Response: FORBIDDEN (0xC3) - Файл отклонен пользователем");
+            } else {
+                logger->warning("OBEX", QString("⚠ Response: 0x%1").arg(responseCode, 2, 16, QChar('0')));
+            }
+            return true;
         }
         
-        if (received > 0) {
-            totalReceived += received;
-            logger->debug("OBEX", QString("Получено %1 байт ответа (всего: %2)").arg(received).arg(totalReceived));
-            
-            // Логируем первые байты для отладки
-            if (totalReceived >= 1) {
-                logger->debug("OBEX", QString("Response Code: 0x%1").arg((unsigned char)buffer[0], 2, 16, QChar('0')));
+        if (status == ObexFrameParser::InvalidFrame) {
+            logger->error("OBEX", response.errorString());
+            return false;
+        }
+        
+        // Прием прямо в буфер парсера
+        char *buffer = response.receiveBuffer(RESPONSE_CHUNK_SIZE);
+        int received = transport->receive(buffer, response.receiveSpace());
+        
+        if (received == ByteTransport::WouldBlock) {
+            // Нет данных пока - ждем их появления, а не опрашиваем
+            qint64 remaining = RESPONSE_TIMEOUT_MS - timer.elapsed();
+            if (remaining <= 0) {
+                break;
             }
-            
-            // Проверяем что получили полный ответ (минимум 3 байта: opcode + length)
-            if (totalReceived >= 3) {
-                quint16 packetLength = ((unsigned char)buffer[1] << 8) | (unsigned char)buffer[2];
-                logger->debug("OBEX", QString("Ожидаемая длина пакета: %1 байт").arg(packetLength));
-                
-                if (totalReceived >= packetLength) {
-                    logger->success("OBEX", QString("✓ Получен полный ответ (%1 байт)").arg(packetLength));
-                    
-                    // Проверяем response code
-                    unsigned char responseCode = (unsigned char)buffer[0];
-                    if (responseCode == OBEX_RSP_SUCCESS) {
-                        logger->success("OBEX", "✓ Response: SUCCESS (0xA0)");
-                    } else if (responseCode == OBEX_RSP_CONTINUE) {
-                        logger->info("OBEX", "→ Response: CONTINUE (0x90)");
-                    } else if (responseCode == OBEX_RSP_FORBIDDEN) {
-                        logger->warning("OBEX", "⚠ Response: FORBIDDEN (0xC3) - Файл отклонен пользователем");
-                    } else {
-                        logger->warning("OBEX", QString("⚠ Response: 0x%1").arg(responseCode, 2, 16, QChar('0')));
-                    }
-                    
-                    return QByteArray(buffer, packetLength);
+            if (!transport->waitForReadable(qMin<qint64>(remaining, 5000))) {
+                // Логируем каждые 5 секунд
+                qint64 elapsed = timer.elapsed();
+                if (elapsed - lastLog >= 5000) {
+                    lastLog = elapsed;
+                    logger->debug("OBEX", QString("Ожидание... (%1 сек)").arg(elapsed / 1000));
                 }
             }
+            continue;
         }
+        
+        if (received < 0) {
+            logger->error("OBEX", QString("Ошибка recv: %1").arg(transport->lastError()));
+            return false;
+        }
+        
+        if (received == 0) {
+            logger->error("OBEX", "Соединение закрыто другой стороной");
+            return false;
+        }
+        
+        response.commit(received);
+        logger->debug("OBEX", QString("Получено %1 байт ответа").arg(received));
     }
     
     logger->warning("OBEX", "Таймаут ожидания ответа");
-    return QByteArray();
+    return false;
 }
 
 QByteArray ObexFileSender::buildConnectPacket()
@@ -794,8 +672,7 @@ QByteArray ObexFileSender::buildConnectPacket()
     packet.append((char)0x00);
     
     // Max packet length (0xFFFF = 65535)
-    packet.append((char)0xFF);
-    packet.append((char)0xFF);
+    writeUInt16BE(packet, OBEX_MAX_PACKET_LENGTH);
     
     // Обновляем длину пакета
     quint16 totalLength = packet.size();
@@ -805,11 +682,47 @@ QByteArray ObexFileSender::buildConnectPacket()
     return packet;
 }
 
-QByteArray ObexFileSender::buildPutPacket(const QString &fileName, qint64 fileSize, bool final)
+void ObexFileSender::buildPutPacket(QByteArray &packet, const QString &fileName, qint64 fileSize, bool firstPacket)
 {
-    // Эта функция используется для построения PUT пакета
-    // Но основную логику мы сделали в obexPut()
-    return QByteArray();
+    // Начало PUT пакета до заголовка Body. resize(0) сохраняет выделенную
+    // память (буфер зарезервирован через reserve), пакет собирается заново
+    packet.resize(0);
+    
+    // Opcode: PUT. Будет ли пакет последним, зависит от размера Body,
+    // который известен только после сборки заголовков, - тогда obexPut
+    // меняет opcode на PUT FINAL
+    packet.append((char)OBEX_PUT);
+    
+    // Packet Length (будет заполнено позже)
+    packet.append((char)0x00);
+    packet.append((char)0x00);
+    
+    // Connection ID header (если есть)
+    if (connectionId != 0) {
+        packet.append((char)OBEX_HDR_CONNECTION);
+        writeUInt32BE(packet, connectionId);
+    }
+    
+    // Name и Length только в первом пакете
+    if (firstPacket) {
+        QByteArray nameUnicode = encodeUnicode(fileName);
+        packet.append((char)OBEX_HDR_NAME);
+        writeUInt16BE(packet, nameUnicode.size() + 3);
+        packet.append(nameUnicode);
+        
+        // Length - 4 байта; размер файла больше 4 ГБ не указывается
+        if (fileSize <= 0xFFFFFFFFLL) {
+            packet.append((char)OBEX_HDR_LENGTH);
+            writeUInt32BE(packet, (quint32)fileSize);
+        }
+        
+        // Запрос Single Response Mode; сервер без поддержки SRM
+        // пропускает незнакомый заголовок
+        if (srmRequested) {
+            packet.append((char)OBEX_HDR_SRM);
+            packet.append((char)OBEX_SRM_ENABLE);
+        }
+    }
 }
 
 QByteArray ObexFileSender::buildDisconnectPacket()
@@ -857,20 +770,3 @@ QByteArray ObexFileSender::encodeUnicode(const QString &str)
     
     return result;
 }
-
-QString ObexFileSender::getLastSocketError()
-{
-    int error = WSAGetLastError();
-    
-    switch (error) {
-    case WSAETIMEDOUT:
-        return QString("WSAETIMEDOUT (%1): Таймаут подключения").arg(error);
-    case WSAECONNREFUSED:
-        return QString("WSAECONNREFUSED (%1): Подключение отклонено").arg(error);
-    case WSAEWOULDBLOCK:
-        return QString("WSAEWOULDBLOCK (%1): Операция заблокирована").arg(error);
-    default:
-        return QString("WSA Error %1").arg(error);
-    }
-}
-
@@ -3,12 +3,11 @@
 
 #include <QObject>
 #include <QString>
-#include <winsock2.h>
-#include <ws2bth.h>
-#include <BluetoothAPIs.h>
-#include <bthdef.h>  // Для системного RFCOMM_PROTOCOL_UUID
+#include "bytetransport.h"
+#include "obexframeparser.h"
 
 class BluetoothLogger;
+class QFile;
 
 // OBEX OpCodes
 #define OBEX_CONNECT    0x80
@@ -26,6 +25,11 @@ class BluetoothLogger;
 #define OBEX_RSP_FORBIDDEN       0xC3  // 195 - Forbidden
 #define OBEX_RSP_NOT_FOUND       0xC4  // 196 - Not Found
 
+// OBEX Maximum Packet Length: минимум, который обязан принимать любой
+// OBEX сервер, и наибольший возможный (16-битное поле длины)
+#define OBEX_MIN_PACKET_LENGTH 255
+#define OBEX_MAX_PACKET_LENGTH 0xFFFF
+
 // OBEX Header IDs
 #define OBEX_HDR_NAME        0x01  // Unicode text (null terminated)
 #define OBEX_HDR_TYPE        0x42  // Byte sequence (ASCII)
@@ -33,12 +37,14 @@ class BluetoothLogger;
 #define OBEX_HDR_BODY        0x48  // Byte sequence
 #define OBEX_HDR_END_OF_BODY 0x49  // Byte sequence (final)
 #define OBEX_HDR_CONNECTION  0xCB  // 4-byte connection ID
+#define OBEX_HDR_SRM         0x97  // 1-byte Single Response Mode (OBEX 1.4)
+#define OBEX_HDR_SRMP        0x98  // 1-byte SRM Parameters
 
-// OBEX FTP Service UUID
-static const GUID OBEX_PUSH_SERVICE_UUID = 
-    { 0x00001105, 0x0000, 0x1000, { 0x80, 0x00, 0x00, 0x80, 0x5F, 0x9B, 0x34, 0xFB } };
+// Значения заголовков SRM и SRMP
+#define OBEX_SRM_ENABLE      0x01  // Включить SRM / SRM включен
+#define OBEX_SRMP_WAIT       0x01  // Ждать ответа перед следующим запросом
 
-// RFCOMM Protocol UUID для ПК-ПК передачи (используем системный RFCOMM_PROTOCOL_UUID)
+// UUID сервисов OBEX Object Push и RFCOMM - см. RfcommTransport::Service
 
 // Класс для прямой отправки файлов через OBEX протокол
 class ObexFileSender : public QObject
@@ -55,6 +61,15 @@ public:
     // Отправка файла через RFCOMM напрямую на компьютер
     bool sendFileViaRfcomm(const QString &filePath, const QString &deviceAddress, const QString &deviceName);
     
+    // Те же протоколы поверх уже установленного соединения: Bluetooth,
+    // TCP или пара сокетов в одном процессе (см. obex_loopback)
+    bool sendFileOverObex(const QString &filePath, ByteTransport *transport);
+    bool sendFileRaw(const QString &filePath, ByteTransport *transport);
+    
+    // Single Response Mode: запрашивать у сервера потоковую передачу PUT
+    // без ответа на каждый пакет (по умолчанию включено)
+    void setSingleResponseMode(bool enabled) { srmRequested = enabled; }
+    
 signals:
     void transferStarted(const QString &fileName);
     void transferProgress(qint64 bytesSent, qint64 totalBytes);
@@ -63,37 +78,32 @@ signals:
     
 private:
     BluetoothLogger *logger;
-    SOCKET obexSocket;
+    ByteTransport *transport;  // Соединение текущей передачи (не владеет)
     bool connected;
     quint32 connectionId;
-    
-    // Парсинг MAC адреса
-    bool parseMacAddress(const QString &address, BLUETOOTH_ADDRESS &btAddr);
-    
-    // Инициализация Winsock
-    bool initWinsock();
-    void cleanupWinsock();
+    quint16 maxPacketLength;  // Согласованный в CONNECT размер пакета
+    bool srmRequested;        // Запрашивать SRM в первом пакете PUT
+    ObexFrameParser response; // Прием и разбор ответов сервера
     
     // OBEX протокол
     bool obexConnect();
-    bool obexPut(const QString &fileName, const QByteArray &fileData);
+    bool obexPut(const QString &fileName, QFile &file);
     bool obexDisconnect();
     
     // Отправка/прием OBEX пакетов
     bool sendObexPacket(const QByteArray &packet);
-    QByteArray receiveObexResponse();
+    // Ответ сервера: true - в response готов очередной пакет
+    bool receiveObexResponse();
     
     // Формирование OBEX пакетов
     QByteArray buildConnectPacket();
-    QByteArray buildPutPacket(const QString &fileName, qint64 fileSize, bool final = false);
+    void buildPutPacket(QByteArray &packet, const QString &fileName, qint64 fileSize, bool firstPacket);
     QByteArray buildDisconnectPacket();
     
     // Вспомогательные функции
     void writeUInt16BE(QByteArray &data, quint16 value);  // Big-endian 16-bit
     void writeUInt32BE(QByteArray &data, quint32 value);  // Big-endian 32-bit
     QByteArray encodeUnicode(const QString &str);
-    
-    QString getLastSocketError();
 };
 
 #endif // OBEXFILESENDER_H
@@ -0,0 +1,159 @@
+#include "obexframeparser.h"
+#include <cstring>
+
+// Начальный размер буфера: ответы OBEX обычно укладываются в несколько байт
+static const int INITIAL_BUFFER_SIZE = 4096;
+
+// Заголовков в одном пакете обычно немного; память под них не освобождается
+static const int RESERVED_HEADERS = 16;
+
+quint32 ObexHeader::toUInt32() const
+{
+    if (size < 4) return 0;
+    return ((quint32)(quint8)data[0] << 24) |
+           ((quint32)(quint8)data[1] << 16) |
+           ((quint32)(quint8)data[2] << 8) |
+           ((quint32)(quint8)data[3]);
+}
+
+ObexFrameParser::ObexFrameParser(int maxFrameLength)
+    : begin(0)
+    , end(0)
+    , frameSize(0)
+    , maxFrameLength(qBound(3, maxFrameLength, (int)MaxFrameLength))
+    , invalid(false)
+{
+    // reserve() - чтобы resize(0) не освобождал память
+    headers.reserve(RESERVED_HEADERS);
+}
+
+void ObexFrameParser::reset()
+{
+    begin = 0;
+    end = 0;
+    frameSize = 0;
+    invalid = false;
+    headers.resize(0);
+    error.clear();
+}
+
+void ObexFrameParser::dropFrame()
+{
+    begin += frameSize;
+    frameSize = 0;
+    headers.resize(0);
+    
+    // Все данные разобраны - следующий прием снова с начала буфера
+    if (begin == end) {
+        begin = 0;
+        end = 0;
+    }
+}
+
+char *ObexFrameParser::receiveBuffer(int minSpace)
+{
+    dropFrame();
+    
+    if (buffer.size() - end < minSpace) {
+        // Сначала место освобождается сдвигом остатка (начало следующего
+        // пакета - не больше одного пакета), и только потом буфер растет
+        int pending = end - begin;
+        if (begin > 0) {
+            memmove(buffer.data(), buffer.constData() + begin, pending);
+            begin = 0;
+            end = pending;
+        }
+        if (buffer.size() - end < minSpace) {
+            int newSize = qMax(qMax(INITIAL_BUFFER_SIZE, buffer.size() * 2), end + minSpace);
+            buffer.resize(newSize);
+        }
+    }
+    return buffer.data() + end;
+}
+
+void ObexFrameParser::commit(int bytes)
+{
+    end += qBound(0, bytes, buffer.size() - end);
+}
+
+void ObexFrameParser::append(const char *data, int size)
+{
+    if (size <= 0) return;
+    memcpy(receiveBuffer(size), data, size);
+    commit(size);
+}
+
+ObexFrameParser::Status ObexFrameParser::next()
+{
+    if (invalid) return InvalidFrame;
+    
+    dropFrame();
+    
+    // Код и длина: 3 байта
+    int available = end - begin;
+    if (available < 3) return NeedMoreData;
+    
+    const char *frame = buffer.constData() + begin;
+    int length = ((quint8)frame[1] << 8) | (quint8)frame[2];
+    if (length < 3 || length > maxFrameLength) {
+        invalid = true;
+        error = QString("Неверная длина OBEX пакета: %1 (код 0x%2)")
+            .arg(length).arg((quint8)frame[0], 2, 16, QChar('0'));
+        return InvalidFrame;
+    }
+    if (available < length) return NeedMoreData;
+    
+    frameSize = length;
+    return FrameReady;
+}
+
+bool ObexFrameParser::parseHeaders(int offset)
+{
+    headers.resize(0);
+    if (frameSize == 0) return false;
+    
+    const char *frame = buffer.constData() + begin;
+    int pos = offset;
+    while (pos < frameSize) {
+        ObexHeader header;
+        header.id = (quint8)frame[pos];
+        int length;
+        int valueOffset;
+        switch (header.encoding()) {
+        case ObexHeader::Byte:
+            length = 2;
+            valueOffset = 1;
+            break;
+        case ObexHeader::UInt32:
+            length = 5;
+            valueOffset = 1;
+            break;
+        default:
+            if (pos + 3 > frameSize) {
+                error = QString("Заголовок 0x%1 обрезан").arg(header.id, 2, 16, QChar('0'));
+                return false;
+            }
+            length = ((quint8)frame[pos + 1] << 8) | (quint8)frame[pos + 2];
+            valueOffset = 3;
+            break;
+        }
+        if (length < valueOffset || pos + length > frameSize) {
+            error = QString("Неверная длина заголовка 0x%1: %2")
+                .arg(header.id, 2, 16, QChar('0')).arg(length);
+            return false;
+        }
+        header.data = frame + pos + valueOffset;
+        header.size = length - valueOffset;
+        headers.append(header);
+        pos += length;
+    }
+    return true;
+}
+
+const ObexHeader *ObexFrameParser::findHeader(quint8 id) const
+{
+    for (int i = 0; i < headers.size(); ++i) {
+        if (headers[i].id == id) return &headers[i];
+    }
+    return nullptr;
+}
@@ -0,0 +1,93 @@
+#ifndef OBEXFRAMEPARSER_H
+#define OBEXFRAMEPARSER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// Заголовок OBEX пакета. Значение не копируется: data указывает в буфер
+// ObexFrameParser и действительно, пока не вызван next() или receiveBuffer()
+struct ObexHeader
+{
+    // Формат значения задают старшие 2 бита ID
+    enum Encoding {
+        Unicode = 0x00,     // UTF-16 BE с завершающим нулем, 2 байта длины
+        Bytes   = 0x40,     // Последовательность байт, 2 байта длины
+        Byte    = 0x80,     // 1 байт
+        UInt32  = 0xC0      // 4 байта, big-endian
+    };
+    
+    quint8 id;
+    const char *data;   // Значение без ID и поля длины
+    int size;
+    
+    Encoding encoding() const { return Encoding(id & 0xC0); }
+    quint8 toByte() const { return size > 0 ? (quint8)data[0] : 0; }
+    quint32 toUInt32() const;
+};
+
+// Разбор потока OBEX пакетов по мере приема. Данные принимаются прямо в
+// буфер парсера (receiveBuffer/commit); пакет, пришедший по частям,
+// собирается в нем же, а несколько пакетов из одного приема выдаются
+// по очереди. Буфер растет до размера пакета и дальше переиспользуется
+class ObexFrameParser
+{
+public:
+    enum Status {
+        NeedMoreData,   // Пакет еще не принят целиком
+        FrameReady,     // Следующий пакет готов: code(), frameData()
+        InvalidFrame    // Неверная длина пакета, поток рассинхронизирован
+    };
+    
+    enum {
+        MaxFrameLength = 0xFFFF     // Поле длины OBEX - 16 бит
+    };
+    
+    explicit ObexFrameParser(int maxFrameLength = MaxFrameLength);
+    
+    // Место под прием не меньше minSpace байт после принятых данных.
+    // Текущий пакет отбрасывается (необработанные данные могут сдвинуться)
+    char *receiveBuffer(int minSpace);
+    int receiveSpace() const { return buffer.size() - end; }
+    // Принято bytes байт в receiveBuffer()
+    void commit(int bytes);
+    // То же с копированием (данные уже в памяти)
+    void append(const char *data, int size);
+    
+    // Следующий пакет из принятых данных; предыдущий отбрасывается
+    Status next();
+    
+    // Текущий пакет после FrameReady: код операции или ответа, длина
+    // и данные целиком (с кодом и длиной)
+    quint8 code() const { return (quint8)buffer[begin]; }
+    int frameLength() const { return frameSize; }
+    const char *frameData() const { return buffer.constData() + begin; }
+    
+    // Разбор заголовков текущего пакета, начиная с offset: 3 - сразу
+    // после кода и длины, 7 - для CONNECT (версия, флаги, размер пакета).
+    // false - заголовок выходит за границу пакета (заголовки до него
+    // остаются доступны)
+    bool parseHeaders(int offset = 3);
+    int headerCount() const { return headers.size(); }
+    const ObexHeader &header(int index) const { return headers[index]; }
+    const ObexHeader *findHeader(quint8 id) const;
+    
+    // Принято, но еще не выдано пакетами
+    int pendingBytes() const { return end - begin - frameSize; }
+    QString errorString() const { return error; }
+    void reset();
+    
+private:
+    void dropFrame();
+    
+    QByteArray buffer;
+    int begin;          // Начало текущего пакета / необработанных данных
+    int end;            // Конец принятых данных
+    int frameSize;      // Длина текущего пакета, 0 - пакета нет
+    int maxFrameLength;
+    bool invalid;
+    QVector<ObexHeader> headers;
+    QString error;
+};
+
+#endif // OBEXFRAMEPARSER_H